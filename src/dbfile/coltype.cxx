@@ -9,8 +9,11 @@ module;
 
 #include <cstdint>
 #ifndef IMPORT_STD
+#include <array>
+#include <cstring>
 #include <functional>
 #include <optional>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <variant>
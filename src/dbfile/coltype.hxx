@@ -10,8 +10,11 @@
 #include "tinydb_export.h"
 #ifndef ENABLE_MODULES
 #include "dbfile/internal/heap_base.hxx"
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <optional>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #endif // !ENABLE_MODULES
@@ -40,9 +43,149 @@ enum TINYDB_EXPORT class ColType : char {
   Uint64,
   Float32,
   Float64,
+  // Arbitrary-length string. Short ones live inside the row, long ones in the
+  // heap. See TextSlot.
   Text,
+  // Fixed-length strings of up to N bytes, always stored inside the row.
+  // Shorter strings are padded with zeros.
+  Char8,
+  Char16,
+  Char32,
+  Char64,
 };
 
+/**
+ * @class FixedText
+ * @brief The value of a `CharN` column: up to N bytes, zero-padded.
+ */
+template <std::size_t N> struct FixedText {
+  std::array<char, N> data{};
+
+  /**
+   * @return The fixed-length string, or nullopt if `t_str` is longer than N.
+   */
+  static constexpr auto from(std::string_view t_str)
+      -> std::optional<FixedText> {
+    if (t_str.size() > N) {
+      return std::nullopt;
+    }
+    FixedText ret{};
+    t_str.copy(ret.data.data(), t_str.size());
+    return ret;
+  }
+
+  [[nodiscard]] constexpr auto view() const noexcept -> std::string_view {
+    std::size_t len{0};
+    while (len < N && data[len] != '\0') {
+      ++len;
+    }
+    return {data.data(), len};
+  }
+
+  constexpr auto operator==(const FixedText&) const -> bool = default;
+};
+
+/**
+ * @class TextSlot
+ * @brief The in-row part of a Text value. Strings of up to `INLINE_CAP`
+ * bytes are stored right here, so reading them costs no extra page access.
+ * Longer ones spill into the heap, and the slot keeps a pointer to them.
+ *
+ * Inline format:
+ * - offset 0: 1 byte, the length (0 to INLINE_CAP).
+ * - offset 1: the string.
+ *
+ * Spilled format:
+ * - offset 0: 1 byte, `SPILLED`.
+ * - offset 1: 4 bytes, the length.
+ * - offset 5: 6 bytes, pointer to the first heap fragment holding the string.
+ * - offset 11: the first PREFIX_LEN bytes of the string, so that most
+ *   comparisons don't need to follow the pointer.
+ */
+struct TINYDB_EXPORT TextSlot {
+  static constexpr std::size_t SIZE = 16;
+  static constexpr std::size_t INLINE_CAP = SIZE - 1;
+  static constexpr unsigned char SPILLED = 0xFF;
+  static constexpr std::size_t LEN_OFF = 1;
+  static constexpr std::size_t PTR_OFF = LEN_OFF + sizeof(uint32_t);
+  static constexpr std::size_t PREFIX_OFF = PTR_OFF + internal::Ptr::SIZE;
+  static constexpr std::size_t PREFIX_LEN = SIZE - PREFIX_OFF;
+
+  std::array<char, SIZE> bytes{};
+
+  /**
+   * @return The inline slot, or nullopt if `t_str` must be spilled.
+   */
+  static constexpr auto make_inline(std::string_view t_str)
+      -> std::optional<TextSlot> {
+    if (t_str.size() > INLINE_CAP) {
+      return std::nullopt;
+    }
+    TextSlot ret{};
+    ret.bytes[0] = static_cast<char>(t_str.size());
+    t_str.copy(ret.bytes.data() + 1, t_str.size());
+    return ret;
+  }
+
+  /**
+   * @brief A slot for a string already written into the heap.
+   *
+   * @param t_str The whole string; only its prefix is kept.
+   * @param t_ptr Where it was written.
+   */
+  static auto make_spilled(std::string_view t_str, internal::Ptr t_ptr)
+      -> TextSlot {
+    TextSlot ret{};
+    ret.bytes[0] = static_cast<char>(SPILLED);
+    auto len = static_cast<uint32_t>(t_str.size());
+    std::memcpy(ret.bytes.data() + LEN_OFF, &len, sizeof(len));
+    std::memcpy(ret.bytes.data() + PTR_OFF, &t_ptr.pagenum,
+                sizeof(t_ptr.pagenum));
+    std::memcpy(ret.bytes.data() + PTR_OFF + sizeof(t_ptr.pagenum),
+                &t_ptr.offset, sizeof(t_ptr.offset));
+    t_str.copy(ret.bytes.data() + PREFIX_OFF, PREFIX_LEN);
+    return ret;
+  }
+
+  [[nodiscard]] constexpr auto is_inline() const noexcept -> bool {
+    return static_cast<unsigned char>(bytes[0]) != SPILLED;
+  }
+
+  [[nodiscard]] auto size() const noexcept -> std::size_t {
+    if (is_inline()) {
+      return static_cast<unsigned char>(bytes[0]);
+    }
+    uint32_t len{0};
+    std::memcpy(&len, bytes.data() + LEN_OFF, sizeof(len));
+    return len;
+  }
+
+  /**
+   * @return The string itself if inline, otherwise the prefix kept in the
+   * slot.
+   */
+  [[nodiscard]] auto prefix() const noexcept -> std::string_view {
+    if (is_inline()) {
+      return {bytes.data() + 1, size()};
+    }
+    return {bytes.data() + PREFIX_OFF, PREFIX_LEN};
+  }
+
+  /**
+   * @return Where a spilled string lives. Only valid if `!is_inline()`.
+   */
+  [[nodiscard]] auto spilled_ptr() const noexcept -> internal::Ptr {
+    internal::Ptr ret{};
+    std::memcpy(&ret.pagenum, bytes.data() + PTR_OFF, sizeof(ret.pagenum));
+    std::memcpy(&ret.offset, bytes.data() + PTR_OFF + sizeof(ret.pagenum),
+                sizeof(ret.offset));
+    return ret;
+  }
+
+  auto operator==(const TextSlot&) const -> bool = default;
+};
+static_assert(sizeof(TextSlot) == TextSlot::SIZE);
+
 using coltype_num_t = std::underlying_type_t<ColType>;
 
 /**
@@ -69,13 +212,67 @@ constexpr TINYDB_EXPORT auto type_size(ColType t_type) -> uint8_t {
   case Float64:
     return sizeof(double);
   case Text:
-    return internal::Ptr::SIZE;
+    return TextSlot::SIZE;
+  case Char8:
+    return 8;
+  case Char16:
+    return 16;
+  case Char32:
+    return 32;
+  case Char64:
+    return 64;
     // the more type we have, the more we need to add.
   default:
     std::unreachable();
   }
 }
 
+/**
+ * @return Whether the specified type holds a string.
+ */
+constexpr TINYDB_EXPORT auto is_text(ColType t_type) -> bool {
+  return t_type >= ColType::Text;
+}
+
+/**
+ * @return The alignment a value of the specified type wants inside a row.
+ * Numeric types align to their own size; strings are just bytes.
+ * @param t_type The specified type.
+ */
+constexpr TINYDB_EXPORT auto type_align(ColType t_type) -> uint8_t {
+  if (is_text(t_type)) {
+    return 1;
+  }
+  return type_size(t_type);
+}
+
+/**
+ * @brief The C++ type a value of column type `T` is stored as.
+ */
+template <ColType T> struct native_type;
+template <> struct native_type<ColType::Int8> { using type = int8_t; };
+template <> struct native_type<ColType::Uint8> { using type = uint8_t; };
+template <> struct native_type<ColType::Int16> { using type = int16_t; };
+template <> struct native_type<ColType::Uint16> { using type = uint16_t; };
+template <> struct native_type<ColType::Int32> { using type = int32_t; };
+template <> struct native_type<ColType::Uint32> { using type = uint32_t; };
+template <> struct native_type<ColType::Int64> { using type = int64_t; };
+template <> struct native_type<ColType::Uint64> { using type = uint64_t; };
+template <> struct native_type<ColType::Float32> { using type = float; };
+template <> struct native_type<ColType::Float64> { using type = double; };
+template <> struct native_type<ColType::Text> { using type = TextSlot; };
+template <> struct native_type<ColType::Char8> { using type = FixedText<8>; };
+template <> struct native_type<ColType::Char16> {
+  using type = FixedText<16>;
+};
+template <> struct native_type<ColType::Char32> {
+  using type = FixedText<32>;
+};
+template <> struct native_type<ColType::Char64> {
+  using type = FixedText<64>;
+};
+template <ColType T> using native_t = typename native_type<T>::type;
+
 /**
  * @param t_type The ColType passed in.
  * @return The type id of the specified column type.
@@ -91,7 +288,7 @@ constexpr TINYDB_EXPORT auto type_id(const ColType& t_type) -> coltype_num_t {
  * @return The appropriate column type.
  */
 constexpr TINYDB_EXPORT auto type_of(coltype_num_t t_num) -> std::optional<ColType> {
-  if (t_num >= 0 && t_num <= static_cast<coltype_num_t>(ColType::Text)) {
+  if (t_num >= 0 && t_num <= static_cast<coltype_num_t>(ColType::Char64)) {
     return static_cast<ColType>(t_num);
   }
   return std::nullopt;
@@ -8,52 +8,143 @@ module;
 
 #include "version.hxx"
 #ifndef IMPORT_STD
+#include <algorithm>
 #include <bit>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
 #endif
 export module tinydb.dbfile;
 export import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.catalog;
 import tinydb.dbfile.internal.page;
 import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.header;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page_cache;
 import tinydb.dbfile.internal.tbl;
 #ifdef IMPORT_STD
 import std;
 #endif // IMPORT_STD
 #else
 #include "version.hxx"
+#include <algorithm>
 #include <bit>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
 #endif // ENABLE_MODULES
 
 #include "dbfile/dbfile.hxx"
 
 namespace tinydb::dbfile {
 
+namespace {
+/**
+ * @brief The header of a database with no table yet: the first page is all
+ * metadata, the freelist starts right after it.
+ */
+void write_empty_header(std::iostream& t_io) {
+  internal::write_header(
+      internal::FileHeader{.m_major = tinydb::VERSION_MAJOR,
+                           .m_minor = tinydb::VERSION_MINOR,
+                           .m_patch = tinydb::VERSION_PATCH,
+                           .m_n_pages = 2,
+                           .m_freelist = 1,
+                           .m_heap = internal::NULL_PAGE,
+                           .m_catalog = internal::NULL_PAGE},
+      t_io);
+}
+
+/**
+ * @return How many arenas the heap gets: one per hardware thread.
+ */
+auto n_arenas() -> std::size_t {
+  return std::max(std::thread::hardware_concurrency(), 1U);
+}
+} // namespace
+
 void DbFile::write_init() {
-  m_rw->seekp(0);
-  // version.
-  m_rw->rdbuf()->sputn(std::bit_cast<const char*>(&tinydb::VERSION_MAJOR),
-                       sizeof(tinydb::VERSION_MAJOR));
-  m_rw->rdbuf()->sputn(std::bit_cast<const char*>(&tinydb::VERSION_MINOR),
-                       sizeof(tinydb::VERSION_MINOR));
-  m_rw->rdbuf()->sputn(std::bit_cast<const char*>(&tinydb::VERSION_PATCH),
-                       sizeof(tinydb::VERSION_PATCH));
-  // dbfile size. The first page is all metadata.
-  constexpr uint32_t initial_size = 1;
-  m_rw->rdbuf()->sputn(std::bit_cast<const char*>(&initial_size),
-                       sizeof(initial_size));
-  m_freelist.do_write_to(*m_rw);
-  m_tbl.write_to(*m_rw);
-}
-
-auto DbFile::construct_from(std::unique_ptr<std::iostream> t_io) -> DbFile {
-  auto freelist = internal::FreeList::construct_from(*t_io);
-  auto tbl = internal::TableMeta::read_from(*t_io);
-  return DbFile{std::move(tbl), std::move(freelist), std::move(t_io)};
+  const std::scoped_lock lock{*m_latch};
+  m_freelist = internal::FreeList::default_init(1, *m_rw);
+  // no table yet, no heap page either.
+  m_catalog = internal::SchemaCatalog{};
+  m_heap = internal::Heap::with_arenas(n_arenas());
+  write_empty_header(*m_rw);
+}
+
+auto DbFile::create(std::unique_ptr<std::iostream> t_io,
+                    internal::PageCompression t_compression) -> DbFile {
+  auto cache =
+      std::make_unique<internal::PageCache>(std::move(t_io), t_compression);
+  auto rw = std::make_unique<std::iostream>(cache.get());
+  auto freelist = internal::FreeList::default_init(1, *rw);
+  write_empty_header(*rw);
+  return DbFile{internal::SchemaCatalog{}, freelist,
+                internal::Heap::with_arenas(n_arenas()), std::move(cache),
+                std::move(rw)};
+}
+
+auto DbFile::construct_from(std::unique_ptr<std::iostream> t_io,
+                            internal::PageCompression t_compression)
+    -> DbFile {
+  auto cache =
+      std::make_unique<internal::PageCache>(std::move(t_io), t_compression);
+  auto rw = std::make_unique<std::iostream>(cache.get());
+  // page 0, which the freelist is read from too, then the heap's pages.
+  auto header = internal::read_header(*rw);
+  auto freelist = internal::FreeList::construct_from(*rw);
+  auto heap = internal::read_heap_from(*rw, n_arenas());
+  // tables are only read once they're used.
+  return DbFile{internal::SchemaCatalog{header.m_catalog}, freelist,
+                std::move(heap), std::move(cache), std::move(rw)};
+}
+
+DbFile::~DbFile() {
+  // moved from.
+  if (m_rw == nullptr) {
+    return;
+  }
+  const std::scoped_lock lock{*m_latch};
+  m_heap.write_heap_to(*m_rw);
+}
+
+void DbFile::flush() {
+  const std::scoped_lock lock{*m_latch};
+  m_heap.write_heap_to(*m_rw);
+  m_rw->flush();
+}
+
+auto DbFile::add_table(internal::TableMeta t_tbl) -> bool {
+  const std::scoped_lock lock{*m_latch};
+  if (!m_catalog.add_table(std::move(t_tbl), *m_rw)) {
+    return false;
+  }
+  m_catalog.write_to(m_freelist, *m_rw);
+  return true;
+}
+
+auto DbFile::find_table(std::string_view t_name)
+    -> const internal::TableMeta* {
+  const std::scoped_lock lock{*m_latch};
+  return m_catalog.find_table(t_name, *m_rw);
+}
+
+auto DbFile::table_names() -> std::vector<std::string_view> {
+  const std::scoped_lock lock{*m_latch};
+  return m_catalog.table_names(*m_rw);
+}
+
+auto DbFile::open_stream() const -> std::unique_ptr<std::iostream> {
+  return std::make_unique<internal::PageStream>(m_cache->pool());
 }
 
 } // namespace tinydb::dbfile
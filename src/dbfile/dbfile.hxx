@@ -19,10 +19,17 @@
 #include "tinydb_export.h"
 #ifndef ENABLE_MODULES
 #include "dbfile/coltype.hxx"
+#include "dbfile/internal/catalog.hxx"
 #include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/header.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_cache.hxx"
 #include "dbfile/internal/tbl.hxx"
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
 #endif // !ENABLE_MODULES
 
 #ifdef ENABLE_MODULES
@@ -35,20 +42,61 @@ namespace tinydb::dbfile {
  * @class DbFile
  * @brief The database file itself.
  *
- * Once a database file is created, one can NOT modify its columns.
+ * A file holds any number of tables, listed in its catalog (see
+ * internal/catalog). Once a table is created, one can NOT modify its
+ * columns.
+ *
+ * A DbFile can be shared between threads. Its own functions take a latch
+ * around the catalog; whatever reads or writes pages from another thread
+ * does it through a stream of its own, from `open_stream`. Pages are shared
+ * by all of those streams (see internal/page_cache), and each page is
+ * latched while it's read or written.
+ *
+ * Its heap has an arena per hardware thread, so threads writing text or row
+ * versions into it at the same time don't wait on each other.
  */
 class TINYDB_EXPORT DbFile {
 public:
   /**
    * @brief Read the stream passed in and constructs a database file.
-   * Note, with the current implementation, there is no checking whether the
-   * file is valid.
-   * Since the bottleneck is the I/O anyways, extensive checking could
-   * technically be implemented.
+   * Only the header is read, and checked (see internal/header); the catalog
+   * is read on first use.
    *
    * @param t_io The stream.
+   * @param t_compression Whether heap, B+ tree leaf and column pages are
+   * compressed when they are written back into `t_io`. Compressed and
+   * uncompressed pages can be read back either way.
+   * @throw std::ios_base::failure if the header is corrupted, or from
+   * another major version.
+   */
+  static auto construct_from(std::unique_ptr<std::iostream> t_io,
+                             internal::PageCompression t_compression =
+                                 internal::PageCompression::None) -> DbFile;
+
+  /**
+   * @brief Formats the stream passed in as an empty database file, see
+   * `write_init`.
+   */
+  static auto create(std::unique_ptr<std::iostream> t_io,
+                     internal::PageCompression t_compression =
+                         internal::PageCompression::None) -> DbFile;
+
+  DbFile(DbFile&&) noexcept = default;
+  auto operator=(DbFile&&) noexcept -> DbFile& = default;
+  DbFile(const DbFile&) = delete;
+  auto operator=(const DbFile&) -> DbFile& = delete;
+  /**
+   * @brief Links the heap's chains into the file, see `flush`.
+   */
+  ~DbFile();
+
+  /**
+   * @brief Writes every page modified so far back into the stream, once
+   * the heap's chains are linked into the file (see internal/heap).
+   * Also done automatically when the DbFile is destroyed, since the page
+   * cache flushes itself on destruction.
    */
-  static auto construct_from(std::unique_ptr<std::iostream> t_io) -> DbFile;
+  void flush();
 
   /**
    * @brief Writes the database metadata into the stream it was assigned to.
@@ -58,23 +106,61 @@ public:
   void write_init();
 
   /**
-   * @return The name of the current key.
-   *
-   * If no key was set, it returns a nullopt.
+   * @brief Adds a table, written to the catalog right away.
+   * @return false if there's already a table or an index of that name.
+   */
+  auto add_table(internal::TableMeta t_tbl) -> bool;
+
+  /**
+   * @return The table of that name, or nullptr if there isn't one. Its
+   * definition is only read the first time it's asked for. Valid until
+   * `write_init`: adding tables, from any thread, doesn't move it.
+   */
+  auto find_table(std::string_view t_name) -> const internal::TableMeta*;
+
+  /**
+   * @return The names of every table, in order, valid as long as the tables
+   * from `find_table` are.
+   */
+  auto table_names() -> std::vector<std::string_view>;
+
+  /**
+   * @brief A new stream over the file, for one more thread to read and write
+   * pages with. It sees every page written through the DbFile or any other
+   * stream it opened, and may outlive the DbFile.
+   */
+  [[nodiscard]] auto open_stream() const -> std::unique_ptr<std::iostream>;
+
+  /**
+   * @brief The heap whatever spills out of rows (text, row versions) is
+   * written into, from any thread, each with a stream from `open_stream`.
+   * Valid until `write_init`.
+   */
+  [[nodiscard]] auto heap() noexcept -> internal::Heap& { return m_heap; }
+
+  /**
+   * @brief Where `heap` and tables take their new pages from. Thread-safe.
    */
-  [[nodiscard]] auto get_key() const -> std::optional<std::string_view>;
+  [[nodiscard]] auto freelist() noexcept -> internal::FreeList& {
+    return m_freelist;
+  }
 
 private:
-  template <class T1, class T2>
-    requires std::is_same_v<T1, internal::TableMeta> &&
-                 std::is_same_v<T2, internal::FreeList>
-  DbFile(T1&& t_tbl, T2&& t_fl, std::unique_ptr<std::iostream> t_io)
-      : m_tbl{std::forward<T1>(t_tbl)}, m_rw{std::move(t_io)},
-        m_freelist{std::forward<T2>(t_fl)} {}
-  internal::TableMeta m_tbl;
+  DbFile(internal::SchemaCatalog t_catalog, internal::FreeList t_fl,
+         internal::Heap t_heap, std::unique_ptr<internal::PageCache> t_cache,
+         std::unique_ptr<std::iostream> t_io)
+      : m_catalog{std::move(t_catalog)}, m_cache{std::move(t_cache)},
+        m_rw{std::move(t_io)}, m_freelist{t_fl}, m_heap{std::move(t_heap)} {}
+  // held by every function reading or writing through `m_rw`. Boxed, so a
+  // DbFile can still be moved around.
+  std::unique_ptr<std::mutex> m_latch{std::make_unique<std::mutex>()};
+  internal::SchemaCatalog m_catalog;
+  // every read and write goes through the cache. `m_rw` is merely a stream
+  // wrapped around it.
+  std::unique_ptr<internal::PageCache> m_cache;
   std::unique_ptr<std::iostream> m_rw;
   internal::FreeList m_freelist;
-  // for now there's no need for heap yet.
+  internal::Heap m_heap;
 };
 
 } // namespace tinydb::dbfile
@@ -0,0 +1,161 @@
+/**
+ * @file async.cxx
+ * @brief Definitions for async.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include <cassert>
+#ifndef IMPORT_STD
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.async;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.mvcc;
+import tinydb.dbfile.internal.page_cache;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/mvcc.hxx"
+#include "dbfile/internal/page_cache.hxx"
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/async.hxx"
+
+namespace tinydb::dbfile::internal {
+
+EventLoop::EventLoop(std::size_t t_n_threads) {
+  assert(t_n_threads > 0);
+  m_threads.reserve(t_n_threads);
+  for (std::size_t i = 0; i < t_n_threads; ++i) {
+    m_threads.emplace_back([this] { work(); });
+  }
+}
+
+EventLoop::~EventLoop() {
+  {
+    const std::scoped_lock lock{m_mutex};
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void EventLoop::post(std::coroutine_handle<> t_handle) {
+  {
+    const std::scoped_lock lock{m_mutex};
+    m_ready.push_back(t_handle);
+  }
+  m_cv.notify_one();
+}
+
+void EventLoop::work() {
+  for (;;) {
+    std::coroutine_handle<> handle;
+    {
+      std::unique_lock lock{m_mutex};
+      m_cv.wait(lock, [this] { return m_stop || !m_ready.empty(); });
+      if (m_ready.empty()) {
+        return;
+      }
+      handle = m_ready.front();
+      m_ready.pop_front();
+    }
+    handle.resume();
+  }
+}
+
+auto AsyncTable::get(const Snapshot& t_snap, row_id_t t_id,
+                     std::span<char> t_row) -> Task<bool> {
+  PageStream io{m_pool};
+  io.cache().set_cached_only(true);
+  auto found = m_tbl.read(t_snap, t_id, io, t_row);
+  if (!io.cache().missed()) {
+    co_return found;
+  }
+  // whatever was read past the missing page is garbage. Read again from a
+  // thread of the loop, which may wait on the file.
+  m_n_waits.fetch_add(1, std::memory_order_relaxed);
+  co_await m_loop.schedule();
+  io.clear();
+  io.cache().set_cached_only(false);
+  co_return m_tbl.read(t_snap, t_id, io, t_row);
+}
+
+auto AsyncTable::insert(const Snapshot& t_snap, std::span<const char> t_row)
+    -> Task<row_id_t> {
+  co_await m_loop.schedule();
+  PageStream io{m_pool};
+  co_return m_tbl.insert(t_snap, t_row, m_heap, m_fl, io);
+}
+
+auto AsyncTable::update(const Snapshot& t_snap, row_id_t t_id,
+                        std::span<const char> t_row) -> Task<WriteResult> {
+  co_await m_loop.schedule();
+  PageStream io{m_pool};
+  co_return m_tbl.update(t_snap, t_id, t_row, m_heap, m_fl, io);
+}
+
+auto AsyncTable::erase(const Snapshot& t_snap, row_id_t t_id)
+    -> Task<WriteResult> {
+  co_await m_loop.schedule();
+  PageStream io{m_pool};
+  co_return m_tbl.erase(t_snap, t_id, io);
+}
+
+auto AsyncTable::abort(txn_id_t t_txn) -> Task<void> {
+  co_await m_loop.schedule();
+  PageStream io{m_pool};
+  m_tbl.abort(t_txn, m_heap, m_fl, io);
+}
+
+auto AsyncTable::cursor(Snapshot t_snap) -> AsyncCursor {
+  return AsyncCursor{*this, std::move(t_snap)};
+}
+
+auto AsyncCursor::next() -> Task<bool> {
+  while (m_next < m_tbl->n_row_ids()) {
+    auto id = m_next++;
+    if (co_await m_tbl->get(m_snap, id, m_row)) {
+      m_id = id;
+      co_return true;
+    }
+  }
+  co_return false;
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,375 @@
+/**
+ * @file async.hxx
+ * @brief Declares coroutine versions of the row operations of a table: an
+ * event loop to run them on, the `Task` they return, and the table itself.
+ *
+ * A read runs right away, on whichever thread awaits it, as long as every
+ * page it needs is cached. The first page that isn't makes it suspend, and
+ * start over on a thread of the event loop, which reads whatever pages are
+ * missing from the file. So a thread awaiting reads never blocks on the
+ * file, and one whose pages are cached never waits on the loop at all.
+ *
+ * A write can't stop halfway through to wait for a page, then start over,
+ * so writes always run on the event loop, where blocking on the file only
+ * holds up that loop thread.
+ *
+ * The loop is a pool of threads rather than io_uring: page reads go through
+ * the PagePool, which reads from any `std::iostream`, not a file descriptor.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_ASYNC_HXX
+#define TINYDB_DBFILE_INTERNAL_ASYNC_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/mvcc.hxx"
+#include "dbfile/internal/page_cache.hxx"
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+template <typename T> class Task;
+
+namespace detail {
+
+template <typename T> struct TaskPromiseBase {
+  // whoever awaits the task, resumed once it's done.
+  std::coroutine_handle<> m_continuation{std::noop_coroutine()};
+  std::exception_ptr m_error{};
+
+  struct FinalAwaiter {
+    [[nodiscard]] auto await_ready() const noexcept -> bool { return false; }
+    template <typename Promise>
+    auto await_suspend(std::coroutine_handle<Promise> t_self) noexcept
+        -> std::coroutine_handle<> {
+      return t_self.promise().m_continuation;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+  auto final_suspend() noexcept -> FinalAwaiter { return {}; }
+  void unhandled_exception() noexcept { m_error = std::current_exception(); }
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase<T> {
+  std::optional<T> m_value{};
+
+  auto get_return_object() -> Task<T>;
+  void return_value(T t_value) { m_value.emplace(std::move(t_value)); }
+  auto result() -> T {
+    if (this->m_error) {
+      std::rethrow_exception(this->m_error);
+    }
+    return std::move(*m_value);
+  }
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase<void> {
+  auto get_return_object() -> Task<void>;
+  void return_void() noexcept {}
+  void result() const {
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+};
+
+} // namespace detail
+
+/**
+ * @class Task
+ * @brief A coroutine returning a `T`, started once it's awaited, and
+ * resuming whoever awaited it when it's done. Exceptions are rethrown to
+ * the awaiter.
+ *
+ * Like any lazy coroutine, the arguments it takes by reference must outlive
+ * it: await it right away.
+ */
+template <typename T> class [[nodiscard]] Task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+
+  Task(const Task&) = delete;
+  Task(Task&& t_other) noexcept
+      : m_handle{std::exchange(t_other.m_handle, nullptr)} {}
+  auto operator=(const Task&) -> Task& = delete;
+  auto operator=(Task&& t_other) noexcept -> Task& {
+    if (this != &t_other) {
+      if (m_handle) {
+        m_handle.destroy();
+      }
+      m_handle = std::exchange(t_other.m_handle, nullptr);
+    }
+    return *this;
+  }
+  ~Task() {
+    if (m_handle) {
+      m_handle.destroy();
+    }
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> m_handle;
+
+      [[nodiscard]] auto await_ready() const noexcept -> bool {
+        return false;
+      }
+      auto await_suspend(std::coroutine_handle<> t_awaiter) noexcept
+          -> std::coroutine_handle<> {
+        m_handle.promise().m_continuation = t_awaiter;
+        return m_handle;
+      }
+      auto await_resume() -> T { return m_handle.promise().result(); }
+    };
+    return Awaiter{m_handle};
+  }
+
+private:
+  friend promise_type;
+  explicit Task(std::coroutine_handle<promise_type> t_handle)
+      : m_handle{t_handle} {}
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+
+template <typename T> auto TaskPromise<T>::get_return_object() -> Task<T> {
+  return Task<T>{std::coroutine_handle<TaskPromise>::from_promise(*this)};
+}
+
+inline auto TaskPromise<void>::get_return_object() -> Task<void> {
+  return Task<void>{std::coroutine_handle<TaskPromise>::from_promise(*this)};
+}
+
+/**
+ * @brief Runs as soon as it's called, and frees itself once it's done.
+ */
+struct Detached {
+  struct promise_type {
+    auto get_return_object() noexcept -> Detached { return {}; }
+    auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+    auto final_suspend() noexcept -> std::suspend_never { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+} // namespace detail
+
+/**
+ * @brief Runs a task to completion, blocking the calling thread (which must
+ * not be a thread of the loop the task runs on) until then.
+ */
+template <typename T> auto sync_wait(Task<T> t_task) -> T {
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done{false};
+  std::exception_ptr error{};
+  using Result = std::conditional_t<std::is_void_v<T>, bool, T>;
+  std::optional<Result> result{};
+
+  [](Task<T> t_inner, std::mutex& t_mutex, std::condition_variable& t_cv,
+     bool& t_done, std::exception_ptr& t_error,
+     std::optional<Result>& t_result) -> detail::Detached {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(t_inner);
+        t_result.emplace(true);
+      } else {
+        t_result.emplace(co_await std::move(t_inner));
+      }
+    } catch (...) {
+      t_error = std::current_exception();
+    }
+    // notified under the lock: the waiter can't go away before we're done.
+    const std::scoped_lock lock{t_mutex};
+    t_done = true;
+    t_cv.notify_one();
+  }(std::move(t_task), mutex, done_cv, done, error, result);
+
+  std::unique_lock lock{mutex};
+  done_cv.wait(lock, [&] { return done; });
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*result);
+  }
+}
+
+/**
+ * @class EventLoop
+ * @brief Threads resuming coroutines, in the order they were scheduled.
+ *
+ * Every coroutine scheduled must be done before the loop is destroyed.
+ */
+class TINYDB_EXPORT EventLoop {
+public:
+  /**
+   * @param t_n_threads At least 1.
+   */
+  explicit EventLoop(std::size_t t_n_threads);
+  EventLoop(const EventLoop&) = delete;
+  EventLoop(EventLoop&&) = delete;
+  auto operator=(const EventLoop&) -> EventLoop& = delete;
+  auto operator=(EventLoop&&) -> EventLoop& = delete;
+  ~EventLoop();
+
+  /**
+   * @return Something to `co_await` to carry on on a thread of the loop.
+   */
+  [[nodiscard]] auto schedule() noexcept {
+    struct Awaiter {
+      EventLoop* m_loop;
+
+      [[nodiscard]] auto await_ready() const noexcept -> bool {
+        return false;
+      }
+      void await_suspend(std::coroutine_handle<> t_handle) {
+        m_loop->post(t_handle);
+      }
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{this};
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::coroutine_handle<>> m_ready;
+  bool m_stop{false};
+  std::vector<std::thread> m_threads;
+
+  void post(std::coroutine_handle<> t_handle);
+  void work();
+};
+
+class AsyncCursor;
+
+/**
+ * @class AsyncTable
+ * @brief A VersionedTable, with the Heap and FreeList it writes into, whose
+ * rows are read and written by coroutines, from any thread.
+ *
+ * There's no latch of its own: readers go straight to the VersionedTable,
+ * which takes turns between writers by itself. Snapshots and rows passed in
+ * must outlive the task.
+ */
+class TINYDB_EXPORT AsyncTable {
+public:
+  AsyncTable(VersionedTable& t_tbl, Heap& t_heap, FreeList& t_fl,
+             std::shared_ptr<PagePool> t_pool, EventLoop& t_loop)
+      : m_tbl{t_tbl}, m_heap{t_heap}, m_fl{t_fl}, m_pool{std::move(t_pool)},
+        m_loop{t_loop} {}
+
+  [[nodiscard]] auto row_size() const noexcept -> EntrySiz {
+    return m_tbl.row_size();
+  }
+
+  [[nodiscard]] auto n_row_ids() const -> std::size_t {
+    return m_tbl.n_row_ids();
+  }
+
+  /**
+   * @brief Reads the version of a row `t_snap` sees, see
+   * `VersionedTable::read`.
+   */
+  auto get(const Snapshot& t_snap, row_id_t t_id, std::span<char> t_row)
+      -> Task<bool>;
+
+  auto insert(const Snapshot& t_snap, std::span<const char> t_row)
+      -> Task<row_id_t>;
+  auto update(const Snapshot& t_snap, row_id_t t_id,
+              std::span<const char> t_row) -> Task<WriteResult>;
+  auto erase(const Snapshot& t_snap, row_id_t t_id) -> Task<WriteResult>;
+  auto abort(txn_id_t t_txn) -> Task<void>;
+
+  /**
+   * @brief Doesn't touch any page, so there's nothing to await.
+   */
+  void commit(txn_id_t t_txn) { m_tbl.commit(t_txn); }
+
+  /**
+   * @brief Every row `t_snap` sees, in ID order. Rows inserted while the
+   * cursor moves may or may not show up, as long as `t_snap` sees them.
+   */
+  [[nodiscard]] auto cursor(Snapshot t_snap) -> AsyncCursor;
+
+  /**
+   * @return How many times a read had to wait for a page so far.
+   */
+  [[nodiscard]] auto n_waits() const noexcept -> std::size_t {
+    return m_n_waits.load(std::memory_order_relaxed);
+  }
+
+private:
+  VersionedTable& m_tbl;
+  Heap& m_heap;
+  FreeList& m_fl;
+  std::shared_ptr<PagePool> m_pool;
+  EventLoop& m_loop;
+  std::atomic<std::size_t> m_n_waits{0};
+};
+
+/**
+ * @class AsyncCursor
+ * @brief Goes through the rows of an AsyncTable, one `co_await next()` at a
+ * time.
+ */
+class TINYDB_EXPORT AsyncCursor {
+public:
+  AsyncCursor(AsyncTable& t_tbl, Snapshot t_snap)
+      : m_tbl{&t_tbl}, m_snap{std::move(t_snap)}, m_row(t_tbl.row_size()) {}
+
+  /**
+   * @brief Moves to the next row.
+   * @return false once there's none left.
+   */
+  auto next() -> Task<bool>;
+
+  /**
+   * @return The ID of the current row.
+   */
+  [[nodiscard]] auto id() const noexcept -> row_id_t { return m_id; }
+
+  /**
+   * @return The current row, valid until `next` is called again.
+   */
+  [[nodiscard]] auto row() const noexcept -> std::span<const char> {
+    return m_row;
+  }
+
+private:
+  AsyncTable* m_tbl;
+  Snapshot m_snap;
+  row_id_t m_next{0};
+  row_id_t m_id{0};
+  std::vector<char> m_row;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_ASYNC_HXX
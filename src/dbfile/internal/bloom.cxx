@@ -0,0 +1,218 @@
+/**
+ * @file bloom.cxx
+ * @brief Definitions for bloom.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#include <climits>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.bloom;
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.page;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/bloom.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+static_assert(sizeof(BloomFilter::Block) == BloomFilter::BLOCK_SIZE);
+static_assert(BloomFilter::BLOCKS_PER_PAGE == 63);
+
+// odd constants, one per lane, so that each lane picks its bit from a
+// different mix of the same 32 bits of hash.
+constexpr std::array<uint32_t, BloomFilter::LANES> SALTS{
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+// keeps the top 6 bits of a 32-bit product: a bit inside a 64-bit lane.
+constexpr unsigned LANE_SHIFT = 32 - 6;
+
+constexpr std::array<char, sizeof(double)> ZEROS{};
+
+constexpr uint64_t HASH_MUL = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * @brief The finalizer of MurmurHash3: every input bit ends up affecting
+ * every output bit.
+ */
+constexpr auto fmix(uint64_t t_k) -> uint64_t {
+  t_k ^= t_k >> 33U;
+  t_k *= 0xff51afd7ed558ccdULL;
+  t_k ^= t_k >> 33U;
+  t_k *= 0xc4ceb9fe1a85ec53ULL;
+  t_k ^= t_k >> 33U;
+  return t_k;
+}
+
+/**
+ * @return The bit each lane of a block must have set for this hash.
+ */
+auto lane_masks(uint64_t t_hash) -> BloomFilter::Block {
+  BloomFilter::Block ret{};
+  const auto low = static_cast<uint32_t>(t_hash);
+  for (std::size_t i = 0; i < BloomFilter::LANES; ++i) {
+    ret.lanes[i] = uint64_t{1}
+                   << (static_cast<uint32_t>(low * SALTS[i]) >> LANE_SHIFT);
+  }
+  return ret;
+}
+
+auto block_pos(page_ptr_t t_pg, std::size_t t_slot) -> std::streamoff {
+  return (static_cast<std::streamoff>(t_pg) * SIZEOF_PAGE) +
+         static_cast<std::streamoff>(BloomPageMeta::BLOCKS_OFF +
+                                     (t_slot * BloomFilter::BLOCK_SIZE));
+}
+
+} // namespace
+
+BloomFilter::BloomFilter(std::size_t t_capacity)
+    : BloomFilter{std::vector<Block>(
+          std::max<std::size_t>(
+              1, ((t_capacity * BITS_PER_KEY) + (BLOCK_SIZE * CHAR_BIT) - 1) /
+                     (BLOCK_SIZE * CHAR_BIT)),
+          Block{})} {
+  // nothing was ever written: every block must be on the first write.
+  std::ranges::fill(m_dirty, 1);
+}
+
+auto BloomFilter::read_from(page_ptr_t t_first, std::istream& t_in)
+    -> BloomFilter {
+  std::vector<Block> blocks;
+  std::vector<page_ptr_t> pages;
+  for (auto pg = t_first; pg != NULL_PAGE;) {
+    auto meta = internal::read_from<BloomPageMeta>(pg, t_in);
+    pages.push_back(pg);
+    auto first = blocks.size();
+    blocks.resize(first + meta.get_n_blocks());
+    t_in.seekg(block_pos(pg, 0));
+    t_in.rdbuf()->sgetn(
+        std::bit_cast<char*>(blocks.data() + first),
+        static_cast<std::streamsize>(meta.get_n_blocks() * BLOCK_SIZE));
+    pg = meta.get_next_pg();
+  }
+  BloomFilter ret{std::move(blocks)};
+  ret.m_pages = std::move(pages);
+  return ret;
+}
+
+auto BloomFilter::hash(column::ColType t_type, std::string_view t_val)
+    -> uint64_t {
+  // -0.0 == 0.0, so they must hash the same.
+  if (t_type == column::ColType::Float32) {
+    float val{0};
+    std::memcpy(&val, t_val.data(), sizeof(val));
+    t_val = val == 0 ? std::string_view{ZEROS.data(), sizeof(val)} : t_val;
+  } else if (t_type == column::ColType::Float64) {
+    double val{0};
+    std::memcpy(&val, t_val.data(), sizeof(val));
+    t_val = val == 0 ? std::string_view{ZEROS.data(), sizeof(val)} : t_val;
+  }
+  uint64_t ret = HASH_MUL ^ t_val.size();
+  while (!t_val.empty()) {
+    uint64_t word{0};
+    auto len = std::min(t_val.size(), sizeof(word));
+    std::memcpy(&word, t_val.data(), len);
+    ret = (ret ^ fmix(word)) * HASH_MUL;
+    t_val.remove_prefix(len);
+  }
+  return fmix(ret);
+}
+
+auto BloomFilter::block_of(uint64_t t_hash) const -> std::size_t {
+  // the high 32 bits, scaled to the number of blocks, without a division.
+  return static_cast<std::size_t>(((t_hash >> 32U) * m_blocks.size()) >> 32U);
+}
+
+void BloomFilter::add(uint64_t t_hash) {
+  auto idx = block_of(t_hash);
+  auto masks = lane_masks(t_hash);
+  auto& block = m_blocks[idx];
+  for (std::size_t i = 0; i < LANES; ++i) {
+    block.lanes[i] |= masks.lanes[i];
+  }
+  m_dirty[idx] = 1;
+}
+
+auto BloomFilter::may_contain(uint64_t t_hash) const -> bool {
+  const auto& block = m_blocks[block_of(t_hash)];
+  auto masks = lane_masks(t_hash);
+  // no early exit: a fixed number of independent lanes vectorizes.
+  uint64_t missing{0};
+  for (std::size_t i = 0; i < LANES; ++i) {
+    missing |= masks.lanes[i] & ~block.lanes[i];
+  }
+  return missing == 0;
+}
+
+void BloomFilter::write_to(FreeList& t_fl, std::iostream& t_io) {
+  if (m_pages.empty()) {
+    const auto n_pages =
+        (m_blocks.size() + BLOCKS_PER_PAGE - 1) / BLOCKS_PER_PAGE;
+    for (std::size_t i = 0; i < n_pages; ++i) {
+      auto n_blocks = std::min(BLOCKS_PER_PAGE,
+                               m_blocks.size() - (i * BLOCKS_PER_PAGE));
+      auto meta = t_fl.allocate_page<BloomPageMeta>(
+          t_io, NULL_PAGE, static_cast<BloomPageMeta::n_blocks_t>(n_blocks));
+      if (!m_pages.empty()) {
+        auto prev = internal::read_from<BloomPageMeta>(m_pages.back(), t_io);
+        prev.update_next_pg(meta.get_pg_num());
+        internal::write_to(prev, t_io);
+      }
+      m_pages.push_back(meta.get_pg_num());
+    }
+  }
+  for (std::size_t i = 0; i < m_blocks.size(); ++i) {
+    if (m_dirty[i] == 0) {
+      continue;
+    }
+    t_io.seekp(block_pos(m_pages[i / BLOCKS_PER_PAGE], i % BLOCKS_PER_PAGE));
+    t_io.rdbuf()->sputn(std::bit_cast<const char*>(&m_blocks[i]), BLOCK_SIZE);
+    m_dirty[i] = 0;
+  }
+}
+
+void BloomFilter::free_pages(FreeList& t_fl, std::iostream& t_io) {
+  for (auto pg : m_pages) {
+    t_fl.deallocate_page(t_io, PageMixin{pg});
+  }
+  m_pages.clear();
+  std::ranges::fill(m_dirty, 1);
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,139 @@
+/**
+ * @file bloom.hxx
+ * @brief Declares blocked Bloom filters, for answering "is this key
+ * there?" without looking.
+ *
+ * A Bloom filter can say for sure that a key is absent, and only says
+ * "maybe" for keys that are present (and, rarely, for some that aren't). A
+ * lot of lookups are existence checks for keys that aren't there, and those
+ * end up costing a few hashes instead of reading pages.
+ *
+ * A plain Bloom filter sets its k bits anywhere in the filter, so a probe is
+ * k cache misses. A blocked one first picks one block, the size of a cache
+ * line, and sets all k bits inside it: one cache miss per probe. Each block
+ * is `LANES` 64-bit lanes, and a key sets exactly one bit per lane, so a
+ * probe is a handful of independent AND/compare on a whole block at once,
+ * which compilers turn into SIMD code. That's the "split block" layout, also
+ * used by Parquet.
+ *
+ * A filter is persisted in its own chain of pages, `BLOCKS_PER_PAGE` blocks
+ * per page. It can't grow: once it holds more keys than its capacity, the
+ * false positive rate climbs, and the owner should build a bigger one.
+ *
+ * Hashes are part of the file format, so they're computed by `hash` and not
+ * std::hash, which is free to change between standard libraries.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_BLOOM_HXX
+#define TINYDB_DBFILE_INTERNAL_BLOOM_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @class BloomFilter
+ * @brief A blocked Bloom filter over hashed keys.
+ */
+class TINYDB_EXPORT BloomFilter {
+public:
+  static constexpr std::size_t BLOCK_SIZE = 64;
+  static constexpr std::size_t LANES = BLOCK_SIZE / sizeof(uint64_t);
+  // about 1% of false positives with 8 bits set per key.
+  static constexpr std::size_t BITS_PER_KEY = 10;
+  static constexpr std::size_t BLOCKS_PER_PAGE =
+      (SIZEOF_PAGE - BloomPageMeta::BLOCKS_OFF) / BLOCK_SIZE;
+
+  struct alignas(BLOCK_SIZE) Block {
+    std::array<uint64_t, LANES> lanes;
+  };
+
+  /**
+   * @brief An empty filter, sized for `t_capacity` keys. Nothing is written
+   * until `write_to`.
+   */
+  explicit BloomFilter(std::size_t t_capacity);
+
+  /**
+   * @brief Reads a filter written by `write_to`.
+   */
+  static auto read_from(page_ptr_t t_first, std::istream& t_in)
+      -> BloomFilter;
+
+  /**
+   * @brief Hashes a non-NULL value of a column, given as its bytes (see
+   * `ColumnVector::bytes`). Values that compare equal hash the same.
+   */
+  [[nodiscard]] static auto hash(column::ColType t_type,
+                                 std::string_view t_val) -> uint64_t;
+
+  /**
+   * @return How many keys the filter is sized for.
+   */
+  [[nodiscard]] auto capacity() const noexcept -> std::size_t {
+    return m_blocks.size() * BLOCK_SIZE * CHAR_BIT / BITS_PER_KEY;
+  }
+
+  /**
+   * @return The first page of the filter, NULL_PAGE if it was never
+   * written.
+   */
+  [[nodiscard]] auto first_page() const noexcept -> page_ptr_t {
+    return m_pages.empty() ? NULL_PAGE : m_pages.front();
+  }
+
+  /**
+   * @param t_hash As returned by `hash`.
+   */
+  void add(uint64_t t_hash);
+
+  /**
+   * @param t_hash As returned by `hash`.
+   * @return false if the key was definitely never added.
+   */
+  [[nodiscard]] auto may_contain(uint64_t t_hash) const -> bool;
+
+  /**
+   * @brief Writes the blocks changed since the last call. Pages are
+   * allocated on the first call.
+   */
+  void write_to(FreeList& t_fl, std::iostream& t_io);
+
+  /**
+   * @brief Gives the filter's pages back to the free list. The filter
+   * itself stays usable in memory.
+   */
+  void free_pages(FreeList& t_fl, std::iostream& t_io);
+
+private:
+  explicit BloomFilter(std::vector<Block> t_blocks)
+      : m_blocks{std::move(t_blocks)}, m_dirty(m_blocks.size(), 0) {}
+
+  std::vector<Block> m_blocks;
+  // one byte per block, non-zero if it changed since the last write.
+  std::vector<uint8_t> m_dirty;
+  std::vector<page_ptr_t> m_pages;
+
+  [[nodiscard]] auto block_of(uint64_t t_hash) const -> std::size_t;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_BLOOM_HXX
@@ -0,0 +1,323 @@
+/**
+ * @file catalog.cxx
+ * @brief Definitions for catalog.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/offsets.hxx"
+#include "general/sizes.hxx"
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.catalog;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "general/offsets.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/catalog.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+auto data_pos(page_ptr_t t_pg) -> std::streamoff {
+  return (static_cast<std::streamoff>(t_pg) * SIZEOF_PAGE) +
+         CatalogPageMeta::DATA_OFF;
+}
+
+template <typename T> void put(std::string& t_out, const T& t_val) {
+  t_out.append(std::bit_cast<const char*>(&t_val), sizeof(T));
+}
+
+/**
+ * @brief Appends a string after its length, as a `Len`.
+ */
+template <typename Len>
+void put_string(std::string& t_out, std::string_view t_str) {
+  put(t_out, static_cast<Len>(t_str.size()));
+  t_out.append(t_str);
+}
+
+[[noreturn]] void corrupted() {
+  throw std::ios_base::failure("Corrupted catalog");
+}
+
+/**
+ * @brief Takes a `T` off the front of some bytes.
+ */
+template <typename T> auto get(std::string_view& t_in) -> T {
+  if (t_in.size() < sizeof(T)) {
+    corrupted();
+  }
+  T ret{};
+  std::copy_n(t_in.data(), sizeof(T), std::bit_cast<char*>(&ret));
+  t_in.remove_prefix(sizeof(T));
+  return ret;
+}
+
+/**
+ * @brief Takes a string written by `put_string` off the front of some bytes.
+ */
+template <typename Len> auto get_string(std::string_view& t_in) -> std::string {
+  auto len = get<Len>(t_in);
+  if (t_in.size() < len) {
+    corrupted();
+  }
+  std::string ret{t_in.substr(0, len)};
+  t_in.remove_prefix(len);
+  return ret;
+}
+
+// an index: its table, its column, then its root page.
+auto encode_index(const IndexDef& t_idx) -> std::string {
+  std::string ret;
+  put_string<uint16_t>(ret, t_idx.m_table);
+  put_string<uint16_t>(ret, t_idx.m_column);
+  put(ret, t_idx.m_root);
+  return ret;
+}
+
+auto decode_index(std::string t_name, std::string_view t_def) -> IndexDef {
+  auto table = get_string<uint16_t>(t_def);
+  auto column = get_string<uint16_t>(t_def);
+  auto root = get<page_ptr_t>(t_def);
+  if (!t_def.empty()) {
+    corrupted();
+  }
+  return IndexDef{.m_name{std::move(t_name)},
+                  .m_table{std::move(table)},
+                  .m_column{std::move(column)},
+                  .m_root = root};
+}
+
+} // namespace
+
+auto SchemaCatalog::construct_from(std::istream& t_in) -> SchemaCatalog {
+  page_ptr_t first{NULL_PAGE};
+  t_in.seekg(CATALOG_PTR_OFF);
+  t_in.rdbuf()->sgetn(std::bit_cast<char*>(&first), sizeof(first));
+  return SchemaCatalog{first};
+}
+
+void SchemaCatalog::load(std::istream& t_in) {
+  if (m_loaded) {
+    return;
+  }
+  m_loaded = true;
+  std::string bytes;
+  for (auto pg = m_first; pg != NULL_PAGE;) {
+    auto meta = internal::read_from<CatalogPageMeta>(pg, t_in);
+    // a page twice means the chain loops.
+    if (meta.get_n_bytes() > PAGE_BYTES ||
+        std::ranges::find(m_pages, pg) != m_pages.end()) {
+      corrupted();
+    }
+    m_pages.push_back(pg);
+    auto off = bytes.size();
+    bytes.resize(off + meta.get_n_bytes());
+    t_in.seekg(data_pos(pg));
+    t_in.rdbuf()->sgetn(bytes.data() + off, meta.get_n_bytes());
+    pg = meta.get_next_pg();
+  }
+  // each entry: its kind, its name, then its definition, after their
+  // lengths. Definitions of tables are left as they are.
+  std::string_view rest{bytes};
+  while (!rest.empty()) {
+    auto kind = static_cast<Kind>(get<uint8_t>(rest));
+    if (kind != Kind::Table && kind != Kind::Index) {
+      corrupted();
+    }
+    auto name = get_string<uint16_t>(rest);
+    auto def = get_string<uint32_t>(rest);
+    // each one is appended to the map, in constant time.
+    if (!m_entries.empty() && m_entries.rbegin()->first >= name) {
+      corrupted();
+    }
+    auto it = m_entries.emplace_hint(
+        m_entries.end(), std::move(name),
+        Entry{.kind = kind, .def{std::move(def)}, .table{}, .index{}});
+    if (kind == Kind::Index) {
+      it->second.index = decode_index(it->first, it->second.def);
+    }
+  }
+}
+
+auto SchemaCatalog::find(std::string_view t_name) -> Entry* {
+  auto it = m_entries.find(t_name);
+  return it == m_entries.end() ? nullptr : &it->second;
+}
+
+auto SchemaCatalog::table_of(Entry& t_entry) -> const TableMeta& {
+  if (!t_entry.table) {
+    t_entry.table = TableMeta::decode(t_entry.def);
+    ++m_n_decoded;
+  }
+  return *t_entry.table;
+}
+
+auto SchemaCatalog::table_names(std::istream& t_in)
+    -> std::vector<std::string_view> {
+  load(t_in);
+  std::vector<std::string_view> ret;
+  for (const auto& [name, entry] : m_entries) {
+    if (entry.kind == Kind::Table) {
+      ret.emplace_back(name);
+    }
+  }
+  return ret;
+}
+
+auto SchemaCatalog::find_table(std::string_view t_name, std::istream& t_in)
+    -> const TableMeta* {
+  load(t_in);
+  auto* entry = find(t_name);
+  if (entry == nullptr || entry->kind != Kind::Table) {
+    return nullptr;
+  }
+  return &table_of(*entry);
+}
+
+auto SchemaCatalog::find_index(std::string_view t_name, std::istream& t_in)
+    -> const IndexDef* {
+  load(t_in);
+  auto* entry = find(t_name);
+  if (entry == nullptr || entry->kind != Kind::Index) {
+    return nullptr;
+  }
+  return &*entry->index;
+}
+
+auto SchemaCatalog::indexes_of(std::string_view t_table, std::istream& t_in)
+    -> std::vector<const IndexDef*> {
+  load(t_in);
+  std::vector<const IndexDef*> ret;
+  for (const auto& [name, entry] : m_entries) {
+    if (entry.kind == Kind::Index && entry.index->m_table == t_table) {
+      ret.push_back(&*entry.index);
+    }
+  }
+  return ret;
+}
+
+auto SchemaCatalog::add_table(TableMeta t_tbl, std::istream& t_in) -> bool {
+  load(t_in);
+  if (find(t_tbl.get_name()) != nullptr) {
+    return false;
+  }
+  auto def = t_tbl.encode();
+  std::string name{t_tbl.get_name()};
+  m_entries.emplace(std::move(name), Entry{.kind = Kind::Table,
+                                           .def{std::move(def)},
+                                           .table{std::move(t_tbl)},
+                                           .index{}});
+  return true;
+}
+
+auto SchemaCatalog::add_index(IndexDef t_idx, std::istream& t_in) -> bool {
+  load(t_in);
+  if (find(t_idx.m_name) != nullptr) {
+    return false;
+  }
+  auto* tbl = find(t_idx.m_table);
+  if (tbl == nullptr || tbl->kind != Kind::Table ||
+      !table_of(*tbl).column_pos(t_idx.m_column)) {
+    return false;
+  }
+  auto def = encode_index(t_idx);
+  std::string name{t_idx.m_name};
+  m_entries.emplace(std::move(name), Entry{.kind = Kind::Index,
+                                           .def{std::move(def)},
+                                           .table{},
+                                           .index{std::move(t_idx)}});
+  return true;
+}
+
+auto SchemaCatalog::drop(std::string_view t_name, std::istream& t_in) -> bool {
+  load(t_in);
+  auto* entry = find(t_name);
+  if (entry == nullptr) {
+    return false;
+  }
+  const bool table = entry->kind == Kind::Table;
+  // a copy of the name: `t_name` may well be the one erased.
+  std::string name{t_name};
+  std::erase_if(m_entries, [&](const auto& t_kv) {
+    const auto& [key, other] = t_kv;
+    return key == name || (table && other.kind == Kind::Index &&
+                           other.index->m_table == name);
+  });
+  return true;
+}
+
+void SchemaCatalog::write_to(FreeList& t_fl, std::iostream& t_io) {
+  load(t_io);
+  std::string bytes;
+  for (const auto& [name, entry] : m_entries) {
+    put(bytes, static_cast<uint8_t>(entry.kind));
+    put_string<uint16_t>(bytes, name);
+    put_string<uint32_t>(bytes, entry.def);
+  }
+  const auto n_pages = (bytes.size() + PAGE_BYTES - 1) / PAGE_BYTES;
+  while (m_pages.size() < n_pages) {
+    m_pages.push_back(
+        t_fl.allocate_page<CatalogPageMeta>(t_io).get_pg_num());
+  }
+  while (m_pages.size() > n_pages) {
+    t_fl.deallocate_page(t_io, PageMixin{m_pages.back()});
+    m_pages.pop_back();
+  }
+  std::string_view rest{bytes};
+  for (std::size_t i = 0; i < m_pages.size(); ++i) {
+    auto chunk = rest.substr(0, PAGE_BYTES);
+    rest.remove_prefix(chunk.size());
+    auto next = i + 1 < m_pages.size() ? m_pages[i + 1] : NULL_PAGE;
+    internal::write_to(
+        CatalogPageMeta{m_pages[i], next,
+                        static_cast<CatalogPageMeta::n_bytes_t>(chunk.size())},
+        t_io);
+    t_io.seekp(data_pos(m_pages[i]));
+    t_io.rdbuf()->sputn(chunk.data(),
+                        static_cast<std::streamsize>(chunk.size()));
+  }
+  m_first = m_pages.empty() ? NULL_PAGE : m_pages.front();
+  t_io.seekp(CATALOG_PTR_OFF);
+  t_io.rdbuf()->sputn(std::bit_cast<const char*>(&m_first), sizeof(m_first));
+}
+
+} // namespace tinydb::dbfile::internal
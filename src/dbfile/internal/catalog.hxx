@@ -0,0 +1,176 @@
+/**
+ * @file catalog.hxx
+ * @brief Declares the catalog: the definitions of every table and index of a
+ * database file.
+ *
+ * The catalog is a system table of its own: a chain of Catalog pages, the
+ * first of which the header points to (at CATALOG_PTR_OFF), holding one
+ * entry per table or index, in name order. An entry is its kind, its name
+ * after its length, then its definition after its length. Tables and
+ * indexes share names.
+ *
+ * Nothing is read when a file is opened. The entries are read on first use,
+ * and only their names: the definition of a table is only decoded once that
+ * table is looked up. The catalog is written back whole whenever it changes,
+ * in the pages it already had.
+ *
+ * Every length is checked against what's left, so a corrupted catalog throws
+ * `std::ios_base::failure` where it's read instead of reading garbage.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_CATALOG_HXX
+#define TINYDB_DBFILE_INTERNAL_CATALOG_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "general/sizes.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @brief An index over one column of a table.
+ */
+struct TINYDB_EXPORT IndexDef {
+  std::string m_name;
+  std::string m_table;
+  std::string m_column;
+  // the first page of the index, NULL_PAGE until it's built.
+  page_ptr_t m_root;
+};
+
+/**
+ * @class SchemaCatalog
+ * @brief Tables and indexes of a database file, by name, read lazily.
+ *
+ * Every lookup takes the stream of the file, in case the entries haven't
+ * been read yet.
+ */
+class TINYDB_EXPORT SchemaCatalog {
+public:
+  static constexpr std::size_t PAGE_BYTES =
+      SIZEOF_PAGE - CatalogPageMeta::DATA_OFF;
+
+  /**
+   * @brief An empty catalog, in no page yet.
+   */
+  SchemaCatalog() = default;
+
+  /**
+   * @brief The catalog starting at that page, as the header says.
+   */
+  explicit SchemaCatalog(page_ptr_t t_first) : m_first{t_first} {}
+
+  /**
+   * @brief The catalog of a file. Only reads where it starts.
+   */
+  static auto construct_from(std::istream& t_in) -> SchemaCatalog;
+
+  [[nodiscard]] auto first_page() const noexcept -> page_ptr_t {
+    return m_first;
+  }
+
+  /**
+   * @return The names of every table, in order. Each is valid until its
+   * table is dropped.
+   */
+  auto table_names(std::istream& t_in) -> std::vector<std::string_view>;
+
+  /**
+   * @return The table of that name, or nullptr if there isn't one. Valid
+   * until the table is dropped: adding others doesn't move it.
+   */
+  auto find_table(std::string_view t_name, std::istream& t_in)
+      -> const TableMeta*;
+
+  /**
+   * @return The index of that name, or nullptr if there isn't one. Valid
+   * until the index is dropped.
+   */
+  auto find_index(std::string_view t_name, std::istream& t_in)
+      -> const IndexDef*;
+
+  /**
+   * @return The indexes of a table.
+   */
+  auto indexes_of(std::string_view t_table, std::istream& t_in)
+      -> std::vector<const IndexDef*>;
+
+  /**
+   * @return false if there's already a table or an index of the same name.
+   */
+  auto add_table(TableMeta t_tbl, std::istream& t_in) -> bool;
+
+  /**
+   * @return false if the name is taken, or if there's no such table or
+   * column.
+   */
+  auto add_index(IndexDef t_idx, std::istream& t_in) -> bool;
+
+  /**
+   * @brief Removes a table, with its indexes, or an index.
+   * @return Whether there was one of that name.
+   */
+  auto drop(std::string_view t_name, std::istream& t_in) -> bool;
+
+  /**
+   * @brief Writes the catalog back into its pages, taking more from the
+   * FreeList or giving some back as needed, and points the header to them.
+   */
+  void write_to(FreeList& t_fl, std::iostream& t_io);
+
+  /**
+   * @return How many table definitions were decoded so far.
+   */
+  [[nodiscard]] auto n_decoded() const noexcept -> std::size_t {
+    return m_n_decoded;
+  }
+
+private:
+  enum class Kind : uint8_t { Table, Index };
+
+  struct Entry {
+    Kind kind;
+    // the definition as it's stored, and decoded, once it was.
+    std::string def;
+    std::optional<TableMeta> table{};
+    std::optional<IndexDef> index{};
+  };
+
+  page_ptr_t m_first{NULL_PAGE};
+  bool m_loaded{false};
+  // the pages the catalog is in, in order.
+  std::vector<page_ptr_t> m_pages{};
+  // by name. A map, so entries stay put while others come and go: pointers
+  // to them are handed out.
+  std::map<std::string, Entry, std::less<>> m_entries{};
+  std::size_t m_n_decoded{0};
+
+  /**
+   * @brief Reads the entries, unless they already were.
+   */
+  void load(std::istream& t_in);
+  auto find(std::string_view t_name) -> Entry*;
+  auto table_of(Entry& t_entry) -> const TableMeta&;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_CATALOG_HXX
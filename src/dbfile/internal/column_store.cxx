@@ -0,0 +1,914 @@
+/**
+ * @file column_store.cxx
+ * @brief Definitions for column_store.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#include <climits>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.column_store;
+export import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.bloom;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+import tinydb.dbfile.internal.text;
+import tinydb.dbfile.internal.zone_map;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/bloom.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "dbfile/internal/text.hxx"
+#include "dbfile/internal/zone_map.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/column_store.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+constexpr std::size_t VALUES_ALIGN = 8;
+constexpr std::size_t TEXT_ENTRY_SIZE = sizeof(uint16_t);
+
+constexpr auto bitmap_size(std::size_t t_cap) -> std::size_t {
+  return (t_cap + CHAR_BIT - 1) / CHAR_BIT;
+}
+
+/**
+ * @return Where the values start inside a fixed-width page holding up to
+ * `t_cap` values.
+ */
+constexpr auto values_off(std::size_t t_cap) -> std::size_t {
+  auto off = ColumnPageMeta::DEFAULT_FREE_OFF + bitmap_size(t_cap);
+  return (off + VALUES_ALIGN - 1) / VALUES_ALIGN * VALUES_ALIGN;
+}
+
+/**
+ * @return How many values of the specified width a fixed-width page holds.
+ */
+constexpr auto fixed_capacity(std::size_t t_width) -> std::size_t {
+  // every value takes its width plus one bit. Start from that, then make
+  // room for the alignment of the values.
+  auto cap = (SIZEOF_PAGE - ColumnPageMeta::DEFAULT_FREE_OFF) * CHAR_BIT /
+             ((t_width * CHAR_BIT) + 1);
+  while (values_off(cap) + (cap * t_width) > SIZEOF_PAGE) {
+    --cap;
+  }
+  return cap;
+}
+
+static_assert(fixed_capacity(1) > 3600);
+static_assert(fixed_capacity(8) == 502);
+
+// encoded pages.
+constexpr std::size_t DICT_OFF = ColumnPageMeta::DEFAULT_FREE_OFF + 1;
+constexpr std::size_t TEXT_DICT_ENTRY_SIZE = 2 * sizeof(page_off_t);
+constexpr std::size_t RUN_SIZE = 1 + sizeof(uint16_t);
+constexpr std::size_t MAX_RUN = UINT16_MAX;
+constexpr std::size_t MAX_PAGE_VALUES = UINT16_MAX;
+
+auto page_pos(page_ptr_t t_pg, std::size_t t_off) -> std::streamoff {
+  return (static_cast<std::streamoff>(t_pg) * SIZEOF_PAGE) +
+         static_cast<std::streamoff>(t_off);
+}
+
+/**
+ * @return How many values starting at `t_from` fit in an empty plain Text
+ * page.
+ */
+auto plain_text_fit(const ColumnVector& t_col, std::size_t t_from)
+    -> std::size_t {
+  std::size_t used{ColumnPageMeta::DEFAULT_FREE_OFF};
+  std::size_t count{0};
+  for (auto i = t_from; i < t_col.size(); ++i, ++count) {
+    std::size_t len{0};
+    if (!t_col.is_null(i)) {
+      len = t_col.text(i).size();
+      len = len > ColumnStore::MAX_INLINE_TEXT ? column::TextSlot::SIZE : len;
+    }
+    used += TEXT_ENTRY_SIZE + len;
+    if (used > SIZEOF_PAGE) {
+      break;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Picks the encoding of a new page for the values starting at
+ * `t_from`: whichever fits the most of them, plain on ties.
+ * @return The encoding, and how many values to put in the page. The count is
+ * only meaningful for encoded pages; plain pages take as many as they can.
+ */
+auto choose_encoding(const ColumnVector& t_col, std::size_t t_from)
+    -> std::pair<ColumnEncoding, std::size_t> {
+  const bool is_text = t_col.type == column::ColType::Text;
+  const std::size_t left = t_col.size() - t_from;
+  const std::size_t plain_fit = std::min(
+      left, is_text ? plain_text_fit(t_col, t_from)
+                    : fixed_capacity(column::type_size(t_col.type)));
+
+  std::unordered_set<std::string_view> seen;
+  std::size_t dict_bytes{0};
+  std::size_t runs{0};
+  std::size_t run_len{0};
+  std::optional<std::string_view> prev;
+  bool prev_null{false};
+  std::size_t dict_count{0};
+  std::size_t rle_count{0};
+  bool dict_fits{true};
+  bool rle_fits{true};
+  const auto end = std::min(t_col.size(), t_from + MAX_PAGE_VALUES);
+  for (auto i = t_from; i < end && (dict_fits || rle_fits); ++i) {
+    const bool null = t_col.is_null(i);
+    std::string_view key{};
+    if (!null) {
+      key = t_col.bytes(i);
+      if (is_text && key.size() > ColumnStore::MAX_INLINE_TEXT) {
+        break;
+      }
+      if (!seen.contains(key)) {
+        if (seen.size() == ColumnStore::MAX_DICT) {
+          break;
+        }
+        seen.insert(key);
+        dict_bytes += is_text ? TEXT_DICT_ENTRY_SIZE + key.size() : key.size();
+      }
+    }
+    if (prev.has_value() && prev_null == null && *prev == key &&
+        run_len < MAX_RUN) {
+      ++run_len;
+    } else {
+      ++runs;
+      run_len = 1;
+    }
+    prev = key;
+    prev_null = null;
+
+    const std::size_t n = i - t_from + 1;
+    dict_fits = dict_fits && DICT_OFF + dict_bytes + n <= SIZEOF_PAGE;
+    rle_fits =
+        rle_fits && DICT_OFF + dict_bytes + (runs * RUN_SIZE) <= SIZEOF_PAGE;
+    dict_count = dict_fits ? n : dict_count;
+    rle_count = rle_fits ? n : rle_count;
+  }
+  if (std::max(dict_count, rle_count) <= plain_fit) {
+    return {ColumnEncoding::Plain, plain_fit};
+  }
+  if (rle_count > dict_count) {
+    return {ColumnEncoding::Rle, rle_count};
+  }
+  return {ColumnEncoding::Dict, dict_count};
+}
+
+} // namespace
+
+ColumnStore::ColumnStore(const TableMeta& t_tbl)
+    : m_types{t_tbl.layout().types}, m_chains(m_types.size()) {
+  m_zones.reserve(m_types.size());
+  for (auto type : m_types) {
+    m_zones.emplace_back(type);
+  }
+  if (!t_tbl.get_key().empty()) {
+    m_key = t_tbl.column_pos(t_tbl.get_key());
+  }
+}
+
+auto ColumnStore::read_from(const TableMeta& t_tbl, const Ptr& t_pos,
+                            std::istream& t_in) -> ColumnStore {
+  ColumnStore ret{t_tbl};
+  t_in.seekg(page_pos(t_pos.pagenum, t_pos.offset));
+  auto& rdbuf = *t_in.rdbuf();
+  rdbuf.sgetn(std::bit_cast<char*>(&ret.m_n_rows), sizeof(ret.m_n_rows));
+  std::vector<page_ptr_t> zones_first(ret.m_chains.size());
+  for (std::size_t i = 0; i < ret.m_chains.size(); ++i) {
+    auto& chain = ret.m_chains[i];
+    rdbuf.sgetn(std::bit_cast<char*>(&chain.first), sizeof(chain.first));
+    rdbuf.sgetn(std::bit_cast<char*>(&chain.last), sizeof(chain.last));
+    rdbuf.sgetn(std::bit_cast<char*>(&zones_first[i]), sizeof(page_ptr_t));
+  }
+  page_ptr_t bloom_first{NULL_PAGE};
+  rdbuf.sgetn(std::bit_cast<char*>(&bloom_first), sizeof(bloom_first));
+  for (std::size_t i = 0; i < ret.m_zones.size(); ++i) {
+    ret.m_zones[i] = ZoneMap::read_from(ret.m_types[i], zones_first[i], t_in);
+  }
+  if (bloom_first != NULL_PAGE) {
+    ret.m_bloom = BloomFilter::read_from(bloom_first, t_in);
+  }
+  return ret;
+}
+
+void ColumnStore::write_to(const Ptr& t_pos, std::ostream& t_out) const {
+  t_out.seekp(page_pos(t_pos.pagenum, t_pos.offset));
+  auto& rdbuf = *t_out.rdbuf();
+  rdbuf.sputn(std::bit_cast<const char*>(&m_n_rows), sizeof(m_n_rows));
+  for (std::size_t i = 0; i < m_chains.size(); ++i) {
+    const auto& chain = m_chains[i];
+    auto zones_first = m_zones[i].first_page();
+    rdbuf.sputn(std::bit_cast<const char*>(&chain.first), sizeof(chain.first));
+    rdbuf.sputn(std::bit_cast<const char*>(&chain.last), sizeof(chain.last));
+    rdbuf.sputn(std::bit_cast<const char*>(&zones_first),
+                sizeof(zones_first));
+  }
+  auto bloom_first = m_bloom.has_value() ? m_bloom->first_page() : NULL_PAGE;
+  rdbuf.sputn(std::bit_cast<const char*>(&bloom_first), sizeof(bloom_first));
+}
+
+auto ColumnStore::make_batch() const -> std::vector<ColumnVector> {
+  std::vector<ColumnVector> ret;
+  ret.reserve(m_types.size());
+  for (auto type : m_types) {
+    ret.emplace_back(type);
+  }
+  return ret;
+}
+
+
+auto ColumnStore::new_page(std::size_t t_pos, ColumnEncoding t_encoding,
+                           FreeList& t_fl, std::iostream& t_io)
+    -> ColumnPageMeta {
+  auto meta = t_fl.allocate_page<ColumnPageMeta>(
+      t_io, NULL_PAGE, ColumnPageMeta::n_values_t{0}, SIZEOF_PAGE, t_encoding);
+  if (m_types[t_pos] != column::ColType::Text &&
+      t_encoding == ColumnEncoding::Plain) {
+    // a recycled page may have anything in its bitmap.
+    std::vector<char> zeros(
+        values_off(fixed_capacity(column::type_size(m_types[t_pos]))) -
+            ColumnPageMeta::DEFAULT_FREE_OFF,
+        '\0');
+    t_io.seekp(page_pos(meta.get_pg_num(), ColumnPageMeta::DEFAULT_FREE_OFF));
+    t_io.rdbuf()->sputn(zeros.data(),
+                        static_cast<std::streamsize>(zeros.size()));
+  }
+  auto& chain = m_chains[t_pos];
+  if (chain.last == NULL_PAGE) {
+    chain.first = meta.get_pg_num();
+  } else {
+    auto prev = internal::read_from<ColumnPageMeta>(chain.last, t_io);
+    prev.update_next_pg(meta.get_pg_num());
+    internal::write_to(prev, t_io);
+  }
+  chain.last = meta.get_pg_num();
+  return meta;
+}
+
+auto ColumnStore::append(std::span<const ColumnVector> t_cols, Heap& t_heap,
+                         FreeList& t_fl, std::iostream& t_io) -> bool {
+  if (t_cols.size() != m_types.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < t_cols.size(); ++i) {
+    if (t_cols[i].type != m_types[i] ||
+        t_cols[i].size() != t_cols.front().size()) {
+      return false;
+    }
+  }
+  if (t_cols.empty() || t_cols.front().size() == 0) {
+    return true;
+  }
+  for (std::size_t i = 0; i < t_cols.size(); ++i) {
+    append_column(i, t_cols[i], t_heap, t_fl, t_io);
+  }
+  m_n_rows += t_cols.front().size();
+  if (m_key.has_value()) {
+    update_bloom(t_cols[*m_key], t_fl, t_io);
+  }
+  return true;
+}
+
+void ColumnStore::update_bloom(const ColumnVector& t_keys, FreeList& t_fl,
+                               std::iostream& t_io) {
+  const auto type = m_types[*m_key];
+  if (m_bloom.has_value() && m_n_rows <= m_bloom->capacity()) {
+    for (std::size_t i = 0; i < t_keys.size(); ++i) {
+      if (!t_keys.is_null(i)) {
+        m_bloom->add(BloomFilter::hash(type, t_keys.bytes(i)));
+      }
+    }
+    m_bloom->write_to(t_fl, t_io);
+    return;
+  }
+  // rebuild from every key, with room to double before the next rebuild.
+  if (m_bloom.has_value()) {
+    m_bloom->free_pages(t_fl, t_io);
+  }
+  m_bloom.emplace(static_cast<std::size_t>(2 * m_n_rows));
+  auto cols = std::array{*m_key};
+  auto scanner = scan(cols, t_io);
+  auto keys = scanner.make_batch();
+  while (auto n = scanner.next(keys)) {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!keys[0].is_null(i)) {
+        m_bloom->add(BloomFilter::hash(type, keys[0].bytes(i)));
+      }
+    }
+  }
+  m_bloom->write_to(t_fl, t_io);
+}
+
+auto ColumnStore::may_contain(std::string_view t_key) const -> bool {
+  return !m_bloom.has_value() ||
+         m_bloom->may_contain(BloomFilter::hash(m_types[*m_key], t_key));
+}
+
+void ColumnStore::append_column(std::size_t t_pos, const ColumnVector& t_col,
+                                Heap& t_heap, FreeList& t_fl,
+                                std::iostream& t_io) {
+  std::optional<ColumnPageMeta> meta;
+  if (m_chains[t_pos].last != NULL_PAGE) {
+    meta = internal::read_from<ColumnPageMeta>(m_chains[t_pos].last, t_io);
+  }
+  auto& zones = m_zones[t_pos];
+  std::size_t done{0};
+  while (done < t_col.size()) {
+    if (meta.has_value() && meta->get_encoding() == ColumnEncoding::Plain) {
+      auto count =
+          m_types[t_pos] == column::ColType::Text
+              ? append_plain_text(*meta, t_col, done, t_heap, t_fl, t_io)
+              : append_plain_fixed(*meta, t_col, done, t_io);
+      zones.add(meta->get_pg_num(), t_col, done, count, t_fl, t_io);
+      done += count;
+      if (done == t_col.size()) {
+        break;
+      }
+    }
+    // the last page is either full or encoded.
+    auto [encoding, count] = choose_encoding(t_col, done);
+    meta = new_page(t_pos, encoding, t_fl, t_io);
+    if (encoding != ColumnEncoding::Plain) {
+      write_encoded(*meta, t_col, done, count, t_io);
+      zones.add(meta->get_pg_num(), t_col, done, count, t_fl, t_io);
+      done += count;
+    }
+  }
+}
+
+auto ColumnStore::append_plain_fixed(ColumnPageMeta& t_meta,
+                                     const ColumnVector& t_col,
+                                     std::size_t t_from, std::iostream& t_io)
+    -> std::size_t {
+  const std::size_t width = column::type_size(t_col.type);
+  const std::size_t cap = fixed_capacity(width);
+  const std::size_t start = t_meta.get_n_values();
+  const std::size_t chunk = std::min(t_col.size() - t_from, cap - start);
+  if (chunk == 0) {
+    return 0;
+  }
+  // the whole chunk of values is a single copy.
+  t_io.seekp(page_pos(t_meta.get_pg_num(), values_off(cap) + (start * width)));
+  t_io.rdbuf()->sputn(t_col.data.data() + (t_from * width),
+                      static_cast<std::streamsize>(chunk * width));
+
+  auto nulls = std::span{t_col.nulls}.subspan(t_from, chunk);
+  if (std::ranges::any_of(nulls, [](uint8_t t_n) { return t_n != 0; })) {
+    const std::size_t first_byte = start / CHAR_BIT;
+    const std::size_t last_byte = (start + chunk - 1) / CHAR_BIT;
+    std::vector<char> bitmap(last_byte - first_byte + 1, '\0');
+    auto bitmap_pos = page_pos(t_meta.get_pg_num(),
+                               ColumnPageMeta::DEFAULT_FREE_OFF + first_byte);
+    t_io.seekg(bitmap_pos);
+    t_io.rdbuf()->sgetn(bitmap.data(),
+                        static_cast<std::streamsize>(bitmap.size()));
+    for (std::size_t i = 0; i < chunk; ++i) {
+      if (nulls[i] != 0) {
+        auto bit = start + i - (first_byte * CHAR_BIT);
+        bitmap[bit / CHAR_BIT] = static_cast<char>(
+            static_cast<unsigned char>(bitmap[bit / CHAR_BIT]) |
+            (1U << (bit % CHAR_BIT)));
+      }
+    }
+    t_io.seekp(bitmap_pos);
+    t_io.rdbuf()->sputn(bitmap.data(),
+                        static_cast<std::streamsize>(bitmap.size()));
+  }
+  t_meta.update_n_values(
+      static_cast<ColumnPageMeta::n_values_t>(start + chunk));
+  internal::write_to(t_meta, t_io);
+  return chunk;
+}
+
+auto ColumnStore::append_plain_text(ColumnPageMeta& t_meta,
+                                    const ColumnVector& t_col,
+                                    std::size_t t_from, Heap& t_heap,
+                                    FreeList& t_fl, std::iostream& t_io)
+    -> std::size_t {
+  auto i = t_from;
+  for (; i < t_col.size(); ++i) {
+    std::string_view bytes{};
+    uint16_t flags{0};
+    column::TextSlot slot{};
+    const bool spill =
+        !t_col.is_null(i) && t_col.text(i).size() > MAX_INLINE_TEXT;
+    const std::size_t len = t_col.is_null(i) ? 0
+                            : spill          ? column::TextSlot::SIZE
+                                             : t_col.text(i).size();
+    const std::size_t n_values = t_meta.get_n_values();
+    if (n_values == MAX_PAGE_VALUES ||
+        ColumnPageMeta::DEFAULT_FREE_OFF +
+                ((n_values + 1) * TEXT_ENTRY_SIZE) + len >
+            t_meta.get_data_off()) {
+      break;
+    }
+    if (t_col.is_null(i)) {
+      flags = TEXT_NULL;
+    } else if (spill) {
+      slot = write_text(t_col.text(i), t_heap, t_fl, t_io);
+      bytes = {slot.bytes.data(), slot.bytes.size()};
+      flags = TEXT_SPILLED;
+    } else {
+      bytes = t_col.text(i);
+    }
+
+    auto start = static_cast<page_off_t>(t_meta.get_data_off() - len);
+    t_io.seekp(page_pos(t_meta.get_pg_num(), start));
+    t_io.rdbuf()->sputn(bytes.data(),
+                        static_cast<std::streamsize>(bytes.size()));
+    auto entry = static_cast<uint16_t>(start | flags);
+    t_io.seekp(page_pos(t_meta.get_pg_num(), ColumnPageMeta::DEFAULT_FREE_OFF +
+                                                 (n_values * TEXT_ENTRY_SIZE)));
+    t_io.rdbuf()->sputn(std::bit_cast<const char*>(&entry), sizeof(entry));
+    t_meta.update_data_off(start);
+    t_meta.update_n_values(
+        static_cast<ColumnPageMeta::n_values_t>(n_values + 1));
+  }
+  internal::write_to(t_meta, t_io);
+  return i - t_from;
+}
+
+void ColumnStore::write_encoded(ColumnPageMeta& t_meta,
+                                const ColumnVector& t_col, std::size_t t_from,
+                                std::size_t t_count, std::iostream& t_io) {
+  const bool is_text = t_col.type == column::ColType::Text;
+  std::array<char, SIZEOF_PAGE> page{};
+  std::unordered_map<std::string_view, uint8_t> codes;
+  std::vector<std::string_view> dict;
+  std::vector<uint8_t> value_codes(t_count);
+  for (std::size_t i = 0; i < t_count; ++i) {
+    if (t_col.is_null(t_from + i)) {
+      value_codes[i] = NULL_CODE;
+      continue;
+    }
+    auto key = t_col.bytes(t_from + i);
+    auto [found, inserted] =
+        codes.try_emplace(key, static_cast<uint8_t>(dict.size()));
+    if (inserted) {
+      dict.push_back(key);
+    }
+    value_codes[i] = found->second;
+  }
+  assert(dict.size() <= MAX_DICT);
+
+  page[ColumnPageMeta::DEFAULT_FREE_OFF] = static_cast<char>(dict.size());
+  std::size_t off{DICT_OFF};
+  if (is_text) {
+    // entries first, then the strings.
+    std::size_t str_off = DICT_OFF + (dict.size() * TEXT_DICT_ENTRY_SIZE);
+    for (auto entry : dict) {
+      auto entry_off = static_cast<page_off_t>(str_off);
+      auto entry_len = static_cast<page_off_t>(entry.size());
+      std::memcpy(page.data() + off, &entry_off, sizeof(entry_off));
+      std::memcpy(page.data() + off + sizeof(entry_off), &entry_len,
+                  sizeof(entry_len));
+      off += TEXT_DICT_ENTRY_SIZE;
+      entry.copy(page.data() + str_off, entry.size());
+      str_off += entry.size();
+    }
+    off = str_off;
+  } else {
+    for (auto entry : dict) {
+      entry.copy(page.data() + off, entry.size());
+      off += entry.size();
+    }
+  }
+
+  t_meta.update_data_off(static_cast<page_off_t>(off));
+  if (t_meta.get_encoding() == ColumnEncoding::Dict) {
+    std::memcpy(page.data() + off, value_codes.data(), t_count);
+    off += t_count;
+  } else {
+    for (std::size_t i = 0; i < t_count;) {
+      auto len = std::size_t{1};
+      while (i + len < t_count && len < MAX_RUN &&
+             value_codes[i + len] == value_codes[i]) {
+        ++len;
+      }
+      auto run_len = static_cast<uint16_t>(len);
+      page[off] = static_cast<char>(value_codes[i]);
+      std::memcpy(page.data() + off + 1, &run_len, sizeof(run_len));
+      off += RUN_SIZE;
+      i += len;
+    }
+  }
+  assert(off <= SIZEOF_PAGE);
+  t_meta.update_n_values(static_cast<ColumnPageMeta::n_values_t>(t_count));
+  internal::write_to(t_meta, t_io);
+  t_io.seekp(page_pos(t_meta.get_pg_num(), ColumnPageMeta::DEFAULT_FREE_OFF));
+  t_io.rdbuf()->sputn(
+      page.data() + ColumnPageMeta::DEFAULT_FREE_OFF,
+      static_cast<std::streamsize>(off - ColumnPageMeta::DEFAULT_FREE_OFF));
+}
+
+auto ColumnStore::scan(std::span<const std::size_t> t_cols,
+                       std::istream& t_in) const -> Scanner {
+  std::vector<Scanner::Cursor> cursors;
+  cursors.reserve(t_cols.size());
+  for (auto pos : t_cols) {
+    assert(pos < m_types.size());
+    auto zones = m_zones[pos].zones();
+    cursors.push_back(Scanner::Cursor{.type = m_types[pos],
+                                      .zones{zones.begin(), zones.end()},
+                                      .zone = 0,
+                                      .idx = 0,
+                                      .loaded = false,
+                                      .page{},
+                                      .encoding = ColumnEncoding::Plain,
+                                      .data_off = 0,
+                                      .dict{},
+                                      .run = 0,
+                                      .run_off = 0});
+  }
+  return Scanner{std::move(cursors), m_n_rows, std::nullopt, t_in};
+}
+
+auto ColumnStore::scan(std::span<const std::size_t> t_cols,
+                       ColumnFilter t_filter, std::istream& t_in) const
+    -> Scanner {
+  assert(t_filter.col < m_types.size());
+  assert(m_types[t_filter.col] == column::ColType::Text ||
+         t_filter.value.size() == column::type_size(m_types[t_filter.col]));
+  auto ret = scan(t_cols, t_in);
+  if (t_filter.col == m_key && t_filter.op == CmpOp::Eq &&
+      !may_contain(t_filter.value)) {
+    ret.m_left = 0;
+  }
+  auto filter_col = std::array{t_filter.col};
+  ret.m_cursors.push_back(
+      std::move(scan(filter_col, t_in).m_cursors.front()));
+  ret.m_filter = std::move(t_filter);
+  return ret;
+}
+
+auto ColumnStore::split(std::size_t t_rows) const -> std::vector<RowRange> {
+  std::vector<RowRange> ret;
+  if (m_zones.empty()) {
+    return ret;
+  }
+  RowRange cur{.first = 0, .n = 0};
+  for (const auto& zone : m_zones.front().zones()) {
+    cur.n += zone.n_values;
+    if (cur.n >= t_rows) {
+      ret.push_back(cur);
+      cur = RowRange{.first = cur.first + cur.n, .n = 0};
+    }
+  }
+  if (cur.n != 0) {
+    ret.push_back(cur);
+  }
+  return ret;
+}
+
+auto ColumnStore::Scanner::make_batch() const -> std::vector<ColumnVector> {
+  std::vector<ColumnVector> ret;
+  auto n_out = m_cursors.size() - (m_filter.has_value() ? 1 : 0);
+  ret.reserve(n_out);
+  for (std::size_t i = 0; i < n_out; ++i) {
+    ret.emplace_back(m_cursors[i].type);
+  }
+  return ret;
+}
+
+void ColumnStore::Scanner::restrict_to(RowRange t_range) {
+  for (auto& cur : m_cursors) {
+    assert(cur.zone == 0 && cur.idx == 0);
+    // whole pages are skipped without being read, the rest once loaded.
+    auto skipped = t_range.first;
+    while (cur.zone < cur.zones.size() &&
+           skipped >= cur.zones[cur.zone].n_values) {
+      skipped -= cur.zones[cur.zone].n_values;
+      ++cur.zone;
+    }
+    cur.idx = static_cast<std::size_t>(skipped);
+  }
+  // the Bloom filter may have ruled out every row already.
+  m_left = std::min(m_left, t_range.n);
+}
+
+auto ColumnStore::Scanner::next(std::span<ColumnVector> t_out,
+                                std::size_t t_max) -> std::size_t {
+  const auto n_out = m_cursors.size() - (m_filter.has_value() ? 1 : 0);
+  assert(t_out.size() >= n_out);
+  for (std::size_t i = 0; i < n_out; ++i) {
+    t_out[i].clear();
+  }
+  while (m_left > 0) {
+    auto n = static_cast<std::size_t>(
+        std::min(m_left, static_cast<uint64_t>(t_max)));
+    m_left -= n;
+    if (!m_filter.has_value()) {
+      for (std::size_t i = 0; i < n_out; ++i) {
+        fill(m_cursors[i], t_out[i], n, nullptr);
+      }
+      return n;
+    }
+    auto n_matches = eval(n);
+    // even without a match, the other cursors must move past these rows.
+    for (std::size_t i = 0; i < n_out; ++i) {
+      fill(m_cursors[i], t_out[i], n, m_mask.data());
+    }
+    if (n_matches > 0) {
+      return n_matches;
+    }
+  }
+  return 0;
+}
+
+auto ColumnStore::Scanner::left_in_page(Cursor& t_cur) -> std::size_t {
+  while (t_cur.idx == t_cur.zones[t_cur.zone].n_values) {
+    ++t_cur.zone;
+    t_cur.idx = 0;
+    t_cur.loaded = false;
+  }
+  return t_cur.zones[t_cur.zone].n_values - t_cur.idx;
+}
+
+void ColumnStore::Scanner::skip(Cursor& t_cur, std::size_t t_n) {
+  t_cur.idx += t_n;
+  if (!t_cur.loaded || t_cur.encoding != ColumnEncoding::Rle) {
+    return;
+  }
+  // walk the runs up to the new position.
+  t_cur.run_off += t_n;
+  while (true) {
+    uint16_t run_len{0};
+    std::memcpy(&run_len,
+                t_cur.page.data() + t_cur.data_off + (t_cur.run * RUN_SIZE) +
+                    1,
+                sizeof(run_len));
+    if (t_cur.run_off <= run_len) {
+      break;
+    }
+    t_cur.run_off -= run_len;
+    ++t_cur.run;
+  }
+}
+
+void ColumnStore::Scanner::load(Cursor& t_cur) {
+  const auto pg = t_cur.zones[t_cur.zone].pg;
+  auto meta = internal::read_from<ColumnPageMeta>(pg, *m_in);
+  assert(meta.get_n_values() == t_cur.zones[t_cur.zone].n_values);
+  t_cur.loaded = true;
+  t_cur.encoding = meta.get_encoding();
+  t_cur.data_off = meta.get_data_off();
+  t_cur.run = 0;
+  t_cur.run_off = 0;
+  // one read per page, everything else is done on the copy.
+  t_cur.page.resize(SIZEOF_PAGE);
+  m_in->seekg(page_pos(pg, 0));
+  m_in->rdbuf()->sgetn(t_cur.page.data(), SIZEOF_PAGE);
+
+  t_cur.dict.clear();
+  if (t_cur.encoding != ColumnEncoding::Plain) {
+    const char* page = t_cur.page.data();
+    auto n_dict = static_cast<unsigned char>(
+        page[ColumnPageMeta::DEFAULT_FREE_OFF]);
+    const std::size_t width = t_cur.type == column::ColType::Text
+                                  ? 0
+                                  : column::type_size(t_cur.type);
+    for (std::size_t i = 0; i < n_dict; ++i) {
+      if (width == 0) {
+        page_off_t entry_off{0};
+        page_off_t entry_len{0};
+        const char* entry = page + DICT_OFF + (i * TEXT_DICT_ENTRY_SIZE);
+        std::memcpy(&entry_off, entry, sizeof(entry_off));
+        std::memcpy(&entry_len, entry + sizeof(entry_off), sizeof(entry_len));
+        t_cur.dict.emplace_back(entry_off, entry_len);
+      } else {
+        t_cur.dict.emplace_back(DICT_OFF + (i * width), width);
+      }
+    }
+  }
+  if (m_filter.has_value() && &t_cur == &m_cursors.back()) {
+    // the filter is evaluated once per dictionary entry, not per row.
+    m_dict_match.assign(t_cur.dict.size(), 0);
+    for (std::size_t i = 0; i < t_cur.dict.size(); ++i) {
+      auto [off, len] = t_cur.dict[i];
+      m_dict_match[i] = static_cast<uint8_t>(
+          matches(*m_filter, t_cur.type, {t_cur.page.data() + off, len}));
+    }
+  }
+  // the cursor may have skipped part of the page before it was needed.
+  auto idx = std::exchange(t_cur.idx, 0);
+  skip(t_cur, idx);
+}
+
+auto ColumnStore::Scanner::next_code(Cursor& t_cur) -> uint8_t {
+  const char* page = t_cur.page.data();
+  if (t_cur.encoding == ColumnEncoding::Dict) {
+    return static_cast<uint8_t>(page[t_cur.data_off + t_cur.idx++]);
+  }
+  uint16_t run_len{0};
+  const char* run = page + t_cur.data_off + (t_cur.run * RUN_SIZE);
+  std::memcpy(&run_len, run + 1, sizeof(run_len));
+  if (t_cur.run_off == run_len) {
+    ++t_cur.run;
+    t_cur.run_off = 0;
+    run += RUN_SIZE;
+  }
+  ++t_cur.run_off;
+  ++t_cur.idx;
+  return static_cast<uint8_t>(*run);
+}
+
+void ColumnStore::Scanner::fill(Cursor& t_cur, ColumnVector& t_out,
+                                std::size_t t_n, const uint8_t* t_mask) {
+  const bool is_text = t_cur.type == column::ColType::Text;
+  const std::size_t width = is_text ? 0 : column::type_size(t_cur.type);
+  const std::size_t data_off = is_text ? 0 : values_off(fixed_capacity(width));
+  if (t_mask == nullptr) {
+    t_out.data.reserve(t_out.data.size() + (t_n * width));
+    t_out.nulls.reserve(t_out.nulls.size() + t_n);
+  }
+  auto wanted = [&](std::size_t t_k) {
+    return t_mask == nullptr || t_mask[t_k] != 0;
+  };
+  std::size_t k{0};
+  while (k < t_n) {
+    const std::size_t chunk = std::min(t_n - k, left_in_page(t_cur));
+    if (t_mask != nullptr &&
+        std::none_of(t_mask + k, t_mask + k + chunk,
+                     [](uint8_t t_m) { return t_m != 0; })) {
+      skip(t_cur, chunk);
+      k += chunk;
+      continue;
+    }
+    if (!t_cur.loaded) {
+      load(t_cur);
+    }
+    const char* page = t_cur.page.data();
+    if (t_cur.encoding != ColumnEncoding::Plain) {
+      for (std::size_t j = 0; j < chunk; ++j, ++k) {
+        auto code = next_code(t_cur);
+        if (!wanted(k)) {
+          continue;
+        }
+        if (code == NULL_CODE) {
+          t_out.push_null();
+        } else {
+          auto [off, len] = t_cur.dict[code];
+          t_out.push_bytes({page + off, len});
+        }
+      }
+      continue;
+    }
+    if (!is_text && t_mask == nullptr) {
+      const char* src = page + data_off + (t_cur.idx * width);
+      t_out.data.insert(t_out.data.end(), src, src + (chunk * width));
+    }
+    const auto* bitmap = std::bit_cast<const unsigned char*>(
+        page + ColumnPageMeta::DEFAULT_FREE_OFF);
+    for (auto i = t_cur.idx; i < t_cur.idx + chunk; ++i, ++k) {
+      if (!wanted(k)) {
+        continue;
+      }
+      if (!is_text) {
+        auto null =
+            static_cast<uint8_t>((bitmap[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1U);
+        if (t_mask != nullptr) {
+          const char* src = page + data_off + (i * width);
+          t_out.data.insert(t_out.data.end(), src, src + width);
+        }
+        t_out.nulls.push_back(null);
+        continue;
+      }
+      auto entry_at = [&](std::size_t t_i) {
+        uint16_t entry{0};
+        std::memcpy(&entry,
+                    page + ColumnPageMeta::DEFAULT_FREE_OFF +
+                        (t_i * TEXT_ENTRY_SIZE),
+                    sizeof(entry));
+        return entry;
+      };
+      auto entry = entry_at(i);
+      std::size_t start = entry & TEXT_OFF_MASK;
+      std::size_t end =
+          i == 0 ? SIZEOF_PAGE : (entry_at(i - 1) & TEXT_OFF_MASK);
+      if ((entry & TEXT_NULL) != 0) {
+        t_out.push_null();
+      } else if ((entry & TEXT_SPILLED) != 0) {
+        column::TextSlot slot{};
+        std::memcpy(slot.bytes.data(), page + start, slot.bytes.size());
+        t_out.push_text(read_text(slot, *m_in));
+      } else {
+        t_out.push_text({page + start, end - start});
+      }
+    }
+    t_cur.idx += chunk;
+  }
+}
+
+auto ColumnStore::Scanner::eval(std::size_t t_n) -> std::size_t {
+  auto& cur = m_cursors.back();
+  m_mask.assign(t_n, 0);
+  std::size_t k{0};
+  while (k < t_n) {
+    const std::size_t chunk = std::min(t_n - k, left_in_page(cur));
+    if (!cur.loaded &&
+        !ZoneMap::may_match(cur.type, cur.zones[cur.zone], *m_filter)) {
+      // the mask is already all 0s.
+      skip(cur, chunk);
+      k += chunk;
+      continue;
+    }
+    if (!cur.loaded) {
+      load(cur);
+    }
+    switch (cur.encoding) {
+    case ColumnEncoding::Rle: {
+      // a whole run matches or doesn't.
+      std::size_t j{0};
+      while (j < chunk) {
+        auto code = next_code(cur);
+        uint16_t run_len{0};
+        std::memcpy(&run_len,
+                    cur.page.data() + cur.data_off + (cur.run * RUN_SIZE) + 1,
+                    sizeof(run_len));
+        auto take = std::min<std::size_t>(run_len - cur.run_off + 1, chunk - j);
+        if (code != NULL_CODE && m_dict_match[code] != 0) {
+          std::memset(m_mask.data() + k + j, 1, take);
+        }
+        cur.run_off += take - 1;
+        cur.idx += take - 1;
+        j += take;
+      }
+      break;
+    }
+    case ColumnEncoding::Dict:
+      for (std::size_t j = 0; j < chunk; ++j) {
+        auto code = next_code(cur);
+        m_mask[k + j] =
+            static_cast<uint8_t>(code != NULL_CODE && m_dict_match[code] != 0);
+      }
+      break;
+    default: {
+      // the rows are decoded one by one anyways, so do it the simple way.
+      ColumnVector vals{cur.type};
+      fill(cur, vals, chunk, nullptr);
+      for (std::size_t j = 0; j < chunk; ++j) {
+        m_mask[k + j] = static_cast<uint8_t>(
+            !vals.is_null(j) &&
+            matches(*m_filter, cur.type, vals.bytes(j)));
+      }
+      break;
+    }
+    }
+    k += chunk;
+  }
+  return static_cast<std::size_t>(std::ranges::count(m_mask, 1));
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,377 @@
+/**
+ * @file column_store.hxx
+ * @brief Declares the columnar storage format, for analytic tables.
+ *
+ * A row-oriented table (see row) keeps whole rows together, which is great
+ * for fetching a row, and terrible for a query that only looks at 2 columns
+ * out of 30: it still reads all 30. A columnar table instead keeps each
+ * column in its own chain of pages (see ColumnPageMeta), so a scan only reads
+ * the pages of the columns it asks for, and what it gets back is a plain
+ * array of values per column, which is what filters and aggregates want to
+ * loop over anyways.
+ *
+ * Columnar tables are append-only. Rows are appended in batches, and read
+ * back in batches, one ColumnVector per column.
+ *
+ * A plain page of any type but Text is a dense array:
+ * - offset 0: the ColumnPageMeta.
+ * - offset 10: the null bitmap. One bit per value the page can hold, set if
+ *   the value is NULL.
+ * - after that, aligned to 8 bytes: the values back to back, exactly like a
+ *   C array. NULLs still take their slot.
+ *
+ * A plain Text page is an array of offsets, plus the strings themselves:
+ * - offset 0: the ColumnPageMeta.
+ * - offset 10: 2 bytes per value, where the value starts. It ends where the
+ *   previous value starts, or at the end of the page for the first one. The
+ *   top 2 bits are flags: `TEXT_NULL` and `TEXT_SPILLED`.
+ * - the strings, growing downward from the end of the page. A string longer
+ *   than `MAX_INLINE_TEXT` is put in the heap (see text), and only its
+ *   TextSlot is stored here, flagged with `TEXT_SPILLED`.
+ *
+ * Columns like status or country repeat the same handful of values over and
+ * over. For those, a page can instead hold a dictionary of its distinct
+ * values, and codes pointing into it:
+ * - offset 0: the ColumnPageMeta.
+ * - offset 10: 1 byte, number of dictionary entries (at most `MAX_DICT`).
+ * - offset 11: the dictionary. For Text, 2 bytes of offset and 2 bytes of
+ *   length per entry, then the strings. For other types, the values back to
+ *   back.
+ * - at `get_data_off()`: for a Dict page, 1 byte of code per value. For an
+ *   Rle page, runs of 1 byte of code and 2 bytes of length. `NULL_CODE`
+ *   means NULL.
+ *
+ * Encoded pages are written in one go and never appended to afterwards. When
+ * a batch needs a new page, the encoding that fits the most of its values in
+ * that page wins; plain wins ties, so small batches keep filling the same
+ * plain page. Bulk loads should thus append in large batches.
+ *
+ * A filter passed to `scan` (see ColumnFilter) is evaluated once per
+ * dictionary entry of an encoded page, then only compares codes, or run
+ * lengths for Rle pages. Rows that don't match are never decoded.
+ *
+ * Every column also has a ZoneMap, updated on every append. A filtered scan
+ * skips the pages of the filtered column whose zone can't match, and the
+ * pages of the other columns that only hold rows skipped that way, without
+ * reading them.
+ *
+ * If the table has a key, the store also keeps a BloomFilter of its values.
+ * A scan filtered on `key = constant` for a key that was never appended
+ * returns nothing right away, without reading a single page. The filter is
+ * rebuilt, twice as big, whenever the table outgrows it; a bulk load thus
+ * builds it once, sized for the whole load.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_COLUMN_STORE_HXX
+#define TINYDB_DBFILE_INTERNAL_COLUMN_STORE_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/bloom.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "dbfile/internal/zone_map.hxx"
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @class ColumnStore
+ * @brief A columnar table: one chain of column pages per column.
+ *
+ * Column positions are positions inside `TableMeta::columns()`, same as
+ * RowCodec. Like RowCodec, it takes a snapshot of the table's columns when
+ * constructed.
+ *
+ * The store itself is only a small descriptor (the number of rows, plus the
+ * first and last page of every column), which the owner saves wherever it
+ * wants with `write_to`:
+ * - offset 0: 8 bytes, number of rows.
+ * - then for each column: 4 bytes, first page; 4 bytes, last page; 4 bytes,
+ *   first page of its zone map.
+ * - 4 bytes, first page of the key's Bloom filter, NULL_PAGE if none.
+ */
+class TINYDB_EXPORT ColumnStore {
+public:
+  // Rows per batch a scan hands out by default. Small enough for a batch of
+  // a few columns to stay in L2, large enough to amortize the per-batch work.
+  static constexpr std::size_t BATCH_SIZE = 2048;
+  // Strings longer than this go to the heap, so that a single huge string
+  // doesn't take up a whole page of its column.
+  static constexpr std::size_t MAX_INLINE_TEXT = 1024;
+  // Flags inside the offsets of a Text page.
+  static constexpr uint16_t TEXT_NULL = 0x8000;
+  static constexpr uint16_t TEXT_SPILLED = 0x4000;
+  static constexpr uint16_t TEXT_OFF_MASK = 0x3FFF;
+  // Dictionary size limit, so that codes are a single byte.
+  static constexpr std::size_t MAX_DICT = 255;
+  static constexpr uint8_t NULL_CODE = 0xFF;
+
+  /**
+   * @brief An empty columnar table. No page is allocated until rows are
+   * appended.
+   */
+  explicit ColumnStore(const TableMeta& t_tbl);
+
+  /**
+   * @brief Reads the descriptor written by `write_to`.
+   */
+  static auto read_from(const TableMeta& t_tbl, const Ptr& t_pos,
+                        std::istream& t_in) -> ColumnStore;
+
+  void write_to(const Ptr& t_pos, std::ostream& t_out) const;
+
+  [[nodiscard]] auto descriptor_size() const noexcept -> std::size_t {
+    return sizeof(m_n_rows) + (m_chains.size() * 3 * sizeof(page_ptr_t)) +
+           sizeof(page_ptr_t);
+  }
+
+  [[nodiscard]] auto n_rows() const noexcept -> uint64_t { return m_n_rows; }
+  [[nodiscard]] auto n_cols() const noexcept -> std::size_t {
+    return m_types.size();
+  }
+
+  /**
+   * @return The first page of a column, NULL_PAGE if the table is empty.
+   */
+  [[nodiscard]] auto first_page(std::size_t t_pos) const -> page_ptr_t {
+    return m_chains[t_pos].first;
+  }
+
+  /**
+   * @return The zones of a column, one per page, in page order.
+   */
+  [[nodiscard]] auto zones(std::size_t t_pos) const -> std::span<const Zone> {
+    return m_zones[t_pos].zones();
+  }
+
+  /**
+   * @param t_key A key value, given as its bytes (see `ColumnVector::bytes`).
+   * @return false if no row has this key for sure. Always true if the table
+   * has no key.
+   */
+  [[nodiscard]] auto may_contain(std::string_view t_key) const -> bool;
+
+  /**
+   * @return One empty vector per column, ready to be filled and appended.
+   */
+  [[nodiscard]] auto make_batch() const -> std::vector<ColumnVector>;
+
+  /**
+   * @brief Rows `[first, first + n)`.
+   */
+  struct RowRange {
+    uint64_t first;
+    uint64_t n;
+  };
+
+  /**
+   * @brief Splits the table into ranges of whole pages of the first column,
+   * of at least `t_rows` rows each (except the last one), for several scans
+   * to share.
+   */
+  [[nodiscard]] auto split(std::size_t t_rows) const -> std::vector<RowRange>;
+
+  /**
+   * @brief Appends a batch of rows.
+   *
+   * @param t_cols One vector per column, in column order, all of the same
+   * size.
+   * @param t_heap Where long strings go.
+   * @param t_fl Where new pages come from.
+   * @param t_io The database read/write stream.
+   * @return false if the vectors don't match the table. Nothing is written
+   * then.
+   */
+  auto append(std::span<const ColumnVector> t_cols, Heap& t_heap,
+              FreeList& t_fl, std::iostream& t_io) -> bool;
+
+  /**
+   * @class Scanner
+   * @brief Reads some columns of a columnar table, one batch at a time. Each
+   * scanned column is read one whole page at a time, and a page none of
+   * whose rows are wanted isn't read at all.
+   *
+   * Appending to the table while a scanner is alive is not supported.
+   */
+  class TINYDB_EXPORT Scanner {
+  public:
+    /**
+     * @brief Fills one vector per scanned column with the next rows. With a
+     * filter, only with the rows that match.
+     *
+     * @param t_out One vector per scanned column, in the order they were
+     * passed to `scan`. They are cleared first.
+     * @param t_max The maximum number of rows to produce.
+     * @return The number of rows produced. 0 once every row has been read.
+     */
+    auto next(std::span<ColumnVector> t_out, std::size_t t_max = BATCH_SIZE)
+        -> std::size_t;
+
+    /**
+     * @return One empty vector per scanned column, to pass to `next`.
+     */
+    [[nodiscard]] auto make_batch() const -> std::vector<ColumnVector>;
+
+    /**
+     * @brief Only scans some rows. Pages before them aren't read at all.
+     * Must be called before the first `next`.
+     */
+    void restrict_to(RowRange t_range);
+
+  private:
+    friend class ColumnStore;
+    struct Cursor {
+      column::ColType type;
+      // a copy of the column's zones, which is also the list of its pages.
+      std::vector<Zone> zones;
+      // the current page, as an index inside `zones`.
+      std::size_t zone;
+      // next value to read inside the page.
+      std::size_t idx;
+      // whether `page` holds the current page yet. Pages are only read once
+      // a value is actually needed from them.
+      bool loaded;
+      std::vector<char> page;
+      ColumnEncoding encoding;
+      page_off_t data_off;
+      // encoded pages: [offset, length) of each dictionary entry in `page`.
+      std::vector<std::pair<page_off_t, page_off_t>> dict;
+      // Rle pages: the run `idx` is in, and how much of it is before `idx`.
+      std::size_t run;
+      std::size_t run_off;
+    };
+
+    Scanner(std::vector<Cursor> t_cursors, uint64_t t_n_rows,
+            std::optional<ColumnFilter> t_filter, std::istream& t_in)
+        : m_cursors{std::move(t_cursors)}, m_left{t_n_rows},
+          m_filter{std::move(t_filter)}, m_in{&t_in} {}
+
+    // the last one reads the filtered column, if there's a filter. It's
+    // never output, even if the same column is also scanned.
+    std::vector<Cursor> m_cursors;
+    uint64_t m_left;
+    std::optional<ColumnFilter> m_filter;
+    // whether each dictionary entry of the filter cursor's page matches.
+    std::vector<uint8_t> m_dict_match;
+    // whether each row of the current batch matches.
+    std::vector<uint8_t> m_mask;
+    std::istream* m_in;
+
+    /**
+     * @brief Reads the current page of a cursor, and positions it at `idx`.
+     */
+    void load(Cursor& t_cur);
+    /**
+     * @brief Moves a cursor past `t_n` values of its current page.
+     */
+    static void skip(Cursor& t_cur, std::size_t t_n);
+    /**
+     * @return How many values are left in the current page of a cursor,
+     * moving to the next page first if there are none.
+     */
+    static auto left_in_page(Cursor& t_cur) -> std::size_t;
+    auto next_code(Cursor& t_cur) -> uint8_t;
+    /**
+     * @brief Decodes the next `t_n` values of a column into `t_out`, skipping
+     * those whose byte in `t_mask` (if any) is 0.
+     */
+    void fill(Cursor& t_cur, ColumnVector& t_out, std::size_t t_n,
+              const uint8_t* t_mask);
+    /**
+     * @brief Evaluates the filter over the next `t_n` values of the filter
+     * cursor, into `m_mask`.
+     * @return The number of matches.
+     */
+    auto eval(std::size_t t_n) -> std::size_t;
+  };
+
+  /**
+   * @brief Starts a scan over the specified columns.
+   *
+   * @param t_cols Positions of the columns to read.
+   * @param t_in Must stay alive as long as the scanner does.
+   */
+  [[nodiscard]] auto scan(std::span<const std::size_t> t_cols,
+                          std::istream& t_in) const -> Scanner;
+
+  /**
+   * @brief Starts a scan that only returns the rows matching a filter.
+   */
+  [[nodiscard]] auto scan(std::span<const std::size_t> t_cols,
+                          ColumnFilter t_filter, std::istream& t_in) const
+      -> Scanner;
+
+private:
+  struct Chain {
+    page_ptr_t first{NULL_PAGE};
+    page_ptr_t last{NULL_PAGE};
+  };
+  std::vector<column::ColType> m_types;
+  std::vector<Chain> m_chains;
+  std::vector<ZoneMap> m_zones;
+  uint64_t m_n_rows{0};
+  // position of the key column, if there's one.
+  std::optional<std::size_t> m_key;
+  std::optional<BloomFilter> m_bloom;
+
+  void append_column(std::size_t t_pos, const ColumnVector& t_col,
+                     Heap& t_heap, FreeList& t_fl, std::iostream& t_io);
+
+  /**
+   * @brief Adds freshly appended keys to the Bloom filter, or rebuilds it
+   * if it's too small for the table now.
+   */
+  void update_bloom(const ColumnVector& t_keys, FreeList& t_fl,
+                    std::iostream& t_io);
+
+  /**
+   * @brief Appends values to a plain page, until either the page or the
+   * values run out.
+   * @return The number of values appended.
+   */
+  static auto append_plain_fixed(ColumnPageMeta& t_meta,
+                                 const ColumnVector& t_col,
+                                 std::size_t t_from, std::iostream& t_io)
+      -> std::size_t;
+  static auto append_plain_text(ColumnPageMeta& t_meta,
+                                const ColumnVector& t_col, std::size_t t_from,
+                                Heap& t_heap, FreeList& t_fl,
+                                std::iostream& t_io) -> std::size_t;
+
+  /**
+   * @brief Writes a whole Dict or Rle page.
+   */
+  static void write_encoded(ColumnPageMeta& t_meta, const ColumnVector& t_col,
+                            std::size_t t_from, std::size_t t_count,
+                            std::iostream& t_io);
+
+  /**
+   * @brief Adds a new page at the end of a column's chain.
+   */
+  auto new_page(std::size_t t_pos, ColumnEncoding t_encoding, FreeList& t_fl,
+                std::iostream& t_io) -> ColumnPageMeta;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_COLUMN_STORE_HXX
@@ -0,0 +1,115 @@
+/**
+ * @file column_vector.cxx
+ * @brief Definitions for column_vector.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include <cassert>
+#ifndef IMPORT_STD
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.coltype;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/coltype.hxx"
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/column_vector.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+template <typename T> auto load_as(std::string_view t_bytes) -> T {
+  T ret;
+  std::memcpy(&ret, t_bytes.data(), sizeof(T));
+  return ret;
+}
+
+template <typename T> auto three_way(const T& t_lhs, const T& t_rhs) -> int {
+  if (t_lhs < t_rhs) {
+    return -1;
+  }
+  return t_rhs < t_lhs ? 1 : 0;
+}
+
+} // namespace
+
+auto compare_values(column::ColType t_type, std::string_view t_lhs,
+                    std::string_view t_rhs) -> int {
+  using enum column::ColType;
+  switch (t_type) {
+  case Int8:
+    return three_way(load_as<int8_t>(t_lhs), load_as<int8_t>(t_rhs));
+  case Uint8:
+    return three_way(load_as<uint8_t>(t_lhs), load_as<uint8_t>(t_rhs));
+  case Int16:
+    return three_way(load_as<int16_t>(t_lhs), load_as<int16_t>(t_rhs));
+  case Uint16:
+    return three_way(load_as<uint16_t>(t_lhs), load_as<uint16_t>(t_rhs));
+  case Int32:
+    return three_way(load_as<int32_t>(t_lhs), load_as<int32_t>(t_rhs));
+  case Uint32:
+    return three_way(load_as<uint32_t>(t_lhs), load_as<uint32_t>(t_rhs));
+  case Int64:
+    return three_way(load_as<int64_t>(t_lhs), load_as<int64_t>(t_rhs));
+  case Uint64:
+    return three_way(load_as<uint64_t>(t_lhs), load_as<uint64_t>(t_rhs));
+  case Float32:
+    return three_way(load_as<float>(t_lhs), load_as<float>(t_rhs));
+  case Float64:
+    return three_way(load_as<double>(t_lhs), load_as<double>(t_rhs));
+  case Text:
+    return three_way(t_lhs, t_rhs);
+  default:
+    // CharN: the zero padding isn't part of the string.
+    return three_way(t_lhs.substr(0, t_lhs.find('\0')),
+                     t_rhs.substr(0, t_rhs.find('\0')));
+  }
+}
+
+auto satisfies(CmpOp t_op, int t_cmp) -> bool {
+  switch (t_op) {
+  case CmpOp::Eq:
+    return t_cmp == 0;
+  case CmpOp::Ne:
+    return t_cmp != 0;
+  case CmpOp::Lt:
+    return t_cmp < 0;
+  case CmpOp::Le:
+    return t_cmp <= 0;
+  case CmpOp::Gt:
+    return t_cmp > 0;
+  case CmpOp::Ge:
+    return t_cmp >= 0;
+  default:
+    std::unreachable();
+  }
+}
+
+auto matches(const ColumnFilter& t_filter, column::ColType t_type,
+             std::string_view t_val) -> bool {
+  return satisfies(t_filter.op, compare_values(t_type, t_val, t_filter.value));
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,196 @@
+/**
+ * @file column_vector.hxx
+ * @brief Declares ColumnVector, a batch of values of a single column, and
+ * the simple filters scans evaluate over them.
+ *
+ * Shared by column_store, which produces and consumes them, and zone_map,
+ * which summarizes them.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_COLUMN_VECTOR_HXX
+#define TINYDB_DBFILE_INTERNAL_COLUMN_VECTOR_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/coltype.hxx"
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @class ColumnVector
+ * @brief The values of one column for a batch of rows.
+ *
+ * Fixed-width values are stored back to back in `data`, so `values<T>()` is
+ * a plain array. Text values are stored back to back in `data` too, with
+ * string `i` being `data[offsets[i], offsets[i + 1])`.
+ *
+ * Clearing a vector keeps its memory, so reusing one for every batch of a
+ * scan doesn't allocate after the first batch.
+ */
+struct TINYDB_EXPORT ColumnVector {
+  column::ColType type;
+  std::vector<char> data;
+  // Text only. Always one more than the number of values.
+  std::vector<uint32_t> offsets;
+  // one byte per value, non-zero if NULL. Bytes and not bits, so that
+  // filters can combine them with their own results directly.
+  std::vector<uint8_t> nulls;
+
+  explicit ColumnVector(column::ColType t_type) : type{t_type} {
+    if (type == column::ColType::Text) {
+      offsets.push_back(0);
+    }
+  }
+
+  [[nodiscard]] auto size() const noexcept -> std::size_t {
+    return nulls.size();
+  }
+
+  void clear() noexcept {
+    data.clear();
+    nulls.clear();
+    if (type == column::ColType::Text) {
+      offsets.resize(1);
+    }
+  }
+
+  [[nodiscard]] auto is_null(std::size_t t_idx) const -> bool {
+    return nulls[t_idx] != 0;
+  }
+
+  /**
+   * @tparam T Must be the native type of the column.
+   */
+  template <typename T>
+  [[nodiscard]] auto values() const -> std::span<const T> {
+    assert(type != column::ColType::Text &&
+           sizeof(T) == column::type_size(type));
+    return {std::bit_cast<const T*>(data.data()), size()};
+  }
+
+  [[nodiscard]] auto text(std::size_t t_idx) const -> std::string_view {
+    assert(type == column::ColType::Text);
+    return {data.data() + offsets[t_idx],
+            offsets[t_idx + 1] - offsets[t_idx]};
+  }
+
+  /**
+   * @return The bytes of a non-NULL value: the string itself for Text, the
+   * bytes of the native value otherwise.
+   */
+  [[nodiscard]] auto bytes(std::size_t t_idx) const -> std::string_view {
+    if (type == column::ColType::Text) {
+      return text(t_idx);
+    }
+    auto width = column::type_size(type);
+    return {data.data() + (t_idx * width), width};
+  }
+
+  /**
+   * @tparam T Must be the native type of the column.
+   */
+  template <typename T> void push(const T& t_val) {
+    assert(type != column::ColType::Text &&
+           sizeof(T) == column::type_size(type));
+    const auto* bytes = std::bit_cast<const char*>(&t_val);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+    nulls.push_back(0);
+  }
+
+  void push_text(std::string_view t_str) {
+    assert(type == column::ColType::Text);
+    data.insert(data.end(), t_str.begin(), t_str.end());
+    offsets.push_back(static_cast<uint32_t>(data.size()));
+    nulls.push_back(0);
+  }
+
+  /**
+   * @brief Pushes a value given as its bytes, as returned by `bytes`.
+   */
+  void push_bytes(std::string_view t_bytes) {
+    if (type == column::ColType::Text) {
+      push_text(t_bytes);
+      return;
+    }
+    assert(t_bytes.size() == column::type_size(type));
+    data.insert(data.end(), t_bytes.begin(), t_bytes.end());
+    nulls.push_back(0);
+  }
+
+  void push_null() {
+    if (type == column::ColType::Text) {
+      offsets.push_back(offsets.back());
+    } else {
+      data.resize(data.size() + column::type_size(type), '\0');
+    }
+    nulls.push_back(1);
+  }
+};
+
+enum class TINYDB_EXPORT CmpOp : uint8_t { Eq, Ne, Lt, Le, Gt, Ge };
+
+/**
+ * @class ColumnFilter
+ * @brief `column <op> constant`, evaluated by a scan itself. Like in SQL, a
+ * NULL never matches.
+ */
+struct TINYDB_EXPORT ColumnFilter {
+  // position inside TableMeta::columns().
+  std::size_t col;
+  CmpOp op;
+  // The constant: the bytes of a value of the column's native type, or the
+  // string itself for Text.
+  std::string value;
+
+  /**
+   * @tparam T Must be the native type of the column.
+   */
+  template <typename T>
+  static auto of(std::size_t t_col, CmpOp t_op, const T& t_val)
+      -> ColumnFilter {
+    return {.col = t_col,
+            .op = t_op,
+            .value{std::bit_cast<const char*>(&t_val), sizeof(T)}};
+  }
+
+  static auto of_text(std::size_t t_col, CmpOp t_op, std::string_view t_val)
+      -> ColumnFilter {
+    return {.col = t_col, .op = t_op, .value = std::string{t_val}};
+  }
+};
+
+/**
+ * @brief Compares 2 non-NULL values of the specified type, given as their
+ * bytes (see `ColumnVector::bytes`).
+ * @return Negative, zero or positive, like `memcmp`.
+ */
+TINYDB_EXPORT auto compare_values(column::ColType t_type,
+                                  std::string_view t_lhs,
+                                  std::string_view t_rhs) -> int;
+
+/**
+ * @return Whether `<lhs> <op> <rhs>` holds, given `compare_values(lhs, rhs)`.
+ */
+TINYDB_EXPORT auto satisfies(CmpOp t_op, int t_cmp) -> bool;
+
+/**
+ * @return Whether a non-NULL value, given as its bytes, matches a filter.
+ */
+TINYDB_EXPORT auto matches(const ColumnFilter& t_filter, column::ColType t_type,
+                           std::string_view t_val) -> bool;
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_COLUMN_VECTOR_HXX
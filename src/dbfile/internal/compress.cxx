@@ -0,0 +1,243 @@
+/**
+ * @file compress.cxx
+ * @brief Definitions for compress.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include <cassert>
+#ifndef IMPORT_STD
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#endif
+export module tinydb.dbfile.internal.compress;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/compress.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+// These come straight out of the LZ4 block format description.
+constexpr std::size_t MIN_MATCH = 4;
+// The last 5 bytes of a block are always literals.
+constexpr std::size_t LAST_LITERALS = 5;
+// The last match must start at least 12 bytes before the end of a block.
+constexpr std::size_t MF_LIMIT = 12;
+constexpr std::size_t MAX_OFFSET = 65535;
+constexpr uint8_t RUN_MASK = 15;
+constexpr uint8_t RUN_BITS = 4;
+constexpr uint8_t LEN_EXTEND = 255;
+
+constexpr std::size_t HASH_LOG = 12;
+
+auto read32(const char* t_p) -> uint32_t {
+  uint32_t ret{};
+  std::memcpy(&ret, t_p, sizeof(ret));
+  return ret;
+}
+
+auto hash(uint32_t t_seq) -> std::size_t {
+  // Knuth's multiplicative hash, the same constant LZ4 uses.
+  constexpr uint32_t prime = 2654435761U;
+  constexpr uint32_t shift = 32 - HASH_LOG;
+  return (t_seq * prime) >> shift;
+}
+
+/**
+ * @brief Appends bytes to a span, refusing to write past its end.
+ */
+class Writer {
+public:
+  explicit Writer(std::span<char> t_dst) : m_dst{t_dst} {}
+
+  auto put(char t_c) -> bool {
+    if (m_pos >= m_dst.size()) {
+      return false;
+    }
+    m_dst[m_pos++] = t_c;
+    return true;
+  }
+
+  auto put(std::span<const char> t_bytes) -> bool {
+    if (m_dst.size() - m_pos < t_bytes.size()) {
+      return false;
+    }
+    std::memcpy(m_dst.data() + m_pos, t_bytes.data(), t_bytes.size());
+    m_pos += t_bytes.size();
+    return true;
+  }
+
+  // Writes the 255-run that follows a saturated token nibble.
+  auto put_len(std::size_t t_len) -> bool {
+    while (t_len >= LEN_EXTEND) {
+      if (!put(static_cast<char>(LEN_EXTEND))) {
+        return false;
+      }
+      t_len -= LEN_EXTEND;
+    }
+    return put(static_cast<char>(t_len));
+  }
+
+  [[nodiscard]] auto pos() const noexcept -> std::size_t { return m_pos; }
+
+private:
+  std::span<char> m_dst;
+  std::size_t m_pos{0};
+};
+
+/**
+ * @brief Writes one sequence. `t_match_len` of 0 means "this is the last
+ * sequence", which only carries literals.
+ */
+auto write_sequence(Writer& t_out, std::span<const char> t_literals,
+                    std::size_t t_offset, std::size_t t_match_len) -> bool {
+  auto lit_len = t_literals.size();
+  auto lit_nibble = static_cast<uint8_t>(lit_len < RUN_MASK ? lit_len : RUN_MASK);
+  auto match_code = t_match_len == 0 ? 0 : t_match_len - MIN_MATCH;
+  auto match_nibble =
+      static_cast<uint8_t>(match_code < RUN_MASK ? match_code : RUN_MASK);
+  if (!t_out.put(static_cast<char>((lit_nibble << RUN_BITS) | match_nibble))) {
+    return false;
+  }
+  if (lit_nibble == RUN_MASK && !t_out.put_len(lit_len - RUN_MASK)) {
+    return false;
+  }
+  if (!t_out.put(t_literals)) {
+    return false;
+  }
+  if (t_match_len == 0) {
+    return true;
+  }
+  if (!t_out.put(static_cast<char>(t_offset & 0xFF)) ||
+      !t_out.put(static_cast<char>(t_offset >> 8))) {
+    return false;
+  }
+  if (match_nibble == RUN_MASK && !t_out.put_len(match_code - RUN_MASK)) {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+auto lz4_compress(std::span<const char> t_src, std::span<char> t_dst)
+    -> std::size_t {
+  assert(t_src.size() <= MAX_OFFSET);
+  Writer out{t_dst};
+  const auto len = t_src.size();
+  const char* src = t_src.data();
+  std::size_t anchor = 0;
+
+  if (len >= MF_LIMIT + 1) {
+    // Positions are stored off by one so that 0 means "empty slot".
+    std::array<uint32_t, std::size_t{1} << HASH_LOG> table{};
+    std::size_t ip = 0;
+    while (ip + MF_LIMIT <= len) {
+      auto seq = read32(src + ip);
+      auto& slot = table[hash(seq)];
+      auto candidate = static_cast<std::size_t>(slot);
+      slot = static_cast<uint32_t>(ip + 1);
+      if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET ||
+          read32(src + candidate - 1) != seq) {
+        ++ip;
+        continue;
+      }
+      --candidate;
+      auto match_len = MIN_MATCH;
+      while (ip + match_len < len - LAST_LITERALS &&
+             src[candidate + match_len] == src[ip + match_len]) {
+        ++match_len;
+      }
+      if (!write_sequence(out, t_src.subspan(anchor, ip - anchor),
+                          ip - candidate, match_len)) {
+        return 0;
+      }
+      ip += match_len;
+      anchor = ip;
+    }
+  }
+
+  if (!write_sequence(out, t_src.subspan(anchor), 0, 0)) {
+    return 0;
+  }
+  return out.pos();
+}
+
+auto lz4_decompress(std::span<const char> t_src, std::span<char> t_dst)
+    -> bool {
+  std::size_t ip = 0;
+  std::size_t op = 0;
+  // Reads the 255-run after a saturated nibble. False if the input ends
+  // before the run does.
+  auto read_len = [&](std::size_t& t_len) -> bool {
+    uint8_t byte{LEN_EXTEND};
+    while (byte == LEN_EXTEND) {
+      if (ip >= t_src.size()) {
+        return false;
+      }
+      byte = static_cast<uint8_t>(t_src[ip++]);
+      t_len += byte;
+    }
+    return true;
+  };
+
+  while (ip < t_src.size()) {
+    auto token = static_cast<uint8_t>(t_src[ip++]);
+    std::size_t lit_len = token >> RUN_BITS;
+    if (lit_len == RUN_MASK && !read_len(lit_len)) {
+      return false;
+    }
+    if (t_src.size() - ip < lit_len || t_dst.size() - op < lit_len) {
+      return false;
+    }
+    std::memcpy(t_dst.data() + op, t_src.data() + ip, lit_len);
+    ip += lit_len;
+    op += lit_len;
+    if (ip == t_src.size()) {
+      // the last sequence has no match part.
+      break;
+    }
+
+    if (t_src.size() - ip < 2) {
+      return false;
+    }
+    std::size_t offset = static_cast<uint8_t>(t_src[ip]) |
+                         (static_cast<std::size_t>(
+                              static_cast<uint8_t>(t_src[ip + 1]))
+                          << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) {
+      return false;
+    }
+    std::size_t match_len = token & RUN_MASK;
+    if (match_len == RUN_MASK && !read_len(match_len)) {
+      return false;
+    }
+    match_len += MIN_MATCH;
+    if (t_dst.size() - op < match_len) {
+      return false;
+    }
+    // byte by byte, since the match may overlap what it is writing.
+    for (std::size_t i = 0; i < match_len; ++i, ++op) {
+      t_dst[op] = t_dst[op - offset];
+    }
+  }
+  return op == t_dst.size();
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,57 @@
+/**
+ * @file compress.hxx
+ * @brief Declares a small block compressor for pages.
+ *
+ * The format produced is the LZ4 block format (sequences of a token, literals,
+ * a 2-byte little-endian offset and a match length), so any LZ4 block decoder
+ * can read it back. It is written from scratch instead of pulling in liblz4:
+ * we only ever compress one page at a time, so a greedy single-probe matcher
+ * is plenty.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_COMPRESS_HXX
+#define TINYDB_DBFILE_INTERNAL_COMPRESS_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include <cstddef>
+#include <span>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @brief Compresses `t_src` into `t_dst`.
+ *
+ * @param t_src The bytes to compress. Must be smaller than 64KiB, which a page
+ * always is.
+ * @param t_dst Where the compressed bytes go.
+ * @return The number of bytes written into `t_dst`, or 0 if the compressed
+ * form does not fit inside `t_dst`. Callers should store the data
+ * uncompressed in that case.
+ */
+auto TINYDB_EXPORT lz4_compress(std::span<const char> t_src,
+                                std::span<char> t_dst) -> std::size_t;
+
+/**
+ * @brief Decompresses `t_src` into `t_dst`.
+ *
+ * Every read and write is bounds-checked, so feeding this garbage does not
+ * corrupt memory.
+ *
+ * @param t_src The compressed bytes.
+ * @param t_dst Where the decompressed bytes go. Must be exactly the size of
+ * the original data.
+ * @return Whether `t_src` was well-formed and decompressed into exactly
+ * `t_dst.size()` bytes.
+ */
+auto TINYDB_EXPORT lz4_decompress(std::span<const char> t_src,
+                                  std::span<char> t_dst) -> bool;
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_COMPRESS_HXX
@@ -9,6 +9,7 @@ module;
 #ifndef IMPORT_STD
 #include <bit>
 #include <iostream>
+#include <mutex>
 #endif
 export module tinydb.dbfile.internal.freelist;
 import tinydb.dbfile.internal.page;
@@ -22,6 +23,7 @@ import std;
 #include "general/offsets.hxx"
 #include <bit>
 #include <iostream>
+#include <mutex>
 #endif // ENABLE_MODULES
 
 #include "dbfile/internal/freelist.hxx"
@@ -53,6 +55,11 @@ auto FreeList::default_init(uint32_t t_first_free_pg, std::ostream& t_out)
 }
 
 void FreeList::do_write_to(std::ostream& t_out) {
+  const std::scoped_lock lock{m_latch};
+  write_head_to(t_out);
+}
+
+void FreeList::write_head_to(std::ostream& t_out) {
   t_out.seekp(FREELIST_PTR_OFF);
   t_out.rdbuf()->sputn(std::bit_cast<const char*>(&m_first_free_pg),
                        sizeof(m_first_free_pg));
@@ -61,6 +68,7 @@ void FreeList::do_write_to(std::ostream& t_out) {
 void FreeList::deallocate_page(std::iostream& t_io, PageMixin&& t_meta) {
   // move is to shut the compiler up.
   auto pgnum = std::move(t_meta).get_pg_num();
+  const std::scoped_lock lock{m_latch};
   auto curr_free_pg = m_first_free_pg;
   // this should never happen anyways.
   if (curr_free_pg == pgnum) {
@@ -79,7 +87,7 @@ void FreeList::deallocate_page(std::iostream& t_io, PageMixin&& t_meta) {
     // FreePageMeta freepg{curr_free_pg};
     // read_from(freepg, t_io);
     auto freepg = read_from<FreePageMeta>(curr_free_pg, t_io);
-    curr_free_pg = freepg.get_pg_num();
+    curr_free_pg = freepg.get_next_pg();
   }
   // the same as inserting a node to a linked list.
   write_to(FreePageMeta{prev_free_pg, pgnum}, t_io);
@@ -87,6 +95,7 @@ void FreeList::deallocate_page(std::iostream& t_io, PageMixin&& t_meta) {
 }
 
 [[nodiscard]] auto FreeList::next_free_page(std::iostream& t_io) -> page_ptr_t {
+  const std::scoped_lock lock{m_latch};
   auto old_first_free = m_first_free_pg;
   // FreePageMeta fpage{m_first_free_pg};
   // read_from(fpage, t_io);
@@ -110,7 +119,7 @@ void FreeList::deallocate_page(std::iostream& t_io, PageMixin&& t_meta) {
   fpage.update_next_pg(filesize - 1);
   write_to(fpage, t_io);
   m_first_free_pg = filesize - 1;
-  do_write_to(t_io);
+  write_head_to(t_io);
 
   return old_first_free;
 }
@@ -12,6 +12,7 @@
 #include "dbfile/internal/page_base.hxx"
 #include "dbfile/internal/page_serialize.hxx"
 #include <iosfwd>
+#include <mutex>
 #endif // !ENABLE_MODULES
 
 #ifdef ENABLE_MODULES
@@ -36,9 +37,25 @@ namespace tinydb::dbfile::internal {
  * - "Deallocate" means repurposing a page of different type back into a free
  * page.
  *
+ * A FreeList is thread-safe, as long as every thread passes a stream of its
+ * own over the same file (see PageStream): its head has a latch, held while
+ * a page is allocated or deallocated.
+ *
  */
 class TINYDB_EXPORT FreeList {
 public:
+  // copies the head only, the latch is the copy's own.
+  FreeList(const FreeList& t_other) : m_first_free_pg{t_other.head()} {}
+  auto operator=(const FreeList& t_other) -> FreeList& {
+    if (this != &t_other) {
+      auto head = t_other.head();
+      const std::scoped_lock lock{m_latch};
+      m_first_free_pg = head;
+    }
+    return *this;
+  }
+  ~FreeList() = default;
+
   // This should be written into the header of the database file.
   // This is constant-sized so I expect this to be written before the table
   // definition.
@@ -99,12 +116,20 @@ public:
 
 private:
   FreeList(uint32_t t_first_free_pg) : m_first_free_pg{t_first_free_pg} {}
-  // first free page.
+  mutable std::mutex m_latch;
+  // first free page. Guarded by `m_latch`.
   uint32_t m_first_free_pg;
 
+  [[nodiscard]] auto head() const -> uint32_t {
+    const std::scoped_lock lock{m_latch};
+    return m_first_free_pg;
+  }
+
+  void write_head_to(std::ostream& t_out);
+
   /**
    * @brief Returns the current `m_first_free_pg`, reads the stream passed in,
-   * and updates `m_first_free_pg` to be the next free page.
+   * and updates `m_first_free_pg` to be the next free page. Takes the latch.
    * @return The current `m_first_free_pg`.
    */
   [[nodiscard]] auto next_free_page(std::iostream& t_io) -> page_ptr_t;
@@ -0,0 +1,130 @@
+/**
+ * @file header.cxx
+ * @brief Definitions for header.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/offsets.hxx"
+#include "general/sizes.hxx"
+#include "version.hxx"
+#ifndef IMPORT_STD
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#endif
+export module tinydb.dbfile.internal.header;
+import tinydb.dbfile.internal.page_base;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/internal/page_base.hxx"
+#include "general/offsets.hxx"
+#include "general/sizes.hxx"
+#include "version.hxx"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/header.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+constexpr uint32_t CRC32_POLY = 0xEDB88320;
+
+constexpr auto crc32_table() -> std::array<uint32_t, 256> {
+  std::array<uint32_t, 256> ret{};
+  for (uint32_t i = 0; i < ret.size(); ++i) {
+    auto crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32_POLY : 0);
+    }
+    ret[i] = crc;
+  }
+  return ret;
+}
+
+constexpr auto CRC32_TABLE = crc32_table();
+
+template <typename T>
+auto field(std::span<const char> t_bytes, uint16_t t_off) -> T {
+  T ret{};
+  std::memcpy(&ret, t_bytes.data() + t_off, sizeof(T));
+  return ret;
+}
+
+template <typename T>
+void set_field(std::span<char> t_bytes, uint16_t t_off, const T& t_val) {
+  std::memcpy(t_bytes.data() + t_off, &t_val, sizeof(T));
+}
+
+} // namespace
+
+auto crc32(std::span<const char> t_bytes) noexcept -> uint32_t {
+  uint32_t crc{~uint32_t{0}};
+  for (auto byte : t_bytes) {
+    crc = CRC32_TABLE[(crc ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void stamp_header(std::span<char> t_page) noexcept {
+  set_field(t_page, HEADER_CHECKSUM_OFF,
+            crc32(t_page.first(HEADER_CHECKSUM_OFF)));
+}
+
+auto read_header(std::istream& t_in) -> FileHeader {
+  std::array<char, HEADER_SIZE> bytes{};
+  t_in.seekg(0);
+  if (t_in.rdbuf()->sgetn(bytes.data(), HEADER_SIZE) != HEADER_SIZE) {
+    throw std::ios_base::failure("File header is truncated");
+  }
+  const std::span<const char> view{bytes};
+  if (field<uint32_t>(view, HEADER_CHECKSUM_OFF) !=
+      crc32(view.first(HEADER_CHECKSUM_OFF))) {
+    throw std::ios_base::failure("Corrupted file header");
+  }
+  FileHeader ret{.m_major = field<uint16_t>(view, VERSION_MAJOR_OFF),
+                 .m_minor = field<uint16_t>(view, VERSION_MINOR_OFF),
+                 .m_patch = field<uint16_t>(view, VERSION_PATCH_OFF),
+                 .m_n_pages = field<uint32_t>(view, DBFILE_SIZE_OFF),
+                 .m_freelist = field<page_ptr_t>(view, FREELIST_PTR_OFF),
+                 .m_heap = field<page_ptr_t>(view, HEAP_OFF),
+                 .m_catalog = field<page_ptr_t>(view, CATALOG_PTR_OFF)};
+  if (ret.m_major != VERSION_MAJOR) {
+    throw std::ios_base::failure("File written by another major version");
+  }
+  // the freelist always has a page, the last one at worst.
+  if (ret.m_n_pages == 0 || ret.m_freelist == NULL_PAGE ||
+      ret.m_freelist >= ret.m_n_pages || ret.m_heap >= ret.m_n_pages ||
+      ret.m_catalog >= ret.m_n_pages) {
+    throw std::ios_base::failure("File header points past the file");
+  }
+  return ret;
+}
+
+void write_header(const FileHeader& t_header, std::ostream& t_out) {
+  std::array<char, HEADER_CHECKSUM_OFF> bytes{};
+  const std::span<char> view{bytes};
+  set_field(view, VERSION_MAJOR_OFF, t_header.m_major);
+  set_field(view, VERSION_MINOR_OFF, t_header.m_minor);
+  set_field(view, VERSION_PATCH_OFF, t_header.m_patch);
+  set_field(view, DBFILE_SIZE_OFF, t_header.m_n_pages);
+  set_field(view, FREELIST_PTR_OFF, t_header.m_freelist);
+  set_field(view, HEAP_OFF, t_header.m_heap);
+  set_field(view, CATALOG_PTR_OFF, t_header.m_catalog);
+  t_out.seekp(0);
+  t_out.rdbuf()->sputn(bytes.data(), HEADER_CHECKSUM_OFF);
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,73 @@
+/**
+ * @file header.hxx
+ * @brief Declares how the header of a database file, at the start of page 0,
+ * is read, written and checked.
+ *
+ * Every field sits at a fixed offset (see general/offsets.hxx), followed by
+ * a CRC-32 of all of them at HEADER_CHECKSUM_OFF. The page cache stamps the
+ * checksum whenever it writes page 0 back, so whatever changes a field
+ * (FreeList, SchemaCatalog...) doesn't have to know about it.
+ *
+ * Opening a file reads the header in one go, checks it, and nothing else.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_HEADER_HXX
+#define TINYDB_DBFILE_INTERNAL_HEADER_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/internal/page_base.hxx"
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @class FileHeader
+ * @brief The fields of the header, as they're laid out in page 0.
+ */
+struct TINYDB_EXPORT FileHeader {
+  uint16_t m_major;
+  uint16_t m_minor;
+  uint16_t m_patch;
+  // in pages, header included.
+  uint32_t m_n_pages;
+  page_ptr_t m_freelist;
+  page_ptr_t m_heap;
+  page_ptr_t m_catalog;
+};
+
+/**
+ * @brief CRC-32 (the zlib one) of some bytes.
+ */
+auto TINYDB_EXPORT crc32(std::span<const char> t_bytes) noexcept -> uint32_t;
+
+/**
+ * @brief Writes the checksum of the header into page 0, given whole.
+ */
+void TINYDB_EXPORT stamp_header(std::span<char> t_page) noexcept;
+
+/**
+ * @brief Reads the header of a file, and checks it.
+ * @throw std::ios_base::failure if the checksum doesn't match, the file was
+ * written by another major version, or a page pointer is past the end of
+ * the file.
+ */
+auto TINYDB_EXPORT read_header(std::istream& t_in) -> FileHeader;
+
+/**
+ * @brief Writes every field of the header. The checksum is left to the page
+ * cache, or to `stamp_header`.
+ */
+void TINYDB_EXPORT write_header(const FileHeader& t_header,
+                                std::ostream& t_out);
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_HEADER_HXX
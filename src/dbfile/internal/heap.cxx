@@ -12,13 +12,19 @@ module;
 #include "general/utils.hxx"
 #include <cassert>
 #ifndef IMPORT_STD
+#include <array>
+#include <atomic>
 #include <bit>
 #include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 #endif
 export module tinydb.dbfile.internal.heap;
 export import tinydb.dbfile.internal.heap_base;
@@ -36,13 +42,19 @@ import std;
 #include "general/offsets.hxx"
 #include "general/sizes.hxx"
 #include "general/utils.hxx"
+#include <array>
+#include <atomic>
 #include <bit>
 #include <cassert>
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 #endif // ENABLE_MODULES
 
 #include "dbfile/internal/heap.hxx"
@@ -68,15 +80,6 @@ auto read_ptr_from(const Ptr& t_pos, std::istream& t_in) -> Ptr;
  */
 void write_frag_to(const Fragment& t_frag, std::ostream& t_out);
 
-/**
- * @brief Reads the fragment at the position pointed to from the stream.
- *
- * @param t_pos Pointer to the position of the fragment.
- * @param t_in The read-only stream.
- * @return The fragment read.
- *   - Exception if there's a read error.
- */
-auto read_frag_from(const Ptr& t_pos, std::istream& t_in) -> Fragment;
 
 struct FindFragRetVal {
   Fragment ret_frag;
@@ -118,8 +121,9 @@ auto find_first_fit_frag(page_off_t t_size, bool is_chained, HeapMeta& t_meta,
  *
  * @param t_old_frag The fragment to try break. This fragment will be allocated
  * to the user.
- * @param t_next_frag The next fragment of `t_old_frag`. Can be in an
- * indeterminate state.
+ * @param t_next_frag The next free fragment of `t_old_frag`, invalid if
+ * there's none. Afterwards, whatever comes after `t_old_frag`'s spot in the
+ * free list: the new fragment if one is created.
  * @param t_old_frag_size The requested size.
  * @param heap_meta The heap meta of the heap page containing `t_old_frag` (and
  * consequently t_next_frag). Taken by reference. In case `t_old_frag` is the
@@ -132,20 +136,13 @@ auto try_break_frag(Fragment& t_old_frag, Fragment& t_next_frag,
                     std::iostream& t_io) -> bool;
 
 /**
- * @brief Updates all the parameters passed in if needed before writing them
- * into the stream.
+ * @brief Finds the largest free fragment left in the page again, before
+ * writing the heap meta into the stream.
  *
- * @param t_heap_meta Needs to be updated if max_pair and min_pair changes.
- * @param t_next_frag Will not be updated. The updating is already done in
- * `try_break_frag.`
- * @param t_max_pair Updated if there's a larger fragment (not happening in
- * `malloc`), or if it's a .
- * @param t_min_pair Updated if there's a smaller fragment.
+ * @param t_heap_meta Its max_pair is recomputed from its free list.
  * @param t_io The read/write stream.
  */
-void update_write_heap_pg(HeapMeta& t_heap_meta, const Fragment& t_next_frag,
-                          std::pair<page_off_t, page_off_t>& t_max_pair,
-                          std::iostream& t_io);
+void update_write_heap_pg(HeapMeta& t_heap_meta, std::iostream& t_io);
 
 /**
  * @brief Gets the 2 neighboring free fragments of the fragment passed in.
@@ -173,16 +170,32 @@ auto get_neighboring_free_frags(Fragment& t_curr_frag, HeapMeta& t_meta,
 auto coalesce(Fragment&& t_frag, HeapMeta& t_meta, std::iostream& t_io)
     -> Fragment;
 
-/**
- * @brief Reads from a stream and gets the heap.
- *
- * @param t_in The input stream.
- */
-auto read_heap_from(std::istream& t_in) -> Heap {
+auto read_heap_from(std::istream& t_in, std::size_t t_n_arenas) -> Heap {
   t_in.seekg(HEAP_OFF);
-  page_ptr_t first_heap{};
-  t_in.rdbuf()->sgetn(std::bit_cast<char*>(&first_heap), sizeof(first_heap));
-  return Heap{first_heap};
+  page_ptr_t head{};
+  t_in.rdbuf()->sgetn(std::bit_cast<char*>(&head), sizeof(head));
+  auto ret = Heap::with_arenas(t_n_arenas);
+  for (std::size_t i = 0; head != NULL_PAGE; ++i) {
+    const auto owner = i % t_n_arenas;
+    auto& arena{*ret.m_arenas[owner]};
+    if (arena.first_heap_page == NULL_PAGE) {
+      arena.first_heap_page = head;
+    } else {
+      // more chains than arenas: this one goes after the arena's own.
+      arena.pending.push_back(head);
+    }
+    auto meta{read_from<HeapMeta>(head, t_in)};
+    const auto next_head{meta.get_prev_pg()};
+    if (ret.m_owners) {
+      ret.m_owners->set(head, owner);
+      while (meta.get_next_pg() != NULL_PAGE) {
+        meta = read_from<HeapMeta>(meta.get_next_pg(), t_in);
+        ret.m_owners->set(meta.get_pg_num(), owner);
+      }
+    }
+    head = next_head;
+  }
+  return ret;
 }
 
 void write_ptr_to(const Ptr& t_pos, const Ptr& t_ptr, std::ostream& t_out) {
@@ -265,10 +278,120 @@ auto read_frag_from(const Ptr& t_pos, std::istream& t_in) -> Fragment {
           .type = Fragment::FragType{type}};
 }
 
-void Heap::write_heap_to(std::ostream& t_out) {
-  t_out.seekp(HEAP_OFF);
-  t_out.rdbuf()->sputn(std::bit_cast<const char*>(&m_first_heap_page),
-                       sizeof(m_first_heap_page));
+namespace {
+
+/**
+ * @return A number of its own for the calling thread, handed out in the order
+ * threads first ask for one.
+ */
+auto thread_ordinal() noexcept -> std::size_t {
+  static std::atomic<std::size_t> next{0};
+  thread_local const std::size_t ordinal{
+      next.fetch_add(1, std::memory_order_relaxed)};
+  return ordinal;
+}
+
+} // namespace
+
+Heap::Heap(page_ptr_t t_first_heap_pg) {
+  m_arenas.push_back(std::make_unique<Arena>());
+  m_arenas.front()->first_heap_page = t_first_heap_pg;
+}
+
+auto Heap::with_arenas(std::size_t t_n_arenas) -> Heap {
+  assert(t_n_arenas > 0);
+  assert(t_n_arenas < UINT16_MAX);
+  Heap ret{};
+  while (ret.m_arenas.size() < t_n_arenas) {
+    ret.m_arenas.push_back(std::make_unique<Arena>());
+  }
+  if (t_n_arenas > 1) {
+    ret.m_owners = std::make_unique<Owners>();
+  }
+  return ret;
+}
+
+Heap::Owners::~Owners() {
+  for (auto& chunk : m_chunks) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+}
+
+auto Heap::Owners::locate(page_ptr_t t_pg) noexcept
+    -> std::pair<std::size_t, std::size_t> {
+  // chunk `k` starts at FIRST_CHUNK * (2^k - 1).
+  const auto chunk =
+      static_cast<std::size_t>(std::bit_width((t_pg / FIRST_CHUNK) + 1) - 1);
+  const auto first = FIRST_CHUNK * ((std::size_t{1} << chunk) - 1);
+  return {chunk, t_pg - first};
+}
+
+auto Heap::Owners::find(page_ptr_t t_pg) const noexcept
+    -> std::optional<std::size_t> {
+  const auto [chunk, idx] = locate(t_pg);
+  const auto* slots = m_chunks[chunk].load(std::memory_order_acquire);
+  if (slots == nullptr) {
+    return std::nullopt;
+  }
+  const auto owner = slots[idx].load(std::memory_order_acquire);
+  if (owner == 0) {
+    return std::nullopt;
+  }
+  return owner - 1U;
+}
+
+void Heap::Owners::set(page_ptr_t t_pg, std::size_t t_arena) {
+  const auto [chunk, idx] = locate(t_pg);
+  auto* slots = m_chunks[chunk].load(std::memory_order_acquire);
+  if (slots == nullptr) {
+    // arenas latch their own pages only: two of them may race for a chunk.
+    auto* fresh = new slot_t[FIRST_CHUNK << chunk]{};
+    if (m_chunks[chunk].compare_exchange_strong(slots, fresh,
+                                                std::memory_order_acq_rel)) {
+      slots = fresh;
+    } else {
+      delete[] fresh;
+    }
+  }
+  slots[idx].store(static_cast<uint16_t>(t_arena + 1),
+                   std::memory_order_release);
+}
+
+auto Heap::arena_of_this_thread() const noexcept -> std::size_t {
+  return thread_ordinal() % m_arenas.size();
+}
+
+void Heap::write_heap_to(std::iostream& t_io) {
+  // nobody else ever holds more than one arena latch.
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(m_arenas.size());
+  for (auto& arena : m_arenas) {
+    locks.emplace_back(arena->latch);
+    splice_pending(*arena, t_io);
+  }
+  // linked back to front, so each head knows the one after it.
+  page_ptr_t next_head{NULL_PAGE};
+  for (auto it = m_arenas.rbegin(); it != m_arenas.rend(); ++it) {
+    auto head{(*it)->first_heap_page};
+    if (head == NULL_PAGE) {
+      continue;
+    }
+    // a file that was only read is left as it was.
+    auto head_meta{read_from<HeapMeta>(head, t_io)};
+    if (head_meta.get_prev_pg() != next_head) {
+      head_meta.update_prev_pg(next_head);
+      write_to(head_meta, t_io);
+    }
+    next_head = head;
+  }
+  page_ptr_t old_head{};
+  t_io.seekg(HEAP_OFF);
+  t_io.rdbuf()->sgetn(std::bit_cast<char*>(&old_head), sizeof(old_head));
+  if (old_head != next_head) {
+    t_io.seekp(HEAP_OFF);
+    t_io.rdbuf()->sputn(std::bit_cast<const char*>(&next_head),
+                        sizeof(next_head));
+  }
 }
 
 [[nodiscard]] auto Heap::malloc(page_off_t t_size, bool is_chained,
@@ -283,14 +406,23 @@ void Heap::write_heap_to(std::ostream& t_out) {
 
   assert(actual_size <= SIZEOF_PAGE - HeapMeta::DEFAULT_FREE_OFF);
 
-  auto heap_meta{find_first_fit_heap_pg(t_size, is_chained, t_fl, t_io)};
+  const auto arena = arena_of_this_thread();
+  const std::scoped_lock lock{m_arenas[arena]->latch};
+  splice_pending(*m_arenas[arena], t_io);
+  auto heap_meta{
+      find_first_fit_heap_pg(arena, t_size, is_chained, t_fl, t_io)};
   auto [ret_frag, next_frag, prev_frag,
         ret_off]{find_first_fit_frag(t_size, is_chained, heap_meta, t_io)};
-  auto max_pair{heap_meta.get_max_pair()};
 
   try_break_frag(ret_frag, next_frag, t_size, heap_meta, t_io);
   write_frag_to(ret_frag, t_io);
-  update_write_heap_pg(heap_meta, next_frag, max_pair, t_io);
+  // the free fragment before the one handed out now points past it.
+  if (!prev_frag.is_invalid()) {
+    prev_frag.get_free_extra().next =
+        next_frag.is_invalid() ? Fragment::NULL_FRAG_PTR : next_frag.pos.offset;
+    write_frag_to(prev_frag, t_io);
+  }
+  update_write_heap_pg(heap_meta, t_io);
 
   return std::make_pair(ret_frag, ret_off);
 }
@@ -307,6 +439,20 @@ void Heap::chain(Fragment& t_to_chain, const Fragment& t_next_frag,
 void Heap::free(Fragment&& t_frag, [[maybe_unused]] FreeList& t_fl,
                 std::iostream& t_io) {
   assert(t_frag.type != Fragment::FragType::Free);
+  std::size_t owner{0};
+  if (m_owners) {
+    // pages never change arenas, so the owner found is still the owner.
+    auto found = m_owners->find(t_frag.pos.pagenum);
+    if (!found) {
+      throw std::ios_base::failure("Fragment isn't from this heap");
+    }
+    owner = *found;
+  }
+  const std::scoped_lock lock{m_arenas[owner]->latch};
+  free_in(std::move(t_frag), t_io);
+}
+
+void Heap::free_in(Fragment&& t_frag, std::iostream& t_io) {
   auto heap_meta{read_from<HeapMeta>(t_frag.pos.pagenum, t_io)};
   if (t_frag.type == Fragment::FragType::Chained) {
     t_frag.size = static_cast<page_off_t>(t_frag.size +
@@ -341,6 +487,24 @@ void Heap::free(Fragment&& t_frag, [[maybe_unused]] FreeList& t_fl,
   write_frag_to(std::move(coalesced_frag), t_io);
 }
 
+void Heap::splice_pending(Arena& t_arena, std::iostream& t_io) {
+  auto tail{t_arena.first_heap_page};
+  for (const auto head : t_arena.pending) {
+    auto tail_meta{read_from<HeapMeta>(tail, t_io)};
+    while (tail_meta.get_next_pg() != NULL_PAGE) {
+      tail_meta = read_from<HeapMeta>(tail_meta.get_next_pg(), t_io);
+    }
+    tail_meta.update_next_pg(head);
+    write_to(tail_meta, t_io);
+    // no longer the first page of a chain.
+    auto head_meta{read_from<HeapMeta>(head, t_io)};
+    head_meta.update_prev_pg(tail_meta.get_pg_num());
+    write_to(head_meta, t_io);
+    tail = head;
+  }
+  t_arena.pending.clear();
+}
+
 auto find_first_fit_frag(page_off_t t_size, bool is_chained, HeapMeta& t_meta,
                          std::istream& t_io) -> FindFragRetVal {
   auto header_size{is_chained ? Fragment::CHAINED_FRAG_HEADER_SIZE
@@ -382,19 +546,12 @@ auto find_first_fit_frag(page_off_t t_size, bool is_chained, HeapMeta& t_meta,
   // record the 2 "neighbor" free fragments (neighbor in the sense of
   // "closest together" here) for update later. Of course, only update if
   // there exists those 2.
-  Fragment next_frag{prev_frag};
+  Fragment next_frag{};
   if (ret_frag.get_free_extra().next != Fragment::NULL_FRAG_PTR) {
     next_frag = read_frag_from(
         Ptr{.pagenum = pagenum, .offset = ret_frag.get_free_extra().next},
         t_io);
   }
-  if (!prev_frag.is_invalid()) {
-    auto next_off{ret_frag.get_free_extra().next};
-    if (next_off != Fragment::NULL_FRAG_PTR) {
-      next_frag =
-          read_frag_from(Ptr{.pagenum = pagenum, .offset = next_off}, t_io);
-    }
-  }
   // if the user needs to chain the fragments, they must have another
   // `Chained` fragment ready.
   ret_frag.type = [&]() {
@@ -413,9 +570,10 @@ auto find_first_fit_frag(page_off_t t_size, bool is_chained, HeapMeta& t_meta,
           .ret_off = header_size};
 }
 
-auto Heap::find_first_fit_heap_pg(page_off_t t_size, bool is_chained,
-                                  FreeList& t_fl, std::iostream& t_io)
-    -> HeapMeta {
+auto Heap::find_first_fit_heap_pg(std::size_t t_arena, page_off_t t_size,
+                                  bool is_chained, FreeList& t_fl,
+                                  std::iostream& t_io) -> HeapMeta {
+  auto& arena{*m_arenas[t_arena]};
   auto header_size{(is_chained) ? Fragment::CHAINED_FRAG_HEADER_SIZE
                                 : Fragment::USED_FRAG_HEADER_SIZE};
   auto search_size{t_size + header_size - Fragment::FREE_FRAG_HEADER_SIZE};
@@ -435,15 +593,18 @@ auto Heap::find_first_fit_heap_pg(page_off_t t_size, bool is_chained,
                                     Fragment::FREE_FRAG_HEADER_SIZE),
         .type = Fragment::FragType::Free};
     write_frag_to(write_to, t_io);
+    if (m_owners) {
+      m_owners->set(ret.get_pg_num(), t_arena);
+    }
     return ret;
   }};
   auto heap_meta{[&]() {
-    if (m_first_heap_page == NULL_PAGE) {
+    if (arena.first_heap_page == NULL_PAGE) {
       auto ret = alloc_new_heap_pg();
-      m_first_heap_page = ret.get_pg_num();
+      arena.first_heap_page = ret.get_pg_num();
       return ret;
     } else {
-      return read_from<HeapMeta>(m_first_heap_page, t_io);
+      return read_from<HeapMeta>(arena.first_heap_page, t_io);
     }
   }()};
   // search for the first heap page that has a large enough fragment.
@@ -501,14 +662,13 @@ auto try_break_frag(Fragment& t_old_frag, Fragment& t_next_frag,
         .size = static_cast<page_off_t>(new_frag_size),
         .type = Fragment::FragType::Free};
     t_old_frag.size = t_old_frag_size;
-    // Update the neighboring fragment, particularly the next fragment.
+    // the new fragment takes the old one's spot in the free list.
     if (!t_next_frag.is_invalid()) {
       assert(std::get_if<Fragment::FreeFragExtra>(&t_next_frag.extra) !=
              nullptr);
       new_frag.get_free_extra().next = t_next_frag.pos.offset;
-    } else {
-      t_next_frag = new_frag;
     }
+    t_next_frag = new_frag;
     // then the heap page
     if (heap_meta.get_first_free_off() == t_old_frag.pos.offset) {
       heap_meta.update_first_free(new_frag_off);
@@ -519,38 +679,25 @@ auto try_break_frag(Fragment& t_old_frag, Fragment& t_next_frag,
     return true;
   }
   if (heap_meta.get_first_free_off() == t_old_frag.pos.offset) {
-    heap_meta.update_first_free(Fragment::NULL_FRAG_PTR);
+    heap_meta.update_first_free(t_next_frag.is_invalid()
+                                    ? Fragment::NULL_FRAG_PTR
+                                    : t_next_frag.pos.offset);
   }
   return false;
 }
 
-void update_write_heap_pg(HeapMeta& heap_meta, const Fragment& next_frag,
-                          std::pair<page_off_t, page_off_t>& max_pair,
-                          std::iostream& t_io) {
+void update_write_heap_pg(HeapMeta& heap_meta, std::iostream& t_io) {
   auto pagenum{heap_meta.get_pg_num()};
-  auto curr_update_frag{next_frag};
-  // Force update. I'm a bit paranoid.
-  if (max_pair.second == curr_update_frag.pos.offset) {
-    // if first remains 0 after the for loop, it's basically the same as
-    // "this page is out of memory".
-    max_pair = {static_cast<page_off_t>(0), static_cast<page_off_t>(0)};
-  }
-  // Traverse the entire page to see which free fragments remaining are
-  // the biggest and smallest.
-  for (auto o{heap_meta.get_first_free_off()}; o != Fragment::NULL_FRAG_PTR;
-       o = curr_update_frag.get_free_extra().next) {
-    assert(std::get_if<Fragment::FreeFragExtra>(&curr_update_frag.extra) !=
-           nullptr);
-    if (max_pair.first < curr_update_frag.size) {
-      max_pair = {curr_update_frag.size, curr_update_frag.pos.offset};
+  // Traverse the entire page to see which free fragment remaining is the
+  // biggest. first = 0 is basically the same as "this page is out of memory".
+  std::pair<page_off_t, page_off_t> max_pair{0, 0};
+  for (auto o{heap_meta.get_first_free_off()}; o != Fragment::NULL_FRAG_PTR;) {
+    auto frag{read_frag_from(Ptr{.pagenum = pagenum, .offset = o}, t_io)};
+    assert(frag.type == Fragment::FragType::Free);
+    if (max_pair.first < frag.size) {
+      max_pair = {frag.size, frag.pos.offset};
     }
-    curr_update_frag =
-        read_frag_from(Ptr{.pagenum = pagenum, .offset = o}, t_io);
-  }
-  // if min_pair is not updated at all, meaning there is no fragment left.
-  // first = 0 is basically the same as "this page is out of memory".
-  if (max_pair.first == 0) {
-    max_pair.second = 0;
+    o = frag.get_free_extra().next;
   }
 
   heap_meta.update_max_pair(max_pair.first, max_pair.second);
@@ -712,19 +859,11 @@ auto coalesce(Fragment&& t_frag, HeapMeta& t_meta, std::iostream& t_io)
     ret = [&]() {
       // merge left_merge with next_frag if next_frag exists, or just return
       // left_merge.
-      // If prev_frag has a value but cannot be merged (due to not being
-      // neighbors) but t_frag and next_frag can still be merged, update
-      // prev_frag's next pointer.
       auto ret_opt = next_frag
                          .transform([&](Fragment& next) noexcept {
                            if (!is_next_to(left_merge, next)) {
                              return left_merge;
                            }
-                           if (!prev_merged && prev_frag.has_value()) {
-                             prev_frag->get_free_extra().next =
-                                 left_merge.pos.offset;
-                             write_frag_to(*prev_frag, t_io);
-                           }
                            return merge(std::move(left_merge), std::move(next));
                          })
                          .or_else([&left_merge]() noexcept {
@@ -733,6 +872,11 @@ auto coalesce(Fragment&& t_frag, HeapMeta& t_meta, std::iostream& t_io)
       assert(ret_opt.has_value());
       return ret_opt.value();
     }();
+    // If prev_frag has a value but cannot be merged (due to not being
+    // neighbors), it now points to t_frag.
+    if (!prev_merged && prev_frag.has_value()) {
+      write_frag_to(*prev_frag, t_io);
+    }
   }();
 
   // std::println("Resulting fragment: (page: {}, offset: {}, header: {}, size:
@@ -14,10 +14,18 @@
 #include "dbfile/internal/freelist.hxx"
 #include "dbfile/internal/heap_base.hxx"
 #include "dbfile/internal/page_meta.hxx"
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <utility>
+#include <vector>
 #endif // !ENABLE_MODULES
 
 #ifdef ENABLE_MODULES
@@ -26,6 +34,22 @@ export namespace tinydb::dbfile::internal {
 namespace tinydb::dbfile::internal {
 #endif // ENABLE_MODULES
 
+class Heap;
+
+/**
+ * @brief Reads the heap whose first page the file header points to. Only
+ * reads: a file opened without writing anything stays as it was.
+ *
+ * Chains of more arenas than `t_n_arenas` go to the arenas read before
+ * them, so that nothing is lost. They're only appended to those arenas'
+ * own chains once the arenas are written to (`malloc`, `write_heap_to`).
+ *
+ * @param t_in The database stream.
+ * @param t_n_arenas How many arenas the heap gets, at least 1.
+ */
+TINYDB_EXPORT auto read_heap_from(std::istream& t_in,
+                                  std::size_t t_n_arenas = 1) -> Heap;
+
 /**
  * @class Heap
  * @brief A dynamic storage allocator.
@@ -44,13 +68,46 @@ namespace tinydb::dbfile::internal {
  * they are next to each other, a coalesce is done, resulting in a bigger
  * fragment.
  *
+ * A Heap is split into arenas, each with a chain of heap pages of its own
+ * and a latch. A thread always allocates from the same arena (threads are
+ * spread round-robin over them), so with at least as many arenas as threads
+ * allocating, nobody waits on anybody else's latch. Only taking a brand new
+ * page goes through the FreeList, and its latch. A fragment is given back to
+ * the arena owning its page, whichever thread frees it: the owner of every
+ * page is looked up without latching anything, so a free only ever latches
+ * that one arena. Each thread passes a stream of its own over the same file
+ * (see PageStream).
+ *
+ * The first page of an arena's chain has no previous page. Its prev pointer
+ * links to the first page of the next arena instead, which is how every
+ * chain is found again once the file is reopened.
+ *
  */
 
 class TINYDB_EXPORT Heap {
 public:
-  Heap() = default;
-  explicit Heap(page_ptr_t t_first_heap_pg)
-      : m_first_heap_page{t_first_heap_pg} {}
+  /**
+   * @brief A heap with one arena, with no page yet.
+   */
+  Heap() : Heap{NULL_PAGE} {}
+  /**
+   * @brief A heap with one arena, whose chain starts at `t_first_heap_pg`.
+   */
+  explicit Heap(page_ptr_t t_first_heap_pg);
+
+  /**
+   * @brief An empty heap with `t_n_arenas` arenas, for as many threads.
+   */
+  static auto with_arenas(std::size_t t_n_arenas) -> Heap;
+
+  [[nodiscard]] auto n_arenas() const noexcept -> std::size_t {
+    return m_arenas.size();
+  }
+
+  /**
+   * @return The arena the calling thread allocates from.
+   */
+  [[nodiscard]] auto arena_of_this_thread() const noexcept -> std::size_t;
 
   /**
    * @brief Allocates a large enough chunk of memory. t_size must be smaller
@@ -90,6 +147,8 @@ public:
    * @brief Releases the memory held by a fragment. Fragment must be of type
    * Used.
    *
+   * Throws `std::ios_base::failure` if no arena owns the fragment's page.
+   *
    * @param t_frag The fragment to free, must be of type Used.
    * @param t_fl In case the heap page the fragment points to is entirely
    * free. Then, that page is released to the freelist.
@@ -104,9 +163,77 @@ public:
   void free(Fragment&& t_frag, [[maybe_unused]] FreeList& t_fl,
             std::iostream& t_io);
 
+  /**
+   * @brief Links the first pages of the arenas together, and points the
+   * file header to the first of them. Until then, the file only knows the
+   * chains it was read with. See `read_heap_from`.
+   *
+   * @param t_io The database read/write stream.
+   */
+  void write_heap_to(std::iostream& t_io);
+
 private:
-  // offset 0: 4-byte pointer to the first heap.
-  page_ptr_t m_first_heap_page{NULL_PAGE};
+  friend auto read_heap_from(std::istream& t_in, std::size_t t_n_arenas)
+      -> Heap;
+
+  // a cache line (or more) each, so threads latching neighbor arenas don't
+  // step on each other.
+  struct alignas(64) Arena {
+    std::mutex latch;
+    // the first page of the chain. Guarded by `latch`.
+    page_ptr_t first_heap_page{NULL_PAGE};
+    // the first pages of chains read from the file that still have to be
+    // linked after this one. Guarded by `latch`.
+    std::vector<page_ptr_t> pending{};
+  };
+
+  /**
+   * @class Owners
+   * @brief The arena of every heap page, by page number.
+   *
+   * Slots are atomic, in chunks that are allocated once and never move, so
+   * looking a page up while other arenas take new pages needs no latch.
+   */
+  class Owners {
+  public:
+    Owners() = default;
+    Owners(const Owners&) = delete;
+    Owners(Owners&&) = delete;
+    auto operator=(const Owners&) -> Owners& = delete;
+    auto operator=(Owners&&) -> Owners& = delete;
+    ~Owners();
+
+    /**
+     * @return The arena owning the page, nullopt if none does.
+     */
+    [[nodiscard]] auto find(page_ptr_t t_pg) const noexcept
+        -> std::optional<std::size_t>;
+
+    /**
+     * @brief Before any fragment of the page is handed out.
+     */
+    void set(page_ptr_t t_pg, std::size_t t_arena);
+
+  private:
+    static constexpr std::size_t FIRST_CHUNK = 1024;
+    // enough for every page number.
+    static constexpr std::size_t N_CHUNKS = 23;
+    // the arena plus one, 0 if none.
+    using slot_t = std::atomic<uint16_t>;
+
+    std::array<std::atomic<slot_t*>, N_CHUNKS> m_chunks{};
+
+    /**
+     * @return The chunk of a page, and its position inside.
+     */
+    static auto locate(page_ptr_t t_pg) noexcept
+        -> std::pair<std::size_t, std::size_t>;
+  };
+
+  // boxed, so a Heap can still be moved around.
+  std::vector<std::unique_ptr<Arena>> m_arenas;
+  // null with a single arena, which owns every page.
+  std::unique_ptr<Owners> m_owners;
 
   // malloc and free helpers
 
@@ -121,20 +248,42 @@ private:
    * If no such heap page is found, a new heap page is requested from t_fl. If
    * a new heap page is requested, t_fl will initialize the allocated heap
    * page and write the page info into the stream t_io.
-   * If `m_first_heap_page` is NULL_PAGE before calling this function, it will
-   * be updated.
+   * If the arena has no page yet before calling this function, it will be
+   * updated. The arena must be latched.
    *
+   * @param t_arena The index of the arena.
    * @param t_size The size to allocate.
    * @param t_fl The free list to (potentially) request a new page from.
    * @param t_io The read/write stream.
    * @return
    */
-  auto find_first_fit_heap_pg(page_off_t t_size, bool is_chained,
-                              FreeList& t_fl, std::iostream& t_io) -> HeapMeta;
+  auto find_first_fit_heap_pg(std::size_t t_arena, page_off_t t_size,
+                              bool is_chained, FreeList& t_fl,
+                              std::iostream& t_io) -> HeapMeta;
+
+  /**
+   * @brief `free`, once the arena owning the fragment is latched.
+   */
+  static void free_in(Fragment&& t_frag, std::iostream& t_io);
 
-  void write_heap_to(std::ostream& t_out);
+  /**
+   * @brief Links the chains pending in an arena after its own. The arena
+   * must be latched.
+   */
+  static void splice_pending(Arena& t_arena, std::iostream& t_io);
 };
 
+/**
+ * @brief Reads the fragment at the position pointed to from the stream.
+ *
+ * @param t_pos Pointer to the position of the fragment.
+ * @param t_in The read-only stream.
+ * @return The fragment read.
+ *   - Exception if there's a read error.
+ */
+TINYDB_EXPORT auto read_frag_from(const Ptr& t_pos, std::istream& t_in)
+    -> Fragment;
+
 } // namespace tinydb::dbfile::internal
 
 #endif // !TINYDB_DBFILE_INTERNAL_HEAP_HXX
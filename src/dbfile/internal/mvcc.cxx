@@ -0,0 +1,417 @@
+/**
+ * @file mvcc.cxx
+ * @brief Definitions for mvcc.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.mvcc;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/mvcc.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+constexpr std::size_t END_OFF = sizeof(txn_id_t);
+constexpr std::size_t PREV_OFF = 2 * sizeof(txn_id_t);
+
+// where the version header of a fragment starts, the row right after it.
+auto data_pos(Ptr t_pos) -> std::streamoff {
+  return (static_cast<std::streamoff>(t_pos.pagenum) * SIZEOF_PAGE) +
+         t_pos.offset + Fragment::USED_FRAG_HEADER_SIZE;
+}
+
+template <typename T>
+void write_at(Ptr t_pos, std::size_t t_off, const T& t_val,
+              std::ostream& t_out) {
+  t_out.seekp(data_pos(t_pos) + static_cast<std::streamoff>(t_off));
+  t_out.rdbuf()->sputn(std::bit_cast<const char*>(&t_val), sizeof(T));
+}
+
+} // namespace
+
+auto TxnManager::begin() -> Snapshot {
+  const std::scoped_lock lock{m_mutex};
+  Snapshot ret{.m_self = m_next++, .m_xmax = NULL_TXN, .m_active{}};
+  ret.m_xmax = m_next;
+  ret.m_active.reserve(m_running.size());
+  for (const auto& [txn, _] : m_running) {
+    ret.m_active.push_back(txn);
+  }
+  m_running.emplace(ret.m_self,
+                    ret.m_active.empty() ? ret.m_self : ret.m_active.front());
+  return ret;
+}
+
+void TxnManager::end(txn_id_t t_txn) {
+  const std::scoped_lock lock{m_mutex};
+  m_running.erase(t_txn);
+}
+
+auto TxnManager::horizon() const -> txn_id_t {
+  const std::scoped_lock lock{m_mutex};
+  auto ret = m_next;
+  for (const auto& [_, oldest] : m_running) {
+    ret = std::min(ret, oldest);
+  }
+  return ret;
+}
+
+auto RowDirectory::slot(row_id_t t_id) const noexcept -> std::atomic<Ptr>& {
+  // chunk `k` starts at FIRST_CHUNK * (2^k - 1).
+  const auto chunk =
+      static_cast<std::size_t>(std::bit_width((t_id / FIRST_CHUNK) + 1) - 1);
+  const auto first = FIRST_CHUNK * ((std::size_t{1} << chunk) - 1);
+  return m_chunks[chunk][t_id - first];
+}
+
+auto RowDirectory::push_back(Ptr t_pos) -> row_id_t {
+  const auto id = m_size.load(std::memory_order_relaxed);
+  const auto chunk =
+      static_cast<std::size_t>(std::bit_width((id / FIRST_CHUNK) + 1) - 1);
+  assert(chunk < N_CHUNKS);
+  if (!m_chunks[chunk]) {
+    m_chunks[chunk] =
+        std::make_unique<std::atomic<Ptr>[]>(FIRST_CHUNK << chunk);
+  }
+  slot(id).store(t_pos, std::memory_order_relaxed);
+  m_size.store(id + 1, std::memory_order_release);
+  return id;
+}
+
+VersionedTable::VersionedTable(const TableMeta& t_tbl)
+    : m_row_size{t_tbl.layout().row_size} {
+  // a version has to fit in one fragment.
+  assert(VERSION_HEADER_SIZE + m_row_size <=
+         SIZEOF_PAGE - HeapMeta::DEFAULT_FREE_OFF -
+             Fragment::USED_FRAG_HEADER_SIZE);
+}
+
+namespace {
+
+struct Version {
+  txn_id_t begin;
+  txn_id_t end;
+  Ptr prev;
+};
+
+auto read_version(Ptr t_pos, std::istream& t_in) -> Version {
+  std::array<char, VersionedTable::VERSION_HEADER_SIZE> bytes{};
+  t_in.seekg(data_pos(t_pos));
+  t_in.rdbuf()->sgetn(bytes.data(), bytes.size());
+  Version ret{};
+  std::memcpy(&ret.begin, bytes.data(), sizeof(txn_id_t));
+  std::memcpy(&ret.end, bytes.data() + END_OFF, sizeof(txn_id_t));
+  std::memcpy(&ret.prev.pagenum, bytes.data() + PREV_OFF,
+              sizeof(ret.prev.pagenum));
+  std::memcpy(&ret.prev.offset,
+              bytes.data() + PREV_OFF + sizeof(ret.prev.pagenum),
+              sizeof(ret.prev.offset));
+  return ret;
+}
+
+void write_prev(Ptr t_pos, Ptr t_prev, std::ostream& t_out) {
+  write_at(t_pos, PREV_OFF, t_prev.pagenum, t_out);
+  write_at(t_pos, PREV_OFF + sizeof(t_prev.pagenum), t_prev.offset, t_out);
+}
+
+} // namespace
+
+/**
+ * @brief Counts a reader in the current epoch while it's alive.
+ */
+struct VersionedTable::ReadGuard {
+  const VersionedTable& tbl;
+  uint64_t epoch;
+
+  explicit ReadGuard(const VersionedTable& t_tbl) : tbl{t_tbl}, epoch{0} {
+    // the epoch may move on while we count ourselves in: then count again.
+    for (;;) {
+      epoch = tbl.m_epoch.load();
+      tbl.m_readers[epoch & 1].fetch_add(1);
+      if (tbl.m_epoch.load() == epoch) {
+        return;
+      }
+      tbl.m_readers[epoch & 1].fetch_sub(1);
+    }
+  }
+  ReadGuard(const ReadGuard&) = delete;
+  ReadGuard(ReadGuard&&) = delete;
+  auto operator=(const ReadGuard&) -> ReadGuard& = delete;
+  auto operator=(ReadGuard&&) -> ReadGuard& = delete;
+  ~ReadGuard() { tbl.m_readers[epoch & 1].fetch_sub(1); }
+};
+
+auto VersionedTable::n_retired() const -> std::size_t {
+  const std::scoped_lock lock{m_latch};
+  return m_retired[0].size() + m_retired[1].size();
+}
+
+void VersionedTable::reclaim(Heap& t_heap, FreeList& t_fl,
+                             std::iostream& t_io) {
+  // twice: what the current epoch retired goes too, if nobody's reading.
+  for (int round = 0; round < 2; ++round) {
+    if (m_retired[0].empty() && m_retired[1].empty()) {
+      return;
+    }
+    const auto epoch = m_epoch.load();
+    const auto before = (epoch + 1) & 1;
+    if (m_readers[before].load() != 0) {
+      return;
+    }
+    for (auto pos : m_retired[before]) {
+      t_heap.free(read_frag_from(pos, t_io), t_fl, t_io);
+    }
+    m_retired[before].clear();
+    m_epoch.store(epoch + 1);
+  }
+}
+
+auto VersionedTable::push(const Snapshot& t_snap, std::span<const char> t_row,
+                          Ptr t_prev, Heap& t_heap, FreeList& t_fl,
+                          std::iostream& t_io) -> Ptr {
+  assert(t_row.size() >= m_row_size);
+  auto [frag, _] = t_heap.malloc(
+      static_cast<page_off_t>(VERSION_HEADER_SIZE + m_row_size), false, t_fl,
+      t_io);
+  write_at(frag.pos, 0, t_snap.m_self, t_io);
+  write_at(frag.pos, END_OFF, NULL_TXN, t_io);
+  write_prev(frag.pos, t_prev, t_io);
+  t_io.seekp(data_pos(frag.pos) + VERSION_HEADER_SIZE);
+  t_io.rdbuf()->sputn(t_row.data(), m_row_size);
+  return frag.pos;
+}
+
+auto VersionedTable::insert(const Snapshot& t_snap,
+                            std::span<const char> t_row, Heap& t_heap,
+                            FreeList& t_fl, std::iostream& t_io) -> row_id_t {
+  const std::scoped_lock lock{m_latch};
+  reclaim(t_heap, t_fl, t_io);
+  const auto id =
+      m_heads.push_back(push(t_snap, t_row, NullPtr, t_heap, t_fl, t_io));
+  m_undo[t_snap.m_self].push_back(Undo{.kind = Undo::Kind::Insert, .row = id});
+  return id;
+}
+
+auto VersionedTable::check_write(const Snapshot& t_snap, row_id_t t_id,
+                                 std::istream& t_in) const -> WriteResult {
+  if (t_id >= m_heads.size() || m_heads.get(t_id) == NullPtr) {
+    return WriteResult::NotFound;
+  }
+  auto head = read_version(m_heads.get(t_id), t_in);
+  if (!t_snap.sees(head.begin)) {
+    // someone else replaced the row since, unless it didn't exist for us.
+    return visible(t_snap, m_heads.get(t_id), t_in) == NullPtr
+               ? WriteResult::NotFound
+               : WriteResult::Conflict;
+  }
+  if (head.end == NULL_TXN) {
+    return WriteResult::Ok;
+  }
+  return t_snap.sees(head.end) ? WriteResult::NotFound
+                               : WriteResult::Conflict;
+}
+
+auto VersionedTable::update(const Snapshot& t_snap, row_id_t t_id,
+                            std::span<const char> t_row, Heap& t_heap,
+                            FreeList& t_fl, std::iostream& t_io)
+    -> WriteResult {
+  const std::scoped_lock lock{m_latch};
+  reclaim(t_heap, t_fl, t_io);
+  if (auto res = check_write(t_snap, t_id, t_io); res != WriteResult::Ok) {
+    return res;
+  }
+  const auto head = m_heads.get(t_id);
+  if (read_version(head, t_io).begin == t_snap.m_self) {
+    // nobody else can see our own version: no need for another one.
+    t_io.seekp(data_pos(head) + VERSION_HEADER_SIZE);
+    t_io.rdbuf()->sputn(t_row.data(), m_row_size);
+    return WriteResult::Ok;
+  }
+  write_at(head, END_OFF, t_snap.m_self, t_io);
+  // the new version is all written before readers can find it.
+  m_heads.set(t_id, push(t_snap, t_row, head, t_heap, t_fl, t_io));
+  m_undo[t_snap.m_self].push_back(
+      Undo{.kind = Undo::Kind::Update, .row = t_id});
+  return WriteResult::Ok;
+}
+
+auto VersionedTable::erase(const Snapshot& t_snap, row_id_t t_id,
+                           std::iostream& t_io) -> WriteResult {
+  const std::scoped_lock lock{m_latch};
+  if (auto res = check_write(t_snap, t_id, t_io); res != WriteResult::Ok) {
+    return res;
+  }
+  write_at(m_heads.get(t_id), END_OFF, t_snap.m_self, t_io);
+  m_undo[t_snap.m_self].push_back(
+      Undo{.kind = Undo::Kind::Erase, .row = t_id});
+  return WriteResult::Ok;
+}
+
+auto VersionedTable::visible(const Snapshot& t_snap, Ptr t_pos,
+                             std::istream& t_in) const -> Ptr {
+  while (t_pos != NullPtr) {
+    auto version = read_version(t_pos, t_in);
+    if (t_snap.sees(version.begin)) {
+      // the newest one we see, unless we see it deleted too.
+      return t_snap.sees(version.end) ? NullPtr : t_pos;
+    }
+    t_pos = version.prev;
+  }
+  return NullPtr;
+}
+
+auto VersionedTable::read(const Snapshot& t_snap, row_id_t t_id,
+                          std::istream& t_in, std::span<char> t_row) const
+    -> bool {
+  if (t_id >= m_heads.size()) {
+    return false;
+  }
+  const ReadGuard guard{*this};
+  auto pos = visible(t_snap, m_heads.get(t_id), t_in);
+  if (pos == NullPtr) {
+    return false;
+  }
+  t_in.seekg(data_pos(pos) + VERSION_HEADER_SIZE);
+  t_in.rdbuf()->sgetn(t_row.data(), m_row_size);
+  return true;
+}
+
+void VersionedTable::scan(
+    const Snapshot& t_snap, std::istream& t_in,
+    const std::function<void(row_id_t, std::span<const char>)>& t_fn) const {
+  std::vector<char> row(m_row_size);
+  for (row_id_t id = 0; id < m_heads.size(); ++id) {
+    if (read(t_snap, id, t_in, row)) {
+      t_fn(id, row);
+    }
+  }
+}
+
+void VersionedTable::commit(txn_id_t t_txn) {
+  const std::scoped_lock lock{m_latch};
+  m_undo.erase(t_txn);
+}
+
+void VersionedTable::abort(txn_id_t t_txn, Heap& t_heap, FreeList& t_fl,
+                           std::iostream& t_io) {
+  const std::scoped_lock lock{m_latch};
+  auto found = m_undo.find(t_txn);
+  if (found == m_undo.end()) {
+    return;
+  }
+  for (const auto& undo : found->second | std::views::reverse) {
+    const auto head = m_heads.get(undo.row);
+    if (undo.kind == Undo::Kind::Erase) {
+      write_at(head, END_OFF, NULL_TXN, t_io);
+      continue;
+    }
+    auto prev = read_version(head, t_io).prev;
+    m_heads.set(undo.row, prev);
+    m_retired[m_epoch.load() & 1].push_back(head);
+    if (undo.kind == Undo::Kind::Update) {
+      write_at(prev, END_OFF, NULL_TXN, t_io);
+    }
+  }
+  m_undo.erase(found);
+  reclaim(t_heap, t_fl, t_io);
+}
+
+void VersionedTable::retire_chain(Ptr t_pos, std::istream& t_in) {
+  auto& retired = m_retired[m_epoch.load() & 1];
+  while (t_pos != NullPtr) {
+    retired.push_back(t_pos);
+    t_pos = read_version(t_pos, t_in).prev;
+  }
+}
+
+auto VersionedTable::vacuum(txn_id_t t_horizon, Heap& t_heap, FreeList& t_fl,
+                            std::iostream& t_io) -> std::size_t {
+  const std::scoped_lock lock{m_latch};
+  const auto& retired = m_retired[m_epoch.load() & 1];
+  const auto n_retired = retired.size();
+  for (row_id_t id = 0; id < m_heads.size(); ++id) {
+    const auto head = m_heads.get(id);
+    if (head == NullPtr) {
+      continue;
+    }
+    auto newest = read_version(head, t_io);
+    // deleted before every snapshot: the whole row goes.
+    if (newest.end != NULL_TXN && newest.end < t_horizon) {
+      m_heads.set(id, NullPtr);
+      retire_chain(head, t_io);
+      continue;
+    }
+    // the newest version every snapshot sees hides all the older ones.
+    for (auto pos = head; pos != NullPtr;) {
+      auto version = read_version(pos, t_io);
+      if (version.begin < t_horizon) {
+        if (version.prev != NullPtr) {
+          write_prev(pos, NullPtr, t_io);
+          retire_chain(version.prev, t_io);
+        }
+        break;
+      }
+      pos = version.prev;
+    }
+  }
+  const auto ret = retired.size() - n_retired;
+  reclaim(t_heap, t_fl, t_io);
+  return ret;
+}
+
+} // namespace tinydb::dbfile::internal
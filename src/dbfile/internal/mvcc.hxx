@@ -0,0 +1,326 @@
+/**
+ * @file mvcc.hxx
+ * @brief Declares multi-version rows: transactions, snapshots, and a table
+ * keeping every version of its rows that someone may still read.
+ *
+ * Every write makes a new version of a row instead of overwriting it. A
+ * version is a heap fragment:
+ * - offset 0: 8 bytes, the transaction that created it.
+ * - offset 8: 8 bytes, the transaction that replaced or deleted it,
+ *   NULL_TXN while it's the latest.
+ * - offset 16: 6 bytes, the version it replaced, NullPtr if none.
+ * - offset 22: the row, as laid out by the table (see tbl).
+ * Versions of a row are chained from the newest to the oldest.
+ *
+ * A transaction reads through the snapshot it took when it began: it sees
+ * what was committed before then, and its own writes, nothing else. So a
+ * reader never waits for a writer, and doesn't take any lock: the row
+ * directory is read with atomic loads, while writers take turns on a latch
+ * of the table. Two transactions writing the same row is a conflict for the
+ * second one (first writer wins), which should abort.
+ *
+ * Aborting rolls back right away, so every version left in the heap was
+ * written by a transaction that committed or is still running. Versions
+ * that no snapshot can see anymore are let go of by `vacuum`. Either way,
+ * a reader may still be looking at a version as it's unlinked: it's only
+ * given back to the heap once every reader that started before is done
+ * (epochs, see `VersionedTable::reclaim`).
+ *
+ * The row directory (row ID to newest version) and the state of the
+ * transactions are only kept in memory for now.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_MVCC_HXX
+#define TINYDB_DBFILE_INTERNAL_MVCC_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/heap_base.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+using txn_id_t = uint64_t;
+using row_id_t = uint64_t;
+// no transaction. Transaction IDs start at 1.
+constexpr txn_id_t NULL_TXN = 0;
+
+/**
+ * @class Snapshot
+ * @brief Which transactions one transaction sees the writes of.
+ */
+struct TINYDB_EXPORT Snapshot {
+  // the transaction reading through it.
+  txn_id_t m_self;
+  // the first transaction that started after this one.
+  txn_id_t m_xmax;
+  // transactions still running when this one started, sorted.
+  std::vector<txn_id_t> m_active;
+
+  /**
+   * @return Whether the writes of `t_txn` are visible: they're ours, or
+   * were committed before we started.
+   */
+  [[nodiscard]] auto sees(txn_id_t t_txn) const noexcept -> bool {
+    return t_txn == m_self ||
+           (t_txn != NULL_TXN && t_txn < m_xmax &&
+            !std::ranges::binary_search(m_active, t_txn));
+  }
+};
+
+/**
+ * @class TxnManager
+ * @brief Hands out transaction IDs and snapshots. Thread-safe; its mutex is
+ * only held while a transaction begins or ends.
+ */
+class TINYDB_EXPORT TxnManager {
+public:
+  /**
+   * @brief Starts a transaction.
+   */
+  auto begin() -> Snapshot;
+
+  /**
+   * @brief Ends a transaction. If it aborted, every table it wrote must
+   * have rolled it back first: from now on, whatever it left is committed.
+   */
+  void end(txn_id_t t_txn);
+
+  /**
+   * @return The oldest transaction some snapshot may not see as committed
+   * yet. Versions replaced before it are invisible to every snapshot, now
+   * or later.
+   */
+  [[nodiscard]] auto horizon() const -> txn_id_t;
+
+private:
+  mutable std::mutex m_mutex;
+  txn_id_t m_next{1};
+  // running transactions, with the oldest one running when each started.
+  std::map<txn_id_t, txn_id_t> m_running;
+};
+
+/**
+ * @brief The outcome of a write.
+ */
+enum class TINYDB_EXPORT WriteResult : uint8_t {
+  Ok,
+  // not in the snapshot of the writer.
+  NotFound,
+  // another transaction wrote the row since the writer started, or is
+  // writing it.
+  Conflict,
+};
+
+/**
+ * @class RowDirectory
+ * @brief The newest version of each row, by row ID.
+ *
+ * Heads are kept in chunks, each twice as big as the one before, which never
+ * move once allocated. So any number of readers may look heads up while one
+ * writer at a time appends or replaces them, without a lock.
+ */
+class TINYDB_EXPORT RowDirectory {
+public:
+  // heads in the first chunk.
+  static constexpr std::size_t FIRST_CHUNK = 1024;
+
+  /**
+   * @return The number of heads, deleted rows included.
+   */
+  [[nodiscard]] auto size() const noexcept -> std::size_t {
+    return m_size.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @param t_id Below `size()`.
+   */
+  [[nodiscard]] auto get(row_id_t t_id) const noexcept -> Ptr {
+    return slot(t_id).load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Only one writer at a time.
+   */
+  void set(row_id_t t_id, Ptr t_pos) noexcept {
+    slot(t_id).store(t_pos, std::memory_order_release);
+  }
+
+  /**
+   * @brief Only one writer at a time.
+   * @return The ID of the new head.
+   */
+  auto push_back(Ptr t_pos) -> row_id_t;
+
+private:
+  static constexpr std::size_t N_CHUNKS = 48;
+  using Chunk = std::unique_ptr<std::atomic<Ptr>[]>;
+
+  // a chunk is only ever allocated before `m_size` grows into it.
+  std::array<Chunk, N_CHUNKS> m_chunks{};
+  std::atomic<std::size_t> m_size{0};
+
+  [[nodiscard]] auto slot(row_id_t t_id) const noexcept -> std::atomic<Ptr>&;
+};
+
+/**
+ * @class VersionedTable
+ * @brief The rows of a table, with their versions, in heap fragments.
+ *
+ * Every function reading the heap takes the stream of the file, and those
+ * writing to it the Heap and the FreeList as well, as write_text does.
+ *
+ * Thread-safe, as long as each thread has a stream of its own over the same
+ * pages (see page_cache). Readers don't wait on anything; writers, commit
+ * included, go one at a time.
+ */
+class TINYDB_EXPORT VersionedTable {
+public:
+  static constexpr page_off_t VERSION_HEADER_SIZE =
+      (2 * sizeof(txn_id_t)) + Ptr::SIZE;
+
+  explicit VersionedTable(const TableMeta& t_tbl);
+
+  [[nodiscard]] auto row_size() const noexcept -> EntrySiz {
+    return m_row_size;
+  }
+
+  /**
+   * @return The number of row IDs handed out so far, deleted rows included.
+   */
+  [[nodiscard]] auto n_row_ids() const noexcept -> std::size_t {
+    return m_heads.size();
+  }
+
+  /**
+   * @return How many versions were let go of but aren't back in the heap
+   * yet, since a reader may still be looking at them.
+   */
+  [[nodiscard]] auto n_retired() const -> std::size_t;
+
+  /**
+   * @brief Adds a row, only visible to `t_snap` until it commits.
+   * @return Its ID.
+   */
+  auto insert(const Snapshot& t_snap, std::span<const char> t_row,
+              Heap& t_heap, FreeList& t_fl, std::iostream& t_io) -> row_id_t;
+
+  /**
+   * @brief Replaces a row by a new version.
+   */
+  auto update(const Snapshot& t_snap, row_id_t t_id,
+              std::span<const char> t_row, Heap& t_heap, FreeList& t_fl,
+              std::iostream& t_io) -> WriteResult;
+
+  /**
+   * @brief Ends the latest version of a row, without a new one.
+   */
+  auto erase(const Snapshot& t_snap, row_id_t t_id, std::iostream& t_io)
+      -> WriteResult;
+
+  /**
+   * @brief Reads the version of a row `t_snap` sees.
+   * @param t_row At least `row_size()` bytes.
+   * @return false if there's none.
+   */
+  auto read(const Snapshot& t_snap, row_id_t t_id, std::istream& t_in,
+            std::span<char> t_row) const -> bool;
+
+  /**
+   * @brief Calls `t_fn` with every row `t_snap` sees, in ID order. The row
+   * is only valid during the call.
+   */
+  void scan(const Snapshot& t_snap, std::istream& t_in,
+            const std::function<void(row_id_t, std::span<const char>)>& t_fn)
+      const;
+
+  /**
+   * @brief Forgets how to roll a transaction back, once it committed.
+   */
+  void commit(txn_id_t t_txn);
+
+  /**
+   * @brief Undoes every write of a transaction, newest first, giving the
+   * versions it made back to the heap. Call before `TxnManager::end`.
+   */
+  void abort(txn_id_t t_txn, Heap& t_heap, FreeList& t_fl,
+             std::iostream& t_io);
+
+  /**
+   * @brief Lets go of every version no snapshot can see anymore: those
+   * replaced, and rows deleted, before `t_horizon`.
+   * @return How many versions were let go of.
+   */
+  auto vacuum(txn_id_t t_horizon, Heap& t_heap, FreeList& t_fl,
+              std::iostream& t_io) -> std::size_t;
+
+private:
+  struct Undo {
+    enum class Kind : uint8_t { Insert, Update, Erase };
+    Kind kind;
+    row_id_t row;
+  };
+
+  struct ReadGuard;
+
+  EntrySiz m_row_size;
+  // the newest version of each row, NullPtr once vacuumed away.
+  RowDirectory m_heads{};
+  // held by writers, for everything below it.
+  mutable std::mutex m_latch;
+  // the writes of every running transaction, oldest first.
+  std::unordered_map<txn_id_t, std::vector<Undo>> m_undo{};
+  // versions unlinked during each of the last two epochs, by parity.
+  std::array<std::vector<Ptr>, 2> m_retired{};
+  // readers that started during each of the last two epochs, by parity.
+  mutable std::array<std::atomic<std::size_t>, 2> m_readers{};
+  std::atomic<uint64_t> m_epoch{0};
+
+  /**
+   * @brief Looks at the newest version of a row before writing it.
+   */
+  auto check_write(const Snapshot& t_snap, row_id_t t_id,
+                   std::istream& t_in) const -> WriteResult;
+  auto push(const Snapshot& t_snap, std::span<const char> t_row, Ptr t_prev,
+            Heap& t_heap, FreeList& t_fl, std::iostream& t_io) -> Ptr;
+  void retire_chain(Ptr t_pos, std::istream& t_in);
+  /**
+   * @brief Gives back to the heap whatever no reader may be looking at
+   * anymore.
+   *
+   * What's unlinked during an epoch may be seen by the readers that started
+   * during it or before, and no later one. So once none of the epoch before
+   * the current one is left, what it retired is freed, and the next epoch
+   * starts.
+   */
+  void reclaim(Heap& t_heap, FreeList& t_fl, std::iostream& t_io);
+  /**
+   * @brief The version `t_snap` sees, from the newest of a row.
+   */
+  auto visible(const Snapshot& t_snap, Ptr t_pos, std::istream& t_in) const
+      -> Ptr;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_MVCC_HXX
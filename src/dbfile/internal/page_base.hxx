@@ -36,6 +36,20 @@ enum class TINYDB_EXPORT PageType : char {
   BTreeLeaf,
   BTreeInternal,
   Heap,
+  // Only ever seen in the database file, never in memory: the page cache
+  // inflates a compressed page back into its original type. See page_cache.
+  Compressed,
+  // One page of a single column of a columnar table. See column_store.
+  Column,
+  // Per-page summaries of a column of a columnar table. See zone_map.
+  ZoneMap,
+  // Part of a Bloom filter over the keys of a table. See bloom.
+  Bloom,
+  // Scratch space of a query that ran out of memory, freed when it ends.
+  // See spill.
+  Spill,
+  // Table and index definitions of the file. See catalog.
+  Catalog,
 };
 
 
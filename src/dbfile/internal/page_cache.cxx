@@ -0,0 +1,673 @@
+/**
+ * @file page_cache.cxx
+ * @brief Definitions for page_cache.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <streambuf>
+#include <unordered_map>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.page_cache;
+import tinydb.dbfile.internal.page_base;
+import tinydb.dbfile.internal.compress;
+import tinydb.dbfile.internal.header;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/internal/compress.hxx"
+#include "dbfile/internal/header.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <streambuf>
+#include <unordered_map>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/page_cache.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+using comp_len_t = uint16_t;
+constexpr std::size_t COMPRESSED_HEADER_SIZE =
+    sizeof(PageType) + sizeof(comp_len_t);
+
+/**
+ * @brief Whether a page of this type is worth compressing. Only pages holding
+ * bulk data are; metadata-only pages are mostly zeros anyways and get read
+ * way too often to pay for decompression.
+ */
+constexpr auto is_compressible(char t_type) -> bool {
+  return t_type == static_cast<pt_num_t>(PageType::Heap) ||
+         t_type == static_cast<pt_num_t>(PageType::BTreeLeaf) ||
+         t_type == static_cast<pt_num_t>(PageType::Column);
+}
+
+// the packed header has the slot right after page 0.
+constexpr uint64_t PACKED_HEADER_OFF = SIZEOF_PAGE;
+constexpr uint64_t PACKED_DATA_OFF = PACKED_HEADER_OFF + PagePool::SLOT_UNIT;
+constexpr std::size_t PACKED_HEADER_SIZE =
+    sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t);
+constexpr std::size_t MAP_ENTRY_SIZE =
+    sizeof(page_ptr_t) + sizeof(uint64_t) + sizeof(uint16_t) + sizeof(uint16_t);
+
+constexpr auto round_up(uint64_t t_size) -> uint64_t {
+  return (t_size + PagePool::SLOT_UNIT - 1) / PagePool::SLOT_UNIT *
+         PagePool::SLOT_UNIT;
+}
+
+/**
+ * @return How many bytes were read. What's missing at the end of the file is
+ * left as is.
+ */
+auto read_at(std::streambuf& t_rdbuf, uint64_t t_off, std::span<char> t_dst)
+    -> std::size_t {
+  if (t_rdbuf.pubseekpos(static_cast<std::streamoff>(t_off),
+                         std::ios_base::in) == std::streampos(-1)) {
+    return 0;
+  }
+  return static_cast<std::size_t>(t_rdbuf.sgetn(
+      t_dst.data(), static_cast<std::streamsize>(t_dst.size())));
+}
+
+void write_at(std::streambuf& t_rdbuf, uint64_t t_off,
+              std::span<const char> t_src) {
+  if (t_rdbuf.pubseekpos(static_cast<std::streamoff>(t_off),
+                         std::ios_base::out) == std::streampos(-1)) {
+    throw std::ios_base::failure("Cannot seek to page");
+  }
+  t_rdbuf.sputn(t_src.data(), static_cast<std::streamsize>(t_src.size()));
+}
+
+template <typename T> auto get(const char* t_src) -> T {
+  T ret{};
+  std::memcpy(&ret, t_src, sizeof(T));
+  return ret;
+}
+
+template <typename T> auto put(char* t_dst, T t_val) -> char* {
+  std::memcpy(t_dst, &t_val, sizeof(T));
+  return t_dst + sizeof(T);
+}
+
+} // namespace
+
+PagePool::PagePool(std::unique_ptr<std::iostream> t_backing,
+                   PageCompression t_compression, std::size_t t_capacity)
+    : m_backing{std::move(t_backing)},
+      m_shards(std::clamp<std::size_t>(t_capacity, 1, MAX_SHARDS)),
+      m_compression{t_compression} {
+  // the capacity is split evenly, rounding up.
+  for (auto& shard : m_shards) {
+    shard.capacity = (std::max<std::size_t>(t_capacity, 1) +
+                      m_shards.size() - 1) /
+                     m_shards.size();
+  }
+  open_packed();
+}
+
+PagePool::~PagePool() {
+  // There is nobody to report a failure to anymore. Same as std::filebuf.
+  try {
+    sync();
+  } catch (...) { // NOLINT(*empty-catch*)
+  }
+}
+
+auto PagePool::find(page_ptr_t t_pg_num) -> Frame* {
+  auto& shard = shard_of(t_pg_num);
+  const std::shared_lock lock{shard.latch};
+  auto found = shard.index.find(t_pg_num);
+  if (found == shard.index.end()) {
+    return nullptr;
+  }
+  auto& frame = *found->second;
+  frame.pins.fetch_add(1, std::memory_order_acquire);
+  frame.referenced.store(true, std::memory_order_relaxed);
+  return &frame;
+}
+
+auto PagePool::fetch(page_ptr_t t_pg_num) -> Frame& {
+  if (auto* frame = find(t_pg_num); frame != nullptr) {
+    return *frame;
+  }
+  auto& shard = shard_of(t_pg_num);
+  const std::unique_lock lock{shard.latch};
+  // someone may have loaded it in between.
+  if (auto found = shard.index.find(t_pg_num); found != shard.index.end()) {
+    found->second->pins.fetch_add(1, std::memory_order_acquire);
+    return *found->second;
+  }
+  auto& frame = victim(shard);
+  frame.pg_num = t_pg_num;
+  load(frame);
+  frame.pins.store(1, std::memory_order_relaxed);
+  frame.referenced.store(true, std::memory_order_relaxed);
+  frame.version.store(m_clock.fetch_add(1) + 1, std::memory_order_release);
+  shard.index.emplace(t_pg_num, &frame);
+  return frame;
+}
+
+auto PagePool::victim(Shard& t_shard) -> Frame& {
+  if (t_shard.frames.size() < t_shard.capacity) {
+    return *t_shard.frames.emplace_back(std::make_unique<Frame>());
+  }
+  // twice around: the first time only clears referenced bits.
+  for (std::size_t i = 0; i < 2 * t_shard.frames.size(); ++i) {
+    auto& frame = *t_shard.frames[t_shard.hand];
+    t_shard.hand = (t_shard.hand + 1) % t_shard.frames.size();
+    if (frame.pins.load(std::memory_order_acquire) != 0 ||
+        frame.referenced.exchange(false, std::memory_order_relaxed)) {
+      continue;
+    }
+    // unpinned, with the shard latched: nobody can be using it.
+    write_back(frame);
+    t_shard.index.erase(frame.pg_num);
+    return frame;
+  }
+  // every page is pinned. Pins don't last long, going over is fine.
+  return *t_shard.frames.emplace_back(std::make_unique<Frame>());
+}
+
+void PagePool::load(Frame& t_frame) {
+  const std::scoped_lock lock{m_io_latch};
+  t_frame.dirty = false;
+  t_frame.data.fill(0);
+  auto& rdbuf = *m_backing->rdbuf();
+  if (t_frame.pg_num == 0 && m_first_page.has_value()) {
+    t_frame.data = *m_first_page;
+    m_first_page.reset();
+    return;
+  }
+  if (m_packed && t_frame.pg_num != 0) {
+    auto found = m_extents.find(t_frame.pg_num);
+    if (found == m_extents.end()) {
+      // never written back, brand new.
+      return;
+    }
+    const auto& extent = found->second;
+    if (extent.len == SIZEOF_PAGE) {
+      read_at(rdbuf, extent.off, t_frame.data);
+      return;
+    }
+    std::array<char, SIZEOF_PAGE> scratch{};
+    auto payload = std::span{scratch}.first(extent.len);
+    if (read_at(rdbuf, extent.off, payload) != extent.len ||
+        !lz4_decompress(payload, t_frame.data)) {
+      throw std::ios_base::failure("Corrupted compressed page");
+    }
+    return;
+  }
+  auto pos = static_cast<std::streamoff>(t_frame.pg_num) * SIZEOF_PAGE;
+  if (rdbuf.pubseekpos(pos, std::ios_base::in) == std::streampos(-1)) {
+    // past the end of the file. The page is brand new.
+    return;
+  }
+  if (rdbuf.sgetn(t_frame.data.data(), 1) != 1) {
+    return;
+  }
+  if (t_frame.pg_num == 0 ||
+      t_frame.data[0] != static_cast<pt_num_t>(PageType::Compressed)) {
+    // whatever is missing at the end of the file reads as zeros.
+    rdbuf.sgetn(t_frame.data.data() + 1, SIZEOF_PAGE - 1);
+    return;
+  }
+
+  comp_len_t comp_len{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&comp_len), sizeof(comp_len));
+  std::array<char, SIZEOF_PAGE> scratch{};
+  if (comp_len > SIZEOF_PAGE - COMPRESSED_HEADER_SIZE ||
+      rdbuf.sgetn(scratch.data(), comp_len) != comp_len ||
+      !lz4_decompress(std::span{scratch.data(), comp_len}, t_frame.data)) {
+    // streams turn this into badbit.
+    throw std::ios_base::failure("Corrupted compressed page");
+  }
+}
+
+void PagePool::write_back(Frame& t_frame) {
+  if (!t_frame.dirty) {
+    return;
+  }
+  const std::scoped_lock lock{m_io_latch};
+  auto& rdbuf = *m_backing->rdbuf();
+  if (m_packed && t_frame.pg_num != 0) {
+    std::array<char, SIZEOF_PAGE> scratch{};
+    if (get_compression() != PageCompression::None &&
+        is_compressible(t_frame.data[0])) {
+      // a byte of savings at least, so that the length tells them apart.
+      auto comp_len =
+          lz4_compress(t_frame.data, std::span{scratch}.first(SIZEOF_PAGE - 1));
+      if (comp_len != 0) {
+        store(t_frame.pg_num, scratch, comp_len);
+        t_frame.dirty = false;
+        return;
+      }
+    }
+    store(t_frame.pg_num, t_frame.data, SIZEOF_PAGE);
+    t_frame.dirty = false;
+    return;
+  }
+  auto pos = static_cast<std::streamoff>(t_frame.pg_num) * SIZEOF_PAGE;
+  if (rdbuf.pubseekpos(pos, std::ios_base::out) == std::streampos(-1)) {
+    throw std::ios_base::failure("Cannot seek to page");
+  }
+
+  // the header's first byte isn't a page type, and whatever wrote into it
+  // left its checksum stale.
+  if (t_frame.pg_num == 0) {
+    stamp_header(t_frame.data);
+  } else if (get_compression() != PageCompression::None &&
+             is_compressible(t_frame.data[0])) {
+    std::array<char, SIZEOF_PAGE> scratch{};
+    // Leave at least a byte of savings, otherwise it's not worth it.
+    auto comp_len = lz4_compress(
+        t_frame.data,
+        std::span{scratch}.subspan(COMPRESSED_HEADER_SIZE,
+                                   SIZEOF_PAGE - COMPRESSED_HEADER_SIZE - 1));
+    if (comp_len != 0) {
+      scratch[0] = static_cast<pt_num_t>(PageType::Compressed);
+      auto len = static_cast<comp_len_t>(comp_len);
+      std::memcpy(scratch.data() + sizeof(PageType), &len, sizeof(len));
+      rdbuf.sputn(scratch.data(), static_cast<std::streamsize>(
+                                      COMPRESSED_HEADER_SIZE + comp_len));
+      t_frame.dirty = false;
+      return;
+    }
+  }
+  rdbuf.sputn(t_frame.data.data(), SIZEOF_PAGE);
+  t_frame.dirty = false;
+}
+
+auto PagePool::read(page_ptr_t t_pg_num, std::span<char, SIZEOF_PAGE> t_dst)
+    -> uint64_t {
+  auto& frame = fetch(t_pg_num);
+  const Pin pin{&frame};
+  const std::shared_lock lock{frame.latch};
+  std::ranges::copy(frame.data, t_dst.begin());
+  return frame.version.load(std::memory_order_acquire);
+}
+
+auto PagePool::try_read(page_ptr_t t_pg_num,
+                        std::span<char, SIZEOF_PAGE> t_dst)
+    -> std::optional<uint64_t> {
+  auto* frame = find(t_pg_num);
+  if (frame == nullptr) {
+    return std::nullopt;
+  }
+  const Pin pin{frame};
+  const std::shared_lock lock{frame->latch};
+  std::ranges::copy(frame->data, t_dst.begin());
+  return frame->version.load(std::memory_order_acquire);
+}
+
+void PagePool::write(page_ptr_t t_pg_num, std::size_t t_off,
+                     std::span<const char> t_src) {
+  assert(t_off + t_src.size() <= SIZEOF_PAGE);
+  auto& frame = fetch(t_pg_num);
+  const Pin pin{&frame};
+  const std::unique_lock lock{frame.latch};
+  std::ranges::copy(t_src, frame.data.begin() +
+                               static_cast<std::ptrdiff_t>(t_off));
+  frame.dirty = true;
+  frame.version.store(m_clock.fetch_add(1) + 1, std::memory_order_release);
+}
+
+auto PagePool::version(page_ptr_t t_pg_num) -> uint64_t {
+  auto& shard = shard_of(t_pg_num);
+  const std::shared_lock lock{shard.latch};
+  auto found = shard.index.find(t_pg_num);
+  return found == shard.index.end()
+             ? 0
+             : found->second->version.load(std::memory_order_acquire);
+}
+
+auto PagePool::end_pos() -> uint64_t {
+  uint64_t ret{0};
+  {
+    const std::scoped_lock lock{m_io_latch};
+    if (m_packed) {
+      // page 0 is always there.
+      ret = SIZEOF_PAGE;
+      for (const auto& [pg_num, _] : m_extents) {
+        ret = std::max(ret, static_cast<uint64_t>(pg_num + 1) * SIZEOF_PAGE);
+      }
+    } else {
+      auto end = m_backing->rdbuf()->pubseekoff(0, std::ios_base::end,
+                                                std::ios_base::in);
+      ret = end == std::streampos(-1) ? 0 : static_cast<uint64_t>(end);
+    }
+  }
+  for (auto& shard : m_shards) {
+    const std::shared_lock lock{shard.latch};
+    for (const auto& [pg_num, _] : shard.index) {
+      ret = std::max(ret, static_cast<uint64_t>(pg_num + 1) * SIZEOF_PAGE);
+    }
+  }
+  return ret;
+}
+
+auto PagePool::sync() -> bool {
+  for (auto& shard : m_shards) {
+    const std::unique_lock lock{shard.latch};
+    for (auto& frame : shard.frames) {
+      const std::unique_lock frame_lock{frame->latch};
+      write_back(*frame);
+    }
+  }
+  const std::scoped_lock lock{m_io_latch};
+  write_map();
+  m_backing->flush();
+  return m_backing->good();
+}
+
+void PagePool::open_packed() {
+  auto& rdbuf = *m_backing->rdbuf();
+  // one read for both, page 0 is going to be needed anyways.
+  std::array<char, SIZEOF_PAGE + PACKED_HEADER_SIZE> first{};
+  read_at(rdbuf, 0, first);
+  m_first_page.emplace();
+  std::ranges::copy(std::span{first}.first<SIZEOF_PAGE>(),
+                    m_first_page->begin());
+  const char* header = first.data() + PACKED_HEADER_OFF;
+  if (get<uint32_t>(header) != PACKED_MAGIC) {
+    if (get_compression() == PageCompression::None ||
+        std::ranges::any_of(*m_first_page,
+                            [](char t_c) { return t_c != 0; })) {
+      return;
+    }
+    // page 0 isn't anything yet either, writing it makes room for the
+    // packed header.
+    m_packed = true;
+    m_phys_end = PACKED_DATA_OFF;
+    write_at(rdbuf, 0, *m_first_page);
+    m_map_dirty = true;
+    write_map();
+    return;
+  }
+
+  m_packed = true;
+  const auto n_pages = get<uint32_t>(header + sizeof(uint32_t));
+  m_map_off = get<uint64_t>(header + (2 * sizeof(uint32_t)));
+  m_map_size = uint64_t{n_pages} * MAP_ENTRY_SIZE;
+  std::vector<char> map(m_map_size);
+  if (read_at(rdbuf, m_map_off, map) != map.size()) {
+    throw std::ios_base::failure("Corrupted page map");
+  }
+  // whatever isn't taken by a page or the map is free.
+  std::vector<std::pair<uint64_t, uint64_t>> taken{};
+  if (m_map_size != 0) {
+    taken.emplace_back(m_map_off, round_up(m_map_size));
+  }
+  for (const char* entry = map.data(); entry != map.data() + map.size();
+       entry += MAP_ENTRY_SIZE) {
+    const auto pg_num = get<page_ptr_t>(entry);
+    const char* pos = entry + sizeof(page_ptr_t);
+    Extent extent{.off = get<uint64_t>(pos),
+                  .len = get<uint16_t>(pos + sizeof(uint64_t)),
+                  .cap = get<uint16_t>(pos + sizeof(uint64_t) +
+                                       sizeof(uint16_t))};
+    if (extent.off < PACKED_DATA_OFF || extent.len > extent.cap ||
+        extent.len > SIZEOF_PAGE || extent.len == 0) {
+      throw std::ios_base::failure("Corrupted page map");
+    }
+    m_extents.emplace(pg_num, extent);
+    taken.emplace_back(extent.off, extent.cap);
+  }
+  std::ranges::sort(taken);
+  m_phys_end = PACKED_DATA_OFF;
+  for (const auto& [off, size] : taken) {
+    if (off > m_phys_end) {
+      m_holes.emplace(m_phys_end, off - m_phys_end);
+    }
+    m_phys_end = std::max(m_phys_end, off + size);
+  }
+}
+
+void PagePool::store(page_ptr_t t_pg_num,
+                     std::span<const char, SIZEOF_PAGE> t_buf,
+                     std::size_t t_len) {
+  const auto need = round_up(t_len);
+  auto [found, added] = m_extents.try_emplace(t_pg_num);
+  auto& extent = found->second;
+  if (added || need > extent.cap || need * 2 <= extent.cap) {
+    if (!added) {
+      m_freed.emplace_back(extent.off, extent.cap);
+    }
+    extent.off = allocate(need);
+    extent.cap = static_cast<uint16_t>(need);
+    m_map_dirty = true;
+  }
+  if (extent.len != t_len) {
+    extent.len = static_cast<uint16_t>(t_len);
+    m_map_dirty = true;
+  }
+  // the whole room, or a stringstream wouldn't let the next page in after it.
+  write_at(*m_backing->rdbuf(), extent.off, t_buf.first(need));
+}
+
+void PagePool::write_map() {
+  if (!m_packed || !m_map_dirty) {
+    return;
+  }
+  auto& rdbuf = *m_backing->rdbuf();
+  const auto map_size = m_extents.size() * MAP_ENTRY_SIZE;
+  std::vector<char> map(round_up(map_size));
+  char* pos = map.data();
+  for (const auto& [pg_num, extent] : m_extents) {
+    pos = put(pos, pg_num);
+    pos = put(pos, extent.off);
+    pos = put(pos, extent.len);
+    pos = put(pos, extent.cap);
+  }
+  const auto map_off = map.empty() ? 0 : allocate(map.size());
+  write_at(rdbuf, map_off, map);
+  // the map has to be there before the header points to it.
+  m_backing->flush();
+  std::array<char, SLOT_UNIT> header{};
+  pos = put(header.data(), PACKED_MAGIC);
+  pos = put(pos, static_cast<uint32_t>(m_extents.size()));
+  put(pos, map_off);
+  write_at(rdbuf, PACKED_HEADER_OFF, header);
+
+  // nothing on disk points at the old map or the pages' old places anymore.
+  if (m_map_size != 0) {
+    release(m_map_off, round_up(m_map_size));
+  }
+  for (const auto& [off, size] : m_freed) {
+    release(off, size);
+  }
+  m_freed.clear();
+  m_map_off = map_off;
+  m_map_size = map_size;
+  m_map_dirty = false;
+}
+
+auto PagePool::allocate(uint64_t t_size) -> uint64_t {
+  // first fit.
+  for (auto hole = m_holes.begin(); hole != m_holes.end(); ++hole) {
+    if (hole->second < t_size) {
+      continue;
+    }
+    const auto [off, size] = *hole;
+    m_holes.erase(hole);
+    if (size > t_size) {
+      m_holes.emplace(off + t_size, size - t_size);
+    }
+    return off;
+  }
+  const auto ret = m_phys_end;
+  m_phys_end += t_size;
+  return ret;
+}
+
+void PagePool::release(uint64_t t_off, uint64_t t_size) {
+  auto next = m_holes.lower_bound(t_off);
+  if (next != m_holes.end() && t_off + t_size == next->first) {
+    t_size += next->second;
+    next = m_holes.erase(next);
+  }
+  if (next != m_holes.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == t_off) {
+      prev->second += t_size;
+      return;
+    }
+  }
+  m_holes.emplace(t_off, t_size);
+}
+
+PageCache::PageCache(std::unique_ptr<std::iostream> t_backing,
+                     PageCompression t_compression, std::size_t t_capacity)
+    : m_pool{std::make_shared<PagePool>(std::move(t_backing), t_compression,
+                                        t_capacity)} {}
+
+auto PageCache::current_gpos() const noexcept -> uint64_t {
+  if (eback() == nullptr) {
+    return m_gpos;
+  }
+  return (static_cast<uint64_t>(m_garea_pg) * SIZEOF_PAGE) +
+         static_cast<uint64_t>(gptr() - eback());
+}
+
+void PageCache::drop_get_area() noexcept {
+  m_gpos = current_gpos();
+  setg(nullptr, nullptr, nullptr);
+}
+
+auto PageCache::seekoff(off_type t_off, std::ios_base::seekdir t_dir,
+                        std::ios_base::openmode t_which) -> pos_type {
+  const bool in = (t_which & std::ios_base::in) != 0;
+  const bool out = (t_which & std::ios_base::out) != 0;
+  off_type base{0};
+  switch (t_dir) {
+  case std::ios_base::beg:
+    break;
+  case std::ios_base::cur:
+    // like std::stringbuf, moving both positions relative to "current" is
+    // ambiguous.
+    if (in && out) {
+      return pos_type(off_type(-1));
+    }
+    base = static_cast<off_type>(in ? current_gpos() : m_ppos);
+    break;
+  case std::ios_base::end:
+    base = static_cast<off_type>(m_pool->end_pos());
+    break;
+  default:
+    return pos_type(off_type(-1));
+  }
+  if (base + t_off < 0) {
+    return pos_type(off_type(-1));
+  }
+  return seekpos(pos_type(base + t_off), t_which);
+}
+
+auto PageCache::seekpos(pos_type t_pos, std::ios_base::openmode t_which)
+    -> pos_type {
+  if (off_type(t_pos) < 0) {
+    return pos_type(off_type(-1));
+  }
+  auto pos = static_cast<uint64_t>(off_type(t_pos));
+  if ((t_which & std::ios_base::in) != 0) {
+    if (eback() != nullptr && pos / SIZEOF_PAGE == m_garea_pg &&
+        m_pool->version(m_garea_pg) == m_garea_version) {
+      // still inside the same page, which didn't change: keep the get area.
+      setg(eback(), eback() + (pos % SIZEOF_PAGE), egptr());
+    } else {
+      setg(nullptr, nullptr, nullptr);
+      m_gpos = pos;
+    }
+  }
+  if ((t_which & std::ios_base::out) != 0) {
+    m_ppos = pos;
+  }
+  return t_pos;
+}
+
+auto PageCache::underflow() -> int_type {
+  drop_get_area();
+  auto pg_num = static_cast<page_ptr_t>(m_gpos / SIZEOF_PAGE);
+  auto off = static_cast<page_off_t>(m_gpos % SIZEOF_PAGE);
+  if (m_cached_only) {
+    auto version = m_pool->try_read(pg_num, m_garea);
+    if (!version) {
+      if (!m_missed) {
+        m_missed = pg_num;
+      }
+      return traits_type::eof();
+    }
+    m_garea_version = *version;
+  } else {
+    m_garea_version = m_pool->read(pg_num, m_garea);
+  }
+  setg(m_garea.data(), m_garea.data() + off, m_garea.data() + SIZEOF_PAGE);
+  m_garea_pg = pg_num;
+  return traits_type::to_int_type(*gptr());
+}
+
+auto PageCache::overflow(int_type t_c) -> int_type {
+  if (traits_type::eq_int_type(t_c, traits_type::eof())) {
+    return traits_type::not_eof(t_c);
+  }
+  auto c = traits_type::to_char_type(t_c);
+  return xsputn(&c, 1) == 1 ? t_c : traits_type::eof();
+}
+
+auto PageCache::xsputn(const char_type* t_s, std::streamsize t_n)
+    -> std::streamsize {
+  std::streamsize written{0};
+  while (written < t_n) {
+    auto pg_num = static_cast<page_ptr_t>(m_ppos / SIZEOF_PAGE);
+    auto off = static_cast<std::size_t>(m_ppos % SIZEOF_PAGE);
+    auto chunk = std::min(static_cast<std::size_t>(t_n - written),
+                          SIZEOF_PAGE - off);
+    m_pool->write(pg_num, off, std::span{t_s + written, chunk});
+    // our own writes show up in our reads right away.
+    if (eback() != nullptr && pg_num == m_garea_pg) {
+      m_garea_version = m_pool->read(pg_num, m_garea);
+    }
+    written += static_cast<std::streamsize>(chunk);
+    m_ppos += chunk;
+  }
+  return written;
+}
+
+auto PageCache::sync() -> int { return m_pool->sync() ? 0 : -1; }
+
+} // namespace tinydb::dbfile::internal
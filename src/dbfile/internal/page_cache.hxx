@@ -0,0 +1,390 @@
+/**
+ * @file page_cache.hxx
+ * @brief Declares the page cache, which sits between the database file and
+ * everything that reads or writes pages.
+ *
+ * The cache is a `std::streambuf`, so every part of the codebase that already
+ * talks to a `std::iostream` (FreeList, Heap, TableMeta, ...) goes through it
+ * without any change: wrap the cache in a `std::iostream` and pass that
+ * around instead of the raw file. Threads sharing a file each wrap their own
+ * cache around the same PagePool, which holds the pages.
+ *
+ * Pages inside the cache are always uncompressed. Compression only happens
+ * when a dirty page is written back into the underlying stream, and only for
+ * page types that hold bulk data (heap, B+ tree leaf and column pages).
+ *
+ * Files created with compression on are packed: page 0 is at offset 0 as
+ * always, and every other page is wherever the pool put it, taking only the
+ * bytes it needs rounded up to `SLOT_UNIT`. The page map says where:
+ * - offset `SIZEOF_PAGE`: the packed header, in its own slot. 4 bytes of
+ *   `PACKED_MAGIC`, 4 bytes of how many pages the map has, then 8 bytes of
+ *   where the map is.
+ * - the map: for each page, 4 bytes of page number, 8 bytes of offset, 2 bytes
+ *   of length and 2 bytes of room. A length of `SIZEOF_PAGE` means the page is
+ *   stored as is, anything shorter is its compressed bytes.
+ * The map is written on `sync()`. Until then, the room freed by pages that
+ * moved isn't reused, so the map on disk never points at overwritten bytes.
+ *
+ * Other files keep one `SIZEOF_PAGE` slot per page, and a compressed page
+ * only uses the start of its slot:
+ * - offset 0: 1 byte, `PageType::Compressed`.
+ * - offset 1: 2 bytes, size of the compressed payload.
+ * - offset 3: the compressed payload. It decompresses into the whole page,
+ *   including the original page type byte.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_PAGE_CACHE_HXX
+#define TINYDB_DBFILE_INTERNAL_PAGE_CACHE_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/internal/page_base.hxx"
+#include "general/sizes.hxx"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <streambuf>
+#include <unordered_map>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @brief How the page cache stores eligible pages in the underlying stream.
+ */
+enum class TINYDB_EXPORT PageCompression : uint8_t {
+  None = 0,
+  Lz4,
+};
+
+/**
+ * @class PagePool
+ * @brief The pages themselves: a write-back cache of them, shared by every
+ * PageCache reading or writing the same file, from any thread.
+ *
+ * The pool is split into shards by page number, each with its own latch and
+ * its own share of the capacity, so threads working on different pages
+ * rarely meet. A cache hit only takes its shard's latch shared; pages are
+ * evicted CLOCK-style (a referenced bit instead of moving pages around an
+ * LRU list), which is what lets hits stay shared.
+ *
+ * Each page has its own latch too: shared while it's copied out, exclusive
+ * while it's written to. A page is pinned while that happens, and pinned
+ * pages are never evicted. The underlying stream has a latch of its own,
+ * since every shard loads from and writes back to it.
+ *
+ * Latches are always taken in that order (shard, page, stream), and none is
+ * held once a call returns.
+ *
+ * Dirty pages are written back when they are evicted, on `sync()`, and on
+ * destruction.
+ * Page 0 is the header of the file: it's never compressed, and its checksum
+ * is stamped right before it's written back (see header.hxx).
+ * Whether the file is packed is decided once, when the pool is created: it is
+ * if it already was, or if compression is on and the file is still empty.
+ *
+ * The underlying stream must accept writes past its current end. A
+ * `std::fstream` does; a `std::stringstream` must be pre-sized, as the unit
+ * tests already do, unless the file is packed: those only ever grow at the
+ * end.
+ */
+class TINYDB_EXPORT PagePool {
+public:
+  static constexpr std::size_t MAX_SHARDS = 16;
+  static constexpr uint32_t PACKED_MAGIC = 0x50424454; // "TDBP"
+  static constexpr uint64_t SLOT_UNIT = 256;
+
+  PagePool(std::unique_ptr<std::iostream> t_backing,
+           PageCompression t_compression, std::size_t t_capacity);
+  PagePool(const PagePool&) = delete;
+  PagePool(PagePool&&) = delete;
+  auto operator=(const PagePool&) -> PagePool& = delete;
+  auto operator=(PagePool&&) -> PagePool& = delete;
+  ~PagePool();
+
+  void set_compression(PageCompression t_compression) noexcept {
+    m_compression.store(t_compression, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto get_compression() const noexcept -> PageCompression {
+    return m_compression.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Copies a whole page out.
+   * @return The version of the page copied, see `version`.
+   */
+  auto read(page_ptr_t t_pg_num, std::span<char, SIZEOF_PAGE> t_dst)
+      -> uint64_t;
+
+  /**
+   * @brief `read`, only if the page is cached already: never waits on the
+   * underlying stream.
+   * @return std::nullopt if the page isn't cached.
+   */
+  auto try_read(page_ptr_t t_pg_num, std::span<char, SIZEOF_PAGE> t_dst)
+      -> std::optional<uint64_t>;
+
+  /**
+   * @brief Writes some bytes into one page.
+   */
+  void write(page_ptr_t t_pg_num, std::size_t t_off,
+             std::span<const char> t_src);
+
+  /**
+   * @return A number that changes whenever the page does, or is evicted.
+   * 0 if the page isn't cached.
+   */
+  [[nodiscard]] auto version(page_ptr_t t_pg_num) -> uint64_t;
+
+  /**
+   * @return One past the last byte of the file, pages not written back yet
+   * included.
+   */
+  [[nodiscard]] auto end_pos() -> uint64_t;
+
+  /**
+   * @brief Writes every dirty page back, and the page map of a packed file,
+   * and flushes the underlying stream.
+   * @return false if the underlying stream went bad.
+   */
+  auto sync() -> bool;
+
+  [[nodiscard]] auto is_packed() const noexcept -> bool { return m_packed; }
+
+private:
+  struct Frame {
+    page_ptr_t pg_num{NULL_PAGE};
+    std::atomic<uint32_t> pins{0};
+    std::atomic<bool> referenced{false};
+    std::atomic<uint64_t> version{0};
+    // guarded by `latch`.
+    bool dirty{false};
+    std::shared_mutex latch;
+    std::array<char, SIZEOF_PAGE> data{};
+  };
+
+  struct Shard {
+    std::shared_mutex latch;
+    // frames never move once created.
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::unordered_map<page_ptr_t, Frame*> index;
+    std::size_t capacity{1};
+    std::size_t hand{0};
+  };
+
+  /**
+   * @brief Unpins a frame once it goes out of scope.
+   */
+  struct Pin {
+    Frame* frame;
+    explicit Pin(Frame* t_frame) noexcept : frame{t_frame} {}
+    Pin(const Pin&) = delete;
+    Pin(Pin&&) = delete;
+    auto operator=(const Pin&) -> Pin& = delete;
+    auto operator=(Pin&&) -> Pin& = delete;
+    ~Pin() { frame->pins.fetch_sub(1, std::memory_order_release); }
+  };
+
+  /**
+   * @brief Where a page of a packed file is.
+   */
+  struct Extent {
+    uint64_t off{0};
+    // SIZEOF_PAGE if the page is stored as is.
+    uint16_t len{0};
+    // a page only moves once it outgrows its room, or uses under half of it.
+    uint16_t cap{0};
+  };
+
+  std::unique_ptr<std::iostream> m_backing;
+  std::mutex m_io_latch;
+  // set once by the constructor. The rest is guarded by m_io_latch, and only
+  // used by packed files.
+  bool m_packed{false};
+  bool m_map_dirty{false};
+  std::unordered_map<page_ptr_t, Extent> m_extents;
+  uint64_t m_map_off{0};
+  uint64_t m_map_size{0};
+  // free ranges of the file, by offset.
+  std::map<uint64_t, uint64_t> m_holes;
+  // ranges freed since the map was last written.
+  std::vector<std::pair<uint64_t, uint64_t>> m_freed;
+  uint64_t m_phys_end{0};
+  // page 0, read along with the packed header, until it's first loaded.
+  std::optional<std::array<char, SIZEOF_PAGE>> m_first_page;
+  std::vector<Shard> m_shards;
+  std::atomic<PageCompression> m_compression;
+  // every page version comes from here, so a page evicted and read back
+  // never gets a version it had before.
+  std::atomic<uint64_t> m_clock{0};
+
+  auto shard_of(page_ptr_t t_pg_num) noexcept -> Shard& {
+    return m_shards[t_pg_num % m_shards.size()];
+  }
+
+  /**
+   * @brief Returns the cached page, pinned, or nullptr if it isn't cached.
+   */
+  auto find(page_ptr_t t_pg_num) -> Frame*;
+  /**
+   * @brief Returns the cached page, pinned, reading it from the underlying
+   * stream if it isn't cached yet. May evict an unpinned page.
+   */
+  auto fetch(page_ptr_t t_pg_num) -> Frame&;
+  /**
+   * @brief Finds a frame to load a page into, under the shard's latch.
+   */
+  auto victim(Shard& t_shard) -> Frame&;
+  void load(Frame& t_frame);
+  void write_back(Frame& t_frame);
+
+  /**
+   * @brief Reads the page map of a packed file, or starts a new one if the
+   * file is still empty and compression is on.
+   */
+  void open_packed();
+  /**
+   * @brief Writes a page of a packed file, moving it if it has to.
+   */
+  void store(page_ptr_t t_pg_num, std::span<const char, SIZEOF_PAGE> t_buf,
+             std::size_t t_len);
+  void write_map();
+  auto allocate(uint64_t t_size) -> uint64_t;
+  void release(uint64_t t_off, uint64_t t_size);
+};
+
+/**
+ * @class PageCache
+ * @brief One reader/writer of a PagePool, in the shape of a `std::streambuf`.
+ *
+ * A PageCache is used by one thread at a time, like any stream; threads
+ * sharing a file each get their own over the same pool (see PageStream).
+ *
+ * Like `std::stringbuf`, the read and write positions are separate, so
+ * `seekg` followed by reads and `seekp` followed by writes behave the same as
+ * they do on the raw file.
+ *
+ * The get area is a copy of the page being read, taken when the reads get
+ * to that page. It's taken again on a seek if the page changed in between,
+ * so reads following one seek see the page as it was at that seek.
+ */
+class TINYDB_EXPORT PageCache : public std::streambuf {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 256;
+
+  /**
+   * @brief A cache with a pool of its own.
+   */
+  explicit PageCache(std::unique_ptr<std::iostream> t_backing,
+                     PageCompression t_compression = PageCompression::None,
+                     std::size_t t_capacity = DEFAULT_CAPACITY);
+  /**
+   * @brief Another cache over the same pool.
+   */
+  explicit PageCache(std::shared_ptr<PagePool> t_pool)
+      : m_pool{std::move(t_pool)} {}
+  PageCache(const PageCache&) = delete;
+  PageCache(PageCache&&) = delete;
+  auto operator=(const PageCache&) -> PageCache& = delete;
+  auto operator=(PageCache&&) -> PageCache& = delete;
+  ~PageCache() override = default;
+
+  [[nodiscard]] auto pool() const noexcept
+      -> const std::shared_ptr<PagePool>& {
+    return m_pool;
+  }
+
+  /**
+   * @brief Changes how pages are written back from now on. Pages already in
+   * the underlying stream keep whichever format they were written in; both
+   * are always readable. Applies to the whole pool.
+   */
+  void set_compression(PageCompression t_compression) noexcept {
+    m_pool->set_compression(t_compression);
+  }
+
+  [[nodiscard]] auto get_compression() const noexcept -> PageCompression {
+    return m_pool->get_compression();
+  }
+
+  /**
+   * @brief In cached-only mode, reading a page that isn't cached reads
+   * nothing (end of file) instead of waiting on the underlying stream, and
+   * the page is remembered, see `missed`.
+   */
+  void set_cached_only(bool t_cached_only) noexcept {
+    m_cached_only = t_cached_only;
+  }
+
+  /**
+   * @return The first page a read missed in cached-only mode, since the last
+   * `clear_missed`.
+   */
+  [[nodiscard]] auto missed() const noexcept -> std::optional<page_ptr_t> {
+    return m_missed;
+  }
+
+  void clear_missed() noexcept { m_missed.reset(); }
+
+protected:
+  auto seekoff(off_type t_off, std::ios_base::seekdir t_dir,
+               std::ios_base::openmode t_which) -> pos_type override;
+  auto seekpos(pos_type t_pos, std::ios_base::openmode t_which)
+      -> pos_type override;
+  auto underflow() -> int_type override;
+  auto overflow(int_type t_c) -> int_type override;
+  auto xsputn(const char_type* t_s, std::streamsize t_n)
+      -> std::streamsize override;
+  auto sync() -> int override;
+
+private:
+  std::shared_ptr<PagePool> m_pool;
+  // Read position, only meaningful while there is no get area.
+  uint64_t m_gpos{0};
+  // Page the get area is a copy of, and the version it was copied at.
+  page_ptr_t m_garea_pg{NULL_PAGE};
+  uint64_t m_garea_version{0};
+  uint64_t m_ppos{0};
+  bool m_cached_only{false};
+  std::optional<page_ptr_t> m_missed{};
+  std::array<char, SIZEOF_PAGE> m_garea{};
+
+  [[nodiscard]] auto current_gpos() const noexcept -> uint64_t;
+  void drop_get_area() noexcept;
+};
+
+/**
+ * @class PageStream
+ * @brief A `std::iostream` with a PageCache of its own over a pool, for one
+ * more thread to use the file with.
+ */
+class TINYDB_EXPORT PageStream : public std::iostream {
+public:
+  explicit PageStream(std::shared_ptr<PagePool> t_pool)
+      : std::iostream{nullptr}, m_cache{std::move(t_pool)} {
+    rdbuf(&m_cache);
+  }
+
+  [[nodiscard]] auto cache() noexcept -> PageCache& { return m_cache; }
+
+private:
+  PageCache m_cache;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_PAGE_CACHE_HXX
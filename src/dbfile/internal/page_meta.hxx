@@ -12,10 +12,10 @@
  * TL;DR, a "page" is the basic functional block of disk memory. If we organize
  * our data in terms of pages, it would be MUCH faster to operate on.
  *
- * In our database files, each page can function in 1 of the 4 following ways
- * (maybe 5, the first page is reserved for metadata of the entire database
- * file): as a free page, a BTree's leaf page, a BTree's internal page, or a
- * heap page.
+ * In our database files, each page can function in 1 of the 5 following ways
+ * (maybe 6, the first page is reserved for metadata of the entire database
+ * file): as a free page, a BTree's leaf page, a BTree's internal page, a
+ * heap page, or a page of a columnar table.
  * Which can be grouped into 2 higher categories: indexing and storage
  * management.
  *
@@ -344,6 +344,255 @@ public:
   }
 };
 
+/**
+ * @brief How the values inside a column page are stored. See column_store.
+ */
+enum class TINYDB_EXPORT ColumnEncoding : uint8_t {
+  // the values themselves.
+  Plain = 0,
+  // a dictionary of the distinct values, then one code per value.
+  Dict,
+  // a dictionary of the distinct values, then runs of the same code.
+  Rle,
+};
+
+/**
+ * @class ColumnPageMeta
+ * @brief Contains metadata about a page of a columnar table.
+ *
+ * Each column of a columnar table is its own singly-linked list of these
+ * pages, holding the values of that column only, in row order. How the values
+ * are laid out after the metadata depends on the column's type and the
+ * page's encoding; see column_store.
+ */
+class TINYDB_EXPORT ColumnPageMeta : public PageMixin {
+public:
+  // number of values
+  using n_values_t = uint16_t;
+
+private:
+  // offset 0: 1 byte, equivalent to `PageType::Column`.
+  // offset 1: 4 bytes, pointer to the next page of the same column.
+  //   NULL_PAGE if this is the last one.
+  page_ptr_t m_next_pg;
+  // offset 5: 2 bytes, number of values stored inside this page.
+  n_values_t m_n_values;
+  // offset 7: 2 bytes. In a plain Text page, where the lowest string starts
+  //   (strings grow downward from the end of the page). In a Dict or Rle page,
+  //   where the codes start. Left at SIZEOF_PAGE otherwise.
+  page_off_t m_data_off;
+  // offset 9: 1 byte, the encoding.
+  ColumnEncoding m_encoding;
+
+public:
+  static constexpr page_off_t DEFAULT_FREE_OFF =
+      sizeof(PageType) + sizeof(m_next_pg) + sizeof(m_n_values) +
+      sizeof(m_data_off) + sizeof(m_encoding);
+
+  explicit ColumnPageMeta(page_ptr_t t_page_num)
+      : PageMixin{t_page_num}, m_next_pg{NULL_PAGE}, m_n_values{0},
+        m_data_off{SIZEOF_PAGE}, m_encoding{ColumnEncoding::Plain} {}
+  ColumnPageMeta(page_ptr_t t_page_num, page_ptr_t t_next_pg,
+                 n_values_t t_n_values, page_off_t t_data_off,
+                 ColumnEncoding t_encoding)
+      : PageMixin{t_page_num}, m_next_pg{t_next_pg}, m_n_values{t_n_values},
+        m_data_off{t_data_off}, m_encoding{t_encoding} {}
+
+  [[nodiscard]] constexpr auto get_next_pg() const noexcept -> page_ptr_t {
+    return m_next_pg;
+  }
+
+  [[nodiscard]] constexpr auto get_n_values() const noexcept -> n_values_t {
+    return m_n_values;
+  }
+
+  [[nodiscard]] constexpr auto get_data_off() const noexcept -> page_off_t {
+    return m_data_off;
+  }
+
+  [[nodiscard]] constexpr auto get_encoding() const noexcept
+      -> ColumnEncoding {
+    return m_encoding;
+  }
+
+  constexpr void update_next_pg(page_ptr_t t_next) noexcept {
+    m_next_pg = t_next;
+  }
+
+  constexpr void update_n_values(n_values_t t_n_values) noexcept {
+    m_n_values = t_n_values;
+  }
+
+  constexpr void update_data_off(page_off_t t_data_off) {
+    assert(t_data_off >= DEFAULT_FREE_OFF && t_data_off <= SIZEOF_PAGE);
+    m_data_off = t_data_off;
+  }
+};
+
+/**
+ * @class ZoneMapPageMeta
+ * @brief Contains metadata about a page of zones (see zone_map).
+ *
+ * The zones of a column are a singly-linked list of these pages, zones stored
+ * back to back right after the metadata.
+ */
+class TINYDB_EXPORT ZoneMapPageMeta : public PageMixin {
+public:
+  using n_zones_t = uint16_t;
+
+private:
+  // offset 0: 1 byte, equivalent to `PageType::ZoneMap`.
+  // offset 1: 4 bytes, pointer to the next page of zones. NULL_PAGE if this
+  //   is the last one.
+  page_ptr_t m_next_pg;
+  // offset 5: 2 bytes, number of zones stored inside this page.
+  n_zones_t m_n_zones;
+
+public:
+  static constexpr page_off_t DEFAULT_FREE_OFF =
+      sizeof(PageType) + sizeof(m_next_pg) + sizeof(m_n_zones);
+
+  explicit ZoneMapPageMeta(page_ptr_t t_page_num)
+      : PageMixin{t_page_num}, m_next_pg{NULL_PAGE}, m_n_zones{0} {}
+  ZoneMapPageMeta(page_ptr_t t_page_num, page_ptr_t t_next_pg,
+                  n_zones_t t_n_zones)
+      : PageMixin{t_page_num}, m_next_pg{t_next_pg}, m_n_zones{t_n_zones} {}
+
+  [[nodiscard]] constexpr auto get_next_pg() const noexcept -> page_ptr_t {
+    return m_next_pg;
+  }
+
+  [[nodiscard]] constexpr auto get_n_zones() const noexcept -> n_zones_t {
+    return m_n_zones;
+  }
+
+  constexpr void update_next_pg(page_ptr_t t_next) noexcept {
+    m_next_pg = t_next;
+  }
+
+  constexpr void update_n_zones(n_zones_t t_n_zones) noexcept {
+    m_n_zones = t_n_zones;
+  }
+};
+
+/**
+ * @class BloomPageMeta
+ * @brief Contains metadata about a page of a Bloom filter (see bloom).
+ *
+ * A filter is a singly-linked list of these pages. Each holds a slice of the
+ * filter's blocks, starting at `BLOCKS_OFF` so that blocks stay aligned to
+ * cache lines if the page is.
+ */
+class TINYDB_EXPORT BloomPageMeta : public PageMixin {
+public:
+  using n_blocks_t = uint16_t;
+
+private:
+  // offset 0: 1 byte, equivalent to `PageType::Bloom`.
+  // offset 1: 4 bytes, pointer to the next page of the filter. NULL_PAGE if
+  //   this is the last one.
+  page_ptr_t m_next_pg;
+  // offset 5: 2 bytes, number of blocks stored inside this page.
+  n_blocks_t m_n_blocks;
+
+public:
+  static constexpr page_off_t BLOCKS_OFF = 64;
+
+  explicit BloomPageMeta(page_ptr_t t_page_num)
+      : PageMixin{t_page_num}, m_next_pg{NULL_PAGE}, m_n_blocks{0} {}
+  BloomPageMeta(page_ptr_t t_page_num, page_ptr_t t_next_pg,
+                n_blocks_t t_n_blocks)
+      : PageMixin{t_page_num}, m_next_pg{t_next_pg}, m_n_blocks{t_n_blocks} {}
+
+  [[nodiscard]] constexpr auto get_next_pg() const noexcept -> page_ptr_t {
+    return m_next_pg;
+  }
+
+  [[nodiscard]] constexpr auto get_n_blocks() const noexcept -> n_blocks_t {
+    return m_n_blocks;
+  }
+
+  constexpr void update_next_pg(page_ptr_t t_next) noexcept {
+    m_next_pg = t_next;
+  }
+};
+
+/**
+ * @class SpillPageMeta
+ * @brief Contains metadata about a page of temporary data (see spill).
+ *
+ * A spill file is a singly-linked list of these pages, bytes stored back to
+ * back right after the metadata.
+ */
+class TINYDB_EXPORT SpillPageMeta : public PageMixin {
+public:
+  using n_bytes_t = uint16_t;
+
+private:
+  // offset 0: 1 byte, equivalent to `PageType::Spill`.
+  // offset 1: 4 bytes, pointer to the next page of the file. NULL_PAGE if
+  //   this is the last one.
+  page_ptr_t m_next_pg;
+  // offset 5: 2 bytes, number of bytes stored inside this page.
+  n_bytes_t m_n_bytes;
+
+public:
+  static constexpr page_off_t DATA_OFF =
+      sizeof(PageType) + sizeof(m_next_pg) + sizeof(m_n_bytes);
+
+  explicit SpillPageMeta(page_ptr_t t_page_num)
+      : PageMixin{t_page_num}, m_next_pg{NULL_PAGE}, m_n_bytes{0} {}
+  SpillPageMeta(page_ptr_t t_page_num, page_ptr_t t_next_pg,
+                n_bytes_t t_n_bytes)
+      : PageMixin{t_page_num}, m_next_pg{t_next_pg}, m_n_bytes{t_n_bytes} {}
+
+  [[nodiscard]] constexpr auto get_next_pg() const noexcept -> page_ptr_t {
+    return m_next_pg;
+  }
+
+  [[nodiscard]] constexpr auto get_n_bytes() const noexcept -> n_bytes_t {
+    return m_n_bytes;
+  }
+};
+
+/**
+ * @class CatalogPageMeta
+ * @brief Contains metadata about a page of the catalog (see catalog).
+ *
+ * Laid out like a spill page: the catalog is a singly-linked list of these
+ * pages, bytes stored back to back right after the metadata.
+ */
+class TINYDB_EXPORT CatalogPageMeta : public PageMixin {
+public:
+  using n_bytes_t = uint16_t;
+
+private:
+  // offset 0: 1 byte, equivalent to `PageType::Catalog`.
+  // offset 1: 4 bytes, pointer to the next page of the catalog. NULL_PAGE if
+  //   this is the last one.
+  page_ptr_t m_next_pg;
+  // offset 5: 2 bytes, number of bytes stored inside this page.
+  n_bytes_t m_n_bytes;
+
+public:
+  static constexpr page_off_t DATA_OFF =
+      sizeof(PageType) + sizeof(m_next_pg) + sizeof(m_n_bytes);
+
+  explicit CatalogPageMeta(page_ptr_t t_page_num)
+      : PageMixin{t_page_num}, m_next_pg{NULL_PAGE}, m_n_bytes{0} {}
+  CatalogPageMeta(page_ptr_t t_page_num, page_ptr_t t_next_pg,
+                  n_bytes_t t_n_bytes)
+      : PageMixin{t_page_num}, m_next_pg{t_next_pg}, m_n_bytes{t_n_bytes} {}
+
+  [[nodiscard]] constexpr auto get_next_pg() const noexcept -> page_ptr_t {
+    return m_next_pg;
+  }
+
+  [[nodiscard]] constexpr auto get_n_bytes() const noexcept -> n_bytes_t {
+    return m_n_bytes;
+  }
+};
+
 } // namespace tinydb::dbfile::internal
 
 #endif // !TINYDB_DBFILE_INTERNAL_PAGE_META_HXX
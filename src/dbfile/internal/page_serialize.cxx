@@ -167,6 +167,137 @@ auto read_from<HeapMeta>(page_ptr_t t_pg_num, std::istream& t_in) -> HeapMeta {
   return {t_pg_num, nextpg, prevpg, first_free, max_pair};
 }
 
+void write_to(const ColumnPageMeta& t_meta, std::ostream& t_out) {
+  t_out.seekp(t_meta.get_pg_num() * SIZEOF_PAGE);
+  auto& rdbuf = *t_out.rdbuf();
+  rdbuf.sputc(static_cast<pt_num_t>(PageType::Column));
+  auto nextpg = t_meta.get_next_pg();
+  rdbuf.sputn(std::bit_cast<const char*>(&nextpg), sizeof(nextpg));
+  auto nvalues = t_meta.get_n_values();
+  rdbuf.sputn(std::bit_cast<const char*>(&nvalues), sizeof(nvalues));
+  auto data_off = t_meta.get_data_off();
+  rdbuf.sputn(std::bit_cast<const char*>(&data_off), sizeof(data_off));
+  rdbuf.sputc(static_cast<char>(t_meta.get_encoding()));
+}
+
+template <>
+auto read_from<ColumnPageMeta>(page_ptr_t t_pg_num, std::istream& t_in)
+    -> ColumnPageMeta {
+  t_in.seekg(t_pg_num * SIZEOF_PAGE);
+  auto& rdbuf = *t_in.rdbuf();
+  [[maybe_unused]]
+  auto pagetype = rdbuf.sbumpc();
+  assert(pagetype == static_cast<pt_num_t>(PageType::Column));
+  page_ptr_t nextpg{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nextpg), sizeof(nextpg));
+  ColumnPageMeta::n_values_t nvalues{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nvalues), sizeof(nvalues));
+  page_off_t data_off{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&data_off), sizeof(data_off));
+  auto encoding = static_cast<ColumnEncoding>(rdbuf.sbumpc());
+  return {t_pg_num, nextpg, nvalues, data_off, encoding};
+}
+
+void write_to(const ZoneMapPageMeta& t_meta, std::ostream& t_out) {
+  t_out.seekp(t_meta.get_pg_num() * SIZEOF_PAGE);
+  auto& rdbuf = *t_out.rdbuf();
+  rdbuf.sputc(static_cast<pt_num_t>(PageType::ZoneMap));
+  auto nextpg = t_meta.get_next_pg();
+  rdbuf.sputn(std::bit_cast<const char*>(&nextpg), sizeof(nextpg));
+  auto nzones = t_meta.get_n_zones();
+  rdbuf.sputn(std::bit_cast<const char*>(&nzones), sizeof(nzones));
+}
+
+template <>
+auto read_from<ZoneMapPageMeta>(page_ptr_t t_pg_num, std::istream& t_in)
+    -> ZoneMapPageMeta {
+  t_in.seekg(t_pg_num * SIZEOF_PAGE);
+  auto& rdbuf = *t_in.rdbuf();
+  [[maybe_unused]]
+  auto pagetype = rdbuf.sbumpc();
+  assert(pagetype == static_cast<pt_num_t>(PageType::ZoneMap));
+  page_ptr_t nextpg{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nextpg), sizeof(nextpg));
+  ZoneMapPageMeta::n_zones_t nzones{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nzones), sizeof(nzones));
+  return {t_pg_num, nextpg, nzones};
+}
+
+void write_to(const BloomPageMeta& t_meta, std::ostream& t_out) {
+  t_out.seekp(t_meta.get_pg_num() * SIZEOF_PAGE);
+  auto& rdbuf = *t_out.rdbuf();
+  rdbuf.sputc(static_cast<pt_num_t>(PageType::Bloom));
+  auto nextpg = t_meta.get_next_pg();
+  rdbuf.sputn(std::bit_cast<const char*>(&nextpg), sizeof(nextpg));
+  auto nblocks = t_meta.get_n_blocks();
+  rdbuf.sputn(std::bit_cast<const char*>(&nblocks), sizeof(nblocks));
+}
+
+template <>
+auto read_from<BloomPageMeta>(page_ptr_t t_pg_num, std::istream& t_in)
+    -> BloomPageMeta {
+  t_in.seekg(t_pg_num * SIZEOF_PAGE);
+  auto& rdbuf = *t_in.rdbuf();
+  [[maybe_unused]]
+  auto pagetype = rdbuf.sbumpc();
+  assert(pagetype == static_cast<pt_num_t>(PageType::Bloom));
+  page_ptr_t nextpg{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nextpg), sizeof(nextpg));
+  BloomPageMeta::n_blocks_t nblocks{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nblocks), sizeof(nblocks));
+  return {t_pg_num, nextpg, nblocks};
+}
+
+void write_to(const SpillPageMeta& t_meta, std::ostream& t_out) {
+  t_out.seekp(t_meta.get_pg_num() * SIZEOF_PAGE);
+  auto& rdbuf = *t_out.rdbuf();
+  rdbuf.sputc(static_cast<pt_num_t>(PageType::Spill));
+  auto nextpg = t_meta.get_next_pg();
+  rdbuf.sputn(std::bit_cast<const char*>(&nextpg), sizeof(nextpg));
+  auto nbytes = t_meta.get_n_bytes();
+  rdbuf.sputn(std::bit_cast<const char*>(&nbytes), sizeof(nbytes));
+}
+
+template <>
+auto read_from<SpillPageMeta>(page_ptr_t t_pg_num, std::istream& t_in)
+    -> SpillPageMeta {
+  t_in.seekg(t_pg_num * SIZEOF_PAGE);
+  auto& rdbuf = *t_in.rdbuf();
+  [[maybe_unused]]
+  auto pagetype = rdbuf.sbumpc();
+  assert(pagetype == static_cast<pt_num_t>(PageType::Spill));
+  page_ptr_t nextpg{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nextpg), sizeof(nextpg));
+  SpillPageMeta::n_bytes_t nbytes{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nbytes), sizeof(nbytes));
+  return {t_pg_num, nextpg, nbytes};
+}
+
+void write_to(const CatalogPageMeta& t_meta, std::ostream& t_out) {
+  t_out.seekp(t_meta.get_pg_num() * SIZEOF_PAGE);
+  auto& rdbuf = *t_out.rdbuf();
+  rdbuf.sputc(static_cast<pt_num_t>(PageType::Catalog));
+  auto nextpg = t_meta.get_next_pg();
+  rdbuf.sputn(std::bit_cast<const char*>(&nextpg), sizeof(nextpg));
+  auto nbytes = t_meta.get_n_bytes();
+  rdbuf.sputn(std::bit_cast<const char*>(&nbytes), sizeof(nbytes));
+}
+
+template <>
+auto read_from<CatalogPageMeta>(page_ptr_t t_pg_num, std::istream& t_in)
+    -> CatalogPageMeta {
+  t_in.seekg(t_pg_num * SIZEOF_PAGE);
+  auto& rdbuf = *t_in.rdbuf();
+  [[maybe_unused]]
+  auto pagetype = rdbuf.sbumpc();
+  assert(pagetype == static_cast<pt_num_t>(PageType::Catalog));
+  page_ptr_t nextpg{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nextpg), sizeof(nextpg));
+  CatalogPageMeta::n_bytes_t nbytes{0};
+  rdbuf.sgetn(std::bit_cast<char*>(&nbytes), sizeof(nbytes));
+  return {t_pg_num, nextpg, nbytes};
+}
+
 // technically, write_to could be a templated function, relying on template
 // specialization.
 
@@ -174,5 +305,10 @@ static_assert(PageSerializable<FreePageMeta>);
 static_assert(PageSerializable<BTreeLeafMeta>);
 static_assert(PageSerializable<BTreeInternalMeta>);
 static_assert(PageSerializable<HeapMeta>);
+static_assert(PageSerializable<ColumnPageMeta>);
+static_assert(PageSerializable<ZoneMapPageMeta>);
+static_assert(PageSerializable<BloomPageMeta>);
+static_assert(PageSerializable<SpillPageMeta>);
+static_assert(PageSerializable<CatalogPageMeta>);
 
 } // namespace tinydb::dbfile::internal
@@ -53,6 +53,31 @@ auto TINYDB_EXPORT read_from<BTreeLeafMeta>(page_ptr_t t_pg_num, std::istream& t
 template <>
 auto TINYDB_EXPORT read_from<HeapMeta>(page_ptr_t t_pg_num, std::istream& t_in) -> HeapMeta;
 
+template <>
+auto TINYDB_EXPORT read_from<ColumnPageMeta>(page_ptr_t t_pg_num,
+                                             std::istream& t_in)
+    -> ColumnPageMeta;
+
+template <>
+auto TINYDB_EXPORT read_from<ZoneMapPageMeta>(page_ptr_t t_pg_num,
+                                              std::istream& t_in)
+    -> ZoneMapPageMeta;
+
+template <>
+auto TINYDB_EXPORT read_from<BloomPageMeta>(page_ptr_t t_pg_num,
+                                            std::istream& t_in)
+    -> BloomPageMeta;
+
+template <>
+auto TINYDB_EXPORT read_from<SpillPageMeta>(page_ptr_t t_pg_num,
+                                            std::istream& t_in)
+    -> SpillPageMeta;
+
+template <>
+auto TINYDB_EXPORT read_from<CatalogPageMeta>(page_ptr_t t_pg_num,
+                                              std::istream& t_in)
+    -> CatalogPageMeta;
+
 void TINYDB_EXPORT write_to(const FreePageMeta& t_meta, std::ostream& t_out);
 
 void TINYDB_EXPORT write_to(const BTreeLeafMeta& t_meta, std::ostream& t_out);
@@ -61,6 +86,18 @@ void TINYDB_EXPORT write_to(const BTreeInternalMeta& t_meta, std::ostream& t_out
 
 void TINYDB_EXPORT write_to(const HeapMeta& t_meta, std::ostream& t_out);
 
+void TINYDB_EXPORT write_to(const ColumnPageMeta& t_meta, std::ostream& t_out);
+
+void TINYDB_EXPORT write_to(const ZoneMapPageMeta& t_meta,
+                            std::ostream& t_out);
+
+void TINYDB_EXPORT write_to(const BloomPageMeta& t_meta, std::ostream& t_out);
+
+void TINYDB_EXPORT write_to(const SpillPageMeta& t_meta, std::ostream& t_out);
+
+void TINYDB_EXPORT write_to(const CatalogPageMeta& t_meta,
+                            std::ostream& t_out);
+
 template <typename Pg>
 concept PageSerializable =
     requires(Pg page, page_ptr_t pagenum, std::iostream stream) {
@@ -0,0 +1,208 @@
+/**
+ * @file row.cxx
+ * @brief Definitions for row.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#include <climits>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.row;
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.heap_base;
+import tinydb.dbfile.internal.tbl;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/heap_base.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/row.hxx"
+
+namespace tinydb::dbfile::internal {
+
+RowCodec::RowCodec(const TableMeta& t_tbl)
+    : m_null_off{t_tbl.layout().null_off},
+      m_row_size{t_tbl.layout().row_size} {
+  const auto& layout = t_tbl.layout();
+  m_fields.reserve(layout.offsets.size());
+  for (std::size_t i = 0; i < layout.offsets.size(); ++i) {
+    m_fields.push_back(Field{.off = layout.offsets[i],
+                             .size = layout.sizes[i],
+                             .type = layout.types[i]});
+  }
+}
+
+auto RowCodec::make_row() const -> std::vector<char> {
+  std::vector<char> ret(m_row_size, '\0');
+  for (std::size_t i = 0; i < m_fields.size(); ++i) {
+    set_null(ret, i);
+  }
+  return ret;
+}
+
+auto RowCodec::project(std::span<const std::size_t> t_cols) const
+    -> Projection {
+  Projection ret{.cols{t_cols.begin(), t_cols.end()}, .runs{}};
+  std::vector<std::pair<EntrySiz, EntrySiz>> ranges;
+  ranges.reserve(t_cols.size() + 1);
+  for (auto pos : t_cols) {
+    assert(pos < m_fields.size());
+    ranges.emplace_back(m_fields[pos].off, m_fields[pos].size);
+  }
+  ranges.emplace_back(m_null_off,
+                      static_cast<EntrySiz>(m_row_size - m_null_off));
+  std::ranges::sort(ranges);
+  for (auto [off, len] : ranges) {
+    if (!ret.runs.empty()) {
+      auto& [last_off, last_len] = ret.runs.back();
+      // touching or overlapping: one bigger copy beats two smaller ones.
+      if (off <= last_off + last_len) {
+        last_len = static_cast<EntrySiz>(
+            std::max(last_off + last_len, off + len) - last_off);
+        continue;
+      }
+    }
+    ret.runs.emplace_back(off, len);
+  }
+  return ret;
+}
+
+auto RowCodec::encode(std::span<const Value> t_vals,
+                      std::span<char> t_row) const -> bool {
+  if (t_vals.size() != m_fields.size() || t_row.size() < m_row_size) {
+    return false;
+  }
+  // padding bytes are zeroed so that equal rows are equal bytes.
+  std::memset(t_row.data(), 0, m_row_size);
+  for (std::size_t i = 0; i < m_fields.size(); ++i) {
+    const auto& val = t_vals[i];
+    if (std::holds_alternative<std::monostate>(val)) {
+      set_null(t_row, i);
+      continue;
+    }
+    if (val.index() != value_index(m_fields[i].type)) {
+      return false;
+    }
+    std::visit(
+        [&]<typename T>(const T& t_val) {
+          if constexpr (!std::is_same_v<T, std::monostate>) {
+            set(t_row, i, t_val);
+          }
+        },
+        val);
+  }
+  return true;
+}
+
+auto RowCodec::load(std::span<const char> t_row, std::size_t t_pos) const
+    -> Value {
+  if (is_null(t_row, t_pos)) {
+    return std::monostate{};
+  }
+  using enum column::ColType;
+  switch (m_fields[t_pos].type) {
+  case Int8:
+    return get<column::native_t<Int8>>(t_row, t_pos);
+  case Uint8:
+    return get<column::native_t<Uint8>>(t_row, t_pos);
+  case Int16:
+    return get<column::native_t<Int16>>(t_row, t_pos);
+  case Uint16:
+    return get<column::native_t<Uint16>>(t_row, t_pos);
+  case Int32:
+    return get<column::native_t<Int32>>(t_row, t_pos);
+  case Uint32:
+    return get<column::native_t<Uint32>>(t_row, t_pos);
+  case Int64:
+    return get<column::native_t<Int64>>(t_row, t_pos);
+  case Uint64:
+    return get<column::native_t<Uint64>>(t_row, t_pos);
+  case Float32:
+    return get<column::native_t<Float32>>(t_row, t_pos);
+  case Float64:
+    return get<column::native_t<Float64>>(t_row, t_pos);
+  case Text:
+    return get<column::native_t<Text>>(t_row, t_pos);
+  case Char8:
+    return get<column::native_t<Char8>>(t_row, t_pos);
+  case Char16:
+    return get<column::native_t<Char16>>(t_row, t_pos);
+  case Char32:
+    return get<column::native_t<Char32>>(t_row, t_pos);
+  case Char64:
+    return get<column::native_t<Char64>>(t_row, t_pos);
+  default:
+    std::unreachable();
+  }
+}
+
+void RowCodec::decode(std::span<const char> t_row,
+                      std::span<Value> t_out) const {
+  assert(t_out.size() >= m_fields.size());
+  for (std::size_t i = 0; i < m_fields.size(); ++i) {
+    t_out[i] = load(t_row, i);
+  }
+}
+
+void RowCodec::decode(std::span<const char> t_row, const Projection& t_proj,
+                      std::span<Value> t_out) const {
+  assert(t_out.size() >= t_proj.cols.size());
+  for (std::size_t i = 0; i < t_proj.cols.size(); ++i) {
+    t_out[i] = load(t_row, t_proj.cols[i]);
+  }
+}
+
+void RowCodec::write_row(const Ptr& t_pos, std::span<const char> t_row,
+                         std::ostream& t_out) const {
+  assert(t_row.size() >= m_row_size);
+  t_out.seekp((t_pos.pagenum * SIZEOF_PAGE) + t_pos.offset);
+  t_out.rdbuf()->sputn(t_row.data(), m_row_size);
+}
+
+void RowCodec::read_row(const Ptr& t_pos, std::istream& t_in,
+                        std::span<char> t_row) const {
+  assert(t_row.size() >= m_row_size);
+  t_in.seekg((t_pos.pagenum * SIZEOF_PAGE) + t_pos.offset);
+  t_in.rdbuf()->sgetn(t_row.data(), m_row_size);
+}
+
+void RowCodec::read_row(const Ptr& t_pos, std::istream& t_in,
+                        const Projection& t_proj,
+                        std::span<char> t_row) const {
+  assert(t_row.size() >= m_row_size);
+  auto row_start = (t_pos.pagenum * SIZEOF_PAGE) + t_pos.offset;
+  for (auto [off, len] : t_proj.runs) {
+    t_in.seekg(row_start + off);
+    t_in.rdbuf()->sgetn(t_row.data() + off, len);
+  }
+}
+
+} // namespace tinydb::dbfile::internal
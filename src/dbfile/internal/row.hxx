@@ -0,0 +1,218 @@
+/**
+ * @file row.hxx
+ * @brief Declares the row encoder/decoder.
+ *
+ * A row is stored exactly as described by the table's RowLayout (see tbl), and
+ * an in-memory row is the very same bytes. So moving a whole row in or out of
+ * a page is a single copy, and reading one column out of a row is a load at a
+ * fixed offset. The only real "encoding" happens when converting between a
+ * row and a list of Values, which is what query processing hands us.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_ROW_HXX
+#define TINYDB_DBFILE_INTERNAL_ROW_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/heap_base.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @brief One value of a row. `std::monostate` is NULL; otherwise the
+ * alternative at index `type_id(t) + 1` is the one for column type `t`.
+ */
+using Value = std::variant<
+    std::monostate, int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t,
+    int64_t, uint64_t, float, double, column::TextSlot, column::FixedText<8>,
+    column::FixedText<16>, column::FixedText<32>, column::FixedText<64>>;
+
+/**
+ * @return The index inside Value of the specified column type.
+ */
+constexpr auto value_index(column::ColType t_type) -> std::size_t {
+  return static_cast<std::size_t>(column::type_id(t_type)) + 1;
+}
+
+static_assert(std::is_same_v<std::variant_alternative_t<
+                                 value_index(column::ColType::Float64), Value>,
+                             column::native_t<column::ColType::Float64>>);
+static_assert(std::is_same_v<std::variant_alternative_t<
+                                 value_index(column::ColType::Text), Value>,
+                             column::native_t<column::ColType::Text>>);
+static_assert(std::is_same_v<std::variant_alternative_t<
+                                 value_index(column::ColType::Char64), Value>,
+                             column::native_t<column::ColType::Char64>>);
+
+/**
+ * @class RowCodec
+ * @brief Converts rows of one table to and from bytes.
+ *
+ * Takes a snapshot of the table's layout when constructed; construct a new
+ * one if the table's columns change.
+ *
+ * Column positions are positions inside `TableMeta::columns()`. Resolve them
+ * from names once (`TableMeta::column_pos`), not per row.
+ */
+class TINYDB_EXPORT RowCodec {
+public:
+  explicit RowCodec(const TableMeta& t_tbl);
+
+  /**
+   * @class Projection
+   * @brief A subset of columns to decode, and the byte ranges of a row that
+   * contain them. Adjacent ranges are merged, so reading a projection from a
+   * page is as few copies as possible.
+   */
+  struct Projection {
+    std::vector<std::size_t> cols;
+    // [offset, length) inside the row. Always includes the null bitmap.
+    std::vector<std::pair<EntrySiz, EntrySiz>> runs;
+  };
+
+  [[nodiscard]] auto row_size() const noexcept -> EntrySiz {
+    return m_row_size;
+  }
+  [[nodiscard]] auto n_cols() const noexcept -> std::size_t {
+    return m_fields.size();
+  }
+
+  /**
+   * @return A row buffer with every column set to NULL.
+   */
+  [[nodiscard]] auto make_row() const -> std::vector<char>;
+
+  /**
+   * @brief Builds a projection. Do this once per query, not per row.
+   *
+   * @param t_cols Positions of the columns to keep. The decoded values come
+   * out in this order.
+   */
+  [[nodiscard]] auto project(std::span<const std::size_t> t_cols) const
+      -> Projection;
+
+  [[nodiscard]] auto is_null(std::span<const char> t_row,
+                             std::size_t t_pos) const -> bool {
+    assert(t_pos < m_fields.size());
+    auto byte = static_cast<unsigned char>(
+        t_row[m_null_off + (t_pos / CHAR_BIT)]);
+    return ((byte >> (t_pos % CHAR_BIT)) & 1U) != 0;
+  }
+
+  void set_null(std::span<char> t_row, std::size_t t_pos,
+                bool t_null = true) const {
+    assert(t_pos < m_fields.size());
+    auto& byte = t_row[m_null_off + (t_pos / CHAR_BIT)];
+    auto mask = static_cast<unsigned char>(1U << (t_pos % CHAR_BIT));
+    byte = static_cast<char>(t_null ? (byte | mask) : (byte & ~mask));
+  }
+
+  /**
+   * @brief Reads a column at its fixed offset. No NULL check; see is_null.
+   *
+   * @tparam T Must be the native type of the column.
+   */
+  template <typename T>
+  [[nodiscard]] auto get(std::span<const char> t_row, std::size_t t_pos) const
+      -> T {
+    assert(t_pos < m_fields.size());
+    const char* src = t_row.data() + m_fields[t_pos].off;
+    assert(sizeof(T) == m_fields[t_pos].size);
+    T ret;
+    std::memcpy(&ret, src, sizeof(T));
+    return ret;
+  }
+
+  /**
+   * @brief Writes a column at its fixed offset, and marks it non-NULL.
+   *
+   * @tparam T Must be the native type of the column.
+   */
+  template <typename T>
+  void set(std::span<char> t_row, std::size_t t_pos, const T& t_val) const {
+    assert(t_pos < m_fields.size());
+    char* dst = t_row.data() + m_fields[t_pos].off;
+    assert(sizeof(T) == m_fields[t_pos].size);
+    std::memcpy(dst, &t_val, sizeof(T));
+    set_null(t_row, t_pos, false);
+  }
+
+  /**
+   * @brief Encodes one value per column into a row.
+   *
+   * @param t_vals Values, in column order. `std::monostate` means NULL.
+   * @param t_row Output, at least `row_size()` bytes.
+   * @return false if the number of values or any value's type doesn't match
+   * the table. `t_row` is left in an unspecified state then.
+   */
+  auto encode(std::span<const Value> t_vals, std::span<char> t_row) const
+      -> bool;
+
+  /**
+   * @brief Decodes every column of a row.
+   *
+   * @param t_out At least `n_cols()` values.
+   */
+  void decode(std::span<const char> t_row, std::span<Value> t_out) const;
+
+  /**
+   * @brief Decodes only the projected columns of a row.
+   *
+   * @param t_out At least `t_proj.cols.size()` values, in projection order.
+   */
+  void decode(std::span<const char> t_row, const Projection& t_proj,
+              std::span<Value> t_out) const;
+
+  /**
+   * @brief Writes a whole row at the specified position, in one go.
+   */
+  void write_row(const Ptr& t_pos, std::span<const char> t_row,
+                 std::ostream& t_out) const;
+
+  /**
+   * @brief Reads a whole row at the specified position, in one go.
+   */
+  void read_row(const Ptr& t_pos, std::istream& t_in,
+                std::span<char> t_row) const;
+
+  /**
+   * @brief Reads only the bytes of a row a projection needs. The other bytes
+   * of `t_row` are left untouched.
+   */
+  void read_row(const Ptr& t_pos, std::istream& t_in, const Projection& t_proj,
+                std::span<char> t_row) const;
+
+private:
+  struct Field {
+    EntrySiz off;
+    uint8_t size;
+    column::ColType type;
+  };
+  std::vector<Field> m_fields;
+  EntrySiz m_null_off;
+  EntrySiz m_row_size;
+
+  [[nodiscard]] auto load(std::span<const char> t_row,
+                          std::size_t t_pos) const -> Value;
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_ROW_HXX
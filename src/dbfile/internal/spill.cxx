@@ -0,0 +1,124 @@
+/**
+ * @file spill.cxx
+ * @brief Definitions for spill.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.spill;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.page;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/spill.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+auto data_pos(page_ptr_t t_pg) -> std::streamoff {
+  return (static_cast<std::streamoff>(t_pg) * SIZEOF_PAGE) +
+         SpillPageMeta::DATA_OFF;
+}
+
+} // namespace
+
+auto SpillFile::Reader::read(std::span<std::byte> t_out, std::istream& t_in)
+    -> bool {
+  while (!t_out.empty()) {
+    if (m_pos == m_buf.size()) {
+      if (m_next == NULL_PAGE) {
+        return false;
+      }
+      auto meta = internal::read_from<SpillPageMeta>(m_next, t_in);
+      m_buf.resize(meta.get_n_bytes());
+      t_in.seekg(data_pos(m_next));
+      t_in.rdbuf()->sgetn(std::bit_cast<char*>(m_buf.data()),
+                          static_cast<std::streamsize>(m_buf.size()));
+      m_pos = 0;
+      m_next = meta.get_next_pg();
+      continue;
+    }
+    auto len = std::min(t_out.size(), m_buf.size() - m_pos);
+    std::copy_n(m_buf.begin() + static_cast<std::ptrdiff_t>(m_pos), len,
+                t_out.begin());
+    m_pos += len;
+    t_out = t_out.subspan(len);
+  }
+  return true;
+}
+
+void SpillFile::write(std::span<const std::byte> t_bytes, FreeList& t_fl,
+                      std::iostream& t_io) {
+  m_n_bytes += t_bytes.size();
+  while (!t_bytes.empty()) {
+    // a page is only written once there's more to go after it: the last one
+    // has no next page yet.
+    if (m_pages.empty() || m_buf.size() == PAGE_BYTES) {
+      auto next = t_fl.allocate_page<SpillPageMeta>(t_io).get_pg_num();
+      if (!m_pages.empty()) {
+        write_page(next, t_io);
+        m_buf.clear();
+      }
+      m_pages.push_back(next);
+    }
+    auto len = std::min(t_bytes.size(), PAGE_BYTES - m_buf.size());
+    m_buf.insert(m_buf.end(), t_bytes.begin(),
+                 t_bytes.begin() + static_cast<std::ptrdiff_t>(len));
+    t_bytes = t_bytes.subspan(len);
+  }
+}
+
+void SpillFile::flush(std::iostream& t_io) {
+  if (!m_pages.empty()) {
+    write_page(NULL_PAGE, t_io);
+  }
+}
+
+void SpillFile::free_pages(FreeList& t_fl, std::iostream& t_io) {
+  for (auto pg : m_pages) {
+    t_fl.deallocate_page(t_io, PageMixin{pg});
+  }
+  m_pages.clear();
+  m_buf.clear();
+  m_n_bytes = 0;
+}
+
+void SpillFile::write_page(page_ptr_t t_next, std::ostream& t_out) {
+  assert(m_buf.size() <= PAGE_BYTES);
+  internal::write_to(
+      SpillPageMeta{m_pages.back(), t_next,
+                    static_cast<SpillPageMeta::n_bytes_t>(m_buf.size())},
+      t_out);
+  t_out.seekp(data_pos(m_pages.back()));
+  t_out.rdbuf()->sputn(std::bit_cast<const char*>(m_buf.data()),
+                       static_cast<std::streamsize>(m_buf.size()));
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,121 @@
+/**
+ * @file spill.hxx
+ * @brief Declares spill files, temporary byte streams stored in pages of a
+ * database file.
+ *
+ * Operators that may need more memory than they're allowed (grouping,
+ * joins, sorts) write what doesn't fit to a spill file and read it back
+ * later, in order. A spill file is a chain of Spill pages taken from the
+ * FreeList, and given back to it with `free_pages` once the query is done
+ * with it. Nothing points to them from the header: a spill file doesn't
+ * survive the process, and a crash leaks its pages.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_SPILL_HXX
+#define TINYDB_DBFILE_INTERNAL_SPILL_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "general/sizes.hxx"
+#include <cstddef>
+#include <iosfwd>
+#include <span>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @brief Where spill files go: free pages of a database file. Neither is
+ * owned.
+ */
+struct SpillSpace {
+  FreeList* fl;
+  std::iostream* io;
+};
+
+/**
+ * @class SpillFile
+ * @brief Bytes appended to a chain of temporary pages, then read back from
+ * the start.
+ */
+class TINYDB_EXPORT SpillFile {
+public:
+  static constexpr std::size_t PAGE_BYTES =
+      SIZEOF_PAGE - SpillPageMeta::DATA_OFF;
+
+  /**
+   * @class Reader
+   * @brief Reads a spill file back, from its first byte to its last.
+   */
+  class TINYDB_EXPORT Reader {
+  public:
+    explicit Reader(page_ptr_t t_first) : m_next{t_first} {}
+
+    /**
+     * @brief Reads the next `t_out.size()` bytes.
+     * @return false if the file ends first. What's in `t_out` is then
+     * unspecified.
+     */
+    auto read(std::span<std::byte> t_out, std::istream& t_in) -> bool;
+
+  private:
+    page_ptr_t m_next;
+    std::vector<std::byte> m_buf{};
+    std::size_t m_pos{0};
+  };
+
+  SpillFile() = default;
+
+  /**
+   * @brief Appends bytes to the file. Pages are written as they fill up,
+   * the last one waits for `flush`.
+   */
+  void write(std::span<const std::byte> t_bytes, FreeList& t_fl,
+             std::iostream& t_io);
+
+  /**
+   * @brief Writes the last page. Nothing can be written afterwards.
+   */
+  void flush(std::iostream& t_io);
+
+  /**
+   * @brief Reads the file from the start. It must have been flushed.
+   */
+  [[nodiscard]] auto reader() const -> Reader {
+    return Reader{m_pages.empty() ? NULL_PAGE : m_pages.front()};
+  }
+
+  /**
+   * @brief Gives every page back to the FreeList. The file is empty, and
+   * can be written again, afterwards.
+   */
+  void free_pages(FreeList& t_fl, std::iostream& t_io);
+
+  [[nodiscard]] auto n_bytes() const noexcept -> std::size_t {
+    return m_n_bytes;
+  }
+
+  [[nodiscard]] auto n_pages() const noexcept -> std::size_t {
+    return m_pages.size();
+  }
+
+private:
+  // the last one is the page `m_buf` goes to.
+  std::vector<page_ptr_t> m_pages{};
+  std::vector<std::byte> m_buf{};
+  std::size_t m_n_bytes{0};
+
+  void write_page(page_ptr_t t_next, std::ostream& t_out);
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_SPILL_HXX
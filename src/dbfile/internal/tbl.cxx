@@ -7,17 +7,21 @@
 
 #ifdef ENABLE_MODULES
 module;
-#include "general/offsets.hxx"
 #include <cstdint>
 #ifndef IMPORT_STD
+#include <algorithm>
+#include <bit>
+#include <functional>
 #include <iostream>
 #include <optional>
 #include <print>
 #include <ranges>
-#include <sstream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <type_traits>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 #endif
 export module tinydb.dbfile.internal.tbl;
 import tinydb.dbfile.coltype;
@@ -25,113 +29,184 @@ import tinydb.dbfile.coltype;
 import std;
 #endif
 #else
-#include "general/offsets.hxx"
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <optional>
 #include <print>
 #include <ranges>
-#include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #endif // ENABLE_MODULES
 
 #include "dbfile/internal/tbl.hxx"
 
 namespace tinydb::dbfile::internal {
 
-void TableMeta::write_to(std::ostream& t_out) {
-  t_out.seekp(TBL_OFF);
-  // table format:
-  // tblname{col1-name,col1-idcol1-typecol1-offsetcol2-namecol2-id...coln-name,coln-idcoln-typecoln-offset;}
-  //
-  // Basically:
-  // - anything from TBL_OFF to before { is the table name.
-  // - Anything after the { until before , is first column's name.
-  // - id, type, size, offset are all numbers. So, the size is their bound.
-  // - Anything after the last byte of column 1's offset and before the next ,
-  // is column 2's name.
-  // - Rinse and repeat from here.
-
-  auto& rdbuf = *t_out.rdbuf();
-  auto write = [&]<typename T>(const T& t_val) -> std::streamsize {
-    return rdbuf.sputn(std::bit_cast<const char*>(&t_val), sizeof(T));
-  };
-  auto write_string = [&](const std::string& t_str) -> std::streamsize {
-    return rdbuf.sputn(t_str.c_str(),
-                       static_cast<std::streamsize>(t_str.length()));
-  };
+auto TableMeta::column_pos(std::string_view t_name) const noexcept
+    -> std::optional<std::size_t> {
+  auto found = std::ranges::lower_bound(
+      m_name_index, t_name, {},
+      [this](uint8_t t_pos) -> std::string_view {
+        return m_columns[t_pos].m_name;
+      });
+  if (found == m_name_index.end() || m_columns[*found].m_name != t_name) {
+    return std::nullopt;
+  }
+  return *found;
+}
 
-  write_string(m_name);
-  write('{');
-  write_string(m_key);
-  write(';');
-  for (const ColumnMeta& colmeta :
-       m_entries | std::views::transform(
-                       [](const auto& pair) { return pair.second; })) {
-    auto type_id = column::type_id(colmeta.m_type);
-    write_string(colmeta.m_name);
-    rdbuf.sputc(',');
-    // with this, I don't really need the commas anymore.
-    // The numbers' bounds are their sizes.
-    write(colmeta.m_col_id);
-    write(type_id);
-    write(colmeta.m_offset);
+auto TableMeta::insert_column(ColumnMeta&& t_colmeta) -> bool {
+  if (column_pos(t_colmeta.m_name)) {
+    return false;
   }
-  t_out << '}';
+  auto pos = std::ranges::lower_bound(m_columns, t_colmeta.m_col_id, {},
+                                      &ColumnMeta::m_col_id);
+  if (pos != m_columns.end() && pos->m_col_id == t_colmeta.m_col_id) {
+    return false;
+  }
+  m_columns.insert(pos, std::move(t_colmeta));
+  rebuild();
+  return true;
 }
 
-auto TableMeta::read_from(std::istream& t_in) -> TableMeta {
-  t_in.seekg(TBL_OFF);
-  // read the comment at the beginning of the definition of `write_to` to get
-  // a sense of how the table metadata is written.
-  // maybe I should throw some kind of failbit exception here.
-
-  // Put data into the stringstream, until either EOF or the delimiter.
-  // There's zero checking whether the file is in valid format.
-  // After that, put formatted data into the variable passed in, then clear
-  // the stringstream flags and content.
-
-  auto fill_string = [&](char delim) -> std::string {
-    std::stringstream var{};
-    while (t_in.peek() != delim) {
-      var.put(static_cast<char>(t_in.get()));
-    }
-    t_in.seekg(1, std::ios_base::cur);
-    return var.str();
-  };
+auto TableMeta::remove_column(std::string_view t_name) -> bool {
+  auto pos = column_pos(t_name);
+  if (!pos) {
+    return false;
+  }
+  m_columns.erase(m_columns.begin() + static_cast<std::ptrdiff_t>(*pos));
+  rebuild();
+  return true;
+}
 
-  auto fill_num =
-      [&]<typename T, typename... Args>(Args... t_placeholders) -> T {
-    T var{t_placeholders...};
-    t_in.rdbuf()->sgetn(std::bit_cast<char*>(&var), sizeof(T));
-    return var;
+void TableMeta::rebuild() {
+  auto align_up = [](EntrySiz t_off, uint8_t t_align) {
+    return static_cast<EntrySiz>((t_off + t_align - 1) / t_align * t_align);
   };
+  m_layout = RowLayout{};
+  m_layout.offsets.resize(m_columns.size());
+  m_layout.sizes.reserve(m_columns.size());
+  m_layout.types.reserve(m_columns.size());
+  for (const auto& col : m_columns) {
+    m_layout.sizes.push_back(column::type_size(col.m_type));
+    m_layout.types.push_back(col.m_type);
+  }
+
+  // widest alignment first. Since every alignment divides the ones before
+  // it, and every size is a multiple of its alignment, no padding is ever
+  // inserted between columns. The check for sizes that aren't a multiple of
+  // their alignment is kept for whichever type breaks that next.
+  std::vector<std::size_t> order(m_columns.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::ranges::stable_sort(order, std::greater{}, [&](std::size_t t_pos) {
+    auto align = column::type_align(m_layout.types[t_pos]);
+    return std::make_pair(align, m_layout.sizes[t_pos] % align == 0);
+  });
+  EntrySiz off{0};
+  uint8_t max_align{1};
+  for (auto pos : order) {
+    auto align = column::type_align(m_layout.types[pos]);
+    max_align = std::max(max_align, align);
+    off = align_up(off, align);
+    m_layout.offsets[pos] = off;
+    m_columns[pos].m_offset = off;
+    off = static_cast<EntrySiz>(off + m_layout.sizes[pos]);
+  }
+  m_layout.null_off = off;
+  m_layout.row_size = align_up(
+      static_cast<EntrySiz>(off + m_layout.null_bytes()), max_align);
 
-  auto tblname = fill_string('{');
-  TableMeta new_tbl{std::move(tblname)};
+  m_name_index.resize(m_columns.size());
+  for (std::size_t i = 0; i < m_columns.size(); ++i) {
+    m_name_index[i] = static_cast<uint8_t>(i);
+  }
+  std::ranges::sort(m_name_index, {},
+                    [this](uint8_t t_pos) -> std::string_view {
+                      return m_columns[t_pos].m_name;
+                    });
+}
 
-  auto key = fill_string(';');
+namespace {
 
-  while (t_in.peek() != '}') {
-    auto colname = fill_string(',');
+template <typename T> void put(std::string& t_out, const T& t_val) {
+  t_out.append(std::bit_cast<const char*>(&t_val), sizeof(T));
+}
 
-    auto id = fill_num.operator()<ColID>();
+void put_string(std::string& t_out, std::string_view t_str) {
+  put(t_out, static_cast<uint16_t>(t_str.size()));
+  t_out.append(t_str);
+}
 
-    auto typenum = fill_num.operator()<column::coltype_num_t>();
+[[noreturn]] void corrupted() {
+  throw std::ios_base::failure("Corrupted table definition");
+}
 
-    auto type = column::type_of(typenum).value();
+template <typename T> auto get(std::string_view& t_in) -> T {
+  if (t_in.size() < sizeof(T)) {
+    corrupted();
+  }
+  T ret{};
+  std::copy_n(t_in.data(), sizeof(T), std::bit_cast<char*>(&ret));
+  t_in.remove_prefix(sizeof(T));
+  return ret;
+}
 
-    auto off = fill_num.operator()<uint8_t>();
+auto get_string(std::string_view& t_in) -> std::string {
+  auto len = get<uint16_t>(t_in);
+  if (t_in.size() < len) {
+    corrupted();
+  }
+  std::string ret{t_in.substr(0, len)};
+  t_in.remove_prefix(len);
+  return ret;
+}
 
-    auto new_col = ColumnMeta{.m_name{std::move(colname)},
-                              .m_type = type,
-                              .m_col_id = id,
-                              .m_offset = off};
-    new_tbl.add_column(std::move(new_col));
+} // namespace
+
+auto TableMeta::encode() const -> std::string {
+  // table format, every string after its length as a uint16_t:
+  // name, key, number of columns as a uint16_t, then each column as its
+  // name, ColID and type id. Offsets aren't stored, they're recomputed.
+  std::string ret;
+  put_string(ret, m_name);
+  put_string(ret, m_key);
+  put(ret, static_cast<uint16_t>(m_columns.size()));
+  // ColID order, so the same table is always written the same way.
+  for (const ColumnMeta& colmeta : m_columns) {
+    put_string(ret, colmeta.m_name);
+    put(ret, colmeta.m_col_id);
+    put(ret, column::type_id(colmeta.m_type));
   }
-  new_tbl.set_key(std::move(key));
+  return ret;
+}
 
-  return new_tbl;
+auto TableMeta::decode(std::string_view t_def) -> TableMeta {
+  TableMeta ret{get_string(t_def)};
+  auto key = get_string(t_def);
+  auto n_cols = get<uint16_t>(t_def);
+  for (uint16_t i = 0; i < n_cols; ++i) {
+    auto name = get_string(t_def);
+    auto id = get<ColID>(t_def);
+    auto type = column::type_of(get<column::coltype_num_t>(t_def));
+    // add_column turns down duplicate names and IDs.
+    if (!type || !ret.add_column(ColumnMeta{.m_name{std::move(name)},
+                                            .m_type = *type,
+                                            .m_col_id = id,
+                                            .m_offset = 0})) {
+      corrupted();
+    }
+  }
+  if (!t_def.empty() || (!key.empty() && !ret.set_key(std::move(key)))) {
+    corrupted();
+  }
+  return ret;
 }
 
 } // namespace tinydb::dbfile::internal
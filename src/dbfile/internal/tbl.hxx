@@ -14,13 +14,15 @@
 #include "tinydb_export.h"
 #ifndef ENABLE_MODULES
 #include "dbfile/coltype.hxx"
+#include <climits>
 #include <cstdint>
-#include <iosfwd>
 #include <optional>
 #include <print>
 #include <string>
+#include <span>
+#include <string_view>
 #include <type_traits>
-#include <unordered_map>
+#include <vector>
 #endif // !ENABLE_MODULES
 
 #ifdef ENABLE_MODULES
@@ -30,12 +32,16 @@ namespace tinydb::dbfile::internal {
 #endif // !ENABLE_MODULES
 
 using ColID = uint8_t;
-using EntrySiz = uint8_t;
+// Byte offset/size of an entry inside a row. A B+ Tree row can be up to 1022
+// bytes long, which doesn't fit in a byte.
+using EntrySiz = uint16_t;
 
 /**
  * @class ColumnMeta
  * @brief Metadata of one column
  *
+ * `m_offset` is computed by the TableMeta the column is added to. Whatever is
+ * set before that is overwritten.
  */
 struct TINYDB_EXPORT ColumnMeta {
   std::string m_name;
@@ -44,10 +50,40 @@ struct TINYDB_EXPORT ColumnMeta {
   EntrySiz m_offset;
 };
 
+/**
+ * @class RowLayout
+ * @brief Where each column lives inside a row, in ColID order.
+ *
+ * A struct of arrays, so that a loop over the columns of a row only touches
+ * the arrays it needs. Index `i` of every array describes the `i`-th column
+ * of `TableMeta::columns()`.
+ *
+ * Inside a row, columns are laid out by descending alignment, each at its
+ * natural alignment, so there's no padding between them. The null bitmap
+ * (bit `i` set means column `i` is null) comes after the last column, and
+ * the row size is rounded up to the largest alignment so that rows packed
+ * one after another stay aligned.
+ */
+struct TINYDB_EXPORT RowLayout {
+  std::vector<EntrySiz> offsets;
+  std::vector<uint8_t> sizes;
+  std::vector<column::ColType> types;
+  EntrySiz null_off{0};
+  EntrySiz row_size{0};
+
+  [[nodiscard]] constexpr auto null_bytes() const noexcept -> EntrySiz {
+    return static_cast<EntrySiz>((offsets.size() + CHAR_BIT - 1) / CHAR_BIT);
+  }
+};
+
 /**
  * @class Table
  * @brief The table meta contains a bunch of column metas.
  *
+ * Columns are kept in a contiguous array sorted by ColID, with their offsets
+ * precomputed. Lookup by name goes through a side index sorted by name, so
+ * that the hot paths (encoding/decoding rows) never need to hash anything:
+ * resolve the column position once, then read `layout().offsets[pos]`.
  */
 class TINYDB_EXPORT TableMeta {
   static_assert(!std::is_trivially_copyable_v<ColumnMeta>);
@@ -63,44 +99,53 @@ public:
   auto operator=(TableMeta&& t_meta) -> TableMeta& = default;
   ~TableMeta() = default;
   /**
-   * @brief Reads the table metadata from a database file.
-   *
-   * @param t_path The path to that file.
-   * @return
-   * - The table metadata if the read and data extraction is successful.
-   * - nullopt otherwise.
-   * - This API will be changed later. optional is a terrible but
-   * quick-and-seemingly-easy way to say there's something wrong.
+   * @return The column meta with the specified name, or nullopt if there
+   * isn't one
    */
-  static auto read_from(std::istream& t_in) -> TableMeta;
+  [[nodiscard]] auto get_column(std::string_view t_name) const noexcept
+      -> std::optional<rw<const ColumnMeta>> {
+    return column_pos(t_name).transform(
+        [this](std::size_t t_pos) { return std::cref(m_columns[t_pos]); });
+  }
   /**
-   * @brief I changed this to noexcept since I think the lookup function
-   * should not throw an exception.
-   * @return The column meta with the specified ID, or nullopt if there isn't
-   * one
+   * @return The position of the column with the specified name inside
+   * `columns()` (and `layout()`), or nullopt if there isn't one.
    */
-  template <typename T>
-    requires std::convertible_to<T, std::string>
-  auto get_column(T&& t_name) noexcept
-      -> std::optional<rw<const ColumnMeta>> const {
-    try {
-      return {{m_entries.at(std::forward<T>(t_name))}};
-    } catch (std::out_of_range&) {
-      return {std::nullopt};
-    }
+  [[nodiscard]] auto column_pos(std::string_view t_name) const noexcept
+      -> std::optional<std::size_t>;
+  /**
+   * @return The name of the key column, empty if none was set.
+   */
+  [[nodiscard]] auto get_key() const noexcept -> std::string_view {
+    return m_key;
+  }
+  /**
+   * @return All columns, sorted by ColID.
+   */
+  [[nodiscard]] auto columns() const noexcept -> std::span<const ColumnMeta> {
+    return m_columns;
+  }
+  /**
+   * @return The row layout derived from the columns.
+   */
+  [[nodiscard]] auto layout() const noexcept -> const RowLayout& {
+    return m_layout;
+  }
+  [[nodiscard]] auto get_name() const noexcept -> std::string_view {
+    return m_name;
   }
   /**
    * @brief Inserts a column into the table.
    *
    * @tparam T ColumnMeta or references (lvalue or rvalue) to ColumnMeta.
    * @param t_colmeta
-   * @return Whether the column meta was successfully added.
+   * @return Whether the column meta was successfully added. Fails if there
+   * is already a column of the same name or ID.
    */
   template <typename T>
     requires std::convertible_to<T, ColumnMeta>
   auto add_column(T&& t_colmeta) -> bool {
-    return m_entries.emplace(t_colmeta.m_name, std::forward<T>(t_colmeta))
-        .second;
+    return insert_column(ColumnMeta(std::forward<T>(t_colmeta)));
   }
 
   /**
@@ -115,7 +160,7 @@ public:
   template <typename T>
     requires std::convertible_to<T, std::string>
   auto set_key(T&& t_key) -> bool {
-    if (m_entries.find(t_key) == m_entries.end()) {
+    if (!column_pos(t_key)) {
       return false;
     }
 
@@ -123,29 +168,39 @@ public:
     return true;
   }
   /**
-   * @brief Note; this is marked as noexcept because I believe the default
-   * hash and equality function for size_t don't throw anything.
-   *
-   * @param t_id
-   * @return
+   * @param t_name Name of the column to remove.
+   * @return Whether there was such a column.
    */
-  template <typename T>
-    requires std::convertible_to<T, std::string>
-  auto remove_column(T&& t_name) noexcept -> bool {
-    return m_entries.erase(std::forward<T>(t_name)) == 1;
-  }
+  auto remove_column(std::string_view t_name) -> bool;
   /**
-   * @brief Overwrite the content of a file with the table metadata.
-   *
-   * @param t_path The path to write to.
+   * @brief The table metadata in the binary format `decode` reads back, as
+   * the catalog stores it.
+   */
+  [[nodiscard]] auto encode() const -> std::string;
+  /**
+   * @brief Reads table metadata written by `encode`.
+   * @throw std::ios_base::failure if `t_def` isn't exactly one well-formed
+   * definition: truncated, trailing bytes, an unknown type, duplicate
+   * columns or a key that isn't a column.
    */
-  void write_to(std::ostream& t_out);
+  static auto decode(std::string_view t_def) -> TableMeta;
 
 private:
-  std::unordered_map<std::string, ColumnMeta> m_entries;
+  // sorted by ColID.
+  std::vector<ColumnMeta> m_columns;
+  // positions into m_columns, sorted by column name. ColID is a byte, so
+  // there can't be more than 256 columns.
+  std::vector<uint8_t> m_name_index;
+  RowLayout m_layout;
   std::string m_name;
   std::string m_key;
-  static constexpr uint16_t TABLE_OFFSET = 18;
+
+  auto insert_column(ColumnMeta&& t_colmeta) -> bool;
+  /**
+   * @brief Recomputes column offsets, the row layout, and the name index.
+   * Called whenever the set of columns changes.
+   */
+  void rebuild();
 };
 
 } // namespace tinydb::dbfile::internal
@@ -0,0 +1,142 @@
+#include "dbfile/internal/test/mvcc_util.hxx"
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.internal.async;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.mvcc;
+import tinydb.dbfile.internal.page_cache;
+#else
+#include "dbfile/internal/async.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/mvcc.hxx"
+#include "dbfile/internal/page_cache.hxx"
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#endif // ENABLE_MODULES
+
+namespace {
+
+using namespace tinydb;
+using namespace tinydb::dbfile;
+using namespace tinydb::dbfile::internal;
+
+/**
+ * @brief A table of one Int64 column, in a pool way too small to hold it,
+ * read and written through coroutines.
+ */
+struct Fixture : test::Int64Table {
+  // NOLINTBEGIN(*magic-number*)
+  std::shared_ptr<PagePool> pool{std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(std::string(SIZEOF_PAGE * 64, '\0')),
+      PageCompression::None, 4)};
+  // NOLINTEND(*magic-number*)
+  PageStream setup{pool};
+  FreeList fl{FreeList::default_init(1, setup)};
+  Heap heap{};
+  EventLoop loop{2};
+  AsyncTable async{tbl, heap, fl, pool, loop};
+
+  auto fill(const Snapshot& t_snap, int64_t t_n) -> Task<void> {
+    auto row = codec.make_row();
+    for (int64_t i = 0; i < t_n; ++i) {
+      codec.set(row, 0, i);
+      co_await async.insert(t_snap, row);
+    }
+  }
+
+  auto sum(const Snapshot& t_snap) -> Task<int64_t> {
+    auto row = codec.make_row();
+    int64_t ret{0};
+    for (row_id_t id = 0; id < async.n_row_ids(); ++id) {
+      if (co_await async.get(t_snap, id, row)) {
+        ret += codec.get<int64_t>(row, 0);
+      }
+    }
+    co_return ret;
+  }
+
+  auto scan(const Snapshot& t_snap) -> Task<std::vector<int64_t>> {
+    std::vector<int64_t> ret;
+    auto cursor = async.cursor(t_snap);
+    while (co_await cursor.next()) {
+      ret.push_back(codec.get<int64_t>(cursor.row(), 0));
+    }
+    co_return ret;
+  }
+};
+
+} // namespace
+
+TEST(async, reads_and_writes) {
+  // NOLINTBEGIN(*magic-number*)
+  Fixture f;
+  static constexpr int64_t n_rows = 1000;
+  auto writer = f.txns.begin();
+  sync_wait(f.fill(writer, n_rows));
+  f.async.commit(writer.m_self);
+  f.txns.end(writer.m_self);
+
+  // readers on threads of their own, all missing pages all the time.
+  auto reader = f.txns.begin();
+  std::vector<int64_t> sums(4, 0);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < sums.size(); ++t) {
+    threads.emplace_back([&, t] { sums[t] = sync_wait(f.sum(reader)); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto sum : sums) {
+    ASSERT_EQ(sum, n_rows * (n_rows - 1) / 2);
+  }
+  ASSERT_GT(f.async.n_waits(), 0);
+
+  // the reader's snapshot doesn't see the writes after it.
+  auto txn = f.txns.begin();
+  ASSERT_EQ(sync_wait(f.async.erase(txn, 0)), WriteResult::Ok);
+  auto row = f.row(-5);
+  ASSERT_EQ(sync_wait(f.async.update(txn, 5, row)), WriteResult::Ok);
+  f.async.commit(txn.m_self);
+  f.txns.end(txn.m_self);
+  ASSERT_EQ(sync_wait(f.scan(reader)).size(), n_rows);
+  auto after = f.txns.begin();
+  auto seen = sync_wait(f.scan(after));
+  ASSERT_EQ(seen.size(), n_rows - 1);
+  ASSERT_EQ(seen[0], 1);
+  ASSERT_EQ(seen[4], -5);
+
+  // and rolling back goes through the loop too.
+  auto aborted = f.txns.begin();
+  ASSERT_EQ(sync_wait(f.async.erase(aborted, 1)), WriteResult::Ok);
+  sync_wait(f.async.abort(aborted.m_self));
+  f.txns.end(aborted.m_self);
+  ASSERT_EQ(sync_wait(f.scan(f.txns.begin())).size(), n_rows - 1);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(async, exceptions) {
+  auto throws = []() -> Task<int> {
+    throw std::runtime_error("nope");
+    co_return 0;
+  };
+  ASSERT_THROW(sync_wait(throws()), std::runtime_error);
+}
@@ -0,0 +1,141 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <array>
+#include <bit>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.bloom;
+import tinydb.dbfile.internal.column_store;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/bloom.hxx"
+#include "dbfile/internal/column_store.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <array>
+#include <bit>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#endif // ENABLE_MODULES
+
+namespace {
+
+template <typename T> auto bytes_of(const T& t_val) -> std::string_view {
+  return {std::bit_cast<const char*>(&t_val), sizeof(T)};
+}
+
+} // namespace
+
+TEST(bloom, filter) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr uint32_t numkeys = 10000;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * 64, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  BloomFilter filter{numkeys};
+  ASSERT_GE(filter.capacity(), numkeys);
+  auto hash = [](uint32_t t_key) {
+    return BloomFilter::hash(column::ColType::Uint32, bytes_of(t_key));
+  };
+  for (uint32_t i = 0; i < numkeys; ++i) {
+    filter.add(hash(i));
+  }
+  filter.write_to(fl, io);
+  auto reread = BloomFilter::read_from(filter.first_page(), io);
+  std::size_t false_pos{0};
+  for (uint32_t i = 0; i < numkeys; ++i) {
+    ASSERT_TRUE(reread.may_contain(hash(i)));
+    false_pos +=
+        static_cast<std::size_t>(reread.may_contain(hash(i + numkeys)));
+  }
+  ASSERT_LT(false_pos, numkeys * 3 / 100);
+
+  // equal values hash the same, whatever their bytes.
+  ASSERT_EQ(BloomFilter::hash(column::ColType::Float64, bytes_of(0.0)),
+            BloomFilter::hash(column::ColType::Float64, bytes_of(-0.0)));
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(bloom, column_store_key) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 128;
+  static constexpr uint32_t bulk = 5000;
+  static constexpr uint32_t numrows = 11000;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+  TableMeta tbl{"users"};
+  tbl.add_column(ColumnMeta{.m_name{"id"},
+                            .m_type = column::ColType::Uint32,
+                            .m_col_id = 1,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"age"},
+                            .m_type = column::ColType::Uint8,
+                            .m_col_id = 2,
+                            .m_offset = 0});
+  tbl.set_key("id");
+  ColumnStore store{tbl};
+  // one bulk load, then small appends that outgrow the filter it built.
+  auto batch = store.make_batch();
+  for (uint32_t i = 0; i < numrows; ++i) {
+    batch[0].push(2 * i);
+    batch[1].push(static_cast<uint8_t>(i % 90));
+    if (i + 1 == bulk || (i >= bulk && batch[0].size() == 500)) {
+      ASSERT_TRUE(store.append(batch, heap, fl, io));
+      batch[0].clear();
+      batch[1].clear();
+    }
+  }
+  ASSERT_TRUE(store.append(batch, heap, fl, io));
+
+  Ptr desc{.pagenum = numpages - 1, .offset = 0};
+  store.write_to(desc, io);
+  auto reopened = ColumnStore::read_from(tbl, desc, io);
+  for (uint32_t i = 0; i < numrows; ++i) {
+    ASSERT_TRUE(reopened.may_contain(bytes_of(2 * i)));
+  }
+  uint32_t absent{1};
+  while (reopened.may_contain(bytes_of(absent))) {
+    absent += 2;
+  }
+  ASSERT_LT(absent, 2 * numrows);
+
+  // a lookup for an absent key doesn't read any page: trash them all.
+  const std::string garbage(SIZEOF_PAGE, '\x7F');
+  for (std::size_t col = 0; col < 2; ++col) {
+    for (const auto& zone : reopened.zones(col)) {
+      io.seekp(static_cast<std::streamoff>(zone.pg) * SIZEOF_PAGE);
+      io.write(garbage.data(), SIZEOF_PAGE);
+    }
+  }
+  std::array<std::size_t, 1> cols{1};
+  auto scanner = reopened.scan(
+      cols, ColumnFilter::of<uint32_t>(0, CmpOp::Eq, absent), io);
+  auto out = scanner.make_batch();
+  ASSERT_EQ(scanner.next(out), 0);
+  // NOLINTEND(*magic-number*)
+}
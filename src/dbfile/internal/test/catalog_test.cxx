@@ -0,0 +1,146 @@
+#include "dbfile/internal/test/test_util.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.catalog;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/catalog.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#endif // ENABLE_MODULES
+
+namespace {
+
+using namespace tinydb;
+using namespace tinydb::dbfile;
+using namespace tinydb::dbfile::internal;
+
+/**
+ * @brief A table of `t_n` Int64 columns `c0`, `c1`...
+ */
+auto table(std::string t_name, int t_n) -> TableMeta {
+  TableMeta ret{std::move(t_name)};
+  for (int i = 0; i < t_n; ++i) {
+    EXPECT_TRUE(ret.add_column(ColumnMeta{.m_name{"c" + std::to_string(i)},
+                                          .m_type = column::ColType::Int64,
+                                          .m_col_id = static_cast<ColID>(i),
+                                          .m_offset = 0}));
+  }
+  return ret;
+}
+
+} // namespace
+
+TEST(catalog, tables) {
+  // NOLINTBEGIN(*magic-number*)
+  test::MemFile file{16};
+  auto& [io, fl] = file;
+  {
+    auto catalog = SchemaCatalog::construct_from(io);
+    ASSERT_TRUE(catalog.table_names(io).empty());
+    ASSERT_TRUE(catalog.add_table(table("orders", 3), io));
+    ASSERT_TRUE(catalog.add_table(table("users", 2), io));
+    ASSERT_TRUE(catalog.add_table(table("items", 1), io));
+    ASSERT_FALSE(catalog.add_table(table("users", 1), io));
+    ASSERT_TRUE(catalog.add_index(
+        IndexDef{.m_name{"by_c1"}, .m_table{"orders"}, .m_column{"c1"},
+                 .m_root = 7},
+        io));
+    // no such column, no such table, name taken.
+    ASSERT_FALSE(catalog.add_index(
+        IndexDef{.m_name{"x"}, .m_table{"items"}, .m_column{"c1"},
+                 .m_root = NULL_PAGE},
+        io));
+    ASSERT_FALSE(catalog.add_index(
+        IndexDef{.m_name{"x"}, .m_table{"nope"}, .m_column{"c0"},
+                 .m_root = NULL_PAGE},
+        io));
+    ASSERT_FALSE(catalog.add_index(
+        IndexDef{.m_name{"users"}, .m_table{"items"}, .m_column{"c0"},
+                 .m_root = NULL_PAGE},
+        io));
+    catalog.write_to(fl, io);
+  }
+
+  // reading it back only decodes the tables looked up.
+  auto catalog = SchemaCatalog::construct_from(io);
+  ASSERT_NE(catalog.first_page(), NULL_PAGE);
+  ASSERT_EQ(catalog.table_names(io),
+            (std::vector<std::string_view>{"items", "orders", "users"}));
+  ASSERT_EQ(catalog.n_decoded(), 0);
+  const auto* users = catalog.find_table("users", io);
+  ASSERT_NE(users, nullptr);
+  ASSERT_EQ(users->columns().size(), 2);
+  ASSERT_TRUE(users->column_pos("c1").has_value());
+  ASSERT_EQ(catalog.n_decoded(), 1);
+  ASSERT_EQ(catalog.find_table("by_c1", io), nullptr);
+  const auto* idx = catalog.find_index("by_c1", io);
+  ASSERT_NE(idx, nullptr);
+  ASSERT_EQ(idx->m_column, "c1");
+  ASSERT_EQ(idx->m_root, 7);
+  ASSERT_EQ(catalog.indexes_of("orders", io).size(), 1);
+  ASSERT_EQ(catalog.n_decoded(), 1);
+
+  // dropping a table drops its indexes.
+  ASSERT_TRUE(catalog.drop("orders", io));
+  ASSERT_FALSE(catalog.drop("orders", io));
+  ASSERT_EQ(catalog.find_index("by_c1", io), nullptr);
+  catalog.write_to(fl, io);
+  catalog = SchemaCatalog::construct_from(io);
+  ASSERT_EQ(catalog.table_names(io),
+            (std::vector<std::string_view>{"items", "users"}));
+  ASSERT_TRUE(catalog.indexes_of("orders", io).empty());
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(catalog, pages) {
+  // NOLINTBEGIN(*magic-number*)
+  test::MemFile file{32};
+  auto& [io, fl] = file;
+  auto catalog = SchemaCatalog::construct_from(io);
+  // a few pages worth of tables.
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(catalog.add_table(table("t" + std::to_string(i), 20), io));
+  }
+  catalog.write_to(fl, io);
+  const auto pages = file.pages();
+  ASSERT_GT(pages, 4);
+
+  catalog = SchemaCatalog::construct_from(io);
+  ASSERT_EQ(catalog.table_names(io).size(), 100);
+  const auto* t42 = catalog.find_table("t42", io);
+  ASSERT_EQ(t42->columns().size(), 20);
+  // what was handed out stays put as tables are added.
+  auto names = catalog.table_names(io);
+  const std::vector<std::string> copies{names.begin(), names.end()};
+  ASSERT_TRUE(catalog.add_table(table("u", 1), io));
+  ASSERT_EQ(catalog.find_table("t42", io), t42);
+  ASSERT_EQ(t42->columns().size(), 20);
+  ASSERT_TRUE(std::ranges::equal(names, copies));
+  // written again in the same pages, then in fewer.
+  catalog.write_to(fl, io);
+  ASSERT_EQ(file.pages(), pages);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(catalog.drop("t" + std::to_string(i), io));
+  }
+  catalog.write_to(fl, io);
+  catalog = SchemaCatalog::construct_from(io);
+  ASSERT_EQ(catalog.table_names(io), (std::vector<std::string_view>{"u"}));
+  ASSERT_EQ(catalog.find_table("u", io)->columns().size(), 1);
+  // NOLINTEND(*magic-number*)
+}
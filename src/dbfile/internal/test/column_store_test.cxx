@@ -0,0 +1,217 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_store;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_store.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+#endif // ENABLE_MODULES
+
+TEST(column_store, append_scan) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 64;
+  static constexpr uint32_t numrows = 3000;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+  TableMeta tbl{"events"};
+  tbl.add_column(ColumnMeta{.m_name{"id"},
+                            .m_type = column::ColType::Uint32,
+                            .m_col_id = 1,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"status"},
+                            .m_type = column::ColType::Text,
+                            .m_col_id = 2,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"price"},
+                            .m_type = column::ColType::Float64,
+                            .m_col_id = 3,
+                            .m_offset = 0});
+  ColumnStore store{tbl};
+  std::array<std::string, 3> statuses{"shipped", "pending", "returned"};
+  const std::string huge(2000, 'x');
+
+  // 2 batches, so that the second one continues half-filled pages.
+  auto batch = store.make_batch();
+  for (uint32_t begin : {0U, numrows / 2}) {
+    for (auto& col : batch) {
+      col.clear();
+    }
+    for (uint32_t i = begin; i < begin + (numrows / 2); ++i) {
+      batch[0].push(i);
+      if (i == 1234) {
+        batch[1].push_text(huge);
+      } else if (i % 10 == 0) {
+        batch[1].push_null();
+      } else {
+        batch[1].push_text(statuses[i % 3]);
+      }
+      if (i % 7 == 0) {
+        batch[2].push_null();
+      } else {
+        batch[2].push(i * 0.5);
+      }
+    }
+    ASSERT_TRUE(store.append(batch, heap, fl, io));
+  }
+  ASSERT_EQ(store.n_rows(), numrows);
+  // mismatched sizes are rejected.
+  batch[0].push(uint32_t{1});
+  ASSERT_FALSE(store.append(batch, heap, fl, io));
+
+  // save and reopen, then read only 2 of the 3 columns.
+  Ptr desc{.pagenum = numpages - 1, .offset = 0};
+  store.write_to(desc, io);
+  auto reopened = ColumnStore::read_from(tbl, desc, io);
+  ASSERT_EQ(reopened.n_rows(), numrows);
+  std::array<std::size_t, 2> cols{*tbl.column_pos("price"),
+                                  *tbl.column_pos("status")};
+  auto scanner = reopened.scan(cols, io);
+  auto out = scanner.make_batch();
+  uint32_t row{0};
+  while (auto n = scanner.next(out, 1000)) {
+    auto prices = out[0].values<double>();
+    for (std::size_t i = 0; i < n; ++i, ++row) {
+      ASSERT_EQ(out[0].is_null(i), row % 7 == 0);
+      if (row % 7 != 0) {
+        ASSERT_EQ(prices[i], row * 0.5);
+      }
+      if (row == 1234) {
+        ASSERT_EQ(out[1].text(i), huge);
+      } else if (row % 10 == 0) {
+        ASSERT_TRUE(out[1].is_null(i));
+      } else {
+        ASSERT_EQ(out[1].text(i), statuses[row % 3]);
+      }
+    }
+  }
+  ASSERT_EQ(row, numrows);
+
+  // the same rows, split into ranges scanned separately.
+  auto ranges = reopened.split(1000);
+  ASSERT_GE(ranges.size(), 2);
+  row = 0;
+  for (auto range : ranges) {
+    ASSERT_EQ(range.first, row);
+    ASSERT_GE(range.n, range.first + range.n == numrows ? 1 : 1000);
+    auto part = reopened.scan(cols, io);
+    part.restrict_to(range);
+    while (auto n = part.next(out, 333)) {
+      for (std::size_t i = 0; i < n; ++i, ++row) {
+        ASSERT_EQ(out[0].is_null(i), row % 7 == 0);
+        if (row % 10 == 0) {
+          ASSERT_TRUE(out[1].is_null(i));
+        } else if (row != 1234) {
+          ASSERT_EQ(out[1].text(i), statuses[row % 3]);
+        }
+      }
+    }
+    ASSERT_EQ(row, range.first + range.n);
+  }
+  ASSERT_EQ(row, numrows);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(column_store, encoded_filter) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 64;
+  static constexpr uint32_t numrows = 20000;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+  TableMeta tbl{"orders"};
+  tbl.add_column(ColumnMeta{.m_name{"country"},
+                            .m_type = column::ColType::Text,
+                            .m_col_id = 1,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"qty"},
+                            .m_type = column::ColType::Uint16,
+                            .m_col_id = 2,
+                            .m_offset = 0});
+  ColumnStore store{tbl};
+  std::array<std::string, 4> countries{"VN", "FR", "JP", "BR"};
+  auto batch = store.make_batch();
+  for (uint32_t i = 0; i < numrows; ++i) {
+    // long runs of the same country, qty all over the place.
+    batch[0].push_text(countries[(i / 1000) % 4]);
+    if (i % 11 == 0) {
+      batch[1].push_null();
+    } else {
+      batch[1].push(static_cast<uint16_t>((i * 7) % 50));
+    }
+  }
+  ASSERT_TRUE(store.append(batch, heap, fl, io));
+
+  auto count_pages = [&](std::size_t t_pos) {
+    std::size_t ret{0};
+    for (auto pg = store.first_page(t_pos); pg != NULL_PAGE;
+         pg = read_from<ColumnPageMeta>(pg, io).get_next_pg()) {
+      ++ret;
+    }
+    return ret;
+  };
+  // plain, that would be 30 pages of strings and 11 of numbers.
+  ASSERT_EQ(count_pages(0), 1);
+  ASSERT_LE(count_pages(1), 6);
+
+  std::array<std::size_t, 2> cols{0, 1};
+  auto by_country =
+      store.scan(cols, ColumnFilter::of_text(0, CmpOp::Eq, "JP"), io);
+  auto out = by_country.make_batch();
+  std::size_t matched{0};
+  while (auto n = by_country.next(out)) {
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(out[0].text(i), "JP");
+    }
+    matched += n;
+  }
+  ASSERT_EQ(matched, numrows / 4);
+
+  auto by_qty = store.scan(
+      cols, ColumnFilter::of(1, CmpOp::Lt, static_cast<uint16_t>(5)), io);
+  std::size_t expected{0};
+  for (uint32_t i = 0; i < numrows; ++i) {
+    expected += static_cast<std::size_t>(i % 11 != 0 && (i * 7) % 50 < 5);
+  }
+  matched = 0;
+  while (auto n = by_qty.next(out, 700)) {
+    auto qty = out[1].values<uint16_t>();
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_FALSE(out[1].is_null(i));
+      ASSERT_LT(qty[i], 5);
+    }
+    matched += n;
+  }
+  ASSERT_EQ(matched, expected);
+  // NOLINTEND(*magic-number*)
+}
@@ -2,19 +2,38 @@
 #include <gtest/gtest.h>
 #ifdef ENABLE_MODULES
 #ifndef IMPORT_STD
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <print>
+#include <ranges>
+#include <set>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #else
 import std;
 #endif // !IMPORT_STD
 import tinydb.dbfile.internal.freelist;
 import tinydb.dbfile.internal.heap;
 import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.page_cache;
 #else
 #include "dbfile/internal/freelist.hxx"
 #include "dbfile/internal/heap.hxx"
 #include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_cache.hxx"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <ranges>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #endif // ENABLE_MODULES
 
 TEST(heap, init) {
@@ -77,6 +96,300 @@ TEST(heap, init) {
   // NOLINTEND(*magic-number*)
 }
 
+TEST(heap, reuse) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  using Frag = std::pair<Fragment, page_off_t>;
+  std::stringstream io{std::string(SIZEOF_PAGE * 64, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{};
+
+  // fragments of all sizes, freed out of order and allocated again, so that
+  // the first fit is often in the middle of a page's free list.
+  auto data_pos = [](const Frag& t_frag) {
+    return (static_cast<std::streamoff>(t_frag.first.pos.pagenum) *
+            SIZEOF_PAGE) +
+           t_frag.first.pos.offset + t_frag.second;
+  };
+  std::vector<std::pair<Frag, std::string>> live;
+  std::set<page_ptr_t> pages;
+  uint32_t seed{42};
+  auto next = [&] {
+    seed = (seed * 1664525) + 1013904223;
+    return seed >> 8;
+  };
+  for (int round = 0; round < 2000; ++round) {
+    if (live.size() > 40 || (!live.empty() && next() % 3 == 0)) {
+      auto i = next() % live.size();
+      heap.free(std::move(live[i].first.first), fl, io);
+      live.erase(live.begin() + i);
+      continue;
+    }
+    auto size = static_cast<page_off_t>(8 + (next() % 300));
+    auto frag = heap.malloc(size, false, fl, io);
+    std::string bytes(size, static_cast<char>('a' + (round % 26)));
+    io.seekp(data_pos(frag));
+    io.rdbuf()->sputn(bytes.data(), size);
+    pages.insert(frag.first.pos.pagenum);
+    live.emplace_back(frag, std::move(bytes));
+    for (const auto& [other, other_bytes] : live) {
+      std::string back(other_bytes.size(), '\0');
+      io.seekg(data_pos(other));
+      io.rdbuf()->sgetn(back.data(), std::ssize(back));
+      ASSERT_EQ(back, other_bytes);
+    }
+  }
+  // 40 fragments of 300 bytes at most fit in 3 pages; give or take the holes.
+  ASSERT_LE(pages.size(), 6);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(heap, threads) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int n_threads = 4;
+  static constexpr int n_frags = 150;
+  static constexpr page_off_t frag_size = 100;
+  auto pool = std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(std::string(SIZEOF_PAGE * 64, '\0')),
+      PageCompression::None, 16);
+  PageStream setup{pool};
+  auto fl = FreeList::default_init(1, setup);
+  Heap heap{};
+
+  // every thread fills its fragments with its own byte, frees every other
+  // one, and allocates again: no fragment may ever be handed out twice.
+  auto data_pos = [](const std::pair<Fragment, page_off_t>& t_frag) {
+    return (static_cast<std::streamoff>(t_frag.first.pos.pagenum) *
+            SIZEOF_PAGE) +
+           t_frag.first.pos.offset + t_frag.second;
+  };
+  std::vector<std::vector<std::pair<Fragment, page_off_t>>> frags(n_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t) {
+    threads.emplace_back([&, t] {
+      PageStream io{pool};
+      const std::string fill(frag_size, static_cast<char>('a' + t));
+      auto& mine = frags[t];
+      for (int i = 0; i < n_frags; ++i) {
+        mine.push_back(heap.malloc(frag_size, false, fl, io));
+        io.seekp(data_pos(mine.back()));
+        io.rdbuf()->sputn(fill.data(), frag_size);
+        if (i % 2 == 1) {
+          heap.free(std::move(mine[mine.size() - 2].first), fl, io);
+          mine.erase(mine.end() - 2);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < n_threads; ++t) {
+    ASSERT_EQ(frags[t].size(), n_frags / 2);
+    for (const auto& frag : frags[t]) {
+      std::string back(frag_size, '\0');
+      setup.seekg(data_pos(frag));
+      setup.rdbuf()->sgetn(back.data(), frag_size);
+      ASSERT_EQ(back, std::string(frag_size, static_cast<char>('a' + t)));
+    }
+  }
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(heap, arenas) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int n_threads = 4;
+  static constexpr int n_frags = 100;
+  static constexpr page_off_t frag_size = 100;
+  using Frag = std::pair<Fragment, page_off_t>;
+  auto pool = std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(std::string(SIZEOF_PAGE * 64, '\0')),
+      PageCompression::None, 16);
+  PageStream setup{pool};
+  auto fl = FreeList::default_init(1, setup);
+  auto heap = Heap::with_arenas(n_threads);
+  ASSERT_EQ(heap.n_arenas(), n_threads);
+
+  auto data_pos = [](const Frag& t_frag) {
+    return (static_cast<std::streamoff>(t_frag.first.pos.pagenum) *
+            SIZEOF_PAGE) +
+           t_frag.first.pos.offset + t_frag.second;
+  };
+  auto fill = [&](std::iostream& t_io, const Frag& t_frag, int t_thread) {
+    const std::string bytes(frag_size, static_cast<char>('a' + t_thread));
+    t_io.seekp(data_pos(t_frag));
+    t_io.rdbuf()->sputn(bytes.data(), frag_size);
+  };
+  std::vector<std::vector<Frag>> frags(n_threads);
+  std::vector<std::size_t> arena(n_threads);
+  std::vector<std::set<page_ptr_t>> pages(n_threads);
+  auto run = [&](auto t_fn) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+      threads.emplace_back([&, t] {
+        PageStream io{pool};
+        t_fn(io, t);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+
+  run([&](std::iostream& t_io, int t_thread) {
+    arena[t_thread] = heap.arena_of_this_thread();
+    for (int i = 0; i < n_frags; ++i) {
+      frags[t_thread].push_back(heap.malloc(frag_size, false, fl, t_io));
+      fill(t_io, frags[t_thread].back(), t_thread);
+      pages[t_thread].insert(frags[t_thread].back().first.pos.pagenum);
+    }
+  });
+  // threads started together get arenas of their own: no page is shared.
+  ASSERT_EQ(std::set<std::size_t>(arena.begin(), arena.end()).size(),
+            n_threads);
+  std::set<page_ptr_t> all;
+  std::vector<std::set<page_ptr_t>> arena_pages(n_threads);
+  for (int t = 0; t < n_threads; ++t) {
+    all.insert(pages[t].begin(), pages[t].end());
+    arena_pages[arena[t]] = pages[t];
+  }
+  ASSERT_EQ(all.size(), pages[0].size() * n_threads);
+
+  // every thread frees half of its neighbor's fragments, then allocates
+  // again: the space freed goes back to the neighbor's arena, not to ours.
+  run([&](std::iostream& t_io, int t_thread) {
+    auto& theirs = frags[(t_thread + 1) % n_threads];
+    for (std::size_t i = 0; i < n_frags / 2; ++i) {
+      heap.free(std::move(theirs[i].first), fl, t_io);
+    }
+  });
+  run([&](std::iostream& t_io, int t_thread) {
+    // new threads, maybe bound to another arena than last time.
+    arena[t_thread] = heap.arena_of_this_thread();
+    auto& mine = frags[t_thread];
+    mine.erase(mine.begin(), mine.begin() + (n_frags / 2));
+    for (int i = 0; i < n_frags / 2; ++i) {
+      mine.push_back(heap.malloc(frag_size, false, fl, t_io));
+      fill(t_io, mine.back(), t_thread);
+    }
+  });
+  for (int t = 0; t < n_threads; ++t) {
+    ASSERT_EQ(frags[t].size(), n_frags);
+    for (const auto& frag : frags[t] | std::views::drop(n_frags / 2)) {
+      ASSERT_TRUE(arena_pages[arena[t]].contains(frag.first.pos.pagenum));
+    }
+    for (const auto& frag : frags[t]) {
+      std::string back(frag_size, '\0');
+      setup.seekg(data_pos(frag));
+      setup.rdbuf()->sgetn(back.data(), frag_size);
+      ASSERT_EQ(back, std::string(frag_size, static_cast<char>('a' + t)));
+    }
+  }
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(heap, reopen) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int n_threads = 3;
+  static constexpr int n_frags = 12;
+  static constexpr page_off_t frag_size = 1000;
+  using Frag = std::pair<Fragment, page_off_t>;
+  auto pool = std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(std::string(SIZEOF_PAGE * 64, '\0')),
+      PageCompression::None, 16);
+  PageStream setup{pool};
+  auto fl = FreeList::default_init(1, setup);
+  std::vector<std::vector<Frag>> frags(n_threads);
+  auto run = [&](Heap& t_heap) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+      threads.emplace_back([&, t] {
+        PageStream io{pool};
+        for (int i = 0; i < n_frags; ++i) {
+          frags[t].push_back(t_heap.malloc(frag_size, false, fl, io));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  auto free_all = [&](Heap& t_heap) {
+    for (auto& mine : frags) {
+      for (auto& frag : mine) {
+        t_heap.free(std::move(frag.first), fl, setup);
+      }
+      mine.clear();
+    }
+  };
+  std::set<page_ptr_t> pages;
+  auto all_in_pages = [&] {
+    return std::ranges::all_of(frags, [&](const auto& t_mine) {
+      return std::ranges::all_of(t_mine, [&](const Frag& t_frag) {
+        return pages.contains(t_frag.first.pos.pagenum);
+      });
+    });
+  };
+
+  {
+    auto heap = Heap::with_arenas(n_threads);
+    run(heap);
+    heap.write_heap_to(setup);
+  }
+  for (const auto& mine : frags) {
+    for (const auto& frag : mine) {
+      pages.insert(frag.first.pos.pagenum);
+    }
+  }
+
+  // every arena's pages are known again: they take back any fragment, and
+  // hand the space out again rather than taking new pages.
+  auto reopened = read_heap_from(setup, n_threads);
+  ASSERT_EQ(reopened.n_arenas(), n_threads);
+  free_all(reopened);
+  run(reopened);
+  ASSERT_TRUE(all_in_pages());
+  Fragment stray{.pos{.pagenum = 63, .offset = HeapMeta::DEFAULT_FREE_OFF},
+                 .extra{Fragment::UsedFragExtra{}},
+                 .size = frag_size,
+                 .type = Fragment::FragType::Used};
+  ASSERT_THROW(reopened.free(std::move(stray), fl, setup),
+               std::ios_base::failure);
+  reopened.write_heap_to(setup);
+
+  // synced and through a stream of its own, for the header checksum is only
+  // stamped on write-back.
+  auto snapshot = [&] {
+    setup.flush();
+    PageStream in{pool};
+    std::string ret(SIZEOF_PAGE * 64, '\0');
+    in.rdbuf()->sgetn(ret.data(), static_cast<std::streamsize>(ret.size()));
+    return ret;
+  };
+  // with fewer arenas, the chains left over go after theirs once written to.
+  // Twice, to make sure nothing is spliced in again.
+  for (int i = 0; i < 2; ++i) {
+    const auto before = snapshot();
+    auto single = read_heap_from(setup, 1);
+    ASSERT_EQ(snapshot(), before);
+    free_all(single);
+    for (int j = 0; j < n_threads * n_frags; ++j) {
+      frags[0].push_back(single.malloc(frag_size, false, fl, setup));
+    }
+    ASSERT_TRUE(all_in_pages());
+    single.write_heap_to(setup);
+  }
+  // NOLINTEND(*magic-number*)
+}
+
 // there used to be tests here.
 // But I decided to rewrite Heap from the ground up.
 // Again, yes.
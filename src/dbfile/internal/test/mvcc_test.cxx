@@ -0,0 +1,289 @@
+#include "dbfile/internal/test/mvcc_util.hxx"
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.mvcc;
+import tinydb.dbfile.internal.page_cache;
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/mvcc.hxx"
+#include "dbfile/internal/page_cache.hxx"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#endif // ENABLE_MODULES
+
+namespace {
+
+using namespace tinydb;
+using namespace tinydb::dbfile;
+using namespace tinydb::dbfile::internal;
+
+/**
+ * @brief A file with a table of one Int64 column, and what it takes to write
+ * versions of its rows.
+ */
+struct Fixture : test::Int64Table {
+  // NOLINTNEXTLINE(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * 16, '\0')};
+  FreeList fl{FreeList::default_init(1, io)};
+  Heap heap{};
+
+  /**
+   * @return The value `t_snap` sees in a row, -1 if none.
+   */
+  auto value(const Snapshot& t_snap, row_id_t t_id) -> int64_t {
+    auto buf = codec.make_row();
+    return tbl.read(t_snap, t_id, io, buf) ? codec.get<int64_t>(buf, 0) : -1;
+  }
+
+  auto update(const Snapshot& t_snap, row_id_t t_id, int64_t t_val)
+      -> WriteResult {
+    return tbl.update(t_snap, t_id, row(t_val), heap, fl, io);
+  }
+
+  void commit(const Snapshot& t_snap) {
+    tbl.commit(t_snap.m_self);
+    txns.end(t_snap.m_self);
+  }
+
+  void abort(const Snapshot& t_snap) {
+    tbl.abort(t_snap.m_self, heap, fl, io);
+    txns.end(t_snap.m_self);
+  }
+};
+
+} // namespace
+
+TEST(mvcc, snapshots) {
+  // NOLINTBEGIN(*magic-number*)
+  Fixture f;
+  f.io.exceptions(std::stringstream::failbit);
+  auto writer = f.txns.begin();
+  auto id = f.tbl.insert(writer, f.row(1), f.heap, f.fl, f.io);
+  // not committed yet: only the writer sees it.
+  auto early = f.txns.begin();
+  ASSERT_EQ(f.value(writer, id), 1);
+  ASSERT_EQ(f.value(early, id), -1);
+  f.commit(writer);
+  // still not, for a snapshot taken before the commit.
+  ASSERT_EQ(f.value(early, id), -1);
+  f.commit(early);
+
+  // a long report, while the row gets updated twice, then deleted.
+  auto report = f.txns.begin();
+  for (int64_t val : {2, 3}) {
+    auto txn = f.txns.begin();
+    ASSERT_EQ(f.update(txn, id, val), WriteResult::Ok);
+    // our own writes, even twice in a row.
+    ASSERT_EQ(f.update(txn, id, val * 10), WriteResult::Ok);
+    ASSERT_EQ(f.value(txn, id), val * 10);
+    f.commit(txn);
+  }
+  auto txn = f.txns.begin();
+  ASSERT_EQ(f.value(txn, id), 30);
+  ASSERT_EQ(f.tbl.erase(txn, id, f.io), WriteResult::Ok);
+  ASSERT_EQ(f.value(txn, id), -1);
+  ASSERT_EQ(f.update(txn, id, 4), WriteResult::NotFound);
+  f.commit(txn);
+
+  ASSERT_EQ(f.value(report, id), 1);
+  std::vector<int64_t> seen;
+  f.tbl.scan(report, f.io, [&](row_id_t, std::span<const char> t_row) {
+    seen.push_back(f.codec.get<int64_t>(t_row, 0));
+  });
+  ASSERT_EQ(seen, std::vector<int64_t>{1});
+  // too late to write what it read.
+  ASSERT_EQ(f.update(report, id, 5), WriteResult::Conflict);
+  f.abort(report);
+  ASSERT_EQ(f.value(f.txns.begin(), id), -1);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(mvcc, conflicts_and_aborts) {
+  // NOLINTBEGIN(*magic-number*)
+  Fixture f;
+  f.io.exceptions(std::stringstream::failbit);
+  auto setup = f.txns.begin();
+  auto a = f.tbl.insert(setup, f.row(1), f.heap, f.fl, f.io);
+  auto b = f.tbl.insert(setup, f.row(2), f.heap, f.fl, f.io);
+  f.commit(setup);
+
+  // first writer wins, whether it committed yet or not.
+  auto first = f.txns.begin();
+  auto second = f.txns.begin();
+  ASSERT_EQ(f.update(first, a, 10), WriteResult::Ok);
+  ASSERT_EQ(f.update(second, a, 20), WriteResult::Conflict);
+  ASSERT_EQ(f.tbl.erase(second, a, f.io), WriteResult::Conflict);
+  ASSERT_EQ(f.update(second, b, 20), WriteResult::Ok);
+  ASSERT_EQ(f.update(first, b, 10), WriteResult::Conflict);
+
+  // rolling back puts every row back the way it was.
+  auto c = f.tbl.insert(first, f.row(3), f.heap, f.fl, f.io);
+  ASSERT_EQ(f.tbl.erase(first, c, f.io), WriteResult::Ok);
+  f.abort(first);
+  auto after = f.txns.begin();
+  ASSERT_EQ(f.value(after, a), 1);
+  ASSERT_EQ(f.value(after, c), -1);
+  ASSERT_EQ(f.update(after, c, 4), WriteResult::NotFound);
+  f.commit(after);
+  // and the row is free to write again.
+  ASSERT_EQ(f.update(second, a, 20), WriteResult::Ok);
+  f.commit(second);
+  auto last = f.txns.begin();
+  ASSERT_EQ(f.value(last, a), 20);
+  ASSERT_EQ(f.value(last, b), 20);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(mvcc, vacuum) {
+  // NOLINTBEGIN(*magic-number*)
+  Fixture f;
+  f.io.exceptions(std::stringstream::failbit);
+  auto setup = f.txns.begin();
+  std::vector<row_id_t> ids;
+  for (int64_t i = 0; i < 50; ++i) {
+    ids.push_back(f.tbl.insert(setup, f.row(i), f.heap, f.fl, f.io));
+  }
+  f.commit(setup);
+
+  auto reader = f.txns.begin();
+  // every row updated 3 times, the last one deleted on top.
+  for (int round = 1; round <= 3; ++round) {
+    auto txn = f.txns.begin();
+    for (auto id : ids) {
+      ASSERT_EQ(f.update(txn, id, (round * 100) + static_cast<int64_t>(id)),
+                WriteResult::Ok);
+    }
+    f.commit(txn);
+  }
+  auto txn = f.txns.begin();
+  ASSERT_EQ(f.tbl.erase(txn, ids.back(), f.io), WriteResult::Ok);
+  f.commit(txn);
+
+  // the reader still needs the first versions, so nothing goes yet.
+  ASSERT_EQ(f.tbl.vacuum(f.txns.horizon(), f.heap, f.fl, f.io), 0);
+  ASSERT_EQ(f.value(reader, 7), 7);
+  f.commit(reader);
+  auto now = f.txns.begin();
+  // 3 older versions per row, and all 4 of the deleted one.
+  ASSERT_EQ(f.tbl.vacuum(f.txns.horizon(), f.heap, f.fl, f.io),
+            (49 * 3) + 4);
+  ASSERT_EQ(f.value(now, 7), 307);
+  ASSERT_EQ(f.value(now, ids.back()), -1);
+  f.commit(now);
+  ASSERT_EQ(f.tbl.vacuum(f.txns.horizon(), f.heap, f.fl, f.io), 0);
+
+  // once more, with nobody left running.
+  auto more = f.txns.begin();
+  for (auto id : ids) {
+    (void)f.update(more, id, 1);
+  }
+  f.commit(more);
+  ASSERT_EQ(f.tbl.vacuum(f.txns.horizon(), f.heap, f.fl, f.io), 49);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(mvcc, readers_during_writes) {
+  // NOLINTBEGIN(*magic-number*)
+  // each thread reads through a stream of its own, over the same pages.
+  auto pool = std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(
+          std::string(SIZEOF_PAGE * 512, '\0')),
+      PageCompression::None, 64);
+  PageStream io{pool};
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{};
+  test::Int64Table table;
+  auto& [meta, codec, tbl, txns] = table;
+  static constexpr row_id_t n_rows = 32;
+  auto setup = txns.begin();
+  for (row_id_t id = 0; id < n_rows; ++id) {
+    tbl.insert(setup, table.row(0), heap, fl, io);
+  }
+  tbl.commit(setup.m_self);
+  txns.end(setup.m_self);
+
+  // every round writes every row at once: a snapshot sees them all alike,
+  // and never a round that aborted.
+  std::atomic<bool> done{false};
+  std::atomic<std::size_t> n_reads{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&] {
+      PageStream in{pool};
+      auto buf = codec.make_row();
+      while (!done.load()) {
+        auto snap = txns.begin();
+        std::optional<int64_t> seen;
+        for (row_id_t id = 0; id < n_rows; ++id) {
+          EXPECT_TRUE(tbl.read(snap, id, in, buf));
+          const auto val = codec.get<int64_t>(buf, 0);
+          EXPECT_EQ(val, seen.value_or(val));
+          seen = val;
+        }
+        EXPECT_NE(*seen % 4, 3);
+        // rows inserted as the directory grows: there, or not yet.
+        (void)tbl.read(snap, tbl.n_row_ids() - 1, in, buf);
+        txns.end(snap.m_self);
+        n_reads.fetch_add(1);
+        // leave the writer some room on a machine with few cores.
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (int64_t round = 1; round <= 100; ++round) {
+    auto txn = txns.begin();
+    for (row_id_t id = 0; id < n_rows; ++id) {
+      EXPECT_EQ(tbl.update(txn, id, table.row(round), heap, fl, io),
+                WriteResult::Ok);
+    }
+    for (int i = 0; i < 40; ++i) {
+      tbl.insert(txn, table.row(round), heap, fl, io);
+    }
+    if (round % 4 == 3) {
+      tbl.abort(txn.m_self, heap, fl, io);
+    } else {
+      tbl.commit(txn.m_self);
+    }
+    txns.end(txn.m_self);
+    tbl.vacuum(txns.horizon(), heap, fl, io);
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_GT(n_reads.load(), 0);
+  ASSERT_GT(tbl.n_row_ids(), 3 * RowDirectory::FIRST_CHUNK);
+
+  // with every reader gone, whatever was let go of goes back to the heap.
+  tbl.vacuum(txns.horizon(), heap, fl, io);
+  ASSERT_EQ(tbl.n_retired(), 0);
+  auto last = txns.begin();
+  auto buf = codec.make_row();
+  ASSERT_TRUE(tbl.read(last, n_rows - 1, io, buf));
+  ASSERT_EQ(codec.get<int64_t>(buf, 0), 100);
+  // NOLINTEND(*magic-number*)
+}
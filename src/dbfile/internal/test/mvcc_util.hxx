@@ -0,0 +1,60 @@
+/**
+ * @file mvcc_util.hxx
+ * @brief Helpers shared by tests working on versioned tables.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_TEST_MVCC_UTIL_HXX
+#define TINYDB_DBFILE_INTERNAL_TEST_MVCC_UTIL_HXX
+
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <cstdint>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.mvcc;
+import tinydb.dbfile.internal.row;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/mvcc.hxx"
+#include "dbfile/internal/row.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <cstdint>
+#include <vector>
+#endif // ENABLE_MODULES
+
+namespace tinydb::test {
+
+/**
+ * @brief A versioned table of one Int64 column, and the transactions
+ * writing it. Where its versions go is up to whoever derives from it.
+ */
+struct Int64Table {
+  dbfile::internal::TableMeta meta{make_meta()};
+  dbfile::internal::RowCodec codec{meta};
+  dbfile::internal::VersionedTable tbl{meta};
+  dbfile::internal::TxnManager txns{};
+
+  static auto make_meta() -> dbfile::internal::TableMeta {
+    dbfile::internal::TableMeta ret{"t"};
+    ret.add_column(
+        dbfile::internal::ColumnMeta{.m_name{"v"},
+                                     .m_type = dbfile::column::ColType::Int64,
+                                     .m_col_id = 0,
+                                     .m_offset = 0});
+    return ret;
+  }
+
+  [[nodiscard]] auto row(int64_t t_val) const -> std::vector<char> {
+    auto ret = codec.make_row();
+    codec.set(ret, 0, t_val);
+    return ret;
+  }
+};
+
+} // namespace tinydb::test
+
+#endif // !TINYDB_DBFILE_INTERNAL_TEST_MVCC_UTIL_HXX
@@ -0,0 +1,230 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.internal.compress;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.page_cache;
+#else
+#include "dbfile/internal/compress.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_cache.hxx"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#endif // ENABLE_MODULES
+
+TEST(compress, round_trip) {
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  std::string text{};
+  for (int i = 0; i < 200; ++i) {
+    text.append("status=shipped;country=VN;");
+    text.push_back(static_cast<char>('a' + (i % 26)));
+  }
+  std::string compressed(text.size(), '\0');
+  auto comp_len = lz4_compress(text, compressed);
+  ASSERT_NE(comp_len, 0);
+  ASSERT_LT(comp_len, text.size() / 3);
+  std::string decompressed(text.size(), '\0');
+  ASSERT_TRUE(lz4_decompress(std::span{compressed.data(), comp_len},
+                             decompressed));
+  ASSERT_EQ(text, decompressed);
+  // truncated input must be rejected, not read out of bounds.
+  ASSERT_FALSE(lz4_decompress(std::span{compressed.data(), comp_len / 2},
+                              decompressed));
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(page_cache, compressed_write_back) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  // nothing in it yet, so the file is packed.
+  auto backing = std::make_unique<std::stringstream>();
+  auto* raw = backing.get();
+  std::string payload(SIZEOF_PAGE - 1, '\0');
+  for (std::size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<char>('a' + (i % 7));
+  }
+  PageCache writer{std::move(backing), PageCompression::Lz4, 2};
+  std::iostream out{&writer};
+  out.seekp(2 * SIZEOF_PAGE);
+  out.rdbuf()->sputc(static_cast<pt_num_t>(PageType::Heap));
+  out.rdbuf()->sputn(payload.data(),
+                     static_cast<std::streamsize>(payload.size()));
+  // a non-data page is never compressed.
+  out.seekp(SIZEOF_PAGE);
+  out.rdbuf()->sputc(static_cast<pt_num_t>(PageType::Free));
+  out.flush();
+  // reads go through the cache too.
+  out.seekg((2 * SIZEOF_PAGE) + 1);
+  ASSERT_EQ(out.rdbuf()->sbumpc(), 'a');
+  ASSERT_EQ(out.rdbuf()->sbumpc(), 'b');
+
+  // `writer` owns the stringstream, so it's still alive here.
+  ASSERT_TRUE(writer.pool()->is_packed());
+  uint32_t magic{0};
+  raw->seekg(SIZEOF_PAGE);
+  raw->rdbuf()->sgetn(std::bit_cast<char*>(&magic), sizeof(magic));
+  ASSERT_EQ(magic, PagePool::PACKED_MAGIC);
+  // page 0, the packed header, page 1 as is, then the compressed page 2 and
+  // the map in a slot each.
+  ASSERT_EQ(raw->str().size(),
+            (2 * SIZEOF_PAGE) + (3 * PagePool::SLOT_UNIT));
+
+  // read it back with a fresh cache, without compression enabled.
+  auto copy = std::make_unique<std::stringstream>(raw->str());
+  PageCache cache{std::move(copy)};
+  std::iostream io{&cache};
+  io.seekg(2 * SIZEOF_PAGE);
+  ASSERT_EQ(io.rdbuf()->sbumpc(), static_cast<pt_num_t>(PageType::Heap));
+  std::string read_back(payload.size(), '\0');
+  io.rdbuf()->sgetn(read_back.data(),
+                    static_cast<std::streamsize>(read_back.size()));
+  ASSERT_EQ(read_back, payload);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(page_cache, packed_moves) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr page_ptr_t numpages = 8;
+  auto backing = std::make_unique<std::stringstream>();
+  auto* raw = backing.get();
+  auto pool = std::make_shared<PagePool>(std::move(backing),
+                                         PageCompression::Lz4, 4);
+  ASSERT_TRUE(pool->is_packed());
+
+  // pages going back and forth between compressible and not, so they keep
+  // moving. The room they leave is used again once the map is written.
+  std::vector<std::string> pages(numpages + 1);
+  uint32_t seed{42};
+  std::size_t first_size{0};
+  for (int round = 0; round < 6; ++round) {
+    for (page_ptr_t pg = 1; pg <= numpages; ++pg) {
+      auto& page = pages[pg];
+      page.assign(SIZEOF_PAGE, static_cast<char>('a' + round));
+      page[0] = static_cast<pt_num_t>(PageType::Heap);
+      if ((pg + round) % 2 == 0) {
+        for (std::size_t i = 1; i < page.size(); ++i) {
+          seed = (seed * 1664525) + 1013904223;
+          page[i] = static_cast<char>(seed >> 24);
+        }
+      }
+      pool->write(pg, 0, page);
+    }
+    ASSERT_TRUE(pool->sync());
+    if (round == 0) {
+      first_size = raw->str().size();
+    }
+  }
+  // half the pages are as is, every round.
+  ASSERT_LE(raw->str().size(), first_size + (numpages * SIZEOF_PAGE));
+
+  // the map is all it takes to find them again, compression or not.
+  auto check = [&](const std::shared_ptr<PagePool>& t_pool) {
+    std::array<char, SIZEOF_PAGE> back{};
+    for (page_ptr_t pg = 1; pg <= numpages; ++pg) {
+      t_pool->read(pg, back);
+      ASSERT_EQ(std::string(back.data(), back.size()), pages[pg]);
+    }
+    ASSERT_EQ(t_pool->end_pos(), (numpages + 1) * SIZEOF_PAGE);
+  };
+  auto reopened = std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(raw->str()), PageCompression::None,
+      4);
+  ASSERT_TRUE(reopened->is_packed());
+  check(reopened);
+  pages[3].assign(SIZEOF_PAGE, 'z');
+  reopened->write(3, 0, pages[3]);
+  ASSERT_TRUE(reopened->sync());
+  check(reopened);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(page_cache, threads) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int n_threads = 8;
+  static constexpr page_ptr_t pages_per_thread = 4;
+  static constexpr page_ptr_t numpages = 2 + (n_threads * pages_per_thread);
+  // way fewer frames than pages, so pages get evicted (and compressed) while
+  // other threads read them.
+  auto pool = std::make_shared<PagePool>(
+      std::make_unique<std::stringstream>(
+          std::string(SIZEOF_PAGE * numpages, '\0')),
+      PageCompression::Lz4, 6);
+  // page 1 is read by everyone, and never written again.
+  {
+    PageStream io{pool};
+    io.seekp(SIZEOF_PAGE);
+    io << std::string(SIZEOF_PAGE, 's');
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<int> failures(n_threads, 0);
+  for (int t = 0; t < n_threads; ++t) {
+    threads.emplace_back([&, t] {
+      PageStream io{pool};
+      auto first = static_cast<page_ptr_t>(2 + (t * pages_per_thread));
+      for (uint64_t round = 0; round < 200; ++round) {
+        auto pg = first + static_cast<page_ptr_t>(round % pages_per_thread);
+        auto pos = (static_cast<std::streamoff>(pg) * SIZEOF_PAGE) +
+                   static_cast<std::streamoff>((round * 8) % SIZEOF_PAGE);
+        uint64_t val = (static_cast<uint64_t>(t) << 32) | round;
+        io.seekp(pos);
+        io.rdbuf()->sputn(std::bit_cast<const char*>(&val), sizeof(val));
+        uint64_t back{0};
+        io.seekg(pos);
+        io.rdbuf()->sgetn(std::bit_cast<char*>(&back), sizeof(back));
+        failures[t] += back == val ? 0 : 1;
+        io.seekg(SIZEOF_PAGE + static_cast<std::streamoff>(round));
+        failures[t] += io.get() == 's' ? 0 : 1;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < n_threads; ++t) {
+    ASSERT_EQ(failures[t], 0) << "thread " << t;
+  }
+
+  // every write made it to the file, whichever thread wrote it back.
+  ASSERT_TRUE(pool->sync());
+  PageStream check{pool};
+  for (int t = 0; t < n_threads; ++t) {
+    for (uint64_t round = 0; round < 200; ++round) {
+      auto pg = static_cast<page_ptr_t>(2 + (t * pages_per_thread)) +
+                static_cast<page_ptr_t>(round % pages_per_thread);
+      check.seekg((static_cast<std::streamoff>(pg) * SIZEOF_PAGE) +
+                  static_cast<std::streamoff>((round * 8) % SIZEOF_PAGE));
+      uint64_t back{0};
+      check.rdbuf()->sgetn(std::bit_cast<char*>(&back), sizeof(back));
+      ASSERT_EQ(back, (static_cast<uint64_t>(t) << 32) | round);
+    }
+  }
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,209 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.heap_base;
+import tinydb.dbfile.internal.row;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/heap_base.hxx"
+#include "dbfile/internal/row.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+#endif // ENABLE_MODULES
+
+TEST(row, encode_decode) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  TableMeta tbl{"orders"};
+  tbl.add_column(ColumnMeta{.m_name{"id"},
+                            .m_type = column::ColType::Uint32,
+                            .m_col_id = 1,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"note"},
+                            .m_type = column::ColType::Text,
+                            .m_col_id = 2,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"qty"},
+                            .m_type = column::ColType::Int16,
+                            .m_col_id = 3,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"price"},
+                            .m_type = column::ColType::Float64,
+                            .m_col_id = 4,
+                            .m_offset = 0});
+  RowCodec codec{tbl};
+  auto row = codec.make_row();
+  auto note = column::TextSlot::make_inline("fragile").value();
+  std::array<Value, 4> vals{Value{uint32_t{42}}, Value{note},
+                            Value{std::monostate{}}, Value{19.5}};
+  ASSERT_TRUE(codec.encode(vals, row));
+  // wrong type for "qty".
+  std::array<Value, 4> bad{vals[0], vals[1], Value{int32_t{1}}, vals[3]};
+  auto scratch = codec.make_row();
+  ASSERT_FALSE(codec.encode(bad, scratch));
+
+  ASSERT_EQ(codec.get<uint32_t>(row, 0), 42);
+  ASSERT_TRUE(codec.is_null(row, 2));
+  ASSERT_EQ(codec.get<double>(row, 3), 19.5);
+
+  // round trip through a page.
+  std::stringstream page{std::string(2 * SIZEOF_PAGE, '\0')};
+  Ptr pos{.pagenum = 1, .offset = 16};
+  codec.write_row(pos, row, page);
+  std::vector<char> read_back(codec.row_size());
+  codec.read_row(pos, page, read_back);
+  std::array<Value, 4> decoded{};
+  codec.decode(read_back, decoded);
+  ASSERT_EQ(decoded, vals);
+
+  // projection only reads and decodes what it's asked for.
+  std::array<std::size_t, 2> cols{3, 1};
+  auto proj = codec.project(cols);
+  std::vector<char> partial(codec.row_size(), '\0');
+  codec.read_row(pos, page, proj, partial);
+  std::array<Value, 2> projected{};
+  codec.decode(partial, proj, projected);
+  ASSERT_EQ(projected[0], vals[3]);
+  ASSERT_EQ(projected[1], vals[1]);
+  // NOLINTEND(*magic-number*)
+}
+
+namespace {
+/**
+ * @brief A table of `t_n` Uint32 columns, c0, c1...
+ */
+auto uint_table(std::size_t t_n) -> tinydb::dbfile::internal::TableMeta {
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  TableMeta tbl{"t"};
+  for (std::size_t i = 0; i < t_n; ++i) {
+    tbl.add_column(ColumnMeta{.m_name{"c" + std::to_string(i)},
+                              .m_type = column::ColType::Uint32,
+                              .m_col_id = static_cast<ColID>(i + 1),
+                              .m_offset = 0});
+  }
+  return tbl;
+}
+} // namespace
+
+TEST(row, all_null) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  TableMeta tbl{"t"};
+  tbl.add_column(ColumnMeta{.m_name{"a"},
+                            .m_type = column::ColType::Int16,
+                            .m_col_id = 1,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"b"},
+                            .m_type = column::ColType::Text,
+                            .m_col_id = 2,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"c"},
+                            .m_type = column::ColType::Float64,
+                            .m_col_id = 3,
+                            .m_offset = 0});
+  RowCodec codec{tbl};
+  auto row = codec.make_row();
+  std::array<Value, 3> vals{};
+  ASSERT_TRUE(codec.encode(vals, row));
+  for (std::size_t i = 0; i < codec.n_cols(); ++i) {
+    ASSERT_TRUE(codec.is_null(row, i));
+  }
+
+  std::stringstream page{std::string(2 * SIZEOF_PAGE, '\0')};
+  Ptr pos{.pagenum = 1, .offset = 16};
+  codec.write_row(pos, row, page);
+  std::vector<char> read_back(codec.row_size());
+  codec.read_row(pos, page, read_back);
+  std::array<Value, 3> decoded{Value{int16_t{1}}, Value{}, Value{2.0}};
+  codec.decode(read_back, decoded);
+  ASSERT_EQ(decoded, vals);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(row, project_last) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  RowCodec codec{uint_table(5)};
+  auto row = codec.make_row();
+  std::array<Value, 5> vals{Value{uint32_t{1}}, Value{uint32_t{2}},
+                            Value{uint32_t{3}}, Value{uint32_t{4}},
+                            Value{uint32_t{5}}};
+  ASSERT_TRUE(codec.encode(vals, row));
+  std::stringstream page{std::string(2 * SIZEOF_PAGE, '\0')};
+  Ptr pos{.pagenum = 1, .offset = 40};
+  codec.write_row(pos, row, page);
+
+  std::array<std::size_t, 1> cols{4};
+  auto proj = codec.project(cols);
+  std::vector<char> partial(codec.row_size(), '\0');
+  codec.read_row(pos, page, proj, partial);
+  std::array<Value, 1> projected{};
+  codec.decode(partial, proj, projected);
+  ASSERT_EQ(projected[0], vals[4]);
+  // the other columns weren't read.
+  ASSERT_EQ(codec.get<uint32_t>(partial, 0), 0);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(row, null_bitmap_bytes) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  // 8 columns fill the bitmap's first byte, 9 need a second one.
+  for (const std::size_t n : {8U, 9U}) {
+    RowCodec codec{uint_table(n)};
+    std::vector<Value> vals;
+    for (std::size_t i = 0; i < n; ++i) {
+      // NULL for every other column, and for the last one.
+      vals.push_back(i % 2 == 1 || i == n - 1
+                         ? Value{}
+                         : Value{static_cast<uint32_t>(i)});
+    }
+    auto row = codec.make_row();
+    ASSERT_TRUE(codec.encode(vals, row));
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(codec.is_null(row, i), vals[i] == Value{}) << n << " " << i;
+    }
+    std::vector<Value> decoded(n);
+    codec.decode(row, decoded);
+    ASSERT_EQ(decoded, vals);
+
+    // flipping the last bit leaves the others alone.
+    codec.set(row, n - 1, uint32_t{77});
+    ASSERT_FALSE(codec.is_null(row, n - 1));
+    ASSERT_EQ(codec.is_null(row, n - 2), n % 2 == 1);
+    ASSERT_FALSE(codec.is_null(row, 0));
+    codec.set_null(row, n - 1);
+    ASSERT_TRUE(codec.is_null(row, n - 1));
+    codec.decode(row, decoded);
+    ASSERT_EQ(decoded, vals);
+  }
+  // NOLINTEND(*magic-number*)
+}
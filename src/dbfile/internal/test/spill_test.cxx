@@ -0,0 +1,119 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/spill.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+#endif // ENABLE_MODULES
+
+TEST(spill, round_trip) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * 8, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  SpillFile file;
+  // odd-sized writes, straddling pages.
+  std::vector<std::byte> data(SpillFile::PAGE_BYTES * 3 + 123);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<std::byte>(i * 7);
+  }
+  std::span<const std::byte> rest{data};
+  for (std::size_t len = 1; !rest.empty(); len = len * 3 + 1) {
+    len = std::min(len, rest.size());
+    file.write(rest.first(len), fl, io);
+    rest = rest.subspan(len);
+  }
+  file.flush(io);
+  ASSERT_EQ(file.n_bytes(), data.size());
+  ASSERT_EQ(file.n_pages(), 4);
+
+  auto reader = file.reader();
+  std::vector<std::byte> back(data.size());
+  ASSERT_TRUE(reader.read({back.data(), 100}, io));
+  ASSERT_TRUE(reader.read({back.data() + 100, back.size() - 100}, io));
+  ASSERT_EQ(back, data);
+  std::byte past{};
+  ASSERT_FALSE(reader.read({&past, 1}, io));
+
+  // freed pages are the ones taken next.
+  file.free_pages(fl, io);
+  ASSERT_EQ(file.n_pages(), 0);
+  SpillFile other;
+  other.write(data, fl, io);
+  other.flush(io);
+  ASSERT_LE(io.str().size(), SIZEOF_PAGE * 8);
+  auto again = other.reader();
+  ASSERT_TRUE(again.read(back, io));
+  ASSERT_EQ(back, data);
+  ASSERT_FALSE(SpillFile{}.reader().read({&past, 1}, io));
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(spill, page_boundary) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile::internal;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * 8, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  const auto page = SpillFile::PAGE_BYTES;
+
+  // exactly one page: no second page for nothing.
+  SpillFile full;
+  const std::vector<std::byte> ones(page, std::byte{1});
+  full.write(ones, fl, io);
+  full.flush(io);
+  ASSERT_EQ(full.n_pages(), 1);
+  std::vector<std::byte> back(page);
+  auto full_reader = full.reader();
+  ASSERT_TRUE(full_reader.read(back, io));
+  ASSERT_EQ(back, ones);
+  std::byte past{};
+  ASSERT_FALSE(full_reader.read({&past, 1}, io));
+
+  // a record whose bytes sit on both sides of the boundary.
+  SpillFile file;
+  std::vector<std::byte> head(page - 3, std::byte{2});
+  std::vector<std::byte> record(6);
+  for (std::size_t i = 0; i < record.size(); ++i) {
+    record[i] = static_cast<std::byte>(0xA0 + i);
+  }
+  file.write(head, fl, io);
+  file.write(record, fl, io);
+  file.flush(io);
+  ASSERT_EQ(file.n_pages(), 2);
+  ASSERT_EQ(file.n_bytes(), page + 3);
+
+  auto reader = file.reader();
+  std::vector<std::byte> skip(head.size());
+  ASSERT_TRUE(reader.read(skip, io));
+  ASSERT_EQ(skip, head);
+  std::vector<std::byte> got(record.size());
+  ASSERT_TRUE(reader.read(got, io));
+  ASSERT_EQ(got, record);
+  ASSERT_FALSE(reader.read({&past, 1}, io));
+
+  full.free_pages(fl, io);
+  file.free_pages(fl, io);
+  // NOLINTEND(*magic-number*)
+}
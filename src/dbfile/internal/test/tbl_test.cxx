@@ -3,7 +3,9 @@
 #ifdef ENABLE_MODULES
 #ifndef IMPORT_STD
 #include <cassert>
-#include <sstream>
+#include <cstddef>
+#include <ios>
+#include <string>
 #else
 import std;
 #endif // !IMPORT_STD
@@ -12,13 +14,14 @@ import tinydb.dbfile.coltype;
 #else
 #include "dbfile/coltype.hxx"
 #include "dbfile/internal/tbl.hxx"
+#include <cstddef>
+#include <ios>
+#include <string>
 #endif // ENABLE_MODULES
 TEST(tbl, init) {
   using namespace tinydb::dbfile;
   using namespace tinydb::dbfile::internal;
   TableMeta tbltest{"test-tbl"};
-  std::stringstream test_stream{std::string(2 * tinydb::SIZEOF_PAGE, '\0')};
-  test_stream.exceptions(std::stringstream::failbit);
   // NOLINTBEGIN
   tbltest.add_column(ColumnMeta{.m_name{"col1"},
                                 .m_type = column::ColType::Uint8,
@@ -30,8 +33,7 @@ TEST(tbl, init) {
                                 .m_offset = 1});
   // NOLINTEND
   tbltest.set_key("col1");
-  tbltest.write_to(test_stream);
-  auto readtest = TableMeta::read_from(test_stream);
+  auto readtest = TableMeta::decode(tbltest.encode());
   // breakpoint here to inspect variables
   // if get_column or read_from is faulty, this part here throws an exception.
   auto initial_col2 = tbltest.get_column("col2").value().get();
@@ -43,3 +45,86 @@ TEST(tbl, init) {
   ASSERT_EQ(column::type_id(initial_col2.m_type),
             column::type_id(column::ColType::Text));
 }
+
+TEST(tbl, decode_checks) {
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  TableMeta tbl{"t"};
+  ASSERT_TRUE(tbl.add_column(ColumnMeta{.m_name{"a"},
+                                        .m_type = column::ColType::Int64,
+                                        .m_col_id = 1,
+                                        .m_offset = 0}));
+  ASSERT_TRUE(tbl.add_column(ColumnMeta{.m_name{"b"},
+                                        .m_type = column::ColType::Text,
+                                        .m_col_id = 2,
+                                        .m_offset = 0}));
+  ASSERT_TRUE(tbl.set_key("a"));
+  const auto def = tbl.encode();
+  auto back = TableMeta::decode(def);
+  ASSERT_EQ(back.get_name(), "t");
+  ASSERT_EQ(back.get_key(), "a");
+  ASSERT_EQ(back.layout().row_size, tbl.layout().row_size);
+
+  // cut anywhere, or with a byte too many.
+  for (std::size_t len = 0; len < def.size(); ++len) {
+    ASSERT_THROW(TableMeta::decode(def.substr(0, len)), std::ios_base::failure);
+  }
+  ASSERT_THROW(TableMeta::decode(def + '\0'), std::ios_base::failure);
+  // an unknown type: the last byte is b's.
+  auto bad = def;
+  bad.back() = static_cast<char>(0x7F);
+  ASSERT_THROW(TableMeta::decode(bad), std::ios_base::failure);
+  // both columns named "a".
+  bad = def;
+  bad[bad.size() - 3] = 'a';
+  ASSERT_THROW(TableMeta::decode(bad), std::ios_base::failure);
+}
+
+TEST(tbl, layout) {
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  TableMeta tbltest{"test-tbl"};
+  // NOLINTBEGIN
+  // added out of order on purpose.
+  ASSERT_TRUE(tbltest.add_column(ColumnMeta{.m_name{"price"},
+                                            .m_type = column::ColType::Float64,
+                                            .m_col_id = 3,
+                                            .m_offset = 0}));
+  ASSERT_TRUE(tbltest.add_column(ColumnMeta{.m_name{"id"},
+                                            .m_type = column::ColType::Uint32,
+                                            .m_col_id = 1,
+                                            .m_offset = 0}));
+  ASSERT_TRUE(tbltest.add_column(ColumnMeta{.m_name{"name"},
+                                            .m_type = column::ColType::Text,
+                                            .m_col_id = 2,
+                                            .m_offset = 0}));
+  // same name, or same ID.
+  ASSERT_FALSE(tbltest.add_column(ColumnMeta{.m_name{"id"},
+                                             .m_type = column::ColType::Int8,
+                                             .m_col_id = 9,
+                                             .m_offset = 0}));
+  ASSERT_FALSE(tbltest.add_column(ColumnMeta{.m_name{"other"},
+                                             .m_type = column::ColType::Int8,
+                                             .m_col_id = 2,
+                                             .m_offset = 0}));
+  auto cols = tbltest.columns();
+  ASSERT_EQ(cols.size(), 3);
+  ASSERT_EQ(cols[0].m_name, "id");
+  ASSERT_EQ(cols[1].m_name, "name");
+  ASSERT_EQ(cols[2].m_name, "price");
+  // widest alignment first: price, id, then name. The null bitmap goes last,
+  // and the row is padded to price's alignment.
+  const auto& layout = tbltest.layout();
+  ASSERT_EQ(layout.offsets[2], 0);
+  ASSERT_EQ(layout.offsets[0], 8);
+  ASSERT_EQ(layout.offsets[1], 12);
+  ASSERT_EQ(layout.null_off, 12 + column::type_size(column::ColType::Text));
+  ASSERT_EQ(layout.row_size, 32);
+  ASSERT_EQ(tbltest.column_pos("price"), 2);
+  ASSERT_FALSE(tbltest.get_column("nope").has_value());
+
+  ASSERT_TRUE(tbltest.remove_column("name"));
+  ASSERT_EQ(tbltest.get_column("id").value().get().m_offset, 8);
+  ASSERT_EQ(tbltest.layout().row_size, 16);
+  // NOLINTEND
+}
@@ -0,0 +1,72 @@
+/**
+ * @file test_util.hxx
+ * @brief Helpers shared by tests working on whole database files.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_TEST_TEST_UTIL_HXX
+#define TINYDB_DBFILE_INTERNAL_TEST_TEST_UTIL_HXX
+
+#include "offsets.hxx"
+#include "sizes.hxx"
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/spill.hxx"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#endif // ENABLE_MODULES
+
+namespace tinydb::test {
+
+/**
+ * @return The number of pages of a database file.
+ */
+inline auto file_pages(std::iostream& t_io) -> uint32_t {
+  uint32_t ret{0};
+  t_io.seekg(DBFILE_SIZE_OFF);
+  t_io.read(std::bit_cast<char*>(&ret), sizeof(ret));
+  return ret;
+}
+
+/**
+ * @brief A database file in a string stream, every page of it free.
+ *
+ * String streams can't grow past their end by seeking: room for every page
+ * up front.
+ */
+struct MemFile {
+  std::stringstream io;
+  dbfile::internal::FreeList fl;
+
+  explicit MemFile(std::size_t t_n_pages)
+      : io{std::string(SIZEOF_PAGE * t_n_pages, '\0')},
+        fl{dbfile::internal::FreeList::default_init(1, io)} {
+    io.exceptions(std::stringstream::failbit);
+  }
+
+  [[nodiscard]] auto spill() -> dbfile::internal::SpillSpace {
+    return {.fl = &fl, .io = &io};
+  }
+
+  [[nodiscard]] auto pages() -> uint32_t { return file_pages(io); }
+};
+
+} // namespace tinydb::test
+
+#endif // !TINYDB_DBFILE_INTERNAL_TEST_TEST_UTIL_HXX
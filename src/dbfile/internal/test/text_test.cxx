@@ -0,0 +1,146 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <sstream>
+#include <string>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.text;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/text.hxx"
+#include <sstream>
+#include <string>
+#endif // ENABLE_MODULES
+
+TEST(text, inline_and_spilled) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 8;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+
+  // short enough: the heap is never touched.
+  auto short_slot = write_text("shipped", heap, fl, io);
+  ASSERT_TRUE(short_slot.is_inline());
+  ASSERT_EQ(short_slot.size(), 7);
+  ASSERT_EQ(read_text(short_slot, io), "shipped");
+
+  std::string medium(100, 'm');
+  auto medium_slot = write_text(medium, heap, fl, io);
+  ASSERT_FALSE(medium_slot.is_inline());
+  ASSERT_EQ(medium_slot.prefix(), medium.substr(0, 5));
+  ASSERT_EQ(read_text(medium_slot, io), medium);
+
+  // longer than a page: a chain of fragments.
+  std::string huge(3 * SIZEOF_PAGE, '\0');
+  for (std::size_t i = 0; i < huge.size(); ++i) {
+    huge[i] = static_cast<char>('a' + (i % 23));
+  }
+  auto huge_slot = write_text(huge, heap, fl, io);
+  ASSERT_EQ(huge_slot.size(), huge.size());
+  ASSERT_EQ(read_text(huge_slot, io), huge);
+
+  free_text(huge_slot, heap, fl, io);
+  free_text(medium_slot, heap, fl, io);
+  // the freed space is reused.
+  auto again = write_text(huge, heap, fl, io);
+  ASSERT_EQ(read_text(again, io), huge);
+
+  auto fixed = column::FixedText<8>::from("VN");
+  ASSERT_TRUE(fixed.has_value());
+  ASSERT_EQ(fixed->view(), "VN");
+  ASSERT_FALSE(column::FixedText<8>::from("too long!").has_value());
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(text, inline_boundary) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 4;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+
+  auto empty = write_text("", heap, fl, io);
+  ASSERT_TRUE(empty.is_inline());
+  ASSERT_EQ(empty.size(), 0);
+  ASSERT_EQ(empty.prefix(), "");
+  ASSERT_EQ(read_text(empty, io), "");
+  // freeing an inline slot is a no-op.
+  free_text(empty, heap, fl, io);
+
+  // the longest string that still fits in the slot.
+  const std::string fits(column::TextSlot::INLINE_CAP, 'f');
+  ASSERT_EQ(fits.size(), 15);
+  auto fits_slot = write_text(fits, heap, fl, io);
+  ASSERT_TRUE(fits_slot.is_inline());
+  ASSERT_EQ(fits_slot.size(), 15);
+  ASSERT_EQ(read_text(fits_slot, io), fits);
+
+  // one more byte and it spills.
+  const std::string spills(column::TextSlot::INLINE_CAP + 1, 's');
+  auto spills_slot = write_text(spills, heap, fl, io);
+  ASSERT_FALSE(spills_slot.is_inline());
+  ASSERT_EQ(spills_slot.size(), 16);
+  ASSERT_EQ(spills_slot.prefix(),
+            spills.substr(0, column::TextSlot::PREFIX_LEN));
+  ASSERT_EQ(read_text(spills_slot, io), spills);
+  free_text(spills_slot, heap, fl, io);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(text, overwrite) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 8;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+
+  // a neighbour that must survive the overwrites.
+  const std::string other(300, 'o');
+  auto other_slot = write_text(other, heap, fl, io);
+
+  // overwriting a value is freeing the old slot and writing the new one.
+  auto overwrite = [&](const column::TextSlot& t_old, std::string_view t_new) {
+    free_text(t_old, heap, fl, io);
+    return write_text(t_new, heap, fl, io);
+  };
+  auto slot = write_text("short", heap, fl, io);
+  // inline to spilled.
+  const std::string longer(200, 'l');
+  slot = overwrite(slot, longer);
+  ASSERT_FALSE(slot.is_inline());
+  ASSERT_EQ(read_text(slot, io), longer);
+  // spilled to a longer spilled one.
+  const std::string longest(2 * SIZEOF_PAGE, 'x');
+  slot = overwrite(slot, longest);
+  ASSERT_EQ(read_text(slot, io), longest);
+  // spilled back to inline.
+  slot = overwrite(slot, "tiny");
+  ASSERT_TRUE(slot.is_inline());
+  ASSERT_EQ(read_text(slot, io), "tiny");
+  slot = overwrite(slot, "");
+  ASSERT_EQ(read_text(slot, io), "");
+
+  ASSERT_EQ(read_text(other_slot, io), other);
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,228 @@
+#include "sizes.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_store;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+import tinydb.dbfile.internal.zone_map;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_store.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "dbfile/internal/zone_map.hxx"
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#endif // ENABLE_MODULES
+
+TEST(zone_map, skip_pages) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 128;
+  static constexpr uint32_t numrows = 10000;
+  static constexpr uint32_t cutoff = 9000;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  Heap heap{0};
+  TableMeta tbl{"log"};
+  tbl.add_column(ColumnMeta{.m_name{"id"},
+                            .m_type = column::ColType::Uint32,
+                            .m_col_id = 1,
+                            .m_offset = 0});
+  tbl.add_column(ColumnMeta{.m_name{"note"},
+                            .m_type = column::ColType::Text,
+                            .m_col_id = 2,
+                            .m_offset = 0});
+  ColumnStore store{tbl};
+  auto note_of = [](uint32_t t_i) { return "note-" + std::to_string(t_i); };
+  auto batch = store.make_batch();
+  // small batches, so that zones get widened by later appends.
+  for (uint32_t i = 0; i < numrows; ++i) {
+    batch[0].push(i);
+    if (i % 5 == 0) {
+      batch[1].push_null();
+    } else {
+      batch[1].push_text(note_of(i));
+    }
+    if (batch[0].size() == 300) {
+      ASSERT_TRUE(store.append(batch, heap, fl, io));
+      batch[0].clear();
+      batch[1].clear();
+    }
+  }
+  ASSERT_TRUE(store.append(batch, heap, fl, io));
+
+  Ptr desc{.pagenum = numpages - 1, .offset = 0};
+  store.write_to(desc, io);
+  auto reopened = ColumnStore::read_from(tbl, desc, io);
+  for (std::size_t col = 0; col < 2; ++col) {
+    auto zones = reopened.zones(col);
+    ASSERT_EQ(zones.size(), store.zones(col).size());
+    std::size_t total{0};
+    std::size_t nulls{0};
+    for (const auto& zone : zones) {
+      total += zone.n_values;
+      nulls += zone.n_nulls;
+    }
+    ASSERT_EQ(total, numrows);
+    ASSERT_EQ(nulls, col == 0 ? 0 : numrows / 5);
+  }
+  auto id_zones = reopened.zones(0);
+  uint32_t lo{0};
+  uint32_t hi{0};
+  std::memcpy(&lo, id_zones[0].min.data(), sizeof(lo));
+  std::memcpy(&hi, id_zones[0].max.data(), sizeof(hi));
+  ASSERT_EQ(lo, 0);
+  ASSERT_EQ(hi, id_zones[0].n_values - 1);
+
+  // strings only keep a prefix: ordering still rules pages out, Ne doesn't.
+  const auto& note_zone = reopened.zones(1)[0];
+  ASSERT_FALSE(ZoneMap::may_match(column::ColType::Text, note_zone,
+                                  ColumnFilter::of_text(1, CmpOp::Lt, "a")));
+  ASSERT_TRUE(ZoneMap::may_match(column::ColType::Text, note_zone,
+                                 ColumnFilter::of_text(1, CmpOp::Ne, "a")));
+
+  // trash every page that only holds rows before the cutoff. A scan that
+  // reads any of them returns garbage, or trips an assert.
+  const std::string garbage(SIZEOF_PAGE, '\x7F');
+  for (std::size_t col = 0; col < 2; ++col) {
+    std::size_t end{0};
+    for (const auto& zone : reopened.zones(col)) {
+      end += zone.n_values;
+      if (end <= cutoff) {
+        io.seekp(static_cast<std::streamoff>(zone.pg) * SIZEOF_PAGE);
+        io.write(garbage.data(), SIZEOF_PAGE);
+      }
+    }
+  }
+  std::vector<std::size_t> cols{0, 1};
+  auto scanner = reopened.scan(
+      cols, ColumnFilter::of<uint32_t>(0, CmpOp::Ge, cutoff), io);
+  auto out = scanner.make_batch();
+  uint32_t row{cutoff};
+  while (auto n = scanner.next(out)) {
+    auto ids = out[0].values<uint32_t>();
+    for (std::size_t i = 0; i < n; ++i, ++row) {
+      ASSERT_EQ(ids[i], row);
+      if (row % 5 == 0) {
+        ASSERT_TRUE(out[1].is_null(i));
+      } else {
+        ASSERT_EQ(out[1].text(i), note_of(row));
+      }
+    }
+  }
+  ASSERT_EQ(row, numrows);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(zone_map, widen) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 8;
+  static constexpr auto type = column::ColType::Int32;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  ZoneMap map{type};
+  auto may = [&](const ZoneMap& t_map, CmpOp t_op, int32_t t_val) {
+    return ZoneMap::may_match(type, t_map.zones()[0],
+                              ColumnFilter::of<int32_t>(0, t_op, t_val));
+  };
+
+  ColumnVector col{type};
+  for (int32_t i = 10; i <= 20; ++i) {
+    col.push(i);
+  }
+  map.add(100, col, 0, col.size(), fl, io);
+  ASSERT_FALSE(may(map, CmpOp::Lt, 10));
+  ASSERT_FALSE(may(map, CmpOp::Gt, 20));
+  ASSERT_FALSE(may(map, CmpOp::Eq, -5));
+
+  // more rows land in the same page, on both sides of the old range.
+  col.clear();
+  col.push(int32_t{-5});
+  col.push(int32_t{50});
+  map.add(100, col, 0, col.size(), fl, io);
+  ASSERT_EQ(map.zones().size(), 1);
+  auto check = [&](const ZoneMap& t_map) {
+    ASSERT_EQ(t_map.zones()[0].n_values, 13);
+    ASSERT_TRUE(may(t_map, CmpOp::Lt, 10));
+    ASSERT_TRUE(may(t_map, CmpOp::Eq, -5));
+    ASSERT_TRUE(may(t_map, CmpOp::Gt, 20));
+    // still narrow enough to rule out what's beyond the new bounds.
+    ASSERT_FALSE(may(t_map, CmpOp::Lt, -5));
+    ASSERT_FALSE(may(t_map, CmpOp::Gt, 50));
+    ASSERT_FALSE(may(t_map, CmpOp::Eq, 51));
+  };
+  check(map);
+  // the widened zone was written back.
+  check(ZoneMap::read_from(type, map.first_page(), io));
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(zone_map, null_only) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  using namespace tinydb::dbfile::internal;
+  static constexpr page_ptr_t numpages = 8;
+  static constexpr auto type = column::ColType::Uint32;
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * numpages, '\0')};
+  io.exceptions(std::stringstream::failbit);
+  auto fl = FreeList::default_init(1, io);
+  ZoneMap map{type};
+  ColumnVector col{type};
+  for (int i = 0; i < 4; ++i) {
+    col.push_null();
+  }
+  map.add(100, col, 0, col.size(), fl, io);
+  auto reread = ZoneMap::read_from(type, map.first_page(), io);
+  for (const auto& zone : {map.zones()[0], reread.zones()[0]}) {
+    ASSERT_TRUE(zone.all_null());
+    ASSERT_EQ(zone.n_nulls, 4);
+    // a NULL matches nothing, not even Ne.
+    for (auto op : {CmpOp::Eq, CmpOp::Ne, CmpOp::Lt, CmpOp::Le, CmpOp::Gt,
+                    CmpOp::Ge}) {
+      ASSERT_FALSE(ZoneMap::may_match(
+          type, zone, ColumnFilter::of<uint32_t>(0, op, 0)));
+    }
+  }
+
+  // the first value replaces the meaningless bounds, instead of being
+  // compared to them.
+  col.clear();
+  col.push(uint32_t{7});
+  map.add(100, col, 0, col.size(), fl, io);
+  reread = ZoneMap::read_from(type, map.first_page(), io);
+  for (const auto& zone : {map.zones()[0], reread.zones()[0]}) {
+    ASSERT_FALSE(zone.all_null());
+    ASSERT_TRUE(ZoneMap::may_match(
+        type, zone, ColumnFilter::of<uint32_t>(0, CmpOp::Eq, 7)));
+    ASSERT_FALSE(ZoneMap::may_match(
+        type, zone, ColumnFilter::of<uint32_t>(0, CmpOp::Lt, 7)));
+    ASSERT_FALSE(ZoneMap::may_match(
+        type, zone, ColumnFilter::of<uint32_t>(0, CmpOp::Gt, 7)));
+  }
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,144 @@
+/**
+ * @file text.cxx
+ * @brief Definitions for text.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.text;
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.page;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/text.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+// the largest allocations a fresh heap page can hold.
+constexpr std::size_t MAX_USED_DATA = SIZEOF_PAGE - HeapMeta::DEFAULT_FREE_OFF -
+                                      Fragment::USED_FRAG_HEADER_SIZE;
+constexpr std::size_t MAX_CHAINED_DATA = SIZEOF_PAGE -
+                                         HeapMeta::DEFAULT_FREE_OFF -
+                                         Fragment::CHAINED_FRAG_HEADER_SIZE;
+
+void write_data(const Fragment& t_frag, std::string_view t_data,
+                std::ostream& t_out) {
+  t_out.seekp((t_frag.pos.pagenum * SIZEOF_PAGE) + t_frag.pos.offset +
+              t_frag.header_size());
+  t_out.rdbuf()->sputn(t_data.data(),
+                       static_cast<std::streamsize>(t_data.size()));
+}
+
+} // namespace
+
+auto write_text(std::string_view t_str, Heap& t_heap, FreeList& t_fl,
+                std::iostream& t_io) -> column::TextSlot {
+  if (auto slot = column::TextSlot::make_inline(t_str); slot.has_value()) {
+    return *slot;
+  }
+  if (t_str.size() <= MAX_USED_DATA) {
+    auto [frag, _] = t_heap.malloc(static_cast<page_off_t>(t_str.size()),
+                                   false, t_fl, t_io);
+    write_data(frag, t_str, t_io);
+    return column::TextSlot::make_spilled(t_str, frag.pos);
+  }
+
+  // allocate every piece first, so that each one can be chained to the next
+  // while its data is written.
+  std::vector<Fragment> chain;
+  chain.reserve((t_str.size() + MAX_CHAINED_DATA - 1) / MAX_CHAINED_DATA);
+  for (std::size_t off = 0; off < t_str.size(); off += MAX_CHAINED_DATA) {
+    auto len = std::min(MAX_CHAINED_DATA, t_str.size() - off);
+    chain.push_back(
+        t_heap.malloc(static_cast<page_off_t>(len), true, t_fl, t_io).first);
+  }
+  for (std::size_t i = 0; i < chain.size(); ++i) {
+    if (i + 1 < chain.size()) {
+      Heap::chain(chain[i], chain[i + 1], t_io);
+    }
+    write_data(chain[i], t_str.substr(i * MAX_CHAINED_DATA, MAX_CHAINED_DATA),
+               t_io);
+  }
+  return column::TextSlot::make_spilled(t_str, chain.front().pos);
+}
+
+auto read_text(const column::TextSlot& t_slot, std::istream& t_in)
+    -> std::string {
+  if (t_slot.is_inline()) {
+    return std::string{t_slot.prefix()};
+  }
+  std::string ret(t_slot.size(), '\0');
+  std::size_t done{0};
+  Ptr pos{t_slot.spilled_ptr()};
+  while (done < ret.size()) {
+    auto frag = read_frag_from(pos, t_in);
+    // a fragment can be a bit larger than what was asked for.
+    auto len = std::min<std::size_t>(frag.size, ret.size() - done);
+    t_in.seekg((pos.pagenum * SIZEOF_PAGE) + pos.offset + frag.header_size());
+    t_in.rdbuf()->sgetn(ret.data() + done, static_cast<std::streamsize>(len));
+    done += len;
+    if (frag.type != Fragment::FragType::Chained) {
+      break;
+    }
+    pos = std::get<Fragment::ChainedFragExtra>(frag.extra).next;
+    if (pos == NullPtr) {
+      break;
+    }
+  }
+  // a short chain means a corrupted file.
+  if (done != ret.size()) {
+    throw std::ios_base::failure("Text value is truncated");
+  }
+  return ret;
+}
+
+void free_text(const column::TextSlot& t_slot, Heap& t_heap, FreeList& t_fl,
+               std::iostream& t_io) {
+  if (t_slot.is_inline()) {
+    return;
+  }
+  Ptr pos{t_slot.spilled_ptr()};
+  while (pos != NullPtr) {
+    auto frag = read_frag_from(pos, t_io);
+    pos = frag.type == Fragment::FragType::Chained
+              ? std::get<Fragment::ChainedFragExtra>(frag.extra).next
+              : NullPtr;
+    t_heap.free(std::move(frag), t_fl, t_io);
+  }
+}
+
+} // namespace tinydb::dbfile::internal
@@ -0,0 +1,59 @@
+/**
+ * @file text.hxx
+ * @brief Declares how Text values are moved between rows and the heap.
+ *
+ * A Text column only takes `TextSlot::SIZE` bytes inside a row. Most strings
+ * people actually store (names, codes, statuses, ...) fit in there, so they
+ * never touch the heap at all. Only the longer ones are spilled into heap
+ * fragments, and those are chained together if one page isn't enough.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_TEXT_HXX
+#define TINYDB_DBFILE_INTERNAL_TEXT_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @brief Makes the slot for a string, spilling it into the heap if it doesn't
+ * fit inline.
+ *
+ * @param t_str The string.
+ * @param t_heap The heap to spill into.
+ * @param t_fl In case the heap needs more pages.
+ * @param t_io The database read/write stream.
+ */
+TINYDB_EXPORT auto write_text(std::string_view t_str, Heap& t_heap,
+                              FreeList& t_fl, std::iostream& t_io)
+    -> column::TextSlot;
+
+/**
+ * @brief Gets the whole string back out of a slot. Doesn't touch the stream
+ * if the string is inline.
+ */
+TINYDB_EXPORT auto read_text(const column::TextSlot& t_slot,
+                             std::istream& t_in) -> std::string;
+
+/**
+ * @brief Releases the heap memory a slot holds, if any. The slot must not be
+ * read afterwards.
+ */
+TINYDB_EXPORT void free_text(const column::TextSlot& t_slot, Heap& t_heap,
+                             FreeList& t_fl, std::iostream& t_io);
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_TEXT_HXX
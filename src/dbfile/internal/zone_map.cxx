@@ -0,0 +1,214 @@
+/**
+ * @file zone_map.cxx
+ * @brief Definitions for zone_map.hxx.
+ */
+
+#ifdef ENABLE_MODULES
+module;
+#include "general/sizes.hxx"
+#include <cassert>
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif
+export module tinydb.dbfile.internal.zone_map;
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.page;
+#ifdef IMPORT_STD
+import std;
+#endif
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/page_serialize.hxx"
+#include "general/sizes.hxx"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#endif // ENABLE_MODULES
+
+#include "dbfile/internal/zone_map.hxx"
+
+namespace tinydb::dbfile::internal {
+
+namespace {
+
+static_assert(ZoneMap::ZONES_PER_PAGE == 170);
+
+auto zone_pos(page_ptr_t t_pg, std::size_t t_slot) -> std::streamoff {
+  return (static_cast<std::streamoff>(t_pg) * SIZEOF_PAGE) +
+         static_cast<std::streamoff>(ZoneMapPageMeta::DEFAULT_FREE_OFF +
+                                     (t_slot * ZoneMap::ZONE_SIZE));
+}
+
+} // namespace
+
+auto ZoneMap::read_from(column::ColType t_type, page_ptr_t t_first,
+                        std::istream& t_in) -> ZoneMap {
+  ZoneMap ret{t_type};
+  for (auto pg = t_first; pg != NULL_PAGE;) {
+    auto meta = internal::read_from<ZoneMapPageMeta>(pg, t_in);
+    ret.m_pages.push_back(pg);
+    t_in.seekg(zone_pos(pg, 0));
+    auto& rdbuf = *t_in.rdbuf();
+    for (std::size_t i = 0; i < meta.get_n_zones(); ++i) {
+      Zone zone{};
+      rdbuf.sgetn(std::bit_cast<char*>(&zone.pg), sizeof(zone.pg));
+      rdbuf.sgetn(std::bit_cast<char*>(&zone.n_values), sizeof(zone.n_values));
+      rdbuf.sgetn(std::bit_cast<char*>(&zone.n_nulls), sizeof(zone.n_nulls));
+      rdbuf.sgetn(zone.min.data(), Zone::KEY_SIZE);
+      rdbuf.sgetn(zone.max.data(), Zone::KEY_SIZE);
+      ret.m_zones.push_back(zone);
+    }
+    pg = meta.get_next_pg();
+  }
+  return ret;
+}
+
+auto ZoneMap::key_of(std::string_view t_val) -> Zone::key_t {
+  Zone::key_t ret{};
+  t_val.copy(ret.data(), std::min(t_val.size(), Zone::KEY_SIZE));
+  return ret;
+}
+
+auto ZoneMap::compare_keys(column::ColType t_type, const Zone::key_t& t_lhs,
+                           const Zone::key_t& t_rhs) -> int {
+  if (column::is_text(t_type)) {
+    // zero padding sorts before any other byte, so comparing the padded
+    // prefixes keeps the order of the strings (ties aside).
+    return std::string_view{t_lhs.data(), t_lhs.size()}.compare(
+        {t_rhs.data(), t_rhs.size()});
+  }
+  auto width = column::type_size(t_type);
+  return compare_values(t_type, {t_lhs.data(), width}, {t_rhs.data(), width});
+}
+
+void ZoneMap::add(page_ptr_t t_pg, const ColumnVector& t_col,
+                  std::size_t t_from, std::size_t t_count, FreeList& t_fl,
+                  std::iostream& t_io) {
+  assert(t_col.type == m_type);
+  if (t_count == 0) {
+    return;
+  }
+  if (m_zones.empty() || m_zones.back().pg != t_pg) {
+    m_zones.push_back(Zone{.pg = t_pg,
+                           .n_values = 0,
+                           .n_nulls = 0,
+                           .min{},
+                           .max{}});
+  }
+  auto& zone = m_zones.back();
+  for (auto i = t_from; i < t_from + t_count; ++i) {
+    if (t_col.is_null(i)) {
+      ++zone.n_nulls;
+      ++zone.n_values;
+      continue;
+    }
+    auto key = key_of(t_col.bytes(i));
+    if (zone.all_null()) {
+      zone.min = key;
+      zone.max = key;
+    } else if (compare_keys(m_type, key, zone.min) < 0) {
+      zone.min = key;
+    } else if (compare_keys(m_type, key, zone.max) > 0) {
+      zone.max = key;
+    }
+    // counted last, so that all_null above only looks at the earlier values.
+    ++zone.n_values;
+  }
+  write_zone(m_zones.size() - 1, t_fl, t_io);
+}
+
+void ZoneMap::write_zone(std::size_t t_idx, FreeList& t_fl,
+                         std::iostream& t_io) {
+  const auto page_idx = t_idx / ZONES_PER_PAGE;
+  const auto slot = t_idx % ZONES_PER_PAGE;
+  if (page_idx == m_pages.size()) {
+    auto meta = t_fl.allocate_page<ZoneMapPageMeta>(t_io);
+    if (!m_pages.empty()) {
+      auto prev = internal::read_from<ZoneMapPageMeta>(m_pages.back(), t_io);
+      prev.update_next_pg(meta.get_pg_num());
+      internal::write_to(prev, t_io);
+    }
+    m_pages.push_back(meta.get_pg_num());
+  }
+  const auto pg = m_pages[page_idx];
+  auto meta = internal::read_from<ZoneMapPageMeta>(pg, t_io);
+  if (meta.get_n_zones() <= slot) {
+    meta.update_n_zones(static_cast<ZoneMapPageMeta::n_zones_t>(slot + 1));
+    internal::write_to(meta, t_io);
+  }
+  const auto& zone = m_zones[t_idx];
+  t_io.seekp(zone_pos(pg, slot));
+  auto& rdbuf = *t_io.rdbuf();
+  rdbuf.sputn(std::bit_cast<const char*>(&zone.pg), sizeof(zone.pg));
+  rdbuf.sputn(std::bit_cast<const char*>(&zone.n_values),
+              sizeof(zone.n_values));
+  rdbuf.sputn(std::bit_cast<const char*>(&zone.n_nulls), sizeof(zone.n_nulls));
+  rdbuf.sputn(zone.min.data(), Zone::KEY_SIZE);
+  rdbuf.sputn(zone.max.data(), Zone::KEY_SIZE);
+}
+
+auto ZoneMap::may_match(column::ColType t_type, const Zone& t_zone,
+                        const ColumnFilter& t_filter) -> bool {
+  // a NULL never matches.
+  if (t_zone.all_null()) {
+    return false;
+  }
+  auto key = key_of(t_filter.value);
+  const int lo = compare_keys(t_type, t_zone.min, key);
+  const int hi = compare_keys(t_type, t_zone.max, key);
+  if (column::is_text(t_type)) {
+    // only prefixes: a string greater than the constant may still have the
+    // same prefix, so strict comparisons can't be trusted.
+    switch (t_filter.op) {
+    case CmpOp::Eq:
+      return lo <= 0 && hi >= 0;
+    case CmpOp::Lt:
+    case CmpOp::Le:
+      return lo <= 0;
+    case CmpOp::Gt:
+    case CmpOp::Ge:
+      return hi >= 0;
+    default:
+      return true;
+    }
+  }
+  switch (t_filter.op) {
+  case CmpOp::Eq:
+    return lo <= 0 && hi >= 0;
+  case CmpOp::Ne:
+    return lo != 0 || hi != 0;
+  case CmpOp::Lt:
+    return lo < 0;
+  case CmpOp::Le:
+    return lo <= 0;
+  case CmpOp::Gt:
+    return hi > 0;
+  case CmpOp::Ge:
+    return hi >= 0;
+  default:
+    std::unreachable();
+  }
+}
+
+} // namespace tinydb::dbfile::internal
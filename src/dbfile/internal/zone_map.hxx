@@ -0,0 +1,153 @@
+/**
+ * @file zone_map.hxx
+ * @brief Declares zone maps: per-page summaries of a column, which let scans
+ * skip pages that can't match a filter.
+ *
+ * A zone is the smallest and largest value of one data page of a column,
+ * plus how many of its values are NULL. A filter like `qty < 5` can't match
+ * anything in a page whose smallest qty is 10, so a scan that checks the zone
+ * first never reads that page. On data that's more or less sorted (dates,
+ * IDs, anything appended in order), that's most pages.
+ *
+ * Zones are kept apart from the pages they summarize, in their own chain of
+ * pages per column:
+ * - offset 0: the ZoneMapPageMeta.
+ * - offset 7: the zones, `ZONE_SIZE` bytes each: 4 bytes, the data page; 2
+ *   bytes, its number of values; 2 bytes, its number of NULLs; `KEY_SIZE`
+ *   bytes, the minimum; `KEY_SIZE` bytes, the maximum.
+ *
+ * That's 170 zones per page, so scanning the zones of a column costs about
+ * one page read every 170 data pages, and they're small enough to be kept in
+ * memory as a whole.
+ *
+ * Numbers are stored as they are, zero-padded to `KEY_SIZE`. Strings (Text
+ * and CharN) only keep their first `KEY_SIZE` bytes: the minimum and maximum
+ * are then only bounds, so a string filter can only skip a page based on
+ * ordering, never on `Ne`.
+ *
+ * Zones only ever widen: values can be added to a zone, not removed from it.
+ * A zone that's too wide is still correct, just less useful.
+ */
+
+#ifndef TINYDB_DBFILE_INTERNAL_ZONE_MAP_HXX
+#define TINYDB_DBFILE_INTERNAL_ZONE_MAP_HXX
+
+#include "tinydb_export.h"
+#ifndef ENABLE_MODULES
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/page_base.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <string_view>
+#include <vector>
+#endif // !ENABLE_MODULES
+
+#ifdef ENABLE_MODULES
+export namespace tinydb::dbfile::internal {
+#else
+namespace tinydb::dbfile::internal {
+#endif // ENABLE_MODULES
+
+/**
+ * @class Zone
+ * @brief The summary of one data page.
+ */
+struct TINYDB_EXPORT Zone {
+  static constexpr std::size_t KEY_SIZE = 8;
+  using key_t = std::array<char, KEY_SIZE>;
+
+  page_ptr_t pg;
+  uint16_t n_values;
+  uint16_t n_nulls;
+  // meaningless while every value is NULL.
+  key_t min;
+  key_t max;
+
+  [[nodiscard]] auto all_null() const noexcept -> bool {
+    return n_nulls == n_values;
+  }
+};
+
+/**
+ * @class ZoneMap
+ * @brief The zones of every data page of one column, in page order.
+ */
+class TINYDB_EXPORT ZoneMap {
+public:
+  static constexpr std::size_t ZONE_SIZE = sizeof(page_ptr_t) +
+                                           (2 * sizeof(uint16_t)) +
+                                           (2 * Zone::KEY_SIZE);
+  static constexpr std::size_t ZONES_PER_PAGE =
+      (SIZEOF_PAGE - ZoneMapPageMeta::DEFAULT_FREE_OFF) / ZONE_SIZE;
+
+  /**
+   * @brief An empty zone map. No page is allocated until a zone is added.
+   */
+  explicit ZoneMap(column::ColType t_type) : m_type{t_type} {}
+
+  /**
+   * @brief Reads every zone of a column.
+   * @param t_first The first page of zones, as returned by `first_page`.
+   */
+  static auto read_from(column::ColType t_type, page_ptr_t t_first,
+                        std::istream& t_in) -> ZoneMap;
+
+  /**
+   * @return The first page of zones, NULL_PAGE if there's no zone yet.
+   */
+  [[nodiscard]] auto first_page() const noexcept -> page_ptr_t {
+    return m_pages.empty() ? NULL_PAGE : m_pages.front();
+  }
+
+  [[nodiscard]] auto zones() const noexcept -> std::span<const Zone> {
+    return m_zones;
+  }
+
+  /**
+   * @brief Records that some values were added to a data page, and writes
+   * the updated zone.
+   *
+   * Pages must be added in order: if `t_pg` isn't the page of the last zone,
+   * it gets a new zone after it.
+   *
+   * @param t_col The values, `[t_from, t_from + t_count)` of which were added.
+   */
+  void add(page_ptr_t t_pg, const ColumnVector& t_col, std::size_t t_from,
+           std::size_t t_count, FreeList& t_fl, std::iostream& t_io);
+
+  /**
+   * @param t_type The type of the zone's column.
+   * @return false if no value of the page of a zone can match a filter,
+   * true if some might.
+   */
+  [[nodiscard]] static auto may_match(column::ColType t_type,
+                                      const Zone& t_zone,
+                                      const ColumnFilter& t_filter) -> bool;
+
+  /**
+   * @brief Compares the mins or maxes of two zones of a column of type
+   * `t_type`. Text only compares prefixes, so two different strings may
+   * compare equal.
+   * @return Negative, zero or positive, like `memcmp`.
+   */
+  [[nodiscard]] static auto compare_keys(column::ColType t_type,
+                                         const Zone::key_t& t_lhs,
+                                         const Zone::key_t& t_rhs) -> int;
+
+private:
+  column::ColType m_type;
+  std::vector<Zone> m_zones;
+  std::vector<page_ptr_t> m_pages;
+
+  static auto key_of(std::string_view t_val) -> Zone::key_t;
+  void write_zone(std::size_t t_idx, FreeList& t_fl, std::iostream& t_io);
+};
+
+} // namespace tinydb::dbfile::internal
+
+#endif // !TINYDB_DBFILE_INTERNAL_ZONE_MAP_HXX
@@ -1,3 +1,266 @@
+#include "offsets.hxx"
+#include "sizes.hxx"
+#include <gtest/gtest.h>
 #ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
 import tinydb.dbfile;
+import tinydb.dbfile.internal.page;
+import tinydb.dbfile.internal.tbl;
+import tinydb.dbfile.internal.text;
+#else
+#include "dbfile/dbfile.hxx"
+#include "dbfile/internal/page_meta.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "dbfile/internal/text.hxx"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 #endif // ENABLE_MODULES
+
+TEST(dbfile, tables) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  // NOLINTBEGIN(*magic-number*)
+  // outlives every DbFile opened on it.
+  std::stringbuf buf{std::string(SIZEOF_PAGE * 8, '\0')};
+  auto open = [&] {
+    return DbFile::construct_from(std::make_unique<std::iostream>(&buf));
+  };
+  {
+    auto file = DbFile::create(std::make_unique<std::iostream>(&buf));
+    for (const auto* name : {"users", "orders"}) {
+      internal::TableMeta tbl{name};
+      ASSERT_TRUE(tbl.add_column(
+          internal::ColumnMeta{.m_name{"id"},
+                               .m_type = column::ColType::Uint32,
+                               .m_col_id = 1,
+                               .m_offset = 0}));
+      ASSERT_TRUE(file.add_table(std::move(tbl)));
+    }
+    ASSERT_FALSE(file.add_table(internal::TableMeta{"users"}));
+  }
+  auto file = open();
+  ASSERT_EQ(file.table_names(),
+            (std::vector<std::string_view>{"orders", "users"}));
+  const auto* users = file.find_table("users");
+  ASSERT_NE(users, nullptr);
+  ASSERT_TRUE(users->column_pos("id").has_value());
+  ASSERT_EQ(file.find_table("nope"), nullptr);
+  // NOLINTEND(*magic-number*)
+}
+
+namespace {
+
+/**
+ * @brief A stringbuf that counts the pages the cache reads out of it.
+ */
+class CountingBuf : public std::stringbuf {
+public:
+  using std::stringbuf::stringbuf;
+  int m_reads{0};
+
+protected:
+  auto seekpos(pos_type t_pos, std::ios_base::openmode t_which)
+      -> pos_type override {
+    if (t_which == std::ios_base::in) {
+      ++m_reads;
+    }
+    return std::stringbuf::seekpos(t_pos, t_which);
+  }
+};
+
+} // namespace
+
+TEST(dbfile, header) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  // NOLINTBEGIN(*magic-number*)
+  CountingBuf buf{std::string(SIZEOF_PAGE * 8, '\0')};
+  auto open = [&] {
+    return DbFile::construct_from(std::make_unique<std::iostream>(&buf));
+  };
+  {
+    auto file = DbFile::create(std::make_unique<std::iostream>(&buf));
+    for (const auto* name : {"a", "b", "c"}) {
+      ASSERT_TRUE(file.add_table(internal::TableMeta{name}));
+    }
+  }
+  // opening reads the header page, and nothing else.
+  buf.m_reads = 0;
+  {
+    auto file = open();
+    ASSERT_EQ(buf.m_reads, 1);
+    ASSERT_EQ(file.table_names().size(), 3);
+    ASSERT_EQ(buf.m_reads, 2);
+  }
+
+  auto flip = [&](std::streamoff t_off) {
+    auto bytes = buf.str();
+    bytes[static_cast<std::size_t>(t_off)] ^= 1;
+    buf.str(bytes);
+  };
+  // any header byte, checksum included.
+  for (std::streamoff off = 0; off < HEADER_SIZE; ++off) {
+    flip(off);
+    ASSERT_THROW(open(), std::ios_base::failure);
+    flip(off);
+  }
+  ASSERT_NO_THROW(open());
+
+  // a broken catalog is only found once it's read.
+  std::uint32_t catalog{0};
+  buf.str().copy(std::bit_cast<char*>(&catalog), sizeof(catalog),
+                 CATALOG_PTR_OFF);
+  // the length of the first name.
+  flip((static_cast<std::streamoff>(catalog) * SIZEOF_PAGE) +
+       internal::CatalogPageMeta::DATA_OFF + 2);
+  auto file = open();
+  ASSERT_THROW(file.table_names(), std::ios_base::failure);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(dbfile, threads) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int n_tables = 8;
+  std::stringbuf buf{std::string(SIZEOF_PAGE * 32, '\0')};
+  {
+    auto file = DbFile::create(std::make_unique<std::iostream>(&buf));
+    for (int i = 0; i < n_tables; ++i) {
+      internal::TableMeta tbl{"t" + std::to_string(i)};
+      ASSERT_TRUE(tbl.add_column(
+          internal::ColumnMeta{.m_name{"c" + std::to_string(i)},
+                               .m_type = column::ColType::Uint32,
+                               .m_col_id = 1,
+                               .m_offset = 0}));
+      ASSERT_TRUE(file.add_table(std::move(tbl)));
+    }
+  }
+  // tables get decoded lazily, by whichever thread asks first.
+  auto file = DbFile::construct_from(std::make_unique<std::iostream>(&buf));
+  std::vector<int> failures(n_tables, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_tables; ++t) {
+    threads.emplace_back([&, t] {
+      // one page each, written through a stream of its own.
+      auto io = file.open_stream();
+      auto pos = static_cast<std::streamoff>(20 + t) * SIZEOF_PAGE;
+      for (int round = 0; round < 50; ++round) {
+        auto i = std::to_string(round % n_tables);
+        const auto* tbl = file.find_table("t" + i);
+        if (tbl == nullptr || !tbl->column_pos("c" + i).has_value()) {
+          ++failures[t];
+        }
+        failures[t] += file.table_names().size() == n_tables ? 0 : 1;
+        io->seekp(pos + round);
+        io->put(static_cast<char>('a' + t));
+        io->seekg(pos);
+        failures[t] += io->get() == 'a' + t ? 0 : 1;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < n_tables; ++t) {
+    ASSERT_EQ(failures[t], 0) << "thread " << t;
+  }
+  file.flush();
+  ASSERT_EQ(buf.str().substr((20 + 3) * SIZEOF_PAGE, 50), std::string(50, 'd'));
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(dbfile, heap) {
+  using namespace tinydb;
+  using namespace tinydb::dbfile;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int n_threads = 4;
+  static constexpr int n_texts = 20;
+  std::stringbuf buf{std::string(SIZEOF_PAGE * 64, '\0')};
+  std::vector<std::vector<column::TextSlot>> slots(n_threads);
+  auto text_of = [](int t_thread, int t_i) {
+    return std::string(100 + t_i, static_cast<char>('a' + t_thread));
+  };
+  auto run = [&](DbFile& t_file, auto t_fn) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+      threads.emplace_back([&, t] {
+        auto io = t_file.open_stream();
+        t_fn(*io, t);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  auto write_all = [&](DbFile& t_file) {
+    run(t_file, [&](std::iostream& t_io, int t_thread) {
+      for (int i = 0; i < n_texts; ++i) {
+        slots[t_thread].push_back(internal::write_text(
+            text_of(t_thread, i), t_file.heap(), t_file.freelist(), t_io));
+      }
+    });
+  };
+  auto n_pages = [&] {
+    std::uint32_t ret{0};
+    buf.str().copy(std::bit_cast<char*>(&ret), sizeof(ret), DBFILE_SIZE_OFF);
+    return ret;
+  };
+  {
+    auto file = DbFile::create(std::make_unique<std::iostream>(&buf));
+    ASSERT_EQ(file.heap().n_arenas(),
+              std::max(std::thread::hardware_concurrency(), 1U));
+    write_all(file);
+  }
+  // opening, and closing right away, leaves the file as it was.
+  const auto written = buf.str();
+  {
+    auto file = DbFile::construct_from(std::make_unique<std::iostream>(&buf));
+  }
+  ASSERT_EQ(buf.str(), written);
+
+  // every arena's pages are known again: any thread frees any text, and the
+  // space is reused rather than taken from new pages.
+  auto file = DbFile::construct_from(std::make_unique<std::iostream>(&buf));
+  const auto pages = n_pages();
+  run(file, [&](std::iostream& t_io, int t_thread) {
+    const auto owner = (t_thread + 1) % n_threads;
+    for (int i = 0; i < n_texts; ++i) {
+      const auto& slot = slots[owner][i];
+      ASSERT_EQ(internal::read_text(slot, t_io), text_of(owner, i));
+      internal::free_text(slot, file.heap(), file.freelist(), t_io);
+    }
+  });
+  for (auto& mine : slots) {
+    mine.clear();
+  }
+  write_all(file);
+  file.flush();
+  ASSERT_EQ(n_pages(), pages);
+  // NOLINTEND(*magic-number*)
+}
@@ -16,7 +16,14 @@ constexpr uint16_t DBFILE_SIZE_OFF =
 constexpr uint16_t FREELIST_PTR_OFF = DBFILE_SIZE_OFF + SIZEOF_FILESIZ; // 10
 constexpr uint16_t HEAP_OFF = FREELIST_PTR_OFF + SIZEOF_FREELIST_PTR;   // 14
 constexpr uint16_t TBL_OFF = HEAP_OFF + SIZEOF_HEAP;                    // 18
-// The BTree offset should be right after the table.
+// The first page of the catalog (see dbfile/internal/catalog), where a file
+// used to keep its only table.
+constexpr uint16_t CATALOG_PTR_OFF = TBL_OFF; // 18
+// A checksum of every field before it (see dbfile/internal/header).
+constexpr uint16_t HEADER_CHECKSUM_OFF =
+    CATALOG_PTR_OFF + SIZEOF_CATALOG_PTR; // 22
+constexpr uint16_t HEADER_SIZE =
+    HEADER_CHECKSUM_OFF + SIZEOF_HEADER_CHECKSUM; // 26
 
 }; // namespace tinydb
 
@@ -11,6 +11,8 @@ constexpr uint16_t SIZEOF_FILESIZ = 4;
 constexpr uint16_t SIZEOF_FREELIST_PTR = 4;
 constexpr uint16_t SIZEOF_HEAP = 4;
 constexpr uint16_t SIZEOF_BTREE_ROOT_PTR = 4;
+constexpr uint16_t SIZEOF_CATALOG_PTR = 4;
+constexpr uint16_t SIZEOF_HEADER_CHECKSUM = 4;
 
 } // namespace tinydb
 
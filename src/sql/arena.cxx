@@ -0,0 +1,45 @@
+#include "arena.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <numeric>
+
+namespace tinydb {
+
+void Arena::reset() noexcept {
+  m_block = 0;
+  if (m_blocks.empty()) {
+    return;
+  }
+  m_ptr = m_blocks.front().data.get();
+  m_end = m_ptr + m_blocks.front().size;
+}
+
+auto Arena::capacity() const noexcept -> std::size_t {
+  return std::accumulate(
+      m_blocks.begin(), m_blocks.end(), std::size_t{0},
+      [](std::size_t t_sum, const Block& t_blk) { return t_sum + t_blk.size; });
+}
+
+auto Arena::next_block(std::size_t t_size, std::size_t t_align) -> void* {
+  // enough for any padding, even in a block of its own.
+  const auto needed = t_size + t_align - 1;
+  // the current block is skipped even if it still has room: it's only a
+  // few bytes, and it keeps the allocations in order.
+  auto idx = m_ptr == nullptr ? 0 : m_block + 1;
+  while (idx < m_blocks.size() && m_blocks[idx].size < needed) {
+    ++idx;
+  }
+  if (idx == m_blocks.size()) {
+    auto size = std::max(BLOCK_SIZE, needed);
+    // NOLINTNEXTLINE(*avoid-c-arrays*)
+    m_blocks.push_back(Block{std::make_unique_for_overwrite<std::byte[]>(size),
+                             size});
+  }
+  m_block = idx;
+  m_ptr = m_blocks[idx].data.get();
+  m_end = m_ptr + m_blocks[idx].size;
+  return allocate(t_size, t_align);
+}
+
+} // namespace tinydb
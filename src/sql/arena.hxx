@@ -0,0 +1,115 @@
+/**
+ * @file arena.hxx
+ * @brief A bump allocator for things that all die together, like the nodes
+ * of the syntax tree of a statement.
+ *
+ * Allocating is moving a pointer forward in the current block. Nothing is
+ * ever freed on its own: `reset` makes the whole arena available again in
+ * O(1), and keeps the blocks for the next statement. Since nothing is
+ * destroyed either, only trivially destructible types can live in an arena.
+ */
+
+#ifndef TINYDB_ARENA_HXX
+#define TINYDB_ARENA_HXX
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tinydb {
+
+/**
+ * @class Arena
+ * @brief Memory for objects that are released all at once.
+ */
+class Arena {
+  public:
+    static constexpr std::size_t BLOCK_SIZE = std::size_t{16} * 1024;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena(Arena&&) noexcept = default;
+    auto operator=(const Arena&) -> Arena& = delete;
+    auto operator=(Arena&&) noexcept -> Arena& = default;
+    ~Arena() = default;
+
+    /**
+     * @brief Constructs a `T` in the arena. It lives until the next
+     * `reset`.
+     */
+    template <typename T, typename... Args>
+    auto make(Args&&... t_args) -> T* {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return std::construct_at(
+            static_cast<T*>(allocate(sizeof(T), alignof(T))),
+            std::forward<Args>(t_args)...);
+    }
+
+    /**
+     * @brief Copies `t_src` into the arena.
+     */
+    template <typename T>
+    auto copy(std::span<const T> t_src) -> std::span<const T> {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (t_src.empty()) {
+            return {};
+        }
+        auto* ret = static_cast<T*>(allocate(t_src.size_bytes(), alignof(T)));
+        std::memcpy(ret, t_src.data(), t_src.size_bytes());
+        return {ret, t_src.size()};
+    }
+
+    /**
+     * @brief Uninitialized memory, until the next `reset`.
+     */
+    [[nodiscard]] auto allocate(std::size_t t_size, std::size_t t_align)
+        -> void* {
+        auto addr = std::bit_cast<std::uintptr_t>(m_ptr);
+        auto pad = (t_align - (addr % t_align)) % t_align;
+        if (m_ptr == nullptr ||
+            pad + t_size > static_cast<std::size_t>(m_end - m_ptr)) {
+            return next_block(t_size, t_align);
+        }
+        auto* ret = m_ptr + pad;
+        m_ptr = ret + t_size;
+        return ret;
+    }
+
+    /**
+     * @brief Forgets everything allocated so far. The memory is kept.
+     */
+    void reset() noexcept;
+
+    /**
+     * @return How many bytes the arena holds on to.
+     */
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t;
+
+  private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data; // NOLINT(*avoid-c-arrays*)
+        std::size_t size;
+    };
+
+    std::vector<Block> m_blocks{};
+    // the block that `m_ptr` points into.
+    std::size_t m_block{0};
+    std::byte* m_ptr{nullptr};
+    std::byte* m_end{nullptr};
+
+    /**
+     * @brief The slow path of `allocate`: moves on to the next block big
+     * enough, and makes one if there's none.
+     */
+    auto next_block(std::size_t t_size, std::size_t t_align) -> void*;
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_ARENA_HXX
@@ -0,0 +1,173 @@
+/**
+ * @file ast.hxx
+ * @brief The syntax tree of a statement, as built by the Parser.
+ *
+ * Nodes are plain structs allocated in the Arena of the statement, and they
+ * point to each other with raw pointers and spans: dropping a tree is
+ * resetting its arena. Names and strings are views into the input of the
+ * Tokenizer, which must outlive the tree too.
+ *
+ * Optional parts of a statement are null pointers or empty spans.
+ */
+
+#ifndef TINYDB_AST_HXX
+#define TINYDB_AST_HXX
+
+#include "tokenizer.hxx"
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <variant>
+
+namespace tinydb {
+
+// expressions
+enum class BinaryOp : uint8_t {
+    Or,
+    And,
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    Add,
+    Sub,
+    Mul,
+    Div,
+};
+
+enum class UnaryOp : uint8_t {
+    Not,
+    Neg,
+    IsNull,
+    IsNotNull,
+};
+
+struct Expr;
+
+/**
+ * @brief `name`, or `table.name`.
+ */
+struct ColumnRef {
+    std::string_view table;
+    std::string_view name;
+};
+
+struct NullValue {};
+
+/**
+ * @brief A `?`, numbered from 0 in the order they appear in the statement.
+ */
+struct Param {
+    uint32_t idx;
+};
+
+struct Unary {
+    UnaryOp op;
+    const Expr* operand;
+};
+
+struct Binary {
+    BinaryOp op;
+    const Expr* lhs;
+    const Expr* rhs;
+};
+
+/**
+ * @brief A function call, like `COUNT(*)`. `star` is set for the `*`, and
+ * then there are no arguments.
+ */
+struct Call {
+    std::string_view name;
+    std::span<const Expr* const> args;
+    bool star;
+};
+
+struct Expr {
+    std::variant<ColumnRef, Literal, NullValue, Param, Unary, Binary, Call>
+        node;
+};
+
+// statements
+struct SelectItem {
+    const Expr* expr;
+    std::string_view alias;
+};
+
+struct OrderItem {
+    const Expr* expr;
+    bool desc;
+};
+
+/**
+ * @brief `[INNER] JOIN table ON condition`.
+ */
+struct JoinClause {
+    std::string_view table;
+    const Expr* on;
+};
+
+/**
+ * @brief `SELECT items FROM table JOIN .. WHERE .. GROUP BY .. ORDER BY ..
+ * LIMIT .. OFFSET ..`.
+ * No items is `SELECT *`.
+ */
+struct Select {
+    std::span<const SelectItem> items;
+    std::string_view table;
+    std::span<const JoinClause> joins;
+    const Expr* where;
+    std::span<const Expr* const> group_by;
+    std::span<const OrderItem> order_by;
+    const Expr* limit;
+    const Expr* offset;
+};
+
+/**
+ * @brief `INSERT INTO table (columns) VALUES (..), (..)`. No columns is
+ * every column, in order.
+ */
+struct Insert {
+    std::string_view table;
+    std::span<const std::string_view> columns;
+    std::span<const std::span<const Expr* const>> rows;
+};
+
+struct Assignment {
+    std::string_view column;
+    const Expr* value;
+};
+
+struct Update {
+    std::string_view table;
+    std::span<const Assignment> set;
+    const Expr* where;
+};
+
+struct Delete {
+    std::string_view table;
+    const Expr* where;
+};
+
+/**
+ * @brief `name type`, `name type(length)`, then maybe `PRIMARY KEY`. The
+ * type is left as written: what it means is up to the storage.
+ */
+struct ColumnDef {
+    std::string_view name;
+    std::string_view type;
+    uint32_t length;
+    bool primary_key;
+};
+
+struct CreateTable {
+    std::string_view name;
+    std::span<const ColumnDef> columns;
+};
+
+using Statement = std::variant<Select, Insert, Update, Delete, CreateTable>;
+
+} // namespace tinydb
+
+#endif // !TINYDB_AST_HXX
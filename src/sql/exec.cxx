@@ -0,0 +1,1843 @@
+#include "exec.hxx"
+#include "ast.hxx"
+#include "hash_agg.hxx"
+#include "join.hxx"
+#include "scheduler.hxx"
+#include "sort.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_store;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.tbl;
+import tinydb.dbfile.internal.zone_map;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_store.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/tbl.hxx"
+#include "dbfile/internal/zone_map.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace tinydb {
+
+using dbfile::column::ColType;
+using dbfile::internal::CmpOp;
+using dbfile::internal::ColumnFilter;
+using dbfile::internal::ColumnStore;
+using dbfile::internal::ColumnVector;
+
+auto Catalog::add(TableRef t_tbl) -> bool {
+  if (find(t_tbl.meta->get_name()) != nullptr) {
+    return false;
+  }
+  m_tables.push_back(t_tbl);
+  m_version = next_version();
+  return true;
+}
+
+auto Catalog::find(std::string_view t_name) const -> const TableRef* {
+  auto it = std::ranges::find_if(m_tables, [&](const TableRef& t_tbl) {
+    return t_tbl.meta->get_name() == t_name;
+  });
+  return it == m_tables.end() ? nullptr : &*it;
+}
+
+auto Catalog::next_version() noexcept -> uint64_t {
+  // shared by every catalog, so that a statement compiled against one is
+  // never taken as current for another.
+  static std::atomic<uint64_t> s_next{0};
+  return ++s_next;
+}
+
+namespace {
+
+/**
+ * @brief Calls `t_fn(row)` for every row of the batch that is selected.
+ */
+template <typename Fn> void for_each_row(const Batch& t_batch, Fn t_fn) {
+  if (t_batch.selective) {
+    for (auto row : t_batch.sel) {
+      t_fn(row);
+    }
+  } else {
+    for (std::size_t row = 0; row < t_batch.n_rows; ++row) {
+      t_fn(row);
+    }
+  }
+}
+
+/**
+ * @brief Reads the columns of a table a query needs, all of its rows or only
+ * one range of them at a time.
+ */
+class ScanOp final : public Operator {
+public:
+  ScanOp(const TableRef& t_tbl, std::istream& t_in,
+         std::span<const std::size_t> t_cols,
+         std::optional<ColumnFilter> t_filter)
+      : m_store{t_tbl.store}, m_in{&t_in}, m_cols{t_cols.begin(), t_cols.end()},
+        m_filter{std::move(t_filter)}, m_scanner{start()},
+        m_vecs{m_scanner.make_batch()} {}
+
+  /**
+   * @brief Starts over, with only the rows of a range.
+   */
+  void reset(ColumnStore::RowRange t_range) {
+    m_scanner = start();
+    m_scanner.restrict_to(t_range);
+  }
+
+  auto next(Batch& t_out) -> bool override {
+    auto n = m_scanner.next(m_vecs);
+    if (n == 0) {
+      return false;
+    }
+    t_out.cols.clear();
+    for (const auto& vec : m_vecs) {
+      t_out.cols.push_back(&vec);
+    }
+    t_out.n_rows = n;
+    t_out.selective = false;
+    t_out.sel.clear();
+    return true;
+  }
+
+private:
+  const ColumnStore* m_store;
+  std::istream* m_in;
+  std::vector<std::size_t> m_cols;
+  std::optional<ColumnFilter> m_filter;
+  ColumnStore::Scanner m_scanner;
+  std::vector<ColumnVector> m_vecs;
+
+  auto start() -> ColumnStore::Scanner {
+    return m_filter ? m_store->scan(m_cols, *m_filter, *m_in)
+                    : m_store->scan(m_cols, *m_in);
+  }
+};
+
+/**
+ * @brief The single row without columns a SELECT without FROM runs on.
+ */
+class OneRowOp final : public Operator {
+public:
+  auto next(Batch& t_out) -> bool override {
+    if (m_done) {
+      return false;
+    }
+    m_done = true;
+    t_out.cols.clear();
+    t_out.n_rows = 1;
+    t_out.selective = false;
+    t_out.sel.clear();
+    return true;
+  }
+
+private:
+  bool m_done{false};
+};
+
+class FilterOp final : public Operator {
+public:
+  FilterOp(std::unique_ptr<Operator> t_child, VectorExpr t_pred)
+      : m_child{std::move(t_child)}, m_pred{std::move(t_pred)} {}
+
+  auto next(Batch& t_out) -> bool override {
+    while (m_child->next(t_out)) {
+      const auto& res = m_pred.eval(t_out);
+      const auto* vals = res.data.data();
+      const auto* nulls = res.nulls.data();
+      auto keep = [&](std::size_t t_row) -> std::size_t {
+        return static_cast<std::size_t>((vals[t_row] != 0) &
+                                        (nulls[t_row] == 0));
+      };
+      // writes every row, but only moves past the ones kept: no branch.
+      std::size_t n{0};
+      if (t_out.selective) {
+        for (auto row : t_out.sel) {
+          t_out.sel[n] = row;
+          n += keep(row);
+        }
+      } else {
+        t_out.sel.resize(t_out.n_rows);
+        for (std::size_t row = 0; row < t_out.n_rows; ++row) {
+          t_out.sel[n] = static_cast<uint32_t>(row);
+          n += keep(row);
+        }
+        t_out.selective = true;
+      }
+      t_out.sel.resize(n);
+      if (n != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  std::unique_ptr<Operator> m_child;
+  VectorExpr m_pred;
+};
+
+class ProjectOp final : public Operator {
+public:
+  ProjectOp(std::unique_ptr<Operator> t_child, std::vector<VectorExpr> t_exprs)
+      : m_child{std::move(t_child)}, m_exprs{std::move(t_exprs)} {}
+
+  auto next(Batch& t_out) -> bool override {
+    if (!m_child->next(m_in)) {
+      return false;
+    }
+    t_out.cols.clear();
+    for (auto& expr : m_exprs) {
+      t_out.cols.push_back(&expr.eval(m_in));
+    }
+    t_out.n_rows = m_in.n_rows;
+    t_out.selective = m_in.selective;
+    t_out.sel = m_in.sel;
+    return true;
+  }
+
+private:
+  std::unique_ptr<Operator> m_child;
+  std::vector<VectorExpr> m_exprs;
+  Batch m_in{};
+};
+
+auto agg_kind(const Call& t_call) -> std::optional<AggKind> {
+  auto is = [&](std::string_view t_name) {
+    return std::ranges::equal(t_call.name, t_name, [](char t_a, char t_b) {
+      return std::toupper(static_cast<unsigned char>(t_a)) == t_b;
+    });
+  };
+  if (is("COUNT")) {
+    return t_call.star ? AggKind::CountStar : AggKind::Count;
+  }
+  if (t_call.star) {
+    return std::nullopt;
+  }
+  if (is("SUM")) {
+    return AggKind::Sum;
+  }
+  if (is("MIN")) {
+    return AggKind::Min;
+  }
+  if (is("MAX")) {
+    return AggKind::Max;
+  }
+  if (is("AVG")) {
+    return AggKind::Avg;
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief One aggregate, and its running state.
+ */
+struct Agg {
+  AggKind kind;
+  // not for COUNT(*).
+  std::optional<VectorExpr> arg;
+  // non-NULL values seen so far.
+  int64_t count{0};
+  int64_t isum{0};
+  double fsum{0};
+  // MIN and MAX: the best value so far, once `count` isn't 0.
+  ColumnVector best;
+
+  [[nodiscard]] auto out_type() const -> VType {
+    switch (kind) {
+    case AggKind::CountStar:
+    case AggKind::Count:
+      return VType::Int;
+    case AggKind::Avg:
+      return VType::Float;
+    default:
+      return arg->type();
+    }
+  }
+};
+
+template <typename T, typename Better>
+void fold_best(Agg& t_agg, const ColumnVector& t_vals, const Batch& t_batch,
+               Better t_better) {
+  const auto* vals = t_vals.values<T>().data();
+  T best = t_agg.count == 0 ? T{} : t_agg.best.values<T>()[0];
+  bool any = t_agg.count != 0;
+  for_each_row(t_batch, [&](std::size_t t_row) {
+    if (t_vals.is_null(t_row)) {
+      return;
+    }
+    if (!any || t_better(vals[t_row], best)) {
+      best = vals[t_row];
+    }
+    any = true;
+  });
+  if (any) {
+    t_agg.best.clear();
+    t_agg.best.push(best);
+  }
+}
+
+/**
+ * @brief Adds the selected rows of a batch to an aggregate.
+ */
+void update(Agg& t_agg, const Batch& t_batch) {
+  if (t_agg.kind == AggKind::CountStar) {
+    t_agg.count += static_cast<int64_t>(t_batch.size());
+    return;
+  }
+  const auto& vals = t_agg.arg->eval(t_batch);
+  const auto type = t_agg.arg->type();
+  switch (t_agg.kind) {
+  case AggKind::Min:
+  case AggKind::Max: {
+    const bool max = t_agg.kind == AggKind::Max;
+    if (type == VType::Int) {
+      fold_best<int64_t>(t_agg, vals, t_batch, [=](int64_t t_a, int64_t t_b) {
+        return max ? t_a > t_b : t_a < t_b;
+      });
+    } else if (type == VType::Float) {
+      fold_best<double>(t_agg, vals, t_batch, [=](double t_a, double t_b) {
+        return max ? t_a > t_b : t_a < t_b;
+      });
+    } else if (type == VType::Bool) {
+      fold_best<uint8_t>(t_agg, vals, t_batch, [=](uint8_t t_a, uint8_t t_b) {
+        return max ? t_a > t_b : t_a < t_b;
+      });
+    } else {
+      for_each_row(t_batch, [&](std::size_t t_row) {
+        if (vals.is_null(t_row)) {
+          return;
+        }
+        auto str = vals.text(t_row);
+        if (t_agg.count == 0 ||
+            (max ? str > t_agg.best.text(0) : str < t_agg.best.text(0))) {
+          t_agg.best.clear();
+          t_agg.best.push_text(str);
+        }
+        ++t_agg.count;
+      });
+      return;
+    }
+    break;
+  }
+  case AggKind::Sum:
+  case AggKind::Avg:
+    if (type == VType::Int) {
+      const auto* ints = vals.values<int64_t>().data();
+      for_each_row(t_batch, [&](std::size_t t_row) {
+        const auto val = vals.is_null(t_row) ? 0 : ints[t_row];
+        t_agg.isum = static_cast<int64_t>(static_cast<uint64_t>(t_agg.isum) +
+                                          static_cast<uint64_t>(val));
+        t_agg.fsum += static_cast<double>(val);
+      });
+    } else {
+      const auto* dbls = vals.values<double>().data();
+      for_each_row(t_batch, [&](std::size_t t_row) {
+        t_agg.fsum += vals.is_null(t_row) ? 0.0 : dbls[t_row];
+      });
+    }
+    break;
+  default:
+    break;
+  }
+  for_each_row(t_batch, [&](std::size_t t_row) {
+    t_agg.count += static_cast<int64_t>(!vals.is_null(t_row));
+  });
+}
+
+/**
+ * @brief Adds what another thread aggregated to an aggregate.
+ */
+void merge(Agg& t_agg, const Agg& t_other) {
+  if (t_other.count != 0 &&
+      (t_agg.kind == AggKind::Min || t_agg.kind == AggKind::Max)) {
+    auto cmp = dbfile::internal::compare_values(
+        t_agg.best.type, t_other.best.bytes(0),
+        t_agg.count == 0 ? t_other.best.bytes(0) : t_agg.best.bytes(0));
+    if (t_agg.count == 0 || (t_agg.kind == AggKind::Max ? cmp > 0 : cmp < 0)) {
+      t_agg.best.clear();
+      t_agg.best.push_bytes(t_other.best.bytes(0));
+    }
+  }
+  t_agg.count += t_other.count;
+  t_agg.isum = static_cast<int64_t>(static_cast<uint64_t>(t_agg.isum) +
+                                    static_cast<uint64_t>(t_other.isum));
+  t_agg.fsum += t_other.fsum;
+}
+
+void finish(const Agg& t_agg, ColumnVector& t_out) {
+  t_out.clear();
+  switch (t_agg.kind) {
+  case AggKind::CountStar:
+  case AggKind::Count:
+    t_out.push(t_agg.count);
+    return;
+  default:
+    break;
+  }
+  // an aggregate of nothing is NULL, except for COUNT.
+  if (t_agg.count == 0) {
+    t_out.push_null();
+    return;
+  }
+  switch (t_agg.kind) {
+  case AggKind::Sum:
+    if (t_agg.out_type() == VType::Int) {
+      t_out.push(t_agg.isum);
+    } else {
+      t_out.push(t_agg.fsum);
+    }
+    break;
+  case AggKind::Avg:
+    t_out.push(t_agg.fsum / static_cast<double>(t_agg.count));
+    break;
+  default:
+    t_out.push_bytes(t_agg.best.bytes(0));
+    break;
+  }
+}
+
+class AggregateOp final : public Operator {
+public:
+  AggregateOp(std::unique_ptr<Operator> t_child, std::vector<Agg> t_aggs)
+      : m_child{std::move(t_child)}, m_aggs{std::move(t_aggs)} {
+    for (const auto& agg : m_aggs) {
+      m_out.emplace_back(storage_type(agg.out_type()));
+    }
+  }
+
+  auto next(Batch& t_out) -> bool override {
+    if (m_done) {
+      return false;
+    }
+    m_done = true;
+    while (m_child->next(m_in)) {
+      for (auto& agg : m_aggs) {
+        update(agg, m_in);
+      }
+    }
+    t_out.cols.clear();
+    for (std::size_t i = 0; i < m_aggs.size(); ++i) {
+      finish(m_aggs[i], m_out[i]);
+      t_out.cols.push_back(&m_out[i]);
+    }
+    t_out.n_rows = 1;
+    t_out.selective = false;
+    t_out.sel.clear();
+    return true;
+  }
+
+private:
+  std::unique_ptr<Operator> m_child;
+  std::vector<Agg> m_aggs;
+  std::vector<ColumnVector> m_out;
+  Batch m_in{};
+  bool m_done{false};
+};
+
+/**
+ * @brief GROUP BY: reads every row first, then outputs the groups one
+ * partition at a time, in no particular order.
+ */
+class GroupOp final : public Operator {
+public:
+  /**
+   * @param t_out For each output column, a key (its position) or an
+   * aggregate (its position after the keys).
+   */
+  GroupOp(std::unique_ptr<Operator> t_child, std::vector<VectorExpr> t_keys,
+          std::vector<Agg> t_aggs, std::vector<std::size_t> t_out,
+          const Catalog& t_catalog)
+      : m_child{std::move(t_child)}, m_keys{std::move(t_keys)},
+        m_aggs{std::move(t_aggs)}, m_out{std::move(t_out)},
+        m_table{key_types(), specs(), t_catalog.spill(),
+                t_catalog.mem_limit()} {
+    for (const auto& key : m_keys) {
+      m_groups.emplace_back(storage_type(key.type()));
+    }
+    for (const auto& agg : m_aggs) {
+      m_groups.emplace_back(storage_type(agg.out_type()));
+    }
+  }
+
+  auto next(Batch& t_out) -> bool override {
+    if (!m_read) {
+      m_read = true;
+      read_all();
+    }
+    while (m_part < m_table.n_partitions()) {
+      for (auto& col : m_groups) {
+        col.clear();
+      }
+      m_table.emit(m_part++, m_groups);
+      if (m_groups.front().size() == 0) {
+        continue;
+      }
+      t_out.cols.clear();
+      for (auto col : m_out) {
+        t_out.cols.push_back(&m_groups[col]);
+      }
+      t_out.n_rows = m_groups.front().size();
+      t_out.selective = false;
+      t_out.sel.clear();
+      return true;
+    }
+    return false;
+  }
+
+private:
+  std::unique_ptr<Operator> m_child;
+  std::vector<VectorExpr> m_keys;
+  std::vector<Agg> m_aggs;
+  std::vector<std::size_t> m_out;
+  HashAggregator m_table;
+  // the keys then the aggregates of a partition.
+  std::vector<ColumnVector> m_groups;
+  Batch m_in{};
+  bool m_read{false};
+  std::size_t m_part{0};
+
+  [[nodiscard]] auto key_types() const -> std::vector<VType> {
+    std::vector<VType> ret;
+    for (const auto& key : m_keys) {
+      ret.push_back(key.type());
+    }
+    return ret;
+  }
+
+  [[nodiscard]] auto specs() const -> std::vector<AggSpec> {
+    std::vector<AggSpec> ret;
+    for (const auto& agg : m_aggs) {
+      ret.push_back({.kind = agg.kind,
+                     .type = agg.arg ? agg.arg->type() : VType::Int});
+    }
+    return ret;
+  }
+
+  void read_all() {
+    std::vector<const ColumnVector*> keys(m_keys.size());
+    std::vector<const ColumnVector*> args(m_aggs.size());
+    while (m_child->next(m_in)) {
+      for (std::size_t k = 0; k < m_keys.size(); ++k) {
+        keys[k] = &m_keys[k].eval(m_in);
+      }
+      for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+        args[a] = m_aggs[a].arg ? &m_aggs[a].arg->eval(m_in) : nullptr;
+      }
+      m_table.add(m_in, keys, args);
+    }
+  }
+};
+
+/**
+ * @brief One side of a join: where its rows come from, its keys, and the
+ * type of each of its columns.
+ */
+struct JoinSide {
+  std::unique_ptr<Operator> op;
+  std::vector<VectorExpr> keys;
+  std::vector<ColType> types;
+};
+
+/**
+ * @brief Outputs some of the joined rows of a join as a batch.
+ * @param t_out For each output column, its position in `t_rows`.
+ */
+void output_joined(std::span<const ColumnVector> t_rows,
+                   std::span<const std::size_t> t_out, Batch& t_batch) {
+  t_batch.cols.clear();
+  for (auto col : t_out) {
+    t_batch.cols.push_back(&t_rows[col]);
+  }
+  t_batch.n_rows = t_rows.front().size();
+  t_batch.selective = false;
+  t_batch.sel.clear();
+}
+
+auto make_rows(std::span<const ColType> t_lhs, std::span<const ColType> t_rhs)
+    -> std::vector<ColumnVector> {
+  std::vector<ColumnVector> ret;
+  for (auto type : t_lhs) {
+    ret.emplace_back(type);
+  }
+  for (auto type : t_rhs) {
+    ret.emplace_back(type);
+  }
+  return ret;
+}
+
+/**
+ * @brief An equi-join, as a hash join: reads the build side whole first,
+ * then joins the probe side one batch at a time.
+ */
+class HashJoinOp final : public Operator {
+public:
+  /**
+   * @param t_out For each output column, its position among the columns of
+   * the probe side then those of the build side.
+   */
+  HashJoinOp(JoinSide t_probe, JoinSide t_build, std::vector<VType> t_keys,
+             std::vector<std::size_t> t_out, const Catalog& t_catalog)
+      : m_probe{std::move(t_probe)}, m_build{std::move(t_build)},
+        m_out{std::move(t_out)},
+        m_join{std::move(t_keys), m_build.types, m_probe.types,
+               t_catalog.spill(), t_catalog.mem_limit()},
+        m_rows{make_rows(m_probe.types, m_build.types)} {}
+
+  auto next(Batch& t_out) -> bool override {
+    if (!m_built) {
+      m_built = true;
+      while (m_build.op->next(m_in)) {
+        m_join.build(m_in, eval_keys(m_build));
+      }
+    }
+    while (true) {
+      for (auto& col : m_rows) {
+        col.clear();
+      }
+      if (!m_probed && m_probe.op->next(m_in)) {
+        m_join.probe(m_in, eval_keys(m_probe), m_rows);
+      } else {
+        // then what was spilled.
+        m_probed = true;
+        if (!m_join.drain(m_rows)) {
+          return false;
+        }
+      }
+      if (m_rows.front().size() != 0) {
+        output_joined(m_rows, m_out, t_out);
+        return true;
+      }
+    }
+  }
+
+private:
+  JoinSide m_probe;
+  JoinSide m_build;
+  std::vector<std::size_t> m_out;
+  HashJoiner m_join;
+  std::vector<ColumnVector> m_rows;
+  std::vector<const ColumnVector*> m_keys{};
+  Batch m_in{};
+  bool m_built{false};
+  bool m_probed{false};
+
+  auto eval_keys(JoinSide& t_side) -> std::span<const ColumnVector* const> {
+    m_keys.clear();
+    for (auto& key : t_side.keys) {
+      m_keys.push_back(&key.eval(m_in));
+    }
+    return m_keys;
+  }
+};
+
+/**
+ * @brief An equi-join, as a sort-merge join: reads both sides whole, then
+ * outputs the joined rows in key order.
+ */
+class MergeJoinOp final : public Operator {
+public:
+  /**
+   * @param t_out For each output column, its position among the columns of
+   * the left side then those of the right side.
+   */
+  MergeJoinOp(JoinSide t_left, JoinSide t_right, std::vector<VType> t_keys,
+              std::vector<std::size_t> t_out)
+      : m_left{std::move(t_left)}, m_right{std::move(t_right)},
+        m_out{std::move(t_out)},
+        m_join{std::move(t_keys), m_left.types, m_right.types},
+        m_rows{make_rows(m_left.types, m_right.types)} {}
+
+  auto next(Batch& t_out) -> bool override {
+    if (!m_read) {
+      m_read = true;
+      read(0, m_left);
+      read(1, m_right);
+    }
+    for (auto& col : m_rows) {
+      col.clear();
+    }
+    if (!m_join.next(m_rows, ColumnStore::BATCH_SIZE)) {
+      return false;
+    }
+    output_joined(m_rows, m_out, t_out);
+    return true;
+  }
+
+private:
+  JoinSide m_left;
+  JoinSide m_right;
+  std::vector<std::size_t> m_out;
+  MergeJoiner m_join;
+  std::vector<ColumnVector> m_rows;
+  Batch m_in{};
+  bool m_read{false};
+
+  void read(std::size_t t_side, JoinSide& t_from) {
+    std::vector<const ColumnVector*> keys;
+    while (t_from.op->next(m_in)) {
+      keys.clear();
+      for (auto& key : t_from.keys) {
+        keys.push_back(&key.eval(m_in));
+      }
+      m_join.add(t_side, m_in, keys);
+    }
+  }
+};
+
+/**
+ * @brief ORDER BY: reads every row first, then outputs them in key order.
+ */
+class SortOp final : public Operator {
+public:
+  /**
+   * @param t_types Of the columns of the child.
+   * @param t_limit Only the first that many rows are wanted.
+   */
+  SortOp(std::unique_ptr<Operator> t_child, std::vector<SortKey> t_keys,
+         std::span<const VType> t_types, std::optional<std::size_t> t_limit,
+         const Catalog& t_catalog)
+      : m_child{std::move(t_child)},
+        m_sort{std::move(t_keys), col_types(t_types), t_catalog.spill(),
+               t_catalog.mem_limit(), t_limit} {
+    for (auto type : t_types) {
+      m_rows.emplace_back(storage_type(type));
+    }
+  }
+
+  auto next(Batch& t_out) -> bool override {
+    if (!m_read) {
+      m_read = true;
+      while (m_child->next(m_in)) {
+        m_sort.add(m_in);
+      }
+    }
+    for (auto& col : m_rows) {
+      col.clear();
+    }
+    if (!m_sort.next(m_rows, ColumnStore::BATCH_SIZE)) {
+      return false;
+    }
+    t_out.cols.clear();
+    for (const auto& col : m_rows) {
+      t_out.cols.push_back(&col);
+    }
+    t_out.n_rows = m_rows.front().size();
+    t_out.selective = false;
+    t_out.sel.clear();
+    return true;
+  }
+
+private:
+  std::unique_ptr<Operator> m_child;
+  Sorter m_sort;
+  std::vector<ColumnVector> m_rows;
+  Batch m_in{};
+  bool m_read{false};
+
+  static auto col_types(std::span<const VType> t_types)
+      -> std::vector<ColType> {
+    std::vector<ColType> ret;
+    for (auto type : t_types) {
+      ret.push_back(storage_type(type));
+    }
+    return ret;
+  }
+};
+
+class LimitOp final : public Operator {
+public:
+  LimitOp(std::unique_ptr<Operator> t_child, std::size_t t_limit,
+          std::size_t t_offset)
+      : m_child{std::move(t_child)}, m_left{t_limit}, m_skip{t_offset} {}
+
+  auto next(Batch& t_out) -> bool override {
+    // stops pulling as soon as it has enough.
+    while (m_left != 0 && m_child->next(t_out)) {
+      auto size = t_out.size();
+      if (m_skip >= size) {
+        m_skip -= size;
+        continue;
+      }
+      auto take = std::min(m_left, size - m_skip);
+      if (!t_out.selective) {
+        t_out.sel.resize(t_out.n_rows);
+        for (std::size_t row = 0; row < t_out.n_rows; ++row) {
+          t_out.sel[row] = static_cast<uint32_t>(row);
+        }
+        t_out.selective = true;
+      }
+      auto first = t_out.sel.begin() + static_cast<std::ptrdiff_t>(m_skip);
+      std::copy(first, first + static_cast<std::ptrdiff_t>(take),
+                t_out.sel.begin());
+      t_out.sel.resize(take);
+      m_skip = 0;
+      m_left -= take;
+      return true;
+    }
+    return false;
+  }
+
+private:
+  std::unique_ptr<Operator> m_child;
+  std::size_t m_left;
+  std::size_t m_skip;
+};
+
+void conjuncts(const Expr* t_expr, std::vector<const Expr*>& t_out) {
+  const auto* bin = std::get_if<Binary>(&t_expr->node);
+  if (bin != nullptr && bin->op == BinaryOp::And) {
+    conjuncts(bin->lhs, t_out);
+    conjuncts(bin->rhs, t_out);
+  } else {
+    t_out.push_back(t_expr);
+  }
+}
+
+template <typename T>
+auto exact_filter(std::size_t t_col, CmpOp t_op, int64_t t_val)
+    -> std::optional<ColumnFilter> {
+  if constexpr (std::is_integral_v<T>) {
+    // out of range: every non-NULL row matches, or none, just like with the
+    // bound the value is past.
+    using limits = std::numeric_limits<T>;
+    if (std::cmp_greater(t_val, limits::max())) {
+      const bool all =
+          t_op == CmpOp::Ne || t_op == CmpOp::Lt || t_op == CmpOp::Le;
+      return ColumnFilter::of<T>(t_col, all ? CmpOp::Le : CmpOp::Gt,
+                                 limits::max());
+    }
+    if (std::cmp_less(t_val, limits::min())) {
+      const bool all =
+          t_op == CmpOp::Ne || t_op == CmpOp::Gt || t_op == CmpOp::Ge;
+      return ColumnFilter::of<T>(t_col, all ? CmpOp::Ge : CmpOp::Lt,
+                                 limits::min());
+    }
+    return ColumnFilter::of<T>(t_col, t_op, static_cast<T>(t_val));
+  } else {
+    auto val = static_cast<T>(t_val);
+    if (static_cast<int64_t>(val) != t_val) {
+      return std::nullopt;
+    }
+    return ColumnFilter::of<T>(t_col, t_op, val);
+  }
+}
+
+/**
+ * @return `t_col <op> t_val` as a filter the scan evaluates itself, if the
+ * scan would give the exact same result. Whether it would only depends on
+ * the types, except for integers a Float32 can't hold.
+ */
+auto push_down(ColType t_type, std::size_t t_col, CmpOp t_op,
+               const Literal& t_val) -> std::optional<ColumnFilter> {
+  if (const auto* str = std::get_if<std::string_view>(&t_val.val)) {
+    if (t_type != ColType::Text) {
+      return std::nullopt;
+    }
+    return ColumnFilter::of_text(t_col, t_op, *str);
+  }
+  const auto* num = std::get_if<int32_t>(&t_val.val);
+  if (num == nullptr) {
+    return std::nullopt;
+  }
+  switch (t_type) {
+  case ColType::Int8:
+    return exact_filter<int8_t>(t_col, t_op, *num);
+  case ColType::Uint8:
+    return exact_filter<uint8_t>(t_col, t_op, *num);
+  case ColType::Int16:
+    return exact_filter<int16_t>(t_col, t_op, *num);
+  case ColType::Uint16:
+    return exact_filter<uint16_t>(t_col, t_op, *num);
+  case ColType::Int32:
+    return exact_filter<int32_t>(t_col, t_op, *num);
+  case ColType::Uint32:
+    return exact_filter<uint32_t>(t_col, t_op, *num);
+  case ColType::Int64:
+    return exact_filter<int64_t>(t_col, t_op, *num);
+  case ColType::Uint64:
+    return exact_filter<uint64_t>(t_col, t_op, *num);
+  case ColType::Float32:
+    return exact_filter<float>(t_col, t_op, *num);
+  case ColType::Float64:
+    return exact_filter<double>(t_col, t_op, *num);
+  default:
+    // CharN compares padding included: leave it to the engine.
+    return std::nullopt;
+  }
+}
+
+/**
+ * @brief `column <op> value`, pushed down to the scan of a table. The value
+ * is a literal, or a `?` only known once the statement runs.
+ */
+struct PushDown {
+  ColType type;
+  std::size_t pos;
+  CmpOp op;
+  const Expr* val;
+};
+
+/**
+ * @return The value of a literal or of a bound `?`, nullptr for anything
+ * else.
+ */
+auto literal_of(const Expr& t_expr, std::span<const ParamValue> t_params)
+    -> const Literal* {
+  if (const auto* lit = std::get_if<Literal>(&t_expr.node)) {
+    return lit;
+  }
+  const auto* prm = std::get_if<Param>(&t_expr.node);
+  if (prm == nullptr || prm->idx >= t_params.size()) {
+    return nullptr;
+  }
+  return std::get_if<Literal>(&t_params[prm->idx]);
+}
+
+/**
+ * @return The filter a pushed down conjunct is, with the current values of
+ * the `?`. Never fails for the types it was pushed down with.
+ */
+auto filter_of(const PushDown& t_down, std::span<const ParamValue> t_params)
+    -> ColumnFilter {
+  const auto* val = literal_of(*t_down.val, t_params);
+  assert(val != nullptr);
+  auto ret = push_down(t_down.type, t_down.pos, t_down.op, *val);
+  assert(ret.has_value());
+  return *std::move(ret);
+}
+
+/**
+ * @brief Turns one of the conjuncts of WHERE into a filter of the scan of a
+ * table, if one of them is simple enough: `column <op> constant`, either way
+ * round, with a column of that table.
+ * @return The position of the conjunct turned into a filter.
+ */
+auto find_push_down(std::span<const Expr* const> t_conjuncts,
+                    const Scope& t_scope, std::size_t t_tbl,
+                    std::optional<PushDown>& t_down)
+    -> std::optional<std::size_t> {
+  for (std::size_t i = 0; i < t_conjuncts.size(); ++i) {
+    const auto* bin = std::get_if<Binary>(&t_conjuncts[i]->node);
+    if (bin == nullptr || bin->op < BinaryOp::Eq || bin->op > BinaryOp::Ge) {
+      continue;
+    }
+    auto op = static_cast<CmpOp>(static_cast<uint8_t>(bin->op) -
+                                 static_cast<uint8_t>(BinaryOp::Eq));
+    const auto* ref = std::get_if<ColumnRef>(&bin->lhs->node);
+    const auto* expr = bin->rhs;
+    if (ref == nullptr || literal_of(*expr, t_scope.params()) == nullptr) {
+      // `constant <op> column`: same as `column <flipped op> constant`.
+      ref = std::get_if<ColumnRef>(&bin->rhs->node);
+      expr = bin->lhs;
+      switch (op) {
+      case CmpOp::Lt:
+        op = CmpOp::Gt;
+        break;
+      case CmpOp::Le:
+        op = CmpOp::Ge;
+        break;
+      case CmpOp::Gt:
+        op = CmpOp::Lt;
+        break;
+      case CmpOp::Ge:
+        op = CmpOp::Le;
+        break;
+      default:
+        break;
+      }
+    }
+    const auto* val = literal_of(*expr, t_scope.params());
+    if (ref == nullptr || val == nullptr) {
+      continue;
+    }
+    auto col = t_scope.resolve(*ref);
+    if (!col || col->tbl != t_tbl) {
+      continue;
+    }
+    auto type = t_scope.tables()[t_tbl]->columns()[col->pos].m_type;
+    // whether a `?` fits in a Float32 depends on its value.
+    if (std::holds_alternative<Param>(expr->node) &&
+        type == ColType::Float32) {
+      continue;
+    }
+    if (push_down(type, col->pos, op, *val)) {
+      t_down = PushDown{.type = type, .pos = col->pos, .op = op, .val = expr};
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @return LIMIT or OFFSET, compiled.
+ */
+auto count_expr(const Expr& t_expr, std::span<const ParamValue> t_params)
+    -> std::expected<VectorExpr, ExecError> {
+  Scope scope{nullptr, t_params};
+  auto expr = VectorExpr::compile(t_expr, scope);
+  if (!expr) {
+    return expr;
+  }
+  if (!expr->is_const()) {
+    return std::unexpected{ExecError::NotConstant};
+  }
+  if (expr->type() != VType::Int) {
+    return std::unexpected{ExecError::TypeMismatch};
+  }
+  return expr;
+}
+
+/**
+ * @return The value of LIMIT or OFFSET, with the current values of the `?`.
+ */
+auto count_of(VectorExpr t_expr, std::span<const ParamValue> t_params)
+    -> std::expected<std::size_t, ExecError> {
+  t_expr.bind(t_params);
+  Batch one;
+  one.n_rows = 1;
+  const auto& val = t_expr.eval(one);
+  if (val.is_null(0) || val.values<int64_t>()[0] < 0) {
+    return std::unexpected{ExecError::TypeMismatch};
+  }
+  return static_cast<std::size_t>(val.values<int64_t>()[0]);
+}
+
+auto name_of(const SelectItem& t_item) -> std::string {
+  if (!t_item.alias.empty()) {
+    return std::string{t_item.alias};
+  }
+  if (const auto* ref = std::get_if<ColumnRef>(&t_item.expr->node)) {
+    return std::string{ref->name};
+  }
+  if (const auto* call = std::get_if<Call>(&t_item.expr->node)) {
+    return std::string{call->name};
+  }
+  return {};
+}
+
+/**
+ * @return Whether two expressions are written the same, give or take the
+ * table in front of column names.
+ */
+auto same(const Expr& t_lhs, const Expr& t_rhs) -> bool {
+  if (t_lhs.node.index() != t_rhs.node.index()) {
+    return false;
+  }
+  if (const auto* ref = std::get_if<ColumnRef>(&t_lhs.node)) {
+    const auto& other = std::get<ColumnRef>(t_rhs.node);
+    return ref->name == other.name &&
+           (ref->table.empty() || other.table.empty() ||
+            ref->table == other.table);
+  }
+  if (const auto* lit = std::get_if<Literal>(&t_lhs.node)) {
+    return lit->val == std::get<Literal>(t_rhs.node).val;
+  }
+  if (const auto* param = std::get_if<Param>(&t_lhs.node)) {
+    return param->idx == std::get<Param>(t_rhs.node).idx;
+  }
+  if (const auto* unary = std::get_if<Unary>(&t_lhs.node)) {
+    const auto& other = std::get<Unary>(t_rhs.node);
+    return unary->op == other.op && same(*unary->operand, *other.operand);
+  }
+  if (const auto* binary = std::get_if<Binary>(&t_lhs.node)) {
+    const auto& other = std::get<Binary>(t_rhs.node);
+    return binary->op == other.op && same(*binary->lhs, *other.lhs) &&
+           same(*binary->rhs, *other.rhs);
+  }
+  // NULL is NULL, but calls are never keys.
+  return std::holds_alternative<NullValue>(t_lhs.node);
+}
+
+/**
+ * @return Whether two calls are the same aggregate of the same arguments.
+ */
+auto same_agg(const Expr& t_lhs, const Expr& t_rhs) -> bool {
+  const auto* lhs = std::get_if<Call>(&t_lhs.node);
+  const auto* rhs = std::get_if<Call>(&t_rhs.node);
+  if (lhs == nullptr || rhs == nullptr) {
+    return false;
+  }
+  auto kind = agg_kind(*lhs);
+  return kind && kind == agg_kind(*rhs) &&
+         std::ranges::equal(lhs->args, rhs->args,
+                            [](const Expr* t_a, const Expr* t_b) {
+                              return same(*t_a, *t_b);
+                            });
+}
+
+/**
+ * @return The selected item an ORDER BY key names, if any: by its alias, or
+ * written the same way.
+ */
+auto order_item(const Expr& t_key, std::span<const SelectItem> t_items)
+    -> std::optional<std::size_t> {
+  const auto* ref = std::get_if<ColumnRef>(&t_key.node);
+  for (std::size_t i = 0; i < t_items.size(); ++i) {
+    if (ref != nullptr && ref->table.empty() && !t_items[i].alias.empty() &&
+        t_items[i].alias == ref->name) {
+      return i;
+    }
+  }
+  for (std::size_t i = 0; i < t_items.size(); ++i) {
+    if (same(t_key, *t_items[i].expr) || same_agg(t_key, *t_items[i].expr)) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief `a = b` in ON, where `a` is a column of a table before the one
+ * joined and `b` one of the table joined. Both are columns of the scope.
+ */
+struct JoinKey {
+  std::size_t left;
+  std::size_t right;
+};
+
+/**
+ * @return The key a condition of the ON of table `t_tbl` (in scope order)
+ * joins on, if it's a key at all.
+ */
+auto join_key(const Expr& t_cond, Scope& t_scope, std::size_t t_tbl)
+    -> std::optional<JoinKey> {
+  const auto* bin = std::get_if<Binary>(&t_cond.node);
+  if (bin == nullptr || bin->op != BinaryOp::Eq) {
+    return std::nullopt;
+  }
+  const auto* lhs = std::get_if<ColumnRef>(&bin->lhs->node);
+  const auto* rhs = std::get_if<ColumnRef>(&bin->rhs->node);
+  if (lhs == nullptr || rhs == nullptr) {
+    return std::nullopt;
+  }
+  auto left = t_scope.resolve(*lhs);
+  auto right = t_scope.resolve(*rhs);
+  if (!left || !right) {
+    return std::nullopt;
+  }
+  if (left->tbl == t_tbl) {
+    std::swap(left, right);
+  }
+  if (right->tbl != t_tbl || left->tbl >= t_tbl) {
+    return std::nullopt;
+  }
+  return JoinKey{.left = t_scope.column(left->pos, left->tbl).first,
+                 .right = t_scope.column(right->pos, right->tbl).first};
+}
+
+/**
+ * @return Whether the pages of a column are in order: no value of a page is
+ * smaller than a value of a page before it. The sign of a table loaded in
+ * that order, whose rows then very likely are.
+ */
+auto clustered(const ColumnStore& t_store, ColType t_type, std::size_t t_pos)
+    -> bool {
+  const dbfile::internal::Zone* prev{nullptr};
+  for (const auto& zone : t_store.zones(t_pos)) {
+    if (zone.all_null()) {
+      continue;
+    }
+    if (prev != nullptr && dbfile::internal::ZoneMap::compare_keys(
+                               t_type, prev->max, zone.min) > 0) {
+      return false;
+    }
+    prev = &zone;
+  }
+  return true;
+}
+
+/**
+ * @brief Joins every table of a query, in order. Each join outputs the
+ * columns of both of its sides in scope order, so the last one outputs
+ * every column of the scope, numbered as in the scope.
+ *
+ * The first join is a sort-merge join if it's on a single column, clustered
+ * in both tables (see `clustered`), and both tables are small enough not to
+ * need spilling. Every other join is a hash join, the build side being the
+ * table joined, or the smaller table for the first join.
+ *
+ * @param t_filters The filter of the scan of each table.
+ */
+auto join_all(std::span<const TableRef* const> t_tbls,
+              std::span<std::optional<ColumnFilter>> t_filters,
+              std::span<const std::vector<JoinKey>> t_keys,
+              const Scope& t_scope, const Catalog& t_catalog)
+    -> std::expected<std::unique_ptr<Operator>, ExecError> {
+  const auto cols = t_scope.columns();
+  auto type_of = [&](std::size_t t_col) {
+    return t_tbls[cols[t_col].tbl]->meta->columns()[cols[t_col].pos].m_type;
+  };
+  // a scan, and the columns of the scope it reads.
+  auto scan = [&](std::size_t t_tbl, std::vector<std::size_t>& t_cols) {
+    t_cols.clear();
+    for (std::size_t col = 0; col < cols.size(); ++col) {
+      if (cols[col].tbl == t_tbl) {
+        t_cols.push_back(col);
+      }
+    }
+    JoinSide ret{.op = std::make_unique<ScanOp>(
+                     *t_tbls[t_tbl], *t_tbls[t_tbl]->in,
+                     t_scope.scanned(t_tbl), std::move(t_filters[t_tbl])),
+                 .keys = {},
+                 .types = {}};
+    for (auto col : t_cols) {
+      ret.types.push_back(type_of(col));
+    }
+    return ret;
+  };
+  auto index_of = [](std::span<const std::size_t> t_cols, std::size_t t_col) {
+    return static_cast<std::size_t>(std::ranges::find(t_cols, t_col) -
+                                    t_cols.begin());
+  };
+
+  std::vector<std::size_t> left_cols;
+  std::vector<std::size_t> right_cols;
+  auto left = scan(0, left_cols);
+  for (std::size_t j = 0; j + 1 < t_tbls.size(); ++j) {
+    auto right = scan(j + 1, right_cols);
+    std::vector<VType> types;
+    for (const auto& key : t_keys[j]) {
+      left.keys.push_back(VectorExpr::column(index_of(left_cols, key.left),
+                                             type_of(key.left)));
+      right.keys.push_back(VectorExpr::column(
+          index_of(right_cols, key.right), type_of(key.right)));
+      auto lhs = left.keys.back().type();
+      auto rhs = right.keys.back().type();
+      if (lhs == rhs) {
+        types.push_back(lhs);
+      } else if ((lhs == VType::Int || lhs == VType::Float) &&
+                 (rhs == VType::Int || rhs == VType::Float)) {
+        types.push_back(VType::Float);
+      } else {
+        return std::unexpected{ExecError::TypeMismatch};
+      }
+    }
+    std::vector<std::size_t> out_cols;
+    std::ranges::merge(left_cols, right_cols, std::back_inserter(out_cols));
+    auto out = [&](std::span<const std::size_t> t_first,
+                   std::span<const std::size_t> t_second) {
+      std::vector<std::size_t> ret;
+      for (auto col : out_cols) {
+        auto idx = index_of(t_first, col);
+        ret.push_back(idx < t_first.size()
+                          ? idx
+                          : t_first.size() + index_of(t_second, col));
+      }
+      return ret;
+    };
+
+    const auto& lstore = *t_tbls[j]->store;
+    const auto& rstore = *t_tbls[j + 1]->store;
+    const auto& key = t_keys[j].front();
+    const auto bytes = ((lstore.n_rows() * left_cols.size()) +
+                        (rstore.n_rows() * right_cols.size())) *
+                       sizeof(int64_t);
+    const bool merge =
+        j == 0 && t_keys[j].size() == 1 &&
+        clustered(lstore, type_of(key.left), cols[key.left].pos) &&
+        clustered(rstore, type_of(key.right), cols[key.right].pos) &&
+        (!t_catalog.spill() || bytes <= t_catalog.mem_limit());
+    std::unique_ptr<Operator> op;
+    if (merge) {
+      op = std::make_unique<MergeJoinOp>(std::move(left), std::move(right),
+                                         std::move(types),
+                                         out(left_cols, right_cols));
+    } else if (j == 0 && lstore.n_rows() < rstore.n_rows()) {
+      op = std::make_unique<HashJoinOp>(std::move(right), std::move(left),
+                                        std::move(types),
+                                        out(right_cols, left_cols), t_catalog);
+    } else {
+      op = std::make_unique<HashJoinOp>(std::move(left), std::move(right),
+                                        std::move(types),
+                                        out(left_cols, right_cols), t_catalog);
+    }
+    left = JoinSide{.op = std::move(op), .keys = {}, .types = {}};
+    for (auto col : out_cols) {
+      left.types.push_back(type_of(col));
+    }
+    left_cols = std::move(out_cols);
+  }
+  return std::move(left.op);
+}
+
+/**
+ * @class Stages
+ * @brief What's done with the output of the operators of a query, as
+ * compiled: copied into every Pipeline.
+ */
+struct Stages {
+  std::vector<std::string> names;
+  std::vector<VType> types;
+  bool aggregate{false};
+  std::vector<Agg> aggs;
+  // GROUP BY: the keys, and where each output column comes from (see
+  // GroupOp).
+  std::vector<VectorExpr> keys;
+  std::vector<std::size_t> group_out;
+  // ORDER BY: its keys, columns of the output or hidden ones after it, and
+  // the type of each hidden one.
+  std::vector<SortKey> order;
+  std::vector<VType> hidden;
+};
+
+/**
+ * @class Pipeline
+ * @brief A query ready to run: the operators from the scan up, and what's
+ * left to do with their output, with the values of the `?`. Built once per
+ * thread running the query, since operators hold the batches they produce.
+ */
+struct Pipeline : Stages {
+  // nullptr without a table.
+  ScanOp* scan{nullptr};
+  // without aggregates, up to the projection. With, up to the filters.
+  std::unique_ptr<Operator> top;
+  std::optional<std::size_t> limit;
+  std::size_t offset{0};
+};
+
+/**
+ * @return The tables of a SELECT, FROM first. Empty without FROM.
+ */
+auto tables_of(const Select& t_sel, const Catalog& t_catalog)
+    -> std::expected<std::vector<const TableRef*>, ExecError> {
+  std::vector<const TableRef*> ret;
+  if (!t_sel.table.empty()) {
+    ret.push_back(t_catalog.find(t_sel.table));
+  }
+  for (const auto& join : t_sel.joins) {
+    ret.push_back(t_catalog.find(join.table));
+  }
+  if (std::ranges::find(ret, nullptr) != ret.end()) {
+    return std::unexpected{ExecError::UnknownTable};
+  }
+  return ret;
+}
+
+/**
+ * @return What each `?` is bound to: nothing, NULL, or a value of which
+ * type. What a statement is compiled for.
+ */
+auto param_types(std::span<const ParamValue> t_params)
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> ret;
+  for (const auto& param : t_params) {
+    const auto* lit = std::get_if<Literal>(&param);
+    ret.push_back(lit == nullptr ? param.index()
+                                 : param.index() + lit->val.index());
+  }
+  return ret;
+}
+
+} // namespace
+
+/**
+ * @class CompiledStatement
+ * @brief A SELECT with its names resolved, types checked and expressions
+ * compiled, but no operator yet: those are built from it for every run (see
+ * `instantiate`), with the values of the `?` then.
+ */
+struct CompiledStatement {
+  uint64_t version;
+  std::vector<std::size_t> params;
+  const Select* sel;
+  // its `?` are only there while compiling.
+  Scope scope;
+  // the equal columns each join is on.
+  std::vector<std::vector<JoinKey>> joins{};
+  // the filter of the scan of each table, if any.
+  std::vector<std::optional<PushDown>> filters{};
+  std::vector<VectorExpr> preds{};
+  Stages stages{};
+  // without aggregates: the output columns, then the hidden ones.
+  std::vector<VectorExpr> exprs{};
+  std::optional<VectorExpr> limit{};
+  std::optional<VectorExpr> offset{};
+};
+
+namespace {
+
+auto compile_select(const Select& t_sel, const Catalog& t_catalog,
+                    std::span<const ParamValue> t_params)
+    -> std::expected<CompiledStatement, ExecError> {
+  auto tbls = tables_of(t_sel, t_catalog);
+  if (!tbls) {
+    return std::unexpected{tbls.error()};
+  }
+  std::vector<const dbfile::internal::TableMeta*> metas;
+  for (const auto* tbl : *tbls) {
+    metas.push_back(tbl->meta);
+  }
+  CompiledStatement comp{.version = t_catalog.version(),
+                         .params = param_types(t_params),
+                         .sel = &t_sel,
+                         .scope{std::move(metas), t_params}};
+  auto& scope = comp.scope;
+  auto& ret = comp.stages;
+
+  std::vector<const Expr*> where;
+  if (t_sel.where != nullptr) {
+    conjuncts(t_sel.where, where);
+  }
+  // each join needs at least one pair of equal columns. The rest of ON
+  // filters the joined rows, just like WHERE.
+  for (std::size_t j = 0; j < t_sel.joins.size(); ++j) {
+    std::vector<const Expr*> on;
+    conjuncts(t_sel.joins[j].on, on);
+    auto& join = comp.joins.emplace_back();
+    for (const auto* cond : on) {
+      if (auto key = join_key(*cond, scope, j + 1)) {
+        join.push_back(*key);
+      } else {
+        where.push_back(cond);
+      }
+    }
+    if (join.empty()) {
+      return std::unexpected{ExecError::Unsupported};
+    }
+  }
+  comp.filters.resize(tbls->size());
+  for (std::size_t tbl = 0; tbl < tbls->size(); ++tbl) {
+    if (auto pos = find_push_down(where, scope, tbl, comp.filters[tbl])) {
+      where.erase(where.begin() + static_cast<std::ptrdiff_t>(*pos));
+    }
+  }
+  for (const auto* cond : where) {
+    auto pred = VectorExpr::compile(*cond, scope);
+    if (!pred) {
+      return std::unexpected{pred.error()};
+    }
+    if (pred->type() != VType::Bool) {
+      return std::unexpected{ExecError::TypeMismatch};
+    }
+    comp.preds.push_back(std::move(*pred));
+  }
+
+  // either only aggregates, or none, unless grouped: then keys too.
+  auto is_call = [](const SelectItem& t_item) {
+    return std::holds_alternative<Call>(t_item.expr->node);
+  };
+  const bool grouped = !t_sel.group_by.empty();
+  ret.aggregate = std::ranges::any_of(t_sel.items, is_call);
+  if (ret.aggregate && !grouped &&
+      !std::ranges::all_of(t_sel.items, is_call)) {
+    return std::unexpected{ExecError::Unsupported};
+  }
+  if (grouped && t_sel.items.empty()) {
+    return std::unexpected{ExecError::Unsupported};
+  }
+  for (const auto* key : t_sel.group_by) {
+    auto expr = VectorExpr::compile(*key, scope);
+    if (!expr) {
+      return std::unexpected{expr.error()};
+    }
+    ret.keys.push_back(std::move(*expr));
+  }
+  auto& exprs = comp.exprs;
+  if (t_sel.items.empty()) {
+    if (tbls->empty()) {
+      return std::unexpected{ExecError::UnknownColumn};
+    }
+    for (std::size_t tbl = 0; tbl < tbls->size(); ++tbl) {
+      const auto& columns = (*tbls)[tbl]->meta->columns();
+      for (std::size_t pos = 0; pos < columns.size(); ++pos) {
+        auto [col, type] = scope.column(pos, tbl);
+        exprs.push_back(VectorExpr::column(col, type));
+        ret.names.emplace_back(columns[pos].m_name);
+      }
+    }
+  }
+  for (const auto& item : t_sel.items) {
+    ret.names.push_back(name_of(item));
+    if (grouped) {
+      auto key = std::ranges::find_if(t_sel.group_by, [&](const Expr* t_key) {
+        return same(*t_key, *item.expr);
+      });
+      if (key != t_sel.group_by.end()) {
+        ret.group_out.push_back(
+            static_cast<std::size_t>(key - t_sel.group_by.begin()));
+        continue;
+      }
+      // anything else must be an aggregate.
+      if (!is_call(item)) {
+        return std::unexpected{ExecError::Unsupported};
+      }
+      ret.group_out.push_back(ret.keys.size() + ret.aggs.size());
+    } else if (!ret.aggregate) {
+      auto expr = VectorExpr::compile(*item.expr, scope);
+      if (!expr) {
+        return std::unexpected{expr.error()};
+      }
+      exprs.push_back(std::move(*expr));
+      continue;
+    }
+    const auto& call = std::get<Call>(item.expr->node);
+    auto kind = agg_kind(call);
+    if (!kind || (*kind != AggKind::CountStar && call.args.size() != 1)) {
+      return std::unexpected{ExecError::Unsupported};
+    }
+    Agg agg{.kind = *kind,
+            .arg = std::nullopt,
+            .best = ColumnVector{ColType::Int64}};
+    if (*kind != AggKind::CountStar) {
+      auto arg = VectorExpr::compile(*call.args[0], scope);
+      if (!arg) {
+        return std::unexpected{arg.error()};
+      }
+      const bool numeric =
+          arg->type() == VType::Int || arg->type() == VType::Float;
+      if ((*kind == AggKind::Sum || *kind == AggKind::Avg) && !numeric) {
+        return std::unexpected{ExecError::TypeMismatch};
+      }
+      agg.best = ColumnVector{storage_type(arg->type())};
+      agg.arg = std::move(*arg);
+    }
+    ret.aggs.push_back(std::move(agg));
+  }
+
+  // ORDER BY sorts the output. Without aggregates, it may also sort on
+  // anything else, computed as hidden columns after the output.
+  const auto n_out = ret.names.size();
+  for (const auto& item : t_sel.order_by) {
+    std::size_t col{0};
+    if (auto pos = order_item(*item.expr, t_sel.items)) {
+      col = *pos;
+    } else if (grouped || ret.aggregate) {
+      return std::unexpected{ExecError::Unsupported};
+    } else {
+      auto expr = VectorExpr::compile(*item.expr, scope);
+      if (!expr) {
+        return std::unexpected{expr.error()};
+      }
+      col = exprs.size();
+      ret.hidden.push_back(expr->type());
+      exprs.push_back(std::move(*expr));
+    }
+    ret.order.push_back({.col = col, .type = VType::Int, .desc = item.desc});
+  }
+
+  if (t_sel.limit != nullptr) {
+    auto expr = count_expr(*t_sel.limit, t_params);
+    if (!expr) {
+      return std::unexpected{expr.error()};
+    }
+    comp.limit = std::move(*expr);
+  }
+  if (t_sel.offset != nullptr) {
+    auto expr = count_expr(*t_sel.offset, t_params);
+    if (!expr) {
+      return std::unexpected{expr.error()};
+    }
+    comp.offset = std::move(*expr);
+  }
+
+  if (grouped) {
+    for (auto col : ret.group_out) {
+      ret.types.push_back(col < ret.keys.size()
+                              ? ret.keys[col].type()
+                              : ret.aggs[col - ret.keys.size()].out_type());
+    }
+  } else if (ret.aggregate) {
+    for (const auto& agg : ret.aggs) {
+      ret.types.push_back(agg.out_type());
+    }
+  } else {
+    for (std::size_t i = 0; i < n_out; ++i) {
+      ret.types.push_back(exprs[i].type());
+    }
+  }
+  for (auto& key : ret.order) {
+    key.type = key.col < n_out ? ret.types[key.col]
+                               : ret.hidden[key.col - n_out];
+  }
+  return comp;
+}
+
+/**
+ * @brief Builds the operators of a compiled query, with the current values
+ * of the `?`.
+ *
+ * @param t_tbls Its tables (see `tables_of`).
+ * @param t_in The stream the scan of FROM reads from. Joined tables are read
+ * from their own.
+ */
+auto instantiate(const CompiledStatement& t_comp,
+                 std::span<const TableRef* const> t_tbls, std::istream* t_in,
+                 std::span<const ParamValue> t_params,
+                 const Catalog& t_catalog)
+    -> std::expected<Pipeline, ExecError> {
+  Pipeline ret{t_comp.stages, nullptr, nullptr, std::nullopt, 0};
+  for (auto& agg : ret.aggs) {
+    if (agg.arg) {
+      agg.arg->bind(t_params);
+    }
+  }
+  for (auto& key : ret.keys) {
+    key.bind(t_params);
+  }
+  if (t_comp.limit) {
+    auto val = count_of(*t_comp.limit, t_params);
+    if (!val) {
+      return std::unexpected{val.error()};
+    }
+    ret.limit = *val;
+  }
+  if (t_comp.offset) {
+    auto val = count_of(*t_comp.offset, t_params);
+    if (!val) {
+      return std::unexpected{val.error()};
+    }
+    ret.offset = *val;
+  }
+
+  // from the scan up.
+  std::vector<std::optional<ColumnFilter>> filters;
+  for (const auto& down : t_comp.filters) {
+    filters.push_back(down ? std::optional{filter_of(*down, t_params)}
+                           : std::nullopt);
+  }
+  if (t_tbls.empty()) {
+    ret.top = std::make_unique<OneRowOp>();
+  } else if (t_tbls.size() == 1) {
+    auto scan = std::make_unique<ScanOp>(*t_tbls.front(), *t_in,
+                                         t_comp.scope.scanned(),
+                                         std::move(filters.front()));
+    ret.scan = scan.get();
+    ret.top = std::move(scan);
+  } else {
+    auto top =
+        join_all(t_tbls, filters, t_comp.joins, t_comp.scope, t_catalog);
+    if (!top) {
+      return std::unexpected{top.error()};
+    }
+    ret.top = std::move(*top);
+  }
+  for (auto pred : t_comp.preds) {
+    pred.bind(t_params);
+    ret.top = std::make_unique<FilterOp>(std::move(ret.top), std::move(pred));
+  }
+  if (!ret.aggregate && ret.keys.empty()) {
+    auto exprs = t_comp.exprs;
+    for (auto& expr : exprs) {
+      expr.bind(t_params);
+    }
+    ret.top = std::make_unique<ProjectOp>(std::move(ret.top), std::move(exprs));
+  }
+  return ret;
+}
+
+/**
+ * @brief Copies the selected rows of a batch at the end of some vectors.
+ */
+void append(const Batch& t_batch, std::vector<ColumnVector>& t_cols) {
+  for (std::size_t i = 0; i < t_cols.size(); ++i) {
+    const auto& src = *t_batch.cols[i];
+    auto& dst = t_cols[i];
+    for_each_row(t_batch, [&](std::size_t t_row) {
+      if (src.is_null(t_row)) {
+        dst.push_null();
+      } else {
+        dst.push_bytes(src.bytes(t_row));
+      }
+    });
+  }
+}
+
+auto make_result(const Pipeline& t_pipe) -> ResultSet {
+  ResultSet res{.names = t_pipe.names, .types = t_pipe.types, .cols{}};
+  for (auto type : res.types) {
+    res.cols.emplace_back(storage_type(type));
+  }
+  return res;
+}
+
+/**
+ * @brief Runs a query on the calling thread, stopping as soon as LIMIT is
+ * reached.
+ */
+auto run_serial(Pipeline t_pipe, const Catalog& t_catalog) -> ResultSet {
+  auto res = make_result(t_pipe);
+  auto op = std::move(t_pipe.top);
+  if (!t_pipe.keys.empty()) {
+    op = std::make_unique<GroupOp>(std::move(op), std::move(t_pipe.keys),
+                                   std::move(t_pipe.aggs),
+                                   std::move(t_pipe.group_out), t_catalog);
+  } else if (t_pipe.aggregate) {
+    op = std::make_unique<AggregateOp>(std::move(op), std::move(t_pipe.aggs));
+  }
+  if (!t_pipe.order.empty()) {
+    // hidden columns are sorted along, and never appended to the result.
+    auto types = t_pipe.types;
+    types.insert(types.end(), t_pipe.hidden.begin(), t_pipe.hidden.end());
+    std::optional<std::size_t> top;
+    if (t_pipe.limit) {
+      top = *t_pipe.limit + t_pipe.offset;
+    }
+    op = std::make_unique<SortOp>(std::move(op), std::move(t_pipe.order),
+                                  types, top, t_catalog);
+  }
+  if (t_pipe.limit || t_pipe.offset != 0) {
+    op = std::make_unique<LimitOp>(
+        std::move(op),
+        t_pipe.limit.value_or(std::numeric_limits<std::size_t>::max()),
+        t_pipe.offset);
+  }
+  Batch batch;
+  while (op->next(batch)) {
+    append(batch, res.cols);
+  }
+  return res;
+}
+
+/**
+ * @brief Runs a query on the workers of a Scheduler, one morsel (range of
+ * pages) at a time. Each worker has its own pipeline, and its own partial
+ * aggregates, merged at the end. Rows come out in the same order as from a
+ * serial run.
+ *
+ * @param t_pipes One per worker.
+ */
+auto run_parallel(std::vector<Pipeline> t_pipes,
+                  std::span<const ColumnStore::RowRange> t_morsels,
+                  Scheduler& t_workers) -> ResultSet {
+  auto res = make_result(t_pipes.front());
+  // without aggregates, the rows of each morsel, in morsel order.
+  std::vector<std::vector<ColumnVector>> parts(
+      t_pipes.front().aggregate ? 0 : t_morsels.size(), res.cols);
+  t_workers.run(t_morsels.size(),
+                [&](std::size_t t_worker, std::size_t t_morsel) {
+                  auto& pipe = t_pipes[t_worker];
+                  pipe.scan->reset(t_morsels[t_morsel]);
+                  Batch batch;
+                  while (pipe.top->next(batch)) {
+                    if (!pipe.aggregate) {
+                      append(batch, parts[t_morsel]);
+                      continue;
+                    }
+                    for (auto& agg : pipe.aggs) {
+                      update(agg, batch);
+                    }
+                  }
+                });
+  if (t_pipes.front().aggregate) {
+    auto& aggs = t_pipes.front().aggs;
+    for (std::size_t i = 0; i < aggs.size(); ++i) {
+      for (std::size_t w = 1; w < t_pipes.size(); ++w) {
+        merge(aggs[i], t_pipes[w].aggs[i]);
+      }
+      finish(aggs[i], res.cols[i]);
+    }
+    return res;
+  }
+  for (auto& part : parts) {
+    Batch batch;
+    batch.n_rows = part.empty() ? 0 : part.front().size();
+    for (const auto& col : part) {
+      batch.cols.push_back(&col);
+    }
+    append(batch, res.cols);
+  }
+  return res;
+}
+
+auto select(const CompiledStatement& t_comp, const Catalog& t_catalog,
+            std::span<const ParamValue> t_params)
+    -> std::expected<ResultSet, ExecError> {
+  auto tbls = tables_of(*t_comp.sel, t_catalog);
+  if (!tbls) {
+    return std::unexpected{tbls.error()};
+  }
+  const TableRef* tbl = tbls->empty() ? nullptr : tbls->front();
+  auto pipe = instantiate(t_comp, *tbls, tbl == nullptr ? nullptr : tbl->in,
+                          t_params, t_catalog);
+  if (!pipe) {
+    return std::unexpected{pipe.error()};
+  }
+  // LIMIT stops a serial scan early, which is usually better than a
+  // parallel one reading everything. GROUP BY, ORDER BY and joins only run
+  // serially, since spill files aren't thread-safe.
+  auto* workers = t_catalog.workers();
+  if (workers == nullptr || workers->n_workers() < 2 || tbl == nullptr ||
+      !tbl->open || pipe->limit || pipe->offset != 0 || !pipe->keys.empty() ||
+      !pipe->order.empty() || pipe->scan == nullptr) {
+    return run_serial(std::move(*pipe), t_catalog);
+  }
+  auto morsels = tbl->store->split(t_catalog.morsel_rows());
+  if (morsels.size() < 2) {
+    return run_serial(std::move(*pipe), t_catalog);
+  }
+
+  // each worker reads its own stream, through its own pipeline. Building
+  // it again can't fail.
+  std::vector<std::unique_ptr<std::istream>> streams;
+  std::vector<Pipeline> pipes;
+  for (std::size_t w = 0; w < workers->n_workers(); ++w) {
+    streams.push_back(tbl->open());
+    pipes.push_back(*instantiate(t_comp, *tbls, streams.back().get(),
+                                 t_params, t_catalog));
+  }
+  return run_parallel(std::move(pipes), morsels, *workers);
+}
+
+} // namespace
+
+auto compile(const Statement& t_stmt, const Catalog& t_catalog,
+             std::span<const ParamValue> t_params)
+    -> std::expected<std::shared_ptr<const CompiledStatement>, ExecError> {
+  const auto* sel = std::get_if<Select>(&t_stmt);
+  if (sel == nullptr) {
+    return std::unexpected{ExecError::Unsupported};
+  }
+  auto comp = compile_select(*sel, t_catalog, t_params);
+  if (!comp) {
+    return std::unexpected{comp.error()};
+  }
+  return std::make_shared<const CompiledStatement>(std::move(*comp));
+}
+
+auto is_current(const CompiledStatement& t_comp, const Catalog& t_catalog,
+                std::span<const ParamValue> t_params) -> bool {
+  return t_comp.version == t_catalog.version() &&
+         t_comp.params == param_types(t_params);
+}
+
+auto run(const CompiledStatement& t_comp, const Catalog& t_catalog,
+         std::span<const ParamValue> t_params)
+    -> std::expected<ResultSet, ExecError> {
+  assert(is_current(t_comp, t_catalog, t_params));
+  return select(t_comp, t_catalog, t_params);
+}
+
+auto execute(const Statement& t_stmt, const Catalog& t_catalog,
+             std::span<const ParamValue> t_params)
+    -> std::expected<ResultSet, ExecError> {
+  auto comp = compile(t_stmt, t_catalog, t_params);
+  if (!comp) {
+    return std::unexpected{comp.error()};
+  }
+  return run(**comp, t_catalog, t_params);
+}
+
+} // namespace tinydb
@@ -0,0 +1,238 @@
+/**
+ * @file exec.hxx
+ * @brief Runs statements over the columnar tables, one batch at a time.
+ *
+ * A query is a pipeline of operators (scan, join, filter, project,
+ * aggregate, group, limit), each pulling batches from the one before it with
+ * `next`. A batch is up to `ColumnStore::BATCH_SIZE` rows, so the cost of
+ * passing batches around and of everything that isn't a loop over the
+ * values is paid once per few thousand rows. See vector_expr.hxx for the loops
+ * themselves, hash_agg.hxx for GROUP BY and join.hxx for joins.
+ *
+ * With a Scheduler, a table scan is split into morsels (ranges of whole
+ * pages) and each worker runs its own copy of the pipeline over the morsels
+ * it takes, aggregating into its own partial results. These are merged once
+ * every morsel is done.
+ *
+ * Filters don't copy the rows they keep: they only narrow down the
+ * selection of the batch. Rows are only copied once, into the ResultSet.
+ *
+ * A statement can be compiled once (see `compile`) and run any number of
+ * times, with other values for its `?`: only the operators are built again
+ * for every run.
+ */
+
+#ifndef TINYDB_EXEC_HXX
+#define TINYDB_EXEC_HXX
+
+#include "ast.hxx"
+#include "scheduler.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.internal.column_store;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/internal/column_store.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#include "dbfile/internal/tbl.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tinydb {
+
+/**
+ * @brief A table queries can read: its metadata, its rows, and the stream
+ * they're read from. None of them are owned.
+ */
+struct TableRef {
+    const dbfile::internal::TableMeta* meta;
+    const dbfile::internal::ColumnStore* store;
+    std::istream* in;
+    /**
+     * @brief Opens another stream over the same rows, for a worker thread
+     * to read on its own. Without it, the table is only ever scanned by the
+     * calling thread.
+     */
+    std::function<std::unique_ptr<std::istream>()> open{};
+};
+
+/**
+ * @class Catalog
+ * @brief The tables statements can refer to, by name.
+ */
+class Catalog {
+  public:
+    /**
+     * @return false if there's already a table of the same name.
+     */
+    auto add(TableRef t_tbl) -> bool;
+
+    /**
+     * @return A number that changes whenever a table is added. A statement
+     * compiled against another one must be compiled again.
+     */
+    [[nodiscard]] auto version() const noexcept -> uint64_t {
+        return m_version;
+    }
+
+    /**
+     * @return nullptr if there's no such table.
+     */
+    [[nodiscard]] auto find(std::string_view t_name) const
+        -> const TableRef*;
+
+    /**
+     * @brief Scans tables with a pool of threads from now on, each taking
+     * ranges of whole pages of about `t_morsel_rows` rows. nullptr goes back
+     * to scanning on the calling thread. The pool isn't owned.
+     */
+    void set_workers(Scheduler* t_workers,
+                     std::size_t t_morsel_rows = MORSEL_ROWS) noexcept {
+        m_workers = t_workers;
+        m_morsel_rows = t_morsel_rows;
+    }
+
+    [[nodiscard]] auto workers() const noexcept -> Scheduler* {
+        return m_workers;
+    }
+
+    [[nodiscard]] auto morsel_rows() const noexcept -> std::size_t {
+        return m_morsel_rows;
+    }
+
+    /**
+     * @brief Lets operators write what doesn't fit in `t_mem_limit` bytes to
+     * temporary pages from now on. Without it, they use as much memory as
+     * they need.
+     */
+    void set_spill(dbfile::internal::SpillSpace t_space,
+                   std::size_t t_mem_limit = MEM_LIMIT) noexcept {
+        m_spill = t_space;
+        m_mem_limit = t_mem_limit;
+    }
+
+    [[nodiscard]] auto spill() const noexcept
+        -> const std::optional<dbfile::internal::SpillSpace>& {
+        return m_spill;
+    }
+
+    [[nodiscard]] auto mem_limit() const noexcept -> std::size_t {
+        return m_mem_limit;
+    }
+
+    // big enough for a worker to spend far longer scanning than being
+    // handed the morsel.
+    static constexpr std::size_t MORSEL_ROWS =
+        std::size_t{16} * dbfile::internal::ColumnStore::BATCH_SIZE;
+    static constexpr std::size_t MEM_LIMIT = std::size_t{64} * 1024 * 1024;
+
+  private:
+    std::vector<TableRef> m_tables{};
+    uint64_t m_version{next_version()};
+    Scheduler* m_workers{nullptr};
+    std::size_t m_morsel_rows{MORSEL_ROWS};
+    std::optional<dbfile::internal::SpillSpace> m_spill{};
+    std::size_t m_mem_limit{MEM_LIMIT};
+
+    static auto next_version() noexcept -> uint64_t;
+};
+
+/**
+ * @class Operator
+ * @brief One step of a query pipeline.
+ */
+class Operator {
+  public:
+    Operator() = default;
+    Operator(const Operator&) = delete;
+    Operator(Operator&&) = delete;
+    auto operator=(const Operator&) -> Operator& = delete;
+    auto operator=(Operator&&) -> Operator& = delete;
+    virtual ~Operator() = default;
+
+    /**
+     * @brief Produces the next batch, valid until the next call.
+     * @return false once there are no more rows.
+     */
+    virtual auto next(Batch& t_out) -> bool = 0;
+};
+
+/**
+ * @class ResultSet
+ * @brief The rows a query returns, one vector per column. Bool columns are
+ * stored as Uint8, integer ones as Int64 and float ones as Float64.
+ */
+struct ResultSet {
+    std::vector<std::string> names;
+    std::vector<VType> types;
+    std::vector<dbfile::internal::ColumnVector> cols;
+
+    [[nodiscard]] auto n_rows() const noexcept -> std::size_t {
+        return cols.empty() ? 0 : cols.front().size();
+    }
+};
+
+/**
+ * @brief A statement, compiled for the tables of a Catalog and the types of
+ * the values of its `?`.
+ */
+struct CompiledStatement;
+
+/**
+ * @brief Compiles a statement, to run it any number of times (see `run`).
+ * The statement must outlive it.
+ *
+ * @param t_params The values of the `?`. Only whether each is NULL, or of
+ * which type, matters: every run gives its own values.
+ */
+auto compile(const Statement& t_stmt, const Catalog& t_catalog,
+             std::span<const ParamValue> t_params)
+    -> std::expected<std::shared_ptr<const CompiledStatement>, ExecError>;
+
+/**
+ * @return Whether a compiled statement can still run with a catalog and
+ * values for its `?`: no table added since, and values of the same types.
+ */
+auto is_current(const CompiledStatement& t_comp, const Catalog& t_catalog,
+                std::span<const ParamValue> t_params) -> bool;
+
+/**
+ * @brief Runs a compiled statement, which must be current (see
+ * `is_current`).
+ */
+auto run(const CompiledStatement& t_comp, const Catalog& t_catalog,
+         std::span<const ParamValue> t_params)
+    -> std::expected<ResultSet, ExecError>;
+
+/**
+ * @brief Compiles a statement and runs it once.
+ *
+ * Only SELECT runs for now. Aggregates (COUNT, SUM, MIN, MAX, AVG) are
+ * allowed at the top of the selected items, and then every item must be
+ * one, unless grouped. With aggregates, ORDER BY can only name selected
+ * items, by alias or written the same way. Tables are joined on equal columns:
+ * each ON must have at least one `a = b`, with `b` a column of the table
+ * joined and `a` one of a table before it.
+ *
+ * @param t_params The values of the `?` of the statement.
+ */
+auto execute(const Statement& t_stmt, const Catalog& t_catalog,
+             std::span<const ParamValue> t_params)
+    -> std::expected<ResultSet, ExecError>;
+
+} // namespace tinydb
+
+#endif // !TINYDB_EXEC_HXX
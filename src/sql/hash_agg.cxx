@@ -0,0 +1,662 @@
+#include "hash_agg.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tinydb {
+
+using dbfile::internal::ColumnVector;
+using dbfile::internal::SpillFile;
+
+namespace {
+
+constexpr uint64_t HASH_MUL = 0x9e3779b97f4a7c15ULL;
+// spilled groups are written a few pages at a time.
+constexpr std::size_t SPILL_CHUNK = std::size_t{64} * 1024;
+
+auto fmix(uint64_t t_h) -> uint64_t {
+  t_h ^= t_h >> 33U;
+  t_h *= 0xff51afd7ed558ccdULL;
+  t_h ^= t_h >> 33U;
+  t_h *= 0xc4ceb9fe1a85ec53ULL;
+  t_h ^= t_h >> 33U;
+  return t_h;
+}
+
+auto mix(uint64_t t_h, uint64_t t_val) -> uint64_t {
+  return (std::rotl(t_h, 27) ^ t_val) * HASH_MUL;
+}
+
+/**
+ * @brief Which field of a GroupTable's state an aggregate keeps its value
+ * in, besides its count.
+ */
+enum class Field : uint8_t { None, Ints, Floats, Texts };
+
+auto field_of(const AggSpec& t_spec) -> Field {
+  switch (t_spec.kind) {
+  case AggKind::CountStar:
+  case AggKind::Count:
+    return Field::None;
+  case AggKind::Avg:
+    return Field::Floats;
+  default:
+    break;
+  }
+  switch (t_spec.type) {
+  case VType::Float:
+    return Field::Floats;
+  case VType::Text:
+    return Field::Texts;
+  default:
+    return Field::Ints;
+  }
+}
+
+auto wrapping_add(int64_t t_a, int64_t t_b) -> int64_t {
+  return static_cast<int64_t>(static_cast<uint64_t>(t_a) +
+                              static_cast<uint64_t>(t_b));
+}
+
+template <typename T> void put(std::vector<std::byte>& t_out, const T& t_val) {
+  const auto* src = std::bit_cast<const std::byte*>(&t_val);
+  t_out.insert(t_out.end(), src, src + sizeof(T));
+}
+
+template <typename T>
+auto get(SpillFile::Reader& t_reader, std::istream& t_in, T& t_val) -> bool {
+  return t_reader.read({std::bit_cast<std::byte*>(&t_val), sizeof(T)}, t_in);
+}
+
+/**
+ * @brief The width of a key column in a key, without its NULL flag. Text is
+ * its length, then the string.
+ */
+auto width_of(VType t_type) -> std::size_t {
+  switch (t_type) {
+  case VType::Bool:
+    return 1;
+  case VType::Text:
+    return sizeof(uint32_t);
+  default:
+    return sizeof(int64_t);
+  }
+}
+
+} // namespace
+
+void KeyEncoder::encode(std::span<const ColumnVector* const> t_keys,
+                        std::span<const uint32_t> t_rows) {
+  const auto n = t_rows.size();
+  m_hashes.assign(n, HASH_MUL);
+  // the size of each key first, then the keys themselves, column by column.
+  m_off.assign(n + 1, 0);
+  for (std::size_t k = 0; k < t_keys.size(); ++k) {
+    const auto& col = *t_keys[k];
+    const auto width = 1 + width_of(m_types[k]);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto row = t_rows[i];
+      m_off[i + 1] += width;
+      if (m_types[k] == VType::Text && !col.is_null(row)) {
+        m_off[i + 1] += col.text(row).size();
+      }
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    m_off[i + 1] += m_off[i];
+  }
+  m_bytes.resize(m_off[n]);
+  std::vector<std::size_t> pos{m_off.begin(), m_off.end() - 1};
+  for (std::size_t k = 0; k < t_keys.size(); ++k) {
+    const auto& col = *t_keys[k];
+    const auto type = m_types[k];
+    const auto width = width_of(type);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto row = t_rows[i];
+      auto* dst = m_bytes.data() + pos[i];
+      const bool null = col.is_null(row);
+      dst[0] = static_cast<std::byte>(!null);
+      uint64_t bits{0};
+      std::string_view str;
+      if (null) {
+        // NULL is a value of its own, distinct from anything else.
+        bits = std::numeric_limits<uint64_t>::max();
+      } else if (type == VType::Text) {
+        str = col.text(row);
+        bits = str.size();
+      } else if (type == VType::Float) {
+        auto val = col.values<double>()[row];
+        // -0.0 == 0.0, and every NaN is the same.
+        if (val == 0) {
+          val = 0;
+        } else if (std::isnan(val)) {
+          val = std::numeric_limits<double>::quiet_NaN();
+        }
+        bits = std::bit_cast<uint64_t>(val);
+      } else if (type == VType::Bool) {
+        bits = static_cast<uint64_t>(col.values<uint8_t>()[row] != 0);
+      } else {
+        bits = std::bit_cast<uint64_t>(col.values<int64_t>()[row]);
+      }
+      std::memcpy(dst + 1, &bits, width);
+      auto hash = mix(m_hashes[i], bits);
+      if (!str.empty()) {
+        std::memcpy(dst + 1 + width, str.data(), str.size());
+        for (std::size_t off = 0; off < str.size(); off += sizeof(uint64_t)) {
+          uint64_t word{0};
+          std::memcpy(&word, str.data() + off,
+                      std::min(sizeof(word), str.size() - off));
+          hash = mix(hash, word);
+        }
+      }
+      m_hashes[i] = hash;
+      pos[i] += 1 + width + str.size();
+    }
+  }
+  for (auto& hash : m_hashes) {
+    hash = fmix(hash);
+  }
+}
+
+void KeyEncoder::decode(std::span<const std::byte> t_key,
+                        std::span<ColumnVector> t_out) const {
+  std::size_t pos{0};
+  for (std::size_t k = 0; k < m_types.size(); ++k) {
+    const auto type = m_types[k];
+    const auto width = width_of(type);
+    const bool null = t_key[pos] == std::byte{0};
+    uint64_t bits{0};
+    std::memcpy(&bits, t_key.data() + pos + 1, width);
+    pos += 1 + width;
+    auto& out = t_out[k];
+    if (null) {
+      out.push_null();
+      continue;
+    }
+    switch (type) {
+    case VType::Bool:
+      out.push(static_cast<uint8_t>(bits));
+      break;
+    case VType::Int:
+      out.push(std::bit_cast<int64_t>(bits));
+      break;
+    case VType::Float:
+      out.push(std::bit_cast<double>(bits));
+      break;
+    case VType::Text:
+      out.push_text({std::bit_cast<const char*>(t_key.data() + pos), bits});
+      pos += bits;
+      break;
+    }
+  }
+}
+
+GroupTable::GroupTable(std::span<const AggSpec> t_aggs)
+    : m_aggs{t_aggs.begin(), t_aggs.end()}, m_state(t_aggs.size()),
+      m_slots(16, Slot{.tag = 0, .group = EMPTY}) {}
+
+auto GroupTable::find_or_add(uint64_t t_hash, std::span<const std::byte> t_key)
+    -> uint32_t {
+  // at most half full: probes stay short.
+  if ((size() + 1) * 2 > m_slots.size()) {
+    grow();
+  }
+  const auto mask = m_slots.size() - 1;
+  const auto tag = static_cast<uint32_t>(t_hash >> 32U);
+  for (auto idx = t_hash & mask;; idx = (idx + 1) & mask) {
+    auto& slot = m_slots[idx];
+    if (slot.group == EMPTY) {
+      const auto group = static_cast<uint32_t>(size());
+      slot = {.tag = tag, .group = group};
+      m_hashes.push_back(t_hash);
+      m_keys.insert(m_keys.end(), t_key.begin(), t_key.end());
+      m_key_off.push_back(static_cast<uint32_t>(m_keys.size()));
+      for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+        auto& state = m_state[a];
+        state.counts.push_back(0);
+        switch (field_of(m_aggs[a])) {
+        case Field::Ints:
+          state.ints.push_back(0);
+          break;
+        case Field::Floats:
+          state.floats.push_back(0);
+          break;
+        case Field::Texts:
+          state.texts.emplace_back();
+          break;
+        default:
+          break;
+        }
+      }
+      return group;
+    }
+    if (slot.tag == tag && std::ranges::equal(key(slot.group), t_key)) {
+      return slot.group;
+    }
+  }
+}
+
+void GroupTable::grow() {
+  std::vector<Slot> slots(m_slots.size() * 2, Slot{.tag = 0, .group = EMPTY});
+  const auto mask = slots.size() - 1;
+  for (uint32_t group = 0; group < size(); ++group) {
+    const auto hash = m_hashes[group];
+    auto idx = hash & mask;
+    while (slots[idx].group != EMPTY) {
+      idx = (idx + 1) & mask;
+    }
+    slots[idx] = {.tag = static_cast<uint32_t>(hash >> 32U), .group = group};
+  }
+  m_slots = std::move(slots);
+}
+
+void GroupTable::update(std::size_t t_agg, const ColumnVector* t_vals,
+                        std::span<const uint32_t> t_rows,
+                        std::span<const uint32_t> t_groups) {
+  const auto& spec = m_aggs[t_agg];
+  auto& state = m_state[t_agg];
+  auto* counts = state.counts.data();
+  const auto n = t_rows.size();
+  if (spec.kind == AggKind::CountStar) {
+    for (std::size_t i = 0; i < n; ++i) {
+      ++counts[t_groups[i]];
+    }
+    return;
+  }
+  const auto& vals = *t_vals;
+  if (spec.kind == AggKind::Count) {
+    for (std::size_t i = 0; i < n; ++i) {
+      counts[t_groups[i]] += static_cast<int64_t>(!vals.is_null(t_rows[i]));
+    }
+    return;
+  }
+  const bool sum = spec.kind == AggKind::Sum || spec.kind == AggKind::Avg;
+  const bool max = spec.kind == AggKind::Max;
+  // a loop per field and type, each with nothing else inside.
+  auto fold = [&]<typename T, typename Acc>(std::span<Acc> t_acc) {
+    const auto* src = vals.values<T>().data();
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto row = t_rows[i];
+      if (vals.is_null(row)) {
+        continue;
+      }
+      const auto group = t_groups[i];
+      const auto val = static_cast<Acc>(src[row]);
+      auto& acc = t_acc[group];
+      if (sum) {
+        if constexpr (std::is_same_v<Acc, int64_t>) {
+          acc = wrapping_add(acc, val);
+        } else {
+          acc += val;
+        }
+      } else if (counts[group] == 0 || (max ? val > acc : val < acc)) {
+        acc = val;
+      }
+      ++counts[group];
+    }
+  };
+  switch (field_of(spec)) {
+  case Field::Ints:
+    if (spec.type == VType::Bool) {
+      fold.operator()<uint8_t, int64_t>(std::span{state.ints});
+    } else {
+      fold.operator()<int64_t, int64_t>(std::span{state.ints});
+    }
+    break;
+  case Field::Floats:
+    if (spec.type == VType::Int) {
+      fold.operator()<int64_t, double>(std::span{state.floats});
+    } else {
+      fold.operator()<double, double>(std::span{state.floats});
+    }
+    break;
+  case Field::Texts:
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto row = t_rows[i];
+      if (vals.is_null(row)) {
+        continue;
+      }
+      const auto group = t_groups[i];
+      auto str = vals.text(row);
+      auto& best = state.texts[group];
+      if (counts[group] == 0 || (max ? str > best : str < best)) {
+        m_text_bytes = m_text_bytes + str.size() - best.size();
+        best = str;
+      }
+      ++counts[group];
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void GroupTable::merge(uint32_t t_group, std::size_t t_agg, int64_t t_count,
+                       int64_t t_int, double t_float,
+                       std::string_view t_text) {
+  const auto& spec = m_aggs[t_agg];
+  auto& state = m_state[t_agg];
+  const auto field = field_of(spec);
+  if (spec.kind == AggKind::Sum || spec.kind == AggKind::Avg) {
+    if (field == Field::Ints) {
+      state.ints[t_group] = wrapping_add(state.ints[t_group], t_int);
+    } else {
+      state.floats[t_group] += t_float;
+    }
+  } else if (field != Field::None && t_count != 0) {
+    const bool max = spec.kind == AggKind::Max;
+    const bool first = state.counts[t_group] == 0;
+    switch (field) {
+    case Field::Ints: {
+      auto& best = state.ints[t_group];
+      best = first || (max ? t_int > best : t_int < best) ? t_int : best;
+      break;
+    }
+    case Field::Floats: {
+      auto& best = state.floats[t_group];
+      best = first || (max ? t_float > best : t_float < best) ? t_float : best;
+      break;
+    }
+    default: {
+      auto& best = state.texts[t_group];
+      if (first || (max ? t_text > best : t_text < best)) {
+        m_text_bytes = m_text_bytes + t_text.size() - best.size();
+        best = t_text;
+      }
+      break;
+    }
+    }
+  }
+  state.counts[t_group] += t_count;
+}
+
+void GroupTable::absorb(const GroupTable& t_other, uint32_t t_group) {
+  const auto group = find_or_add(t_other.hash(t_group), t_other.key(t_group));
+  for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+    const auto& state = t_other.m_state[a];
+    const auto field = field_of(m_aggs[a]);
+    merge(group, a, state.counts[t_group],
+          field == Field::Ints ? state.ints[t_group] : 0,
+          field == Field::Floats ? state.floats[t_group] : 0,
+          field == Field::Texts ? std::string_view{state.texts[t_group]}
+                                : std::string_view{});
+  }
+}
+
+// a group: its hash, the length of its key, its key, then for each
+// aggregate its count and the value of its field, if any.
+void GroupTable::write_group(uint32_t t_group,
+                             std::vector<std::byte>& t_out) const {
+  put(t_out, m_hashes[t_group]);
+  auto key_bytes = key(t_group);
+  put(t_out, static_cast<uint32_t>(key_bytes.size()));
+  t_out.insert(t_out.end(), key_bytes.begin(), key_bytes.end());
+  for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+    const auto& state = m_state[a];
+    put(t_out, state.counts[t_group]);
+    switch (field_of(m_aggs[a])) {
+    case Field::Ints:
+      put(t_out, state.ints[t_group]);
+      break;
+    case Field::Floats:
+      put(t_out, state.floats[t_group]);
+      break;
+    case Field::Texts: {
+      const auto& str = state.texts[t_group];
+      put(t_out, static_cast<uint32_t>(str.size()));
+      const auto* src = std::bit_cast<const std::byte*>(str.data());
+      t_out.insert(t_out.end(), src, src + str.size());
+      break;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+auto GroupTable::read_group(SpillFile::Reader& t_reader, std::istream& t_in)
+    -> bool {
+  uint64_t hash{0};
+  uint32_t len{0};
+  if (!get(t_reader, t_in, hash) || !get(t_reader, t_in, len)) {
+    return false;
+  }
+  std::vector<std::byte> key_bytes(len);
+  t_reader.read(key_bytes, t_in);
+  const auto group = find_or_add(hash, key_bytes);
+  std::string text;
+  for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+    int64_t count{0};
+    int64_t ival{0};
+    double fval{0};
+    get(t_reader, t_in, count);
+    switch (field_of(m_aggs[a])) {
+    case Field::Ints:
+      get(t_reader, t_in, ival);
+      break;
+    case Field::Floats:
+      get(t_reader, t_in, fval);
+      break;
+    case Field::Texts:
+      get(t_reader, t_in, len);
+      text.resize(len);
+      t_reader.read({std::bit_cast<std::byte*>(text.data()), len}, t_in);
+      break;
+    default:
+      break;
+    }
+    merge(group, a, count, ival, fval, text);
+  }
+  return true;
+}
+
+void GroupTable::finish(std::span<ColumnVector> t_out) const {
+  for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+    const auto& spec = m_aggs[a];
+    const auto& state = m_state[a];
+    auto& out = t_out[a];
+    for (std::size_t group = 0; group < size(); ++group) {
+      const auto count = state.counts[group];
+      if (spec.kind == AggKind::CountStar || spec.kind == AggKind::Count) {
+        out.push(count);
+        continue;
+      }
+      // an aggregate of nothing is NULL, except for COUNT.
+      if (count == 0) {
+        out.push_null();
+        continue;
+      }
+      if (spec.kind == AggKind::Avg) {
+        out.push(state.floats[group] / static_cast<double>(count));
+        continue;
+      }
+      switch (field_of(spec)) {
+      case Field::Ints:
+        if (spec.type == VType::Bool) {
+          out.push(static_cast<uint8_t>(state.ints[group]));
+        } else {
+          out.push(state.ints[group]);
+        }
+        break;
+      case Field::Floats:
+        out.push(state.floats[group]);
+        break;
+      default:
+        out.push_text(state.texts[group]);
+        break;
+      }
+    }
+  }
+}
+
+auto GroupTable::memory() const noexcept -> std::size_t {
+  auto ret = (m_slots.size() * sizeof(Slot)) +
+             (size() * (sizeof(uint64_t) + sizeof(uint32_t))) +
+             m_keys.size() + m_text_bytes;
+  for (const auto& state : m_state) {
+    ret += (state.counts.size() + state.ints.size()) * sizeof(int64_t) +
+           (state.floats.size() * sizeof(double)) +
+           (state.texts.size() * sizeof(std::string));
+  }
+  return ret;
+}
+
+HashAggregator::HashAggregator(
+    std::vector<VType> t_keys, std::vector<AggSpec> t_aggs,
+    std::optional<dbfile::internal::SpillSpace> t_spill,
+    std::size_t t_mem_limit)
+    : m_enc{std::move(t_keys)}, m_aggs{std::move(t_aggs)},
+      m_spill{t_spill}, m_mem_limit{t_mem_limit}, m_parts{GroupTable{m_aggs}},
+      m_files(1) {}
+
+HashAggregator::~HashAggregator() {
+  if (!m_spill) {
+    return;
+  }
+  for (auto& file : m_files) {
+    file.free_pages(*m_spill->fl, *m_spill->io);
+  }
+}
+
+void HashAggregator::add(const Batch& t_batch,
+                         std::span<const ColumnVector* const> t_keys,
+                         std::span<const ColumnVector* const> t_args) {
+  if (t_batch.selective) {
+    m_rows.assign(t_batch.sel.begin(), t_batch.sel.end());
+  } else {
+    m_rows.resize(t_batch.n_rows);
+    for (uint32_t i = 0; i < m_rows.size(); ++i) {
+      m_rows[i] = i;
+    }
+  }
+  if (m_rows.empty()) {
+    return;
+  }
+  m_enc.encode(t_keys, m_rows);
+
+  // sorted by partition, keeping the order of the rows inside each.
+  const auto n_parts = m_parts.size();
+  m_bounds.assign(n_parts + 1, 0);
+  for (std::size_t i = 0; i < m_rows.size(); ++i) {
+    ++m_bounds[partition_of(m_enc.hash(i)) + 1];
+  }
+  for (std::size_t p = 0; p < n_parts; ++p) {
+    m_bounds[p + 1] += m_bounds[p];
+  }
+  m_order.resize(m_rows.size());
+  {
+    std::vector<uint32_t> next{m_bounds.begin(), m_bounds.end() - 1};
+    for (uint32_t i = 0; i < m_rows.size(); ++i) {
+      m_order[next[partition_of(m_enc.hash(i))]++] = i;
+    }
+  }
+
+  for (std::size_t p = 0; p < n_parts; ++p) {
+    const auto first = m_bounds[p];
+    const auto len = m_bounds[p + 1] - first;
+    if (len == 0) {
+      continue;
+    }
+    auto& table = m_parts[p];
+    m_part_rows.resize(len);
+    m_groups.resize(len);
+    for (std::size_t j = 0; j < len; ++j) {
+      const auto i = m_order[first + j];
+      m_part_rows[j] = m_rows[i];
+      m_groups[j] = table.find_or_add(m_enc.hash(i), m_enc.key(i));
+    }
+    for (std::size_t a = 0; a < m_aggs.size(); ++a) {
+      table.update(a, t_args[a], m_part_rows, m_groups);
+    }
+  }
+
+  if (m_n_spills == 0 && m_bits < MAX_BITS &&
+      memory() > L2_BYTES * m_parts.size()) {
+    split();
+  }
+  while (m_spill && memory() > m_mem_limit && spill_largest()) {
+  }
+}
+
+void HashAggregator::split() {
+  ++m_bits;
+  std::vector<GroupTable> parts(m_parts.size() * 2, GroupTable{m_aggs});
+  for (const auto& part : m_parts) {
+    for (uint32_t group = 0; group < part.size(); ++group) {
+      parts[partition_of(part.hash(group))].absorb(part, group);
+    }
+  }
+  m_parts = std::move(parts);
+  m_files.resize(m_parts.size());
+}
+
+auto HashAggregator::spill_largest() -> bool {
+  auto largest = std::ranges::max_element(
+      m_parts, {}, [](const GroupTable& t_part) { return t_part.size(); });
+  if (largest->size() == 0) {
+    return false;
+  }
+  auto& file = m_files[static_cast<std::size_t>(largest - m_parts.begin())];
+  std::vector<std::byte> buf;
+  for (uint32_t group = 0; group < largest->size(); ++group) {
+    largest->write_group(group, buf);
+    if (buf.size() >= SPILL_CHUNK) {
+      file.write(buf, *m_spill->fl, *m_spill->io);
+      buf.clear();
+    }
+  }
+  file.write(buf, *m_spill->fl, *m_spill->io);
+  *largest = GroupTable{m_aggs};
+  ++m_n_spills;
+  return true;
+}
+
+void HashAggregator::emit(std::size_t t_part, std::span<ColumnVector> t_out) {
+  auto& table = m_parts[t_part];
+  auto& file = m_files[t_part];
+  if (file.n_bytes() != 0) {
+    file.flush(*m_spill->io);
+    auto reader = file.reader();
+    while (table.read_group(reader, *m_spill->io)) {
+    }
+    file.free_pages(*m_spill->fl, *m_spill->io);
+  }
+
+  for (uint32_t group = 0; group < table.size(); ++group) {
+    m_enc.decode(table.key(group), t_out);
+  }
+  table.finish(t_out.subspan(m_enc.types().size()));
+  table = GroupTable{m_aggs};
+}
+
+auto HashAggregator::memory() const noexcept -> std::size_t {
+  std::size_t ret{0};
+  for (const auto& part : m_parts) {
+    ret += part.memory();
+  }
+  return ret;
+}
+
+} // namespace tinydb
@@ -0,0 +1,305 @@
+/**
+ * @file hash_agg.hxx
+ * @brief GROUP BY: aggregates per distinct value of some keys.
+ *
+ * Groups live in a GroupTable, a hash table with open addressing: a flat
+ * array of slots, each holding a group number and 32 bits of the hash of
+ * its key, probed linearly. A lookup reads consecutive slots and only looks
+ * at a key when those 32 bits match. Full hashes are kept per group, so
+ * growing the table never hashes a key again. The state of the aggregates
+ * is one array per field (counts, sums, ...) indexed by group: updating
+ * SUM(x) for a batch only touches an array of sums.
+ *
+ * A HashAggregator splits groups into partitions by the top bits of their
+ * hash, a GroupTable each, and processes a batch one partition at a time:
+ * rows are first sorted by partition, so that all the lookups of a
+ * partition hit the same table, small enough to stay in L2. The number of
+ * partitions doubles whenever they outgrow `L2_BYTES` on average.
+ *
+ * Given somewhere to spill, the largest partition is written to temporary
+ * pages whenever the partitions take more memory than allowed, and starts
+ * over empty. What it spilled is merged back when it's emitted, one
+ * partition at a time. Partitions stop splitting once one has spilled.
+ */
+
+#ifndef TINYDB_HASH_AGG_HXX
+#define TINYDB_HASH_AGG_HXX
+
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tinydb {
+
+enum class AggKind : uint8_t { CountStar, Count, Sum, Min, Max, Avg };
+
+/**
+ * @brief An aggregate, as far as its state is concerned.
+ */
+struct AggSpec {
+    AggKind kind;
+    // of the argument. Ignored for COUNT(*).
+    VType type;
+
+    [[nodiscard]] constexpr auto out_type() const noexcept -> VType {
+        switch (kind) {
+        case AggKind::CountStar:
+        case AggKind::Count:
+            return VType::Int;
+        case AggKind::Avg:
+            return VType::Float;
+        default:
+            return type;
+        }
+    }
+};
+
+/**
+ * @class KeyEncoder
+ * @brief Turns the keys of some rows into bytes, equal if and only if the
+ * keys are, and hashes them.
+ *
+ * Each column of a key is a byte, 0 if NULL, then its value: 8 bytes for
+ * numbers, 1 for booleans, and the length (4 bytes) then the string for
+ * Text. NULL is a value of its own, equal to itself.
+ */
+class KeyEncoder {
+  public:
+    explicit KeyEncoder(std::vector<VType> t_types)
+        : m_types{std::move(t_types)} {}
+
+    [[nodiscard]] auto types() const noexcept -> std::span<const VType> {
+        return m_types;
+    }
+
+    /**
+     * @brief Encodes the keys of some rows, forgetting the previous ones.
+     * @param t_keys The values of the keys, of `storage_type` of their type.
+     */
+    void encode(std::span<const dbfile::internal::ColumnVector* const> t_keys,
+                std::span<const uint32_t> t_rows);
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return m_hashes.size();
+    }
+
+    /**
+     * @return The hash of the key of the `t_i`th row encoded.
+     */
+    [[nodiscard]] auto hash(std::size_t t_i) const -> uint64_t {
+        return m_hashes[t_i];
+    }
+
+    [[nodiscard]] auto key(std::size_t t_i) const
+        -> std::span<const std::byte> {
+        return std::span{m_bytes}.subspan(m_off[t_i],
+                                          m_off[t_i + 1] - m_off[t_i]);
+    }
+
+    /**
+     * @brief Appends the columns of an encoded key to one vector each.
+     */
+    void decode(std::span<const std::byte> t_key,
+                std::span<dbfile::internal::ColumnVector> t_out) const;
+
+  private:
+    std::vector<VType> m_types;
+    std::vector<uint64_t> m_hashes{};
+    std::vector<std::size_t> m_off{};
+    std::vector<std::byte> m_bytes{};
+};
+
+/**
+ * @class GroupTable
+ * @brief Groups, by key, and the state of their aggregates.
+ *
+ * Keys are opaque bytes, equal if and only if their groups are the same.
+ */
+class GroupTable {
+  public:
+    explicit GroupTable(std::span<const AggSpec> t_aggs);
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return m_hashes.size();
+    }
+
+    /**
+     * @return The group of a key, added if it's new.
+     */
+    auto find_or_add(uint64_t t_hash, std::span<const std::byte> t_key)
+        -> uint32_t;
+
+    /**
+     * @brief Adds values to aggregate `t_agg`: row `t_rows[i]` of `t_vals`
+     * goes to group `t_groups[i]`.
+     * @param t_vals The values of its argument, nullptr for COUNT(*).
+     */
+    void update(std::size_t t_agg, const dbfile::internal::ColumnVector* t_vals,
+                std::span<const uint32_t> t_rows,
+                std::span<const uint32_t> t_groups);
+
+    /**
+     * @brief Adds a group of another table, of the same aggregates.
+     */
+    void absorb(const GroupTable& t_other, uint32_t t_group);
+
+    /**
+     * @brief Appends a group, key and state, to some bytes.
+     */
+    void write_group(uint32_t t_group, std::vector<std::byte>& t_out) const;
+
+    /**
+     * @brief Reads a group written by `write_group`, and absorbs it.
+     * @return false at the end of the file.
+     */
+    auto read_group(dbfile::internal::SpillFile::Reader& t_reader,
+                    std::istream& t_in) -> bool;
+
+    [[nodiscard]] auto hash(uint32_t t_group) const -> uint64_t {
+        return m_hashes[t_group];
+    }
+
+    [[nodiscard]] auto key(uint32_t t_group) const
+        -> std::span<const std::byte> {
+        return std::span{m_keys}.subspan(
+            m_key_off[t_group], m_key_off[t_group + 1] - m_key_off[t_group]);
+    }
+
+    /**
+     * @brief Appends the value of every aggregate of every group, one vector
+     * per aggregate, of `storage_type(out_type())`.
+     */
+    void finish(std::span<dbfile::internal::ColumnVector> t_out) const;
+
+    /**
+     * @return About how many bytes the table takes.
+     */
+    [[nodiscard]] auto memory() const noexcept -> std::size_t;
+
+  private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot {
+        uint32_t tag;
+        uint32_t group;
+    };
+
+    // only the fields an aggregate uses are filled.
+    struct State {
+        // non-NULL values, or rows for COUNT(*).
+        std::vector<int64_t> counts;
+        std::vector<int64_t> ints;
+        std::vector<double> floats;
+        std::vector<std::string> texts;
+    };
+
+    std::vector<AggSpec> m_aggs;
+    std::vector<State> m_state;
+    std::vector<Slot> m_slots;
+    std::vector<uint64_t> m_hashes{};
+    std::vector<uint32_t> m_key_off{0};
+    std::vector<std::byte> m_keys{};
+    std::size_t m_text_bytes{0};
+
+    void grow();
+    void merge(uint32_t t_group, std::size_t t_agg, int64_t t_count,
+               int64_t t_int, double t_float, std::string_view t_text);
+};
+
+/**
+ * @class HashAggregator
+ * @brief GROUP BY over batches: partitions of groups, spilled if need be.
+ */
+class HashAggregator {
+  public:
+    // what a partition should fit in.
+    static constexpr std::size_t L2_BYTES = std::size_t{256} * 1024;
+    // at most 2^MAX_BITS partitions.
+    static constexpr unsigned MAX_BITS = 8;
+
+    /**
+     * @param t_spill Where to spill partitions once they take more than
+     * `t_mem_limit` bytes. Without it, nothing is ever spilled.
+     */
+    HashAggregator(std::vector<VType> t_keys, std::vector<AggSpec> t_aggs,
+                   std::optional<dbfile::internal::SpillSpace> t_spill,
+                   std::size_t t_mem_limit);
+    HashAggregator(const HashAggregator&) = delete;
+    HashAggregator(HashAggregator&&) = delete;
+    auto operator=(const HashAggregator&) -> HashAggregator& = delete;
+    auto operator=(HashAggregator&&) -> HashAggregator& = delete;
+    ~HashAggregator();
+
+    /**
+     * @brief Adds the selected rows of a batch.
+     * @param t_keys The values of the keys, of `storage_type` of their type.
+     * @param t_args The values of the argument of each aggregate, nullptr
+     * for COUNT(*).
+     */
+    void add(const Batch& t_batch,
+             std::span<const dbfile::internal::ColumnVector* const> t_keys,
+             std::span<const dbfile::internal::ColumnVector* const> t_args);
+
+    [[nodiscard]] auto n_partitions() const noexcept -> std::size_t {
+        return m_parts.size();
+    }
+
+    /**
+     * @brief Appends the groups of a partition to `t_out`, the keys then the
+     * aggregates, and forgets them.
+     */
+    void emit(std::size_t t_part,
+              std::span<dbfile::internal::ColumnVector> t_out);
+
+    [[nodiscard]] auto memory() const noexcept -> std::size_t;
+
+    /**
+     * @return How many times a partition was spilled.
+     */
+    [[nodiscard]] auto n_spills() const noexcept -> std::size_t {
+        return m_n_spills;
+    }
+
+  private:
+    KeyEncoder m_enc;
+    std::vector<AggSpec> m_aggs;
+    std::optional<dbfile::internal::SpillSpace> m_spill;
+    std::size_t m_mem_limit;
+    unsigned m_bits{0};
+    std::vector<GroupTable> m_parts;
+    std::vector<dbfile::internal::SpillFile> m_files;
+    std::size_t m_n_spills{0};
+
+    // per batch: the rows, sorted by partition.
+    std::vector<uint32_t> m_rows{};
+    std::vector<uint32_t> m_order{};
+    std::vector<uint32_t> m_bounds{};
+    std::vector<uint32_t> m_part_rows{};
+    std::vector<uint32_t> m_groups{};
+
+    [[nodiscard]] auto partition_of(uint64_t t_hash) const noexcept
+        -> std::size_t {
+        return m_bits == 0 ? 0 : static_cast<std::size_t>(t_hash >>
+                                                          (64U - m_bits));
+    }
+
+    void split();
+    auto spill_largest() -> bool;
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_HASH_AGG_HXX
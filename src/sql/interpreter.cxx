@@ -1,40 +1,27 @@
 #include "interpreter.hxx"
+#include "arena.hxx"
+#include "exec.hxx"
+#include "parser.hxx"
 #include "tokenizer.hxx"
-#include <cstdint>
+#include <expected>
 #include <span>
-#include <variant>
+#include <utility>
 
 namespace tinydb {
 
-/**
- * @brief Helper for variants
- *
- * @tparam Ts
- */
-template <class... Ts> struct matches : Ts... {
-  using Ts::operator()...;
-};
-
-enum class CommandState : uint8_t {
-  Select,
-};
-
-auto interpret(std::span<Token> t_tokens) -> InterpreterRetCode {
-  using enum InterpreterRetCode;
-  if (t_tokens.empty()) {
-    return Err;
+auto interpret(std::span<const Token> t_tokens, const Catalog& t_catalog)
+    -> std::expected<ResultSet, InterpretError> {
+  Arena arena;
+  Parser parser;
+  auto stmt = parser.parse(t_tokens, arena);
+  if (!stmt) {
+    return std::unexpected{stmt.error()};
   }
-
-  auto retval = Ok;
-  std::visit(matches{[&](const Identifier& id) {
-                       if (id.val != "select") {
-                         retval = Err;
-                       };
-                     },
-                     [&](const Literal&) { retval = Err; },
-                     [&](const Symbol&) { retval = Err; }},
-             t_tokens[0]);
-  return retval;
+  auto res = execute(*stmt, t_catalog, {});
+  if (!res) {
+    return std::unexpected{res.error()};
+  }
+  return std::move(*res);
 }
 
 } // namespace tinydb
@@ -1,27 +1,27 @@
-#ifndef TINYDB_AST_HXX
-#define TINYDB_AST_HXX
+#ifndef TINYDB_INTERPRETER_HXX
+#define TINYDB_INTERPRETER_HXX
 
+#include "exec.hxx"
+#include "parser.hxx"
 #include "tokenizer.hxx"
+#include <expected>
 #include <span>
+#include <variant>
 
 namespace tinydb {
 
-/**
- * @brief Return codes of the interpret function, duh.
- * */
-enum class InterpreterRetCode : uint8_t {
-    Ok = 0,
-    Err,
-};
+using InterpretError = std::variant<ParseError, ExecError>;
 
 /**
- * @brief I was lazy with the interpreter. This shitty thing is good enough for
- * now.
+ * @brief Parses and runs a statement in one go, for statements run once.
+ * Those run more than once should be prepared instead (see prepared.hxx).
  *
- * @param t_tokens Whatever Tokenizer spits out.
+ * @param t_tokens Whatever Tokenizer spits out. Without `?`, there's nothing
+ * to bind them to.
  */
-auto interpret(std::span<Token> t_tokens) -> InterpreterRetCode;
+auto interpret(std::span<const Token> t_tokens, const Catalog& t_catalog)
+    -> std::expected<ResultSet, InterpretError>;
 
 } // namespace tinydb
 
-#endif // !TINYDB_AST_HXX
+#endif // !TINYDB_INTERPRETER_HXX
@@ -0,0 +1,593 @@
+#include "join.hxx"
+#include "hash_agg.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tinydb {
+
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+using dbfile::internal::SpillFile;
+
+namespace {
+
+// set-aside probe rows are joined this many at a time.
+constexpr std::size_t DRAIN_ROWS = 2048;
+
+template <typename T> void put(std::vector<std::byte>& t_out, const T& t_val) {
+  const auto* src = std::bit_cast<const std::byte*>(&t_val);
+  t_out.insert(t_out.end(), src, src + sizeof(T));
+}
+
+template <typename T>
+auto get(SpillFile::Reader& t_reader, std::istream& t_in, T& t_val) -> bool {
+  return t_reader.read({std::bit_cast<std::byte*>(&t_val), sizeof(T)}, t_in);
+}
+
+/**
+ * @brief The keys as they're compared: the Int keys of a Float key are
+ * turned into Float ones, into `t_conv`.
+ */
+void convert(std::span<const VType> t_types,
+             std::span<const ColumnVector* const> t_keys,
+             std::vector<ColumnVector>& t_conv,
+             std::vector<const ColumnVector*>& t_out) {
+  t_out.assign(t_keys.begin(), t_keys.end());
+  t_conv.clear();
+  // no reallocation: `t_out` points inside.
+  t_conv.reserve(t_keys.size());
+  for (std::size_t k = 0; k < t_keys.size(); ++k) {
+    const auto& src = *t_keys[k];
+    if (t_types[k] != VType::Float || src.type == ColType::Float64) {
+      continue;
+    }
+    auto& dst = t_conv.emplace_back(ColType::Float64);
+    const auto vals = src.values<int64_t>();
+    for (std::size_t row = 0; row < src.size(); ++row) {
+      if (src.is_null(row)) {
+        dst.push_null();
+      } else {
+        dst.push(static_cast<double>(vals[row]));
+      }
+    }
+    t_out[k] = &dst;
+  }
+}
+
+/**
+ * @brief The selected rows of a batch whose key has no NULL.
+ */
+void matchable_rows(const Batch& t_batch,
+                    std::span<const ColumnVector* const> t_keys,
+                    std::vector<uint32_t>& t_out) {
+  t_out.clear();
+  auto add = [&](uint32_t t_row) {
+    for (const auto* key : t_keys) {
+      if (key->is_null(t_row)) {
+        return;
+      }
+    }
+    t_out.push_back(t_row);
+  };
+  if (t_batch.selective) {
+    for (auto row : t_batch.sel) {
+      add(row);
+    }
+  } else {
+    for (uint32_t row = 0; row < t_batch.n_rows; ++row) {
+      add(row);
+    }
+  }
+}
+
+void copy_value(const ColumnVector& t_src, std::size_t t_row,
+                ColumnVector& t_dst) {
+  if (t_src.is_null(t_row)) {
+    t_dst.push_null();
+  } else {
+    t_dst.push_bytes(t_src.bytes(t_row));
+  }
+}
+
+void gather(const ColumnVector& t_src, std::span<const uint32_t> t_rows,
+            ColumnVector& t_dst) {
+  for (auto row : t_rows) {
+    copy_value(t_src, row, t_dst);
+  }
+}
+
+auto memory_of(const ColumnVector& t_col) -> std::size_t {
+  return t_col.data.size() + t_col.nulls.size() +
+         (t_col.offsets.size() * sizeof(uint32_t));
+}
+
+template <typename T> auto three_way(const T& t_a, const T& t_b) -> int {
+  return static_cast<int>(t_b < t_a) - static_cast<int>(t_a < t_b);
+}
+
+} // namespace
+
+HashJoiner::HashJoiner(std::vector<VType> t_keys,
+                       std::vector<ColType> t_build,
+                       std::vector<ColType> t_probe,
+                       std::optional<dbfile::internal::SpillSpace> t_spill,
+                       std::size_t t_mem_limit)
+    : m_build_types{std::move(t_build)}, m_probe_types{std::move(t_probe)},
+      m_spill{t_spill}, m_mem_limit{t_mem_limit}, m_enc{std::move(t_keys)},
+      m_set_aside{empty_rows(false)} {
+  m_parts.push_back(empty_part());
+}
+
+HashJoiner::~HashJoiner() {
+  if (!m_spill) {
+    return;
+  }
+  for (auto& part : m_parts) {
+    part.build_file.free_pages(*m_spill->fl, *m_spill->io);
+    part.probe_file.free_pages(*m_spill->fl, *m_spill->io);
+  }
+}
+
+auto HashJoiner::empty_rows(bool t_build) const -> Rows {
+  Rows ret{};
+  for (auto type : t_build ? m_build_types : m_probe_types) {
+    ret.cols.emplace_back(type);
+  }
+  return ret;
+}
+
+auto HashJoiner::empty_part() const -> Part {
+  Part ret{};
+  ret.rows = empty_rows(true);
+  return ret;
+}
+
+void HashJoiner::add_row(Rows& t_rows,
+                         std::span<const ColumnVector* const> t_cols,
+                         uint32_t t_row, uint64_t t_hash,
+                         std::span<const std::byte> t_key) {
+  for (std::size_t c = 0; c < t_rows.cols.size(); ++c) {
+    copy_value(*t_cols[c], t_row, t_rows.cols[c]);
+  }
+  t_rows.hashes.push_back(t_hash);
+  t_rows.keys.insert(t_rows.keys.end(), t_key.begin(), t_key.end());
+  t_rows.key_off.push_back(static_cast<uint32_t>(t_rows.keys.size()));
+}
+
+void HashJoiner::prepare(const Batch& t_batch,
+                         std::span<const ColumnVector* const> t_keys) {
+  convert(m_enc.types(), t_keys, m_conv, m_keys);
+  matchable_rows(t_batch, m_keys, m_rows);
+  m_enc.encode(m_keys, m_rows);
+
+  // sorted by partition, keeping the order of the rows inside each.
+  const auto n_parts = m_parts.size();
+  m_bounds.assign(n_parts + 1, 0);
+  for (std::size_t i = 0; i < m_rows.size(); ++i) {
+    ++m_bounds[partition_of(m_enc.hash(i)) + 1];
+  }
+  for (std::size_t p = 0; p < n_parts; ++p) {
+    m_bounds[p + 1] += m_bounds[p];
+  }
+  m_order.resize(m_rows.size());
+  std::vector<uint32_t> next{m_bounds.begin(), m_bounds.end() - 1};
+  for (uint32_t i = 0; i < m_rows.size(); ++i) {
+    m_order[next[partition_of(m_enc.hash(i))]++] = i;
+  }
+}
+
+void HashJoiner::build(const Batch& t_batch,
+                       std::span<const ColumnVector* const> t_keys) {
+  prepare(t_batch, t_keys);
+  for (auto i : m_order) {
+    auto& part = m_parts[partition_of(m_enc.hash(i))];
+    if (part.spilled) {
+      write_row(part.build_file, t_batch.cols, m_rows[i], m_enc.hash(i),
+                m_enc.key(i));
+    } else {
+      add_row(part.rows, t_batch.cols, m_rows[i], m_enc.hash(i),
+              m_enc.key(i));
+    }
+  }
+
+  if (m_n_spills == 0 && m_bits < MAX_BITS &&
+      memory() > L2_BYTES * m_parts.size()) {
+    split();
+  }
+  while (m_spill && memory() > m_mem_limit) {
+    // enough partitions first, for most rows to stay in memory.
+    if (m_n_spills == 0 && m_bits < SPILL_BITS) {
+      split();
+    } else if (!spill_largest()) {
+      break;
+    }
+  }
+}
+
+void HashJoiner::split() {
+  ++m_bits;
+  std::vector<Part> parts;
+  for (std::size_t p = 0; p < m_parts.size() * 2; ++p) {
+    parts.push_back(empty_part());
+  }
+  std::vector<const ColumnVector*> cols;
+  for (const auto& part : m_parts) {
+    const auto& rows = part.rows;
+    cols.clear();
+    for (const auto& col : rows.cols) {
+      cols.push_back(&col);
+    }
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+      add_row(parts[partition_of(rows.hashes[row])].rows, cols, row,
+              rows.hashes[row], rows.key(row));
+    }
+  }
+  m_parts = std::move(parts);
+}
+
+auto HashJoiner::spill_largest() -> bool {
+  auto largest = std::ranges::max_element(m_parts, {}, [](const Part& t_part) {
+    return t_part.spilled ? 0 : t_part.rows.size();
+  });
+  if (largest->spilled || largest->rows.size() == 0) {
+    return false;
+  }
+  const auto& rows = largest->rows;
+  std::vector<const ColumnVector*> cols;
+  for (const auto& col : rows.cols) {
+    cols.push_back(&col);
+  }
+  for (uint32_t row = 0; row < rows.size(); ++row) {
+    write_row(largest->build_file, cols, row, rows.hashes[row], rows.key(row));
+  }
+  largest->rows = empty_rows(true);
+  largest->spilled = true;
+  ++m_n_spills;
+  return true;
+}
+
+void HashJoiner::write_row(SpillFile& t_file,
+                           std::span<const ColumnVector* const> t_cols,
+                           uint32_t t_row, uint64_t t_hash,
+                           std::span<const std::byte> t_key) {
+  // the hash, the key, then each column: whether it's there, then its
+  // bytes, after their length for Text.
+  m_buf.clear();
+  put(m_buf, t_hash);
+  put(m_buf, static_cast<uint32_t>(t_key.size()));
+  m_buf.insert(m_buf.end(), t_key.begin(), t_key.end());
+  for (const auto* col : t_cols) {
+    const bool null = col->is_null(t_row);
+    put(m_buf, static_cast<uint8_t>(!null));
+    if (null) {
+      continue;
+    }
+    auto bytes = col->bytes(t_row);
+    if (col->type == ColType::Text) {
+      put(m_buf, static_cast<uint32_t>(bytes.size()));
+    }
+    const auto* src = std::bit_cast<const std::byte*>(bytes.data());
+    m_buf.insert(m_buf.end(), src, src + bytes.size());
+  }
+  t_file.write(m_buf, *m_spill->fl, *m_spill->io);
+}
+
+auto HashJoiner::read_row(SpillFile::Reader& t_reader, std::istream& t_in,
+                          Rows& t_rows) -> bool {
+  uint64_t hash{0};
+  uint32_t len{0};
+  if (!get(t_reader, t_in, hash) || !get(t_reader, t_in, len)) {
+    return false;
+  }
+  const auto off = t_rows.keys.size();
+  t_rows.keys.resize(off + len);
+  t_reader.read(std::span{t_rows.keys}.subspan(off), t_in);
+  t_rows.key_off.push_back(static_cast<uint32_t>(t_rows.keys.size()));
+  t_rows.hashes.push_back(hash);
+  for (auto& col : t_rows.cols) {
+    uint8_t present{0};
+    get(t_reader, t_in, present);
+    if (present == 0) {
+      col.push_null();
+      continue;
+    }
+    if (col.type == ColType::Text) {
+      get(t_reader, t_in, len);
+    } else {
+      len = static_cast<uint32_t>(dbfile::column::type_size(col.type));
+    }
+    m_val.resize(len);
+    t_reader.read(std::as_writable_bytes(std::span{m_val}), t_in);
+    col.push_bytes({m_val.data(), m_val.size()});
+  }
+  return true;
+}
+
+void HashJoiner::index(Part& t_part) {
+  const auto n = t_part.rows.size();
+  const auto mask = std::bit_ceil(std::max<std::size_t>(n, 1)) - 1;
+  t_part.heads.assign(mask + 1, NONE);
+  t_part.next.resize(n);
+  // backwards, so that each bucket lists its rows in order.
+  for (auto row = static_cast<uint32_t>(n); row-- > 0;) {
+    auto& head = t_part.heads[t_part.rows.hashes[row] & mask];
+    t_part.next[row] = head;
+    head = row;
+  }
+}
+
+void HashJoiner::finish_build() {
+  m_built = true;
+  for (auto& part : m_parts) {
+    if (part.spilled) {
+      part.build_file.flush(*m_spill->io);
+    } else {
+      index(part);
+    }
+  }
+}
+
+void HashJoiner::match(const Part& t_part, uint64_t t_hash,
+                       std::span<const std::byte> t_key, uint32_t t_row) {
+  const auto mask = t_part.heads.size() - 1;
+  for (auto row = t_part.heads[t_hash & mask]; row != NONE;
+       row = t_part.next[row]) {
+    if (t_part.rows.hashes[row] == t_hash &&
+        std::ranges::equal(t_part.rows.key(row), t_key)) {
+      m_probe_rows.push_back(t_row);
+      m_build_rows.push_back(row);
+    }
+  }
+}
+
+void HashJoiner::emit(const Part& t_part,
+                      std::span<const ColumnVector* const> t_probe,
+                      std::span<ColumnVector> t_out) {
+  const auto n_probe = m_probe_types.size();
+  for (std::size_t c = 0; c < n_probe; ++c) {
+    gather(*t_probe[c], m_probe_rows, t_out[c]);
+  }
+  for (std::size_t c = 0; c < m_build_types.size(); ++c) {
+    gather(t_part.rows.cols[c], m_build_rows, t_out[n_probe + c]);
+  }
+  m_probe_rows.clear();
+  m_build_rows.clear();
+}
+
+void HashJoiner::probe(const Batch& t_batch,
+                       std::span<const ColumnVector* const> t_keys,
+                       std::span<ColumnVector> t_out) {
+  if (!m_built) {
+    finish_build();
+  }
+  prepare(t_batch, t_keys);
+  for (std::size_t p = 0; p < m_parts.size(); ++p) {
+    auto& part = m_parts[p];
+    for (auto j = m_bounds[p]; j < m_bounds[p + 1]; ++j) {
+      const auto i = m_order[j];
+      if (part.spilled) {
+        write_row(part.probe_file, t_batch.cols, m_rows[i], m_enc.hash(i),
+                  m_enc.key(i));
+      } else {
+        match(part, m_enc.hash(i), m_enc.key(i), m_rows[i]);
+      }
+    }
+    emit(part, t_batch.cols, t_out);
+  }
+}
+
+auto HashJoiner::drain(std::span<ColumnVector> t_out) -> bool {
+  if (!m_built) {
+    finish_build();
+  }
+  while (m_drain < m_parts.size()) {
+    auto& part = m_parts[m_drain];
+    if (!part.spilled) {
+      ++m_drain;
+      continue;
+    }
+    auto& io = *m_spill->io;
+    if (!m_reader) {
+      // the build rows of the partition back in memory first.
+      auto reader = part.build_file.reader();
+      while (read_row(reader, io, part.rows)) {
+      }
+      part.build_file.free_pages(*m_spill->fl, io);
+      index(part);
+      part.probe_file.flush(io);
+      m_reader = part.probe_file.reader();
+    }
+    m_set_aside = empty_rows(false);
+    while (m_set_aside.size() < DRAIN_ROWS &&
+           read_row(*m_reader, io, m_set_aside)) {
+    }
+    if (m_set_aside.size() == 0) {
+      part.probe_file.free_pages(*m_spill->fl, io);
+      part.rows = empty_rows(true);
+      part.heads = {};
+      part.next = {};
+      m_reader.reset();
+      ++m_drain;
+      continue;
+    }
+    for (uint32_t row = 0; row < m_set_aside.size(); ++row) {
+      match(part, m_set_aside.hashes[row], m_set_aside.key(row), row);
+    }
+    std::vector<const ColumnVector*> cols;
+    for (const auto& col : m_set_aside.cols) {
+      cols.push_back(&col);
+    }
+    emit(part, cols, t_out);
+    return true;
+  }
+  return false;
+}
+
+auto HashJoiner::memory() const noexcept -> std::size_t {
+  std::size_t ret{0};
+  for (const auto& part : m_parts) {
+    const auto& rows = part.rows;
+    for (const auto& col : rows.cols) {
+      ret += memory_of(col);
+    }
+    ret += (rows.hashes.size() * sizeof(uint64_t)) +
+           (rows.key_off.size() * sizeof(uint32_t)) + rows.keys.size() +
+           ((part.heads.size() + part.next.size()) * sizeof(uint32_t));
+  }
+  return ret;
+}
+
+MergeJoiner::MergeJoiner(std::vector<VType> t_keys,
+                         std::vector<ColType> t_left,
+                         std::vector<ColType> t_right)
+    : m_types{std::move(t_keys)} {
+  for (std::size_t s = 0; s < 2; ++s) {
+    auto& side = m_sides[s];
+    for (auto type : s == 0 ? t_left : t_right) {
+      side.cols.emplace_back(type);
+    }
+    for (auto type : m_types) {
+      side.keys.emplace_back(storage_type(type));
+    }
+  }
+}
+
+void MergeJoiner::add(std::size_t t_side, const Batch& t_batch,
+                      std::span<const ColumnVector* const> t_keys) {
+  auto& side = m_sides[t_side];
+  std::vector<const ColumnVector*> keys;
+  convert(m_types, t_keys, m_conv, keys);
+  std::vector<uint32_t> rows;
+  matchable_rows(t_batch, keys, rows);
+  for (std::size_t c = 0; c < side.cols.size(); ++c) {
+    gather(*t_batch.cols[c], rows, side.cols[c]);
+  }
+  for (std::size_t k = 0; k < keys.size(); ++k) {
+    gather(*keys[k], rows, side.keys[k]);
+  }
+}
+
+auto MergeJoiner::compare(const Side& t_lhs, uint32_t t_lrow,
+                          const Side& t_rhs, uint32_t t_rrow) const -> int {
+  for (std::size_t k = 0; k < m_types.size(); ++k) {
+    const auto& lhs = t_lhs.keys[k];
+    const auto& rhs = t_rhs.keys[k];
+    int cmp{0};
+    switch (m_types[k]) {
+    case VType::Bool:
+      cmp = three_way(lhs.values<uint8_t>()[t_lrow] != 0,
+                      rhs.values<uint8_t>()[t_rrow] != 0);
+      break;
+    case VType::Int:
+      cmp = three_way(lhs.values<int64_t>()[t_lrow],
+                      rhs.values<int64_t>()[t_rrow]);
+      break;
+    case VType::Float:
+      cmp = three_way(lhs.values<double>()[t_lrow],
+                      rhs.values<double>()[t_rrow]);
+      break;
+    case VType::Text:
+      cmp = three_way(lhs.text(t_lrow), rhs.text(t_rrow));
+      break;
+    }
+    if (cmp != 0) {
+      return cmp;
+    }
+  }
+  return 0;
+}
+
+void MergeJoiner::sort() {
+  m_sorted = true;
+  for (auto& side : m_sides) {
+    side.order.resize(side.keys.front().size());
+    std::iota(side.order.begin(), side.order.end(), 0);
+    auto less = [&](uint32_t t_a, uint32_t t_b) {
+      return compare(side, t_a, side, t_b) < 0;
+    };
+    // one pass over a side that's in order already.
+    if (!std::ranges::is_sorted(side.order, less)) {
+      std::ranges::stable_sort(side.order, less);
+      ++m_n_sorts;
+    }
+  }
+}
+
+auto MergeJoiner::next(std::span<ColumnVector> t_out, std::size_t t_max)
+    -> bool {
+  if (!m_sorted) {
+    sort();
+  }
+  auto& [left, right] = m_sides;
+  auto& pairs = m_pairs;
+  pairs[0].clear();
+  pairs[1].clear();
+  while (pairs[0].size() < t_max) {
+    // every left row of the current key, with every right one.
+    if (m_cur[0] < m_end[0]) {
+      pairs[0].push_back(left.order[m_cur[0]]);
+      pairs[1].push_back(right.order[m_cur[1]]);
+      if (++m_cur[1] == m_end[1]) {
+        m_cur[1] = m_first[1];
+        ++m_cur[0];
+      }
+      continue;
+    }
+    if (left.pos == left.order.size() || right.pos == right.order.size()) {
+      break;
+    }
+    auto cmp =
+        compare(left, left.order[left.pos], right, right.order[right.pos]);
+    if (cmp < 0) {
+      ++left.pos;
+      continue;
+    }
+    if (cmp > 0) {
+      ++right.pos;
+      continue;
+    }
+    for (std::size_t s = 0; s < 2; ++s) {
+      auto& side = m_sides[s];
+      const auto first = side.order[side.pos];
+      m_first[s] = side.pos;
+      m_cur[s] = side.pos;
+      do {
+        ++side.pos;
+      } while (side.pos < side.order.size() &&
+               compare(side, first, side, side.order[side.pos]) == 0);
+      m_end[s] = side.pos;
+    }
+  }
+  if (pairs[0].empty()) {
+    return false;
+  }
+  const auto n_left = left.cols.size();
+  for (std::size_t c = 0; c < n_left; ++c) {
+    gather(left.cols[c], pairs[0], t_out[c]);
+  }
+  for (std::size_t c = 0; c < right.cols.size(); ++c) {
+    gather(right.cols[c], pairs[1], t_out[n_left + c]);
+  }
+  return true;
+}
+
+} // namespace tinydb
@@ -0,0 +1,314 @@
+/**
+ * @file join.hxx
+ * @brief Equi-joins: the pairs of rows of two inputs whose keys are equal.
+ *
+ * A HashJoiner reads one input, the build side, whole, then streams the
+ * other one, the probe side, past it. Build rows are split into partitions
+ * by the top bits of the hash of their key, like the groups of a
+ * HashAggregator, and each partition is a chained hash table: a head per
+ * bucket, then the next row of the same bucket per row. A probe batch is
+ * first sorted by partition, so that all the lookups of a partition hit the
+ * same table, small enough to stay in L2.
+ *
+ * Given somewhere to spill, the largest partition of the build side is
+ * written to temporary pages whenever the build side takes more memory than
+ * allowed, and build rows of that partition go straight to the same file
+ * afterwards. Probe rows of a spilled partition are set aside in a file of
+ * their own, and spilled partitions are joined one at a time once the probe
+ * side is done.
+ *
+ * A MergeJoiner reads both inputs whole, sorts each of them by key unless it
+ * already is (a table loaded in key order is), and merges them.
+ *
+ * A key with a NULL never matches anything.
+ */
+
+#ifndef TINYDB_JOIN_HXX
+#define TINYDB_JOIN_HXX
+
+#include "hash_agg.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#endif // ENABLE_MODULES
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace tinydb {
+
+/**
+ * @class HashJoiner
+ * @brief A hash join over batches: partitions of build rows, spilled if
+ * need be.
+ *
+ * Joined rows are the columns of the probe side, then those of the build
+ * side, as they were in their batches.
+ */
+class HashJoiner {
+  public:
+    // what a partition should fit in.
+    static constexpr std::size_t L2_BYTES = HashAggregator::L2_BYTES;
+    // at most 2^MAX_BITS partitions.
+    static constexpr unsigned MAX_BITS = 8;
+    // at least 2^SPILL_BITS partitions before any is spilled.
+    static constexpr unsigned SPILL_BITS = 4;
+
+    /**
+     * @param t_keys The types the keys of both sides are compared as. An
+     * Int key is turned into a Float one if need be.
+     * @param t_build The types of the columns of the build side.
+     * @param t_probe Same, for the probe side.
+     * @param t_spill Where to spill partitions once the build side takes
+     * more than `t_mem_limit` bytes. Without it, nothing is ever spilled.
+     */
+    HashJoiner(std::vector<VType> t_keys,
+               std::vector<dbfile::column::ColType> t_build,
+               std::vector<dbfile::column::ColType> t_probe,
+               std::optional<dbfile::internal::SpillSpace> t_spill,
+               std::size_t t_mem_limit);
+    HashJoiner(const HashJoiner&) = delete;
+    HashJoiner(HashJoiner&&) = delete;
+    auto operator=(const HashJoiner&) -> HashJoiner& = delete;
+    auto operator=(HashJoiner&&) -> HashJoiner& = delete;
+    ~HashJoiner();
+
+    /**
+     * @brief Adds the selected rows of a build batch. Every build row must
+     * be added before the first probe.
+     * @param t_keys The values of the keys, of `storage_type` of their type.
+     */
+    void build(const Batch& t_batch,
+               std::span<const dbfile::internal::ColumnVector* const> t_keys);
+
+    /**
+     * @brief Appends the selected rows of a probe batch joined with every
+     * build row of the same key to `t_out`. Rows of a spilled partition are
+     * set aside for `drain` instead.
+     */
+    void probe(const Batch& t_batch,
+               std::span<const dbfile::internal::ColumnVector* const> t_keys,
+               std::span<dbfile::internal::ColumnVector> t_out);
+
+    /**
+     * @brief Once the probe side is done, appends some of the rows set aside
+     * joined with the build rows of their partition to `t_out`.
+     * @return false once there's nothing left to join.
+     */
+    auto drain(std::span<dbfile::internal::ColumnVector> t_out) -> bool;
+
+    [[nodiscard]] auto n_partitions() const noexcept -> std::size_t {
+        return m_parts.size();
+    }
+
+    /**
+     * @return How many times a partition was spilled.
+     */
+    [[nodiscard]] auto n_spills() const noexcept -> std::size_t {
+        return m_n_spills;
+    }
+
+    /**
+     * @return About how many bytes the build rows in memory take.
+     */
+    [[nodiscard]] auto memory() const noexcept -> std::size_t;
+
+  private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /**
+     * @brief Rows of one side, with the hash and the encoded key of each.
+     */
+    struct Rows {
+        std::vector<dbfile::internal::ColumnVector> cols;
+        std::vector<uint64_t> hashes{};
+        std::vector<uint32_t> key_off{0};
+        std::vector<std::byte> keys{};
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t {
+            return hashes.size();
+        }
+
+        [[nodiscard]] auto key(std::size_t t_row) const
+            -> std::span<const std::byte> {
+            return std::span{keys}.subspan(key_off[t_row],
+                                           key_off[t_row + 1] - key_off[t_row]);
+        }
+    };
+
+    struct Part {
+        Rows rows;
+        // the hash table: the first row of each bucket, then the next row
+        // of the same bucket of each row. Built once the build side is done.
+        std::vector<uint32_t> heads{};
+        std::vector<uint32_t> next{};
+        bool spilled{false};
+        dbfile::internal::SpillFile build_file{};
+        dbfile::internal::SpillFile probe_file{};
+    };
+
+    std::vector<dbfile::column::ColType> m_build_types;
+    std::vector<dbfile::column::ColType> m_probe_types;
+    std::optional<dbfile::internal::SpillSpace> m_spill;
+    std::size_t m_mem_limit;
+    KeyEncoder m_enc;
+    unsigned m_bits{0};
+    std::vector<Part> m_parts;
+    std::size_t m_n_spills{0};
+    bool m_built{false};
+
+    // per batch: the rows (without NULL keys), sorted by partition, and the
+    // matching pairs of probe and build rows of a partition.
+    std::vector<dbfile::internal::ColumnVector> m_conv{};
+    std::vector<const dbfile::internal::ColumnVector*> m_keys{};
+    std::vector<uint32_t> m_rows{};
+    std::vector<uint32_t> m_order{};
+    std::vector<uint32_t> m_bounds{};
+    std::vector<uint32_t> m_probe_rows{};
+    std::vector<uint32_t> m_build_rows{};
+    std::vector<std::byte> m_buf{};
+    std::vector<char> m_val{};
+
+    // drain: the spilled partition being joined, and its probe rows.
+    std::size_t m_drain{0};
+    std::optional<dbfile::internal::SpillFile::Reader> m_reader{};
+    Rows m_set_aside{};
+
+    [[nodiscard]] auto partition_of(uint64_t t_hash) const noexcept
+        -> std::size_t {
+        return m_bits == 0 ? 0 : static_cast<std::size_t>(t_hash >>
+                                                          (64U - m_bits));
+    }
+
+    [[nodiscard]] auto empty_rows(bool t_build) const -> Rows;
+    [[nodiscard]] auto empty_part() const -> Part;
+    static void add_row(Rows& t_rows,
+                        std::span<const dbfile::internal::ColumnVector* const>
+                            t_cols,
+                        uint32_t t_row, uint64_t t_hash,
+                        std::span<const std::byte> t_key);
+    /**
+     * @brief Encodes the keys of the selected rows of a batch, without
+     * those with a NULL, and sorts them by partition.
+     */
+    void prepare(const Batch& t_batch,
+                 std::span<const dbfile::internal::ColumnVector* const> t_keys);
+    void split();
+    auto spill_largest() -> bool;
+    void finish_build();
+    static void index(Part& t_part);
+    /**
+     * @brief Adds the build rows matching a probe row to the pairs.
+     */
+    void match(const Part& t_part, uint64_t t_hash,
+               std::span<const std::byte> t_key, uint32_t t_row);
+    /**
+     * @brief Appends the pairs to `t_out`, and forgets them.
+     */
+    void emit(const Part& t_part,
+              std::span<const dbfile::internal::ColumnVector* const> t_probe,
+              std::span<dbfile::internal::ColumnVector> t_out);
+    /**
+     * @brief Appends a row, its hash and its key to a spill file.
+     */
+    void write_row(dbfile::internal::SpillFile& t_file,
+                   std::span<const dbfile::internal::ColumnVector* const>
+                       t_cols,
+                   uint32_t t_row, uint64_t t_hash,
+                   std::span<const std::byte> t_key);
+    /**
+     * @brief Reads a row written by `write_row` at the end of `t_rows`.
+     * @return false at the end of the file.
+     */
+    auto read_row(dbfile::internal::SpillFile::Reader& t_reader,
+                  std::istream& t_in, Rows& t_rows) -> bool;
+};
+
+/**
+ * @class MergeJoiner
+ * @brief A sort-merge join: both sides are read whole, sorted by key unless
+ * they already are, then merged.
+ *
+ * Joined rows are the columns of the left side, then those of the right
+ * side, in key order.
+ */
+class MergeJoiner {
+  public:
+    /**
+     * @param t_keys The types the keys of both sides are compared as.
+     * @param t_left The types of the columns of the left side.
+     * @param t_right Same, for the right side.
+     */
+    MergeJoiner(std::vector<VType> t_keys,
+                std::vector<dbfile::column::ColType> t_left,
+                std::vector<dbfile::column::ColType> t_right);
+
+    /**
+     * @brief Adds the selected rows of a batch of one side, 0 for the left
+     * one and 1 for the right one. Every row must be added before the first
+     * `next`.
+     */
+    void add(std::size_t t_side, const Batch& t_batch,
+             std::span<const dbfile::internal::ColumnVector* const> t_keys);
+
+    /**
+     * @brief Appends the next joined rows to `t_out`, about `t_max` of them.
+     * @return false once every one was.
+     */
+    auto next(std::span<dbfile::internal::ColumnVector> t_out,
+              std::size_t t_max) -> bool;
+
+    /**
+     * @return How many sides had to be sorted, as opposed to found in order.
+     */
+    [[nodiscard]] auto n_sorts() const noexcept -> std::size_t {
+        return m_n_sorts;
+    }
+
+  private:
+    struct Side {
+        std::vector<dbfile::internal::ColumnVector> cols;
+        // one per key, of `storage_type` of its type.
+        std::vector<dbfile::internal::ColumnVector> keys;
+        // the rows, in key order.
+        std::vector<uint32_t> order{};
+        // the next one to merge.
+        std::size_t pos{0};
+    };
+
+    std::vector<VType> m_types;
+    std::array<Side, 2> m_sides;
+    bool m_sorted{false};
+    std::size_t m_n_sorts{0};
+    // the rows of both sides with the same key, [first, end) inside
+    // `order`, and the pair to output next.
+    std::array<std::size_t, 2> m_first{};
+    std::array<std::size_t, 2> m_end{};
+    std::array<std::size_t, 2> m_cur{};
+    std::array<std::vector<uint32_t>, 2> m_pairs{};
+    std::vector<dbfile::internal::ColumnVector> m_conv{};
+
+    /**
+     * @brief Compares the key of a row of a side to the key of a row of
+     * another one, or of the same one.
+     * @return Negative, zero or positive, like `memcmp`.
+     */
+    [[nodiscard]] auto compare(const Side& t_lhs, uint32_t t_lrow,
+                               const Side& t_rhs, uint32_t t_rrow) const
+        -> int;
+    void sort();
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_JOIN_HXX
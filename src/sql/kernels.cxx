@@ -0,0 +1,308 @@
+#include "kernels.hxx"
+#include "ast.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace tinydb {
+
+using dbfile::column::ColType;
+using dbfile::column::native_t;
+using dbfile::internal::ColumnVector;
+
+namespace {
+
+template <typename T> auto resize(ColumnVector& t_vec, std::size_t t_n) -> T* {
+  t_vec.data.resize(t_n * sizeof(T));
+  t_vec.nulls.resize(t_n);
+  return std::bit_cast<T*>(t_vec.data.data());
+}
+
+/**
+ * @brief One operand of a kernel. A constant is copied out of its vector
+ * once, so that the loop keeps it in a register.
+ */
+template <typename T, bool Scalar> class In {
+public:
+  explicit In(const ColumnVector& t_vec)
+      : m_vals{std::bit_cast<const T*>(t_vec.data.data())},
+        m_nulls{t_vec.nulls.data()} {}
+
+  [[nodiscard]] auto val(std::size_t t_idx) const -> T {
+    return m_vals[t_idx];
+  }
+  [[nodiscard]] auto null(std::size_t t_idx) const -> uint8_t {
+    return m_nulls[t_idx];
+  }
+
+private:
+  const T* m_vals;
+  const uint8_t* m_nulls;
+};
+
+template <typename T> class In<T, true> {
+public:
+  explicit In(const ColumnVector& t_vec)
+      : m_val{*std::bit_cast<const T*>(t_vec.data.data())},
+        m_null{t_vec.nulls[0]} {}
+
+  [[nodiscard]] auto val(std::size_t /*t_idx*/) const -> T { return m_val; }
+  [[nodiscard]] auto null(std::size_t /*t_idx*/) const -> uint8_t {
+    return m_null;
+  }
+
+private:
+  T m_val;
+  uint8_t m_null;
+};
+
+/**
+ * @brief The NULL flags of a binary operation: NULL if either side is. Its
+ * own loop, apart from the values: both stay simple enough to vectorize.
+ */
+template <typename LIn, typename RIn>
+void or_nulls(const LIn& t_lhs, const RIn& t_rhs, ColumnVector& t_out,
+              std::size_t t_n) {
+  auto* nulls = t_out.nulls.data();
+  for (std::size_t i = 0; i < t_n; ++i) {
+    nulls[i] = t_lhs.null(i) | t_rhs.null(i);
+  }
+}
+
+template <typename L, typename R>
+using common_t = std::conditional_t<std::is_floating_point_v<L> ||
+                                        std::is_floating_point_v<R>,
+                                    double, int64_t>;
+
+constexpr auto is_cmp(BinaryOp t_op) -> bool {
+  return t_op >= BinaryOp::Eq && t_op <= BinaryOp::Ge;
+}
+
+template <BinaryOp Op, typename C> constexpr auto apply_cmp(C t_x, C t_y) {
+  if constexpr (Op == BinaryOp::Eq) {
+    return t_x == t_y;
+  } else if constexpr (Op == BinaryOp::Ne) {
+    return t_x != t_y;
+  } else if constexpr (Op == BinaryOp::Lt) {
+    return t_x < t_y;
+  } else if constexpr (Op == BinaryOp::Le) {
+    return t_x <= t_y;
+  } else if constexpr (Op == BinaryOp::Gt) {
+    return t_x > t_y;
+  } else {
+    return t_x >= t_y;
+  }
+}
+
+template <BinaryOp Op, typename C> constexpr auto apply_arith(C t_x, C t_y) {
+  if constexpr (std::is_floating_point_v<C>) {
+    if constexpr (Op == BinaryOp::Add) {
+      return t_x + t_y;
+    } else if constexpr (Op == BinaryOp::Sub) {
+      return t_x - t_y;
+    } else if constexpr (Op == BinaryOp::Mul) {
+      return t_x * t_y;
+    } else {
+      return t_x / t_y;
+    }
+  } else {
+    // wrapping, like the hardware does, instead of undefined.
+    const auto x = static_cast<uint64_t>(t_x);
+    const auto y = static_cast<uint64_t>(t_y);
+    if constexpr (Op == BinaryOp::Add) {
+      return static_cast<int64_t>(x + y);
+    } else if constexpr (Op == BinaryOp::Sub) {
+      return static_cast<int64_t>(x - y);
+    } else if constexpr (Op == BinaryOp::Mul) {
+      return static_cast<int64_t>(x * y);
+    } else {
+      // dividing by 0 gives NULL, and INT64_MIN / -1 wraps: both are dealt
+      // with by the caller, this only needs to not trap.
+      return t_y == 0 || t_y == -1 ? static_cast<int64_t>(0 - x) : t_x / t_y;
+    }
+  }
+}
+
+template <BinaryOp Op, typename L, typename R, bool LS, bool RS>
+void compare(const ColumnVector& t_lhs, const ColumnVector& t_rhs,
+             ColumnVector& t_out, std::size_t t_n) {
+  using C = common_t<L, R>;
+  const In<L, LS> lhs{t_lhs};
+  const In<R, RS> rhs{t_rhs};
+  auto* out = resize<uint8_t>(t_out, t_n);
+  for (std::size_t i = 0; i < t_n; ++i) {
+    out[i] = static_cast<uint8_t>(apply_cmp<Op>(static_cast<C>(lhs.val(i)),
+                                                static_cast<C>(rhs.val(i))));
+  }
+  or_nulls(lhs, rhs, t_out, t_n);
+}
+
+template <BinaryOp Op, typename L, typename R, bool LS, bool RS>
+void arith(const ColumnVector& t_lhs, const ColumnVector& t_rhs,
+           ColumnVector& t_out, std::size_t t_n) {
+  using C = common_t<L, R>;
+  const In<L, LS> lhs{t_lhs};
+  const In<R, RS> rhs{t_rhs};
+  auto* out = resize<C>(t_out, t_n);
+  for (std::size_t i = 0; i < t_n; ++i) {
+    out[i] = apply_arith<Op>(static_cast<C>(lhs.val(i)),
+                             static_cast<C>(rhs.val(i)));
+  }
+  or_nulls(lhs, rhs, t_out, t_n);
+  if constexpr (Op == BinaryOp::Div && std::is_integral_v<C>) {
+    auto* nulls = t_out.nulls.data();
+    for (std::size_t i = 0; i < t_n; ++i) {
+      nulls[i] |= static_cast<uint8_t>(rhs.val(i) == 0);
+    }
+  }
+}
+
+/**
+ * @brief AND and OR, in three-valued logic: `NULL AND false` is false, and
+ * `NULL OR true` is true.
+ */
+template <BinaryOp Op, bool LS, bool RS>
+void logic(const ColumnVector& t_lhs, const ColumnVector& t_rhs,
+           ColumnVector& t_out, std::size_t t_n) {
+  const In<uint8_t, LS> lhs{t_lhs};
+  const In<uint8_t, RS> rhs{t_rhs};
+  auto* out = resize<uint8_t>(t_out, t_n);
+  auto* nulls = t_out.nulls.data();
+  // the value that decides on its own: false for AND, true for OR.
+  constexpr uint8_t decisive = Op == BinaryOp::Or ? 1 : 0;
+  for (std::size_t i = 0; i < t_n; ++i) {
+    const auto decided = static_cast<uint8_t>(
+        ((lhs.null(i) == 0) & (lhs.val(i) == decisive)) |
+        ((rhs.null(i) == 0) & (rhs.val(i) == decisive)));
+    nulls[i] = static_cast<uint8_t>((lhs.null(i) | rhs.null(i)) &
+                                    (decided ^ 1U));
+    out[i] = static_cast<uint8_t>(decided != 0 ? decisive : decisive ^ 1U);
+  }
+}
+
+template <BinaryOp Op, bool LS, bool RS>
+void compare_text(const ColumnVector& t_lhs, const ColumnVector& t_rhs,
+                  ColumnVector& t_out, std::size_t t_n) {
+  auto* out = resize<uint8_t>(t_out, t_n);
+  auto* nulls = t_out.nulls.data();
+  for (std::size_t i = 0; i < t_n; ++i) {
+    const auto lhs = t_lhs.text(LS ? 0 : i);
+    const auto rhs = t_rhs.text(RS ? 0 : i);
+    out[i] = static_cast<uint8_t>(apply_cmp<Op>(lhs.compare(rhs), 0));
+    nulls[i] = t_lhs.nulls[LS ? 0 : i] | t_rhs.nulls[RS ? 0 : i];
+  }
+}
+
+template <typename T>
+void widen(const ColumnVector& t_in, ColumnVector& t_out) {
+  using C = common_t<T, T>;
+  const auto n = t_in.size();
+  const auto* in = std::bit_cast<const T*>(t_in.data.data());
+  auto* out = resize<C>(t_out, n);
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = static_cast<C>(in[i]);
+  }
+  std::copy(t_in.nulls.begin(), t_in.nulls.end(), t_out.nulls.begin());
+}
+
+constexpr std::size_t N_OPS = static_cast<std::size_t>(BinaryOp::Div) + 1;
+constexpr std::size_t N_TYPES = static_cast<std::size_t>(ColType::Text) + 1;
+constexpr std::size_t N_SHAPES = 3;
+
+constexpr auto index(BinaryOp t_op, ColType t_lhs, ColType t_rhs,
+                     Shape t_shape) -> std::size_t {
+  return (((static_cast<std::size_t>(t_op) * N_TYPES) +
+           static_cast<std::size_t>(t_lhs)) *
+              N_TYPES +
+          static_cast<std::size_t>(t_rhs)) *
+             N_SHAPES +
+         static_cast<std::size_t>(t_shape);
+}
+
+// the types constants are stored as.
+constexpr auto const_type(ColType t_type) -> bool {
+  return t_type == ColType::Uint8 || t_type == ColType::Int64 ||
+         t_type == ColType::Float64 || t_type == ColType::Text;
+}
+
+template <BinaryOp Op, ColType L, ColType R, Shape S>
+constexpr auto pick() -> Kernel {
+  constexpr bool ls = S == Shape::ConstCol;
+  constexpr bool rs = S == Shape::ColConst;
+  if constexpr ((ls && !const_type(L)) || (rs && !const_type(R))) {
+    return nullptr;
+  } else if constexpr (Op == BinaryOp::And || Op == BinaryOp::Or) {
+    if constexpr (L == ColType::Uint8 && R == ColType::Uint8) {
+      return &logic<Op, ls, rs>;
+    } else {
+      return nullptr;
+    }
+  } else if constexpr (L == ColType::Text || R == ColType::Text) {
+    if constexpr (L == R && is_cmp(Op)) {
+      return &compare_text<Op, ls, rs>;
+    } else {
+      return nullptr;
+    }
+  } else if constexpr (is_cmp(Op)) {
+    return &compare<Op, native_t<L>, native_t<R>, ls, rs>;
+  } else {
+    return &arith<Op, native_t<L>, native_t<R>, ls, rs>;
+  }
+}
+
+template <std::size_t I> constexpr auto pick() -> Kernel {
+  return pick<static_cast<BinaryOp>(I / (N_TYPES * N_TYPES * N_SHAPES)),
+              static_cast<ColType>(I / (N_TYPES * N_SHAPES) % N_TYPES),
+              static_cast<ColType>(I / N_SHAPES % N_TYPES),
+              static_cast<Shape>(I % N_SHAPES)>();
+}
+
+template <std::size_t... Is>
+constexpr auto make_kernels(std::index_sequence<Is...> /*t_seq*/)
+    -> std::array<Kernel, sizeof...(Is)> {
+  return {pick<Is>()...};
+}
+
+constexpr auto KERNELS = make_kernels(
+    std::make_index_sequence<N_OPS * N_TYPES * N_TYPES * N_SHAPES>{});
+
+static_assert(KERNELS[index(BinaryOp::Gt, ColType::Float64, ColType::Float64,
+                            Shape::ColConst)] ==
+              &compare<BinaryOp::Gt, double, double, false, true>);
+
+template <std::size_t... Is>
+constexpr auto make_widen(std::index_sequence<Is...> /*t_seq*/)
+    -> std::array<WidenKernel, sizeof...(Is)> {
+  return {&widen<native_t<static_cast<ColType>(Is)>>...};
+}
+
+constexpr auto WIDEN = make_widen(std::make_index_sequence<N_TYPES - 1>{});
+
+} // namespace
+
+auto binary_kernel(BinaryOp t_op, ColType t_lhs, ColType t_rhs, Shape t_shape)
+    -> Kernel {
+  if (t_lhs > ColType::Text || t_rhs > ColType::Text) {
+    return nullptr;
+  }
+  return KERNELS[index(t_op, t_lhs, t_rhs, t_shape)];
+}
+
+auto widen_kernel(ColType t_type) -> WidenKernel {
+  return t_type < ColType::Text ? WIDEN[static_cast<std::size_t>(t_type)]
+                                : nullptr;
+}
+
+} // namespace tinydb
@@ -0,0 +1,75 @@
+/**
+ * @file kernels.hxx
+ * @brief The loops expressions are made of, one per operator, operand types
+ * and operand shapes.
+ *
+ * Every kernel is a template instantiation for exact types: `price > 10` on
+ * a Float64 column is a loop comparing an array of double to a double held
+ * in a register, with no test on types, no conversion of the column and no
+ * array of copies of the 10. The right kernel is looked up once, when the
+ * expression is compiled, in a single table indexed by operator, types and
+ * shape.
+ *
+ * Operands are vectors of a numeric ColType or Text: CharN columns are
+ * turned into Text first. Bool values are Uint8 vectors of 0 and 1. Mixed
+ * operands are converted to a common type inside the loop: double if either
+ * is a float, int64_t otherwise.
+ */
+
+#ifndef TINYDB_KERNELS_HXX
+#define TINYDB_KERNELS_HXX
+
+#include "ast.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+
+namespace tinydb {
+
+/**
+ * @brief Whether each operand of a kernel is a whole vector, or a single
+ * value standing for the same value on every row.
+ */
+enum class Shape : uint8_t {
+    ColCol,
+    ColConst,
+    ConstCol,
+};
+
+/**
+ * @brief `t_out = t_lhs <op> t_rhs` for the first `t_n` rows. A constant
+ * operand is a vector of a single value.
+ */
+using Kernel = void (*)(const dbfile::internal::ColumnVector& t_lhs,
+                        const dbfile::internal::ColumnVector& t_rhs,
+                        dbfile::internal::ColumnVector& t_out,
+                        std::size_t t_n);
+
+/**
+ * @brief Converts a vector of a numeric type to int64_t, or to double for
+ * floats.
+ */
+using WidenKernel = void (*)(const dbfile::internal::ColumnVector& t_in,
+                             dbfile::internal::ColumnVector& t_out);
+
+/**
+ * @return The kernel of a binary operator, nullptr if there's none for those
+ * types. Constant operands must be Uint8, Int64, Float64 or Text.
+ */
+auto binary_kernel(BinaryOp t_op, dbfile::column::ColType t_lhs,
+                   dbfile::column::ColType t_rhs, Shape t_shape) -> Kernel;
+
+/**
+ * @return nullptr if `t_type` isn't numeric.
+ */
+auto widen_kernel(dbfile::column::ColType t_type) -> WidenKernel;
+
+} // namespace tinydb
+
+#endif // !TINYDB_KERNELS_HXX
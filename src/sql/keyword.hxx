@@ -0,0 +1,180 @@
+/**
+ * @file keyword.hxx
+ * @brief SQL keywords, and how words are recognized as keywords.
+ *
+ * Every word the tokenizer reads is looked up here, so the lookup must not
+ * get slower as the grammar grows. Instead of comparing a word against each
+ * keyword in turn, it's hashed (from its length and 3 of its characters,
+ * case-insensitively) into a table where no 2 keywords collide: a lookup is
+ * one probe and at most one comparison, whatever the number of keywords.
+ *
+ * The table and the seed of the hash are computed at compile time. Adding a
+ * keyword is adding it to `Keyword` and `KEYWORD_NAMES`; the build fails if
+ * no seed manages to keep them all apart anymore.
+ */
+
+#ifndef TINYDB_KEYWORD_HXX
+#define TINYDB_KEYWORD_HXX
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace tinydb {
+
+/**
+ * @brief Reserved words. Same order as `KEYWORD_NAMES`.
+ */
+enum class Keyword : uint8_t {
+    Select,
+    Insert,
+    Update,
+    Delete,
+    Create,
+    Drop,
+    Table,
+    From,
+    Where,
+    Into,
+    Values,
+    Set,
+    And,
+    Or,
+    Not,
+    Is,
+    Null,
+    True,
+    False,
+    Order,
+    Group,
+    By,
+    Asc,
+    Desc,
+    Limit,
+    Offset,
+    Join,
+    Inner,
+    On,
+    As,
+    Distinct,
+    Primary,
+    Key,
+    Begin,
+    Commit,
+    Rollback,
+};
+
+inline constexpr std::array<std::string_view, 36> KEYWORD_NAMES{
+    "SELECT", "INSERT", "UPDATE",   "DELETE",  "CREATE", "DROP",
+    "TABLE",  "FROM",   "WHERE",    "INTO",    "VALUES", "SET",
+    "AND",    "OR",     "NOT",      "IS",      "NULL",   "TRUE",
+    "FALSE",  "ORDER",  "GROUP",    "BY",      "ASC",    "DESC",
+    "LIMIT",  "OFFSET", "JOIN",     "INNER",   "ON",     "AS",
+    "DISTINCT", "PRIMARY", "KEY",   "BEGIN",   "COMMIT", "ROLLBACK",
+};
+static_assert(KEYWORD_NAMES.size() ==
+              static_cast<std::size_t>(Keyword::Rollback) + 1);
+
+/**
+ * @return The upper case spelling of a keyword.
+ */
+constexpr auto keyword_name(Keyword t_kw) -> std::string_view {
+    return KEYWORD_NAMES[static_cast<std::size_t>(t_kw)];
+}
+
+namespace keyword_hash {
+
+// 128 slots for 36 keywords: a seed that spreads them all out is found
+// after a few hundred tries.
+inline constexpr unsigned BITS = 7;
+inline constexpr std::size_t SLOTS = std::size_t{1} << BITS;
+inline constexpr uint8_t EMPTY = UINT8_MAX;
+
+inline constexpr auto MIN_LEN =
+    std::ranges::min(KEYWORD_NAMES, {}, &std::string_view::size).size();
+inline constexpr auto MAX_LEN =
+    std::ranges::max(KEYWORD_NAMES, {}, &std::string_view::size).size();
+static_assert(MIN_LEN >= 2);
+
+/**
+ * @brief Folds ASCII letters to lower case. Keywords are only letters, so
+ * whatever this does to other characters can't make a word match.
+ */
+constexpr auto fold(char t_c) -> uint32_t {
+    return static_cast<unsigned char>(t_c) | 0x20U;
+}
+
+/**
+ * @param t_word At least `MIN_LEN` characters.
+ */
+constexpr auto hash(std::string_view t_word, uint32_t t_seed) -> std::size_t {
+    constexpr uint32_t mul = 31;
+    auto h = static_cast<uint32_t>(t_word.size());
+    h = (h * mul) + fold(t_word[0]);
+    h = (h * mul) + fold(t_word[t_word.size() / 2]);
+    h = (h * mul) + fold(t_word.back());
+    // the top bits of a multiplication depend on all the bits of `h`.
+    return static_cast<uint32_t>(h * t_seed) >> (32U - BITS);
+}
+
+struct Table {
+    uint32_t seed;
+    // index in KEYWORD_NAMES, or EMPTY.
+    std::array<uint8_t, SLOTS> slots;
+};
+
+consteval auto make_table() -> Table {
+    constexpr uint32_t first_seed = 0x9E3779B1U;
+    constexpr uint32_t tries = 1U << 16U;
+    for (uint32_t seed = first_seed; seed != first_seed + (2 * tries);
+         seed += 2) {
+        Table ret{.seed = seed, .slots{}};
+        ret.slots.fill(EMPTY);
+        bool ok{true};
+        for (std::size_t i = 0; ok && i < KEYWORD_NAMES.size(); ++i) {
+            auto& slot = ret.slots[hash(KEYWORD_NAMES[i], seed)];
+            ok = slot == EMPTY;
+            slot = static_cast<uint8_t>(i);
+        }
+        if (ok) {
+            return ret;
+        }
+    }
+    return Table{.seed = 0, .slots{}};
+}
+
+inline constexpr Table TABLE = make_table();
+static_assert(TABLE.seed != 0, "no perfect hash for the keywords, grow BITS");
+
+} // namespace keyword_hash
+
+/**
+ * @return The keyword spelled by `t_word`, in any case.
+ */
+constexpr auto find_keyword(std::string_view t_word)
+    -> std::optional<Keyword> {
+    using namespace keyword_hash;
+    if (t_word.size() < MIN_LEN || t_word.size() > MAX_LEN) {
+        return std::nullopt;
+    }
+    auto idx = TABLE.slots[hash(t_word, TABLE.seed)];
+    if (idx == EMPTY) {
+        return std::nullopt;
+    }
+    auto name = KEYWORD_NAMES[idx];
+    if (name.size() != t_word.size()) {
+        return std::nullopt;
+    }
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        if (fold(name[i]) != fold(t_word[i])) {
+            return std::nullopt;
+        }
+    }
+    return static_cast<Keyword>(idx);
+}
+
+} // namespace tinydb
+
+#endif // !TINYDB_KEYWORD_HXX
@@ -0,0 +1,591 @@
+#include "parser.hxx"
+#include "arena.hxx"
+#include "ast.hxx"
+#include "keyword.hxx"
+#include "tokenizer.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <variant>
+
+namespace tinydb {
+
+namespace {
+
+// binding powers, from loosest to tightest.
+constexpr uint8_t OR_PREC = 1;
+constexpr uint8_t AND_PREC = 2;
+constexpr uint8_t NOT_PREC = 3;
+constexpr uint8_t CMP_PREC = 4;
+constexpr uint8_t ADD_PREC = 5;
+constexpr uint8_t MUL_PREC = 6;
+constexpr uint8_t NEG_PREC = 7;
+
+struct Infix {
+  BinaryOp op;
+  uint8_t prec;
+};
+
+auto infix_of(const Token& t_tok) -> std::optional<Infix> {
+  if (const auto* kw = std::get_if<Keyword>(&t_tok)) {
+    switch (*kw) {
+    case Keyword::Or:
+      return Infix{BinaryOp::Or, OR_PREC};
+    case Keyword::And:
+      return Infix{BinaryOp::And, AND_PREC};
+    default:
+      return std::nullopt;
+    }
+  }
+  const auto* sym = std::get_if<Symbol>(&t_tok);
+  if (sym == nullptr) {
+    return std::nullopt;
+  }
+  switch (*sym) {
+  case Symbol::Equal:
+    return Infix{BinaryOp::Eq, CMP_PREC};
+  case Symbol::NotEqual:
+    return Infix{BinaryOp::Ne, CMP_PREC};
+  case Symbol::LessThan:
+    return Infix{BinaryOp::Lt, CMP_PREC};
+  case Symbol::LessThanEqual:
+    return Infix{BinaryOp::Le, CMP_PREC};
+  case Symbol::MoreThan:
+    return Infix{BinaryOp::Gt, CMP_PREC};
+  case Symbol::MoreThanEqual:
+    return Infix{BinaryOp::Ge, CMP_PREC};
+  case Symbol::Plus:
+    return Infix{BinaryOp::Add, ADD_PREC};
+  case Symbol::Minus:
+    return Infix{BinaryOp::Sub, ADD_PREC};
+  case Symbol::Star:
+    return Infix{BinaryOp::Mul, MUL_PREC};
+  case Symbol::Slash:
+    return Infix{BinaryOp::Div, MUL_PREC};
+  default:
+    return std::nullopt;
+  }
+}
+
+/**
+ * @brief Counts one more level of nesting for as long as it lives.
+ */
+class Nesting {
+public:
+  explicit Nesting(std::size_t& t_depth) : m_depth{t_depth} { ++m_depth; }
+  Nesting(const Nesting&) = delete;
+  Nesting(Nesting&&) = delete;
+  auto operator=(const Nesting&) -> Nesting& = delete;
+  auto operator=(Nesting&&) -> Nesting& = delete;
+  ~Nesting() { --m_depth; }
+
+private:
+  std::size_t& m_depth;
+};
+
+} // namespace
+
+auto Parser::parse(std::span<const Token> t_tokens, Arena& t_arena)
+    -> std::expected<Statement, ParseError> {
+  m_tokens = t_tokens;
+  m_pos = 0;
+  m_depth = 0;
+  m_n_params = 0;
+  m_arena = &t_arena;
+  m_scratch.clear();
+
+  const auto* tok = peek();
+  if (tok == nullptr) {
+    return fail(ParseError::UnexpectedEnd);
+  }
+  const auto* kw = std::get_if<Keyword>(tok);
+  if (kw == nullptr) {
+    return fail(ParseError::UnexpectedToken);
+  }
+  result_t<Statement> ret{std::unexpect, ParseError::UnexpectedToken};
+  switch (*kw) {
+  case Keyword::Select:
+    ret = select();
+    break;
+  case Keyword::Insert:
+    ret = insert();
+    break;
+  case Keyword::Update:
+    ret = update();
+    break;
+  case Keyword::Delete:
+    ret = delete_from();
+    break;
+  case Keyword::Create:
+    ret = create_table();
+    break;
+  default:
+    return fail(ParseError::UnexpectedToken);
+  }
+  if (!ret) {
+    return ret;
+  }
+  accept(Symbol::Semicolon);
+  if (m_pos != m_tokens.size()) {
+    return fail(ParseError::UnexpectedToken);
+  }
+  return ret;
+}
+
+auto Parser::peek() const -> const Token* {
+  return m_pos < m_tokens.size() ? &m_tokens[m_pos] : nullptr;
+}
+
+auto Parser::peek_is(Keyword t_kw) const -> bool {
+  const auto* tok = peek();
+  const auto* kw = tok == nullptr ? nullptr : std::get_if<Keyword>(tok);
+  return kw != nullptr && *kw == t_kw;
+}
+
+auto Parser::peek_is(Symbol t_sym) const -> bool {
+  const auto* tok = peek();
+  const auto* sym = tok == nullptr ? nullptr : std::get_if<Symbol>(tok);
+  return sym != nullptr && *sym == t_sym;
+}
+
+auto Parser::accept(Keyword t_kw) -> bool {
+  if (!peek_is(t_kw)) {
+    return false;
+  }
+  ++m_pos;
+  return true;
+}
+
+auto Parser::accept(Symbol t_sym) -> bool {
+  if (!peek_is(t_sym)) {
+    return false;
+  }
+  ++m_pos;
+  return true;
+}
+
+auto Parser::expect(Keyword t_kw) -> result_t<void> {
+  if (accept(t_kw)) {
+    return {};
+  }
+  return fail(peek() == nullptr ? ParseError::UnexpectedEnd
+                                : ParseError::UnexpectedToken);
+}
+
+auto Parser::expect(Symbol t_sym) -> result_t<void> {
+  if (accept(t_sym)) {
+    return {};
+  }
+  return fail(peek() == nullptr ? ParseError::UnexpectedEnd
+                                : ParseError::UnexpectedToken);
+}
+
+auto Parser::identifier() -> result_t<std::string_view> {
+  const auto* tok = peek();
+  if (tok == nullptr) {
+    return fail(ParseError::UnexpectedEnd);
+  }
+  const auto* id = std::get_if<Identifier>(tok);
+  if (id == nullptr) {
+    return fail(ParseError::ExpectedIdentifier);
+  }
+  ++m_pos;
+  return id->val;
+}
+
+auto Parser::fail(ParseError t_err) const -> std::unexpected<ParseError> {
+  return std::unexpected{t_err};
+}
+
+auto Parser::select() -> result_t<Statement> {
+  ++m_pos;
+  Select ret{};
+  if (!accept(Symbol::Star)) {
+    const auto start = m_scratch.size();
+    do {
+      auto item = expr();
+      if (!item) {
+        return std::unexpected{item.error()};
+      }
+      std::string_view alias{};
+      const auto* tok = peek();
+      if (accept(Keyword::As) ||
+          (tok != nullptr && std::holds_alternative<Identifier>(*tok))) {
+        auto name = identifier();
+        if (!name) {
+          return std::unexpected{name.error()};
+        }
+        alias = *name;
+      }
+      push(SelectItem{.expr = *item, .alias = alias});
+    } while (accept(Symbol::Comma));
+    ret.items = finish_list<SelectItem>(start);
+  }
+  if (accept(Keyword::From)) {
+    auto table = identifier();
+    if (!table) {
+      return std::unexpected{table.error()};
+    }
+    ret.table = *table;
+    const auto start = m_scratch.size();
+    while (peek_is(Keyword::Join) || peek_is(Keyword::Inner)) {
+      accept(Keyword::Inner);
+      if (auto join = expect(Keyword::Join); !join) {
+        return std::unexpected{join.error()};
+      }
+      auto other = identifier();
+      if (!other) {
+        return std::unexpected{other.error()};
+      }
+      if (auto on = expect(Keyword::On); !on) {
+        return std::unexpected{on.error()};
+      }
+      auto on = expr();
+      if (!on) {
+        return std::unexpected{on.error()};
+      }
+      push(JoinClause{.table = *other, .on = *on});
+    }
+    ret.joins = finish_list<JoinClause>(start);
+  }
+  auto cond = where();
+  if (!cond) {
+    return std::unexpected{cond.error()};
+  }
+  ret.where = *cond;
+  if (accept(Keyword::Group)) {
+    if (auto by = expect(Keyword::By); !by) {
+      return std::unexpected{by.error()};
+    }
+    const auto start = m_scratch.size();
+    do {
+      auto key = expr();
+      if (!key) {
+        return std::unexpected{key.error()};
+      }
+      push(*key);
+    } while (accept(Symbol::Comma));
+    ret.group_by = finish_list<const Expr*>(start);
+  }
+  if (accept(Keyword::Order)) {
+    if (auto by = expect(Keyword::By); !by) {
+      return std::unexpected{by.error()};
+    }
+    const auto start = m_scratch.size();
+    do {
+      auto key = expr();
+      if (!key) {
+        return std::unexpected{key.error()};
+      }
+      const bool desc = accept(Keyword::Desc);
+      if (!desc) {
+        accept(Keyword::Asc);
+      }
+      push(OrderItem{.expr = *key, .desc = desc});
+    } while (accept(Symbol::Comma));
+    ret.order_by = finish_list<OrderItem>(start);
+  }
+  if (accept(Keyword::Limit)) {
+    auto limit = expr();
+    if (!limit) {
+      return std::unexpected{limit.error()};
+    }
+    ret.limit = *limit;
+    if (accept(Keyword::Offset)) {
+      auto offset = expr();
+      if (!offset) {
+        return std::unexpected{offset.error()};
+      }
+      ret.offset = *offset;
+    }
+  }
+  return ret;
+}
+
+auto Parser::insert() -> result_t<Statement> {
+  ++m_pos;
+  if (auto into = expect(Keyword::Into); !into) {
+    return std::unexpected{into.error()};
+  }
+  auto table = identifier();
+  if (!table) {
+    return std::unexpected{table.error()};
+  }
+  Insert ret{.table = *table, .columns{}, .rows{}};
+  if (accept(Symbol::LParen)) {
+    const auto start = m_scratch.size();
+    do {
+      auto col = identifier();
+      if (!col) {
+        return std::unexpected{col.error()};
+      }
+      push(*col);
+    } while (accept(Symbol::Comma));
+    if (auto close = expect(Symbol::RParen); !close) {
+      return std::unexpected{close.error()};
+    }
+    ret.columns = finish_list<std::string_view>(start);
+  }
+  if (auto values = expect(Keyword::Values); !values) {
+    return std::unexpected{values.error()};
+  }
+  const auto rows_start = m_scratch.size();
+  do {
+    if (auto open = expect(Symbol::LParen); !open) {
+      return std::unexpected{open.error()};
+    }
+    // a row is complete before it's pushed, so the lists stay stacked.
+    const auto start = m_scratch.size();
+    do {
+      auto val = expr();
+      if (!val) {
+        return std::unexpected{val.error()};
+      }
+      push(*val);
+    } while (accept(Symbol::Comma));
+    if (auto close = expect(Symbol::RParen); !close) {
+      return std::unexpected{close.error()};
+    }
+    push(finish_list<const Expr*>(start));
+  } while (accept(Symbol::Comma));
+  ret.rows = finish_list<std::span<const Expr* const>>(rows_start);
+  return ret;
+}
+
+auto Parser::update() -> result_t<Statement> {
+  ++m_pos;
+  auto table = identifier();
+  if (!table) {
+    return std::unexpected{table.error()};
+  }
+  if (auto set = expect(Keyword::Set); !set) {
+    return std::unexpected{set.error()};
+  }
+  const auto start = m_scratch.size();
+  do {
+    auto col = identifier();
+    if (!col) {
+      return std::unexpected{col.error()};
+    }
+    if (auto eq = expect(Symbol::Equal); !eq) {
+      return std::unexpected{eq.error()};
+    }
+    auto val = expr();
+    if (!val) {
+      return std::unexpected{val.error()};
+    }
+    push(Assignment{.column = *col, .value = *val});
+  } while (accept(Symbol::Comma));
+  auto set = finish_list<Assignment>(start);
+  auto cond = where();
+  if (!cond) {
+    return std::unexpected{cond.error()};
+  }
+  return Update{.table = *table, .set = set, .where = *cond};
+}
+
+auto Parser::delete_from() -> result_t<Statement> {
+  ++m_pos;
+  if (auto from = expect(Keyword::From); !from) {
+    return std::unexpected{from.error()};
+  }
+  auto table = identifier();
+  if (!table) {
+    return std::unexpected{table.error()};
+  }
+  auto cond = where();
+  if (!cond) {
+    return std::unexpected{cond.error()};
+  }
+  return Delete{.table = *table, .where = *cond};
+}
+
+auto Parser::create_table() -> result_t<Statement> {
+  ++m_pos;
+  if (auto table = expect(Keyword::Table); !table) {
+    return std::unexpected{table.error()};
+  }
+  auto name = identifier();
+  if (!name) {
+    return std::unexpected{name.error()};
+  }
+  if (auto open = expect(Symbol::LParen); !open) {
+    return std::unexpected{open.error()};
+  }
+  const auto start = m_scratch.size();
+  do {
+    auto col = column_def();
+    if (!col) {
+      return std::unexpected{col.error()};
+    }
+    push(*col);
+  } while (accept(Symbol::Comma));
+  if (auto close = expect(Symbol::RParen); !close) {
+    return std::unexpected{close.error()};
+  }
+  return CreateTable{.name = *name,
+                     .columns = finish_list<ColumnDef>(start)};
+}
+
+auto Parser::where() -> result_t<const Expr*> {
+  if (!accept(Keyword::Where)) {
+    return nullptr;
+  }
+  return expr();
+}
+
+auto Parser::column_def() -> result_t<ColumnDef> {
+  auto name = identifier();
+  if (!name) {
+    return std::unexpected{name.error()};
+  }
+  auto type = identifier();
+  if (!type) {
+    return std::unexpected{type.error()};
+  }
+  ColumnDef ret{
+      .name = *name, .type = *type, .length = 0, .primary_key = false};
+  if (accept(Symbol::LParen)) {
+    const auto* tok = peek();
+    const auto* lit = tok == nullptr ? nullptr : std::get_if<Literal>(tok);
+    const auto* len =
+        lit == nullptr ? nullptr : std::get_if<int32_t>(&lit->val);
+    if (len == nullptr || *len <= 0) {
+      return fail(tok == nullptr ? ParseError::UnexpectedEnd
+                                 : ParseError::UnexpectedToken);
+    }
+    ++m_pos;
+    ret.length = static_cast<uint32_t>(*len);
+    if (auto close = expect(Symbol::RParen); !close) {
+      return std::unexpected{close.error()};
+    }
+  }
+  if (accept(Keyword::Primary)) {
+    if (auto key = expect(Keyword::Key); !key) {
+      return std::unexpected{key.error()};
+    }
+    ret.primary_key = true;
+  }
+  return ret;
+}
+
+auto Parser::expr(uint8_t t_min_prec) -> result_t<const Expr*> {
+  const Nesting nesting{m_depth};
+  if (m_depth > MAX_DEPTH) {
+    return fail(ParseError::TooDeep);
+  }
+  auto lhs = prefix();
+  if (!lhs) {
+    return lhs;
+  }
+  while (const auto* tok = peek()) {
+    // postfix `IS [NOT] NULL`, as tight as a comparison.
+    if (CMP_PREC >= t_min_prec && accept(Keyword::Is)) {
+      const bool negated = accept(Keyword::Not);
+      if (auto null = expect(Keyword::Null); !null) {
+        return std::unexpected{null.error()};
+      }
+      lhs = new_expr(Unary{
+          .op = negated ? UnaryOp::IsNotNull : UnaryOp::IsNull,
+          .operand = *lhs});
+      continue;
+    }
+    auto op = infix_of(*tok);
+    if (!op || op->prec < t_min_prec) {
+      break;
+    }
+    ++m_pos;
+    // the right side only takes tighter operators: left associative.
+    auto rhs = expr(static_cast<uint8_t>(op->prec + 1));
+    if (!rhs) {
+      return rhs;
+    }
+    lhs = new_expr(Binary{.op = op->op, .lhs = *lhs, .rhs = *rhs});
+  }
+  return lhs;
+}
+
+auto Parser::prefix() -> result_t<const Expr*> {
+  const auto* tok = peek();
+  if (tok == nullptr) {
+    return fail(ParseError::UnexpectedEnd);
+  }
+  if (const auto* lit = std::get_if<Literal>(tok)) {
+    ++m_pos;
+    return new_expr(*lit);
+  }
+  if (const auto* id = std::get_if<Identifier>(tok)) {
+    ++m_pos;
+    return name_or_call(id->val);
+  }
+  if (accept(Keyword::Null)) {
+    return new_expr(NullValue{});
+  }
+  if (accept(Symbol::Placeholder)) {
+    return new_expr(Param{.idx = m_n_params++});
+  }
+  if (accept(Keyword::Not) || accept(Symbol::Minus)) {
+    const bool is_not = std::holds_alternative<Keyword>(*tok);
+    auto operand = expr(is_not ? NOT_PREC : NEG_PREC);
+    if (!operand) {
+      return operand;
+    }
+    return new_expr(Unary{.op = is_not ? UnaryOp::Not : UnaryOp::Neg,
+                          .operand = *operand});
+  }
+  if (accept(Symbol::LParen)) {
+    auto inner = expr();
+    if (!inner) {
+      return inner;
+    }
+    if (auto close = expect(Symbol::RParen); !close) {
+      return std::unexpected{close.error()};
+    }
+    return inner;
+  }
+  return fail(ParseError::ExpectedExpression);
+}
+
+auto Parser::name_or_call(std::string_view t_name) -> result_t<const Expr*> {
+  if (accept(Symbol::Dot)) {
+    auto col = identifier();
+    if (!col) {
+      return std::unexpected{col.error()};
+    }
+    return new_expr(ColumnRef{.table = t_name, .name = *col});
+  }
+  if (!accept(Symbol::LParen)) {
+    return new_expr(ColumnRef{.table{}, .name = t_name});
+  }
+  if (accept(Symbol::Star)) {
+    if (auto close = expect(Symbol::RParen); !close) {
+      return std::unexpected{close.error()};
+    }
+    return new_expr(Call{.name = t_name, .args{}, .star = true});
+  }
+  const auto start = m_scratch.size();
+  if (!accept(Symbol::RParen)) {
+    do {
+      auto arg = expr();
+      if (!arg) {
+        return arg;
+      }
+      push(*arg);
+    } while (accept(Symbol::Comma));
+    if (auto close = expect(Symbol::RParen); !close) {
+      return std::unexpected{close.error()};
+    }
+  }
+  return new_expr(Call{.name = t_name,
+                       .args = finish_list<const Expr*>(start),
+                       .star = false});
+}
+
+auto Parser::new_expr(auto t_node) -> const Expr* {
+  return m_arena->make<Expr>(Expr{t_node});
+}
+
+} // namespace tinydb
@@ -0,0 +1,154 @@
+/**
+ * @file parser.hxx
+ * @brief Parsing turns the tokens of one statement into its syntax tree
+ * (see ast.hxx).
+ *
+ * Statements are parsed by recursive descent, one function per kind of
+ * statement and clause. Expressions are parsed by precedence climbing
+ * (a Pratt parser), from loosest to tightest:
+ * - `OR`
+ * - `AND`
+ * - `NOT`
+ * - comparisons, `IS [NOT] NULL`
+ * - `+`, `-`
+ * - `*`, `/`
+ * - unary `-`
+ *
+ * Binary operators are left associative. Nodes go into the Arena given to
+ * `parse`, and the lists of a statement are first gathered in a scratch
+ * buffer owned by the Parser. Once both have grown big enough, parsing a
+ * statement doesn't touch the system allocator at all.
+ */
+
+#ifndef TINYDB_PARSER_HXX
+#define TINYDB_PARSER_HXX
+
+#include "arena.hxx"
+#include "ast.hxx"
+#include "tokenizer.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace tinydb {
+
+enum class ParseError : uint8_t {
+    UnexpectedEnd = 0,
+    UnexpectedToken,
+    ExpectedIdentifier,
+    ExpectedExpression,
+    TooDeep,
+};
+
+/**
+ * @class Parser
+ * @brief Builds the syntax tree of a statement.
+ *
+ * Like the Tokenizer, one Parser is meant to be reused for every statement.
+ */
+class Parser {
+  public:
+    // nesting allowed in expressions, to keep the recursion off the end of
+    // the stack.
+    static constexpr std::size_t MAX_DEPTH = 256;
+
+    Parser() = default;
+
+    /**
+     * @brief Parses exactly one statement, maybe followed by a `;`.
+     *
+     * @param t_tokens Must outlive the tree, and so must their input.
+     * @param t_arena Where the nodes go. Resetting it drops the tree.
+     */
+    auto parse(std::span<const Token> t_tokens, Arena& t_arena)
+        -> std::expected<Statement, ParseError>;
+
+    /**
+     * @return Index of the token the last error is about. The number of
+     * tokens if the statement ended too early.
+     */
+    [[nodiscard]] auto error_pos() const noexcept -> std::size_t {
+        return m_pos;
+    }
+
+    /**
+     * @return How many `?` the last statement has.
+     */
+    [[nodiscard]] auto n_params() const noexcept -> std::size_t {
+        return m_n_params;
+    }
+
+  private:
+    template <typename T> using result_t = std::expected<T, ParseError>;
+
+    std::span<const Token> m_tokens{};
+    std::size_t m_pos{0};
+    std::size_t m_depth{0};
+    uint32_t m_n_params{0};
+    Arena* m_arena{nullptr};
+    // a stack of lists under construction, as raw bytes: a list is pushed
+    // item by item, and then moved to the arena in one piece.
+    std::vector<std::byte> m_scratch{};
+
+    [[nodiscard]] auto peek() const -> const Token*;
+    [[nodiscard]] auto peek_is(Keyword t_kw) const -> bool;
+    [[nodiscard]] auto peek_is(Symbol t_sym) const -> bool;
+    auto accept(Keyword t_kw) -> bool;
+    auto accept(Symbol t_sym) -> bool;
+    auto expect(Keyword t_kw) -> result_t<void>;
+    auto expect(Symbol t_sym) -> result_t<void>;
+    auto identifier() -> result_t<std::string_view>;
+    auto fail(ParseError t_err) const -> std::unexpected<ParseError>;
+
+    template <typename T> void push(const T& t_item) {
+        auto off = m_scratch.size();
+        m_scratch.resize(off + sizeof(T));
+        std::memcpy(m_scratch.data() + off, &t_item, sizeof(T));
+    }
+
+    /**
+     * @brief Moves what was pushed since `t_start` (a size of the scratch
+     * buffer) to the arena.
+     */
+    template <typename T>
+    auto finish_list(std::size_t t_start) -> std::span<const T> {
+        auto count = (m_scratch.size() - t_start) / sizeof(T);
+        if (count == 0) {
+            return {};
+        }
+        auto* dst =
+            static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+        std::memcpy(dst, m_scratch.data() + t_start, count * sizeof(T));
+        m_scratch.resize(t_start);
+        return {dst, count};
+    }
+
+    auto select() -> result_t<Statement>;
+    auto insert() -> result_t<Statement>;
+    auto update() -> result_t<Statement>;
+    auto delete_from() -> result_t<Statement>;
+    auto create_table() -> result_t<Statement>;
+
+    /**
+     * @brief `WHERE expr`, or nothing.
+     */
+    auto where() -> result_t<const Expr*>;
+    auto column_def() -> result_t<ColumnDef>;
+
+    /**
+     * @brief An expression whose operators all bind at least as tight as
+     * `t_min_prec`.
+     */
+    auto expr(uint8_t t_min_prec = 0) -> result_t<const Expr*>;
+    auto prefix() -> result_t<const Expr*>;
+    auto name_or_call(std::string_view t_name) -> result_t<const Expr*>;
+    auto new_expr(auto t_node) -> const Expr*;
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_PARSER_HXX
@@ -0,0 +1,105 @@
+#include "prepared.hxx"
+#include "ast.hxx"
+#include "exec.hxx"
+#include "parser.hxx"
+#include "tokenizer.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace tinydb {
+
+auto PreparedStatement::bind(std::size_t t_idx, Literal t_val) -> bool {
+  if (t_idx >= m_params.size()) {
+    return false;
+  }
+  m_params[t_idx] = t_val;
+  return true;
+}
+
+auto PreparedStatement::bind_null(std::size_t t_idx) -> bool {
+  if (t_idx >= m_params.size()) {
+    return false;
+  }
+  m_params[t_idx] = NullValue{};
+  return true;
+}
+
+void PreparedStatement::clear_bindings() {
+  std::ranges::fill(m_params, std::monostate{});
+}
+
+auto PreparedStatement::execute(const Catalog& t_catalog)
+    -> std::expected<ResultSet, ExecError> {
+  auto unbound = [](const ParamValue& t_val) {
+    return std::holds_alternative<std::monostate>(t_val);
+  };
+  if (std::ranges::any_of(m_params, unbound)) {
+    return std::unexpected{ExecError::UnboundParameter};
+  }
+  std::shared_ptr<const CompiledStatement> comp;
+  {
+    std::scoped_lock lock{m_plan->mutex};
+    comp = m_plan->compiled;
+  }
+  if (comp == nullptr || !is_current(*comp, t_catalog, m_params)) {
+    auto fresh = compile(m_plan->stmt, t_catalog, m_params);
+    if (!fresh) {
+      return std::unexpected{fresh.error()};
+    }
+    comp = std::move(*fresh);
+    std::scoped_lock lock{m_plan->mutex};
+    m_plan->compiled = comp;
+  }
+  return run(*comp, t_catalog, m_params);
+}
+
+auto PlanCache::prepare(std::string_view t_sql)
+    -> std::expected<PreparedStatement, PrepareError> {
+  Tokenizer::normalize(t_sql, m_key);
+  if (auto it = m_index.find(m_key); it != m_index.end()) {
+    ++m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return PreparedStatement{m_lru.front()};
+  }
+  ++m_misses;
+  auto plan = build(m_key);
+  if (!plan) {
+    return std::unexpected{plan.error()};
+  }
+  if (m_capacity == 0) {
+    return PreparedStatement{std::move(*plan)};
+  }
+  if (m_lru.size() == m_capacity) {
+    // statements still using the plan keep it alive.
+    m_index.erase(m_lru.back()->text);
+    m_lru.pop_back();
+  }
+  m_lru.push_front(*plan);
+  m_index.emplace(m_lru.front()->text, m_lru.begin());
+  return PreparedStatement{std::move(*plan)};
+}
+
+auto PlanCache::build(std::string t_text)
+    -> std::expected<std::shared_ptr<const Plan>, PrepareError> {
+  auto plan = std::make_shared<Plan>();
+  plan->text = std::move(t_text);
+  if (auto ok = plan->tokenizer.tokenize(plan->text); !ok) {
+    return std::unexpected{ok.error()};
+  }
+  auto stmt = m_parser.parse(plan->tokenizer.tokens(), plan->arena);
+  if (!stmt) {
+    return std::unexpected{stmt.error()};
+  }
+  plan->stmt = *stmt;
+  plan->n_params = m_parser.n_params();
+  return plan;
+}
+
+} // namespace tinydb
@@ -0,0 +1,160 @@
+/**
+ * @file prepared.hxx
+ * @brief Prepared statements, and the cache of plans behind them.
+ *
+ * Preparing a statement tokenizes and parses it. The result is a Plan,
+ * which is immutable and shared: every PreparedStatement of the same text
+ * points to the same Plan, and only owns the values bound to its
+ * parameters (`?`).
+ *
+ * The first `execute` also compiles the statement (see `tinydb::compile`),
+ * and keeps the result in the Plan for the next ones: names are resolved,
+ * types checked and the filters to push down picked once. Each `execute`
+ * then only builds the operators, with the values bound then: the `?` are
+ * read by the expressions as they run, not compiled into them. A Plan is
+ * compiled again for a catalog with other tables (see `Catalog::version`),
+ * or values of other types than last time, NULL included.
+ *
+ * Plans are kept in a PlanCache, least recently used first out, keyed by the
+ * normalized text of the statement (see `Tokenizer::normalize`). So
+ * `select * from t where id = ?` and `SELECT *  FROM t WHERE id = ?;` are
+ * prepared once between them, and a statement issued a million times is
+ * tokenized and parsed once.
+ */
+
+#ifndef TINYDB_PREPARED_HXX
+#define TINYDB_PREPARED_HXX
+
+#include "arena.hxx"
+#include "ast.hxx"
+#include "exec.hxx"
+#include "parser.hxx"
+#include "tokenizer.hxx"
+#include <cstddef>
+#include <expected>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace tinydb {
+
+using PrepareError = std::variant<TokenizerError, ParseError>;
+
+/**
+ * @class Plan
+ * @brief A statement, tokenized and parsed.
+ *
+ * The tree points into the tokens, which point into the text: a Plan never
+ * moves once built, and is only handled through a `shared_ptr`.
+ */
+struct Plan {
+    std::string text;
+    Tokenizer tokenizer;
+    Arena arena;
+    Statement stmt;
+    std::size_t n_params;
+    // the statement as last compiled, by whichever PreparedStatement ran it
+    // first.
+    mutable std::mutex mutex{};
+    mutable std::shared_ptr<const CompiledStatement> compiled{};
+};
+
+/**
+ * @class PreparedStatement
+ * @brief A Plan, and values for its parameters.
+ */
+class PreparedStatement {
+  public:
+    explicit PreparedStatement(std::shared_ptr<const Plan> t_plan)
+        : m_plan{std::move(t_plan)}, m_params(m_plan->n_params) {}
+
+    [[nodiscard]] auto plan() const noexcept -> const Plan& {
+        return *m_plan;
+    }
+
+    [[nodiscard]] auto n_params() const noexcept -> std::size_t {
+        return m_params.size();
+    }
+
+    [[nodiscard]] auto params() const noexcept -> std::span<const ParamValue> {
+        return m_params;
+    }
+
+    /**
+     * @brief Binds the `t_idx`th `?`, from 0. Values stay bound across
+     * `execute` calls, until bound again or `clear_bindings`.
+     * @return false if there's no such parameter.
+     */
+    auto bind(std::size_t t_idx, Literal t_val) -> bool;
+    auto bind_null(std::size_t t_idx) -> bool;
+    void clear_bindings();
+
+    /**
+     * @brief Runs the statement with the values bound so far. Every
+     * parameter must have one. Compiles the statement first, unless the
+     * Plan already was for this catalog and values of the same types.
+     */
+    auto execute(const Catalog& t_catalog)
+        -> std::expected<ResultSet, ExecError>;
+
+  private:
+    std::shared_ptr<const Plan> m_plan;
+    std::vector<ParamValue> m_params;
+};
+
+/**
+ * @class PlanCache
+ * @brief Prepares statements, reusing the plans of the most recently used
+ * ones.
+ */
+class PlanCache {
+  public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 128;
+
+    explicit PlanCache(std::size_t t_capacity = DEFAULT_CAPACITY)
+        : m_capacity{t_capacity} {}
+
+    /**
+     * @brief Prepares one statement, from the cache if possible.
+     */
+    auto prepare(std::string_view t_sql)
+        -> std::expected<PreparedStatement, PrepareError>;
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return m_lru.size();
+    }
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t {
+        return m_capacity;
+    }
+    [[nodiscard]] auto hits() const noexcept -> std::size_t { return m_hits; }
+    [[nodiscard]] auto misses() const noexcept -> std::size_t {
+        return m_misses;
+    }
+
+  private:
+    std::size_t m_capacity;
+    std::size_t m_hits{0};
+    std::size_t m_misses{0};
+    // most recently used first.
+    std::list<std::shared_ptr<const Plan>> m_lru{};
+    // keys are views of the text of the plans, which don't move.
+    std::unordered_map<std::string_view,
+                       std::list<std::shared_ptr<const Plan>>::iterator>
+        m_index{};
+    Parser m_parser{};
+    // the normalized text of the statement being prepared.
+    std::string m_key{};
+
+    auto build(std::string t_text)
+        -> std::expected<std::shared_ptr<const Plan>, PrepareError>;
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_PREPARED_HXX
@@ -0,0 +1,124 @@
+#include "scheduler.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace tinydb {
+
+Scheduler::Scheduler(std::size_t t_n_workers) {
+  t_n_workers = std::max<std::size_t>(t_n_workers, 1);
+  for (std::size_t w = 0; w < t_n_workers; ++w) {
+    m_queues.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t w = 0; w < t_n_workers; ++w) {
+    m_threads.emplace_back([this, w] { work(w); });
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+auto Scheduler::default_workers() noexcept -> std::size_t {
+  return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+void Scheduler::run(std::size_t t_n_tasks, const Task& t_fn) {
+  if (t_n_tasks == 0) {
+    return;
+  }
+  std::scoped_lock run_lock{m_run_mutex};
+  // contiguous blocks: neighbouring tasks usually read neighbouring pages.
+  const auto n_workers = m_queues.size();
+  for (std::size_t w = 0; w < n_workers; ++w) {
+    std::scoped_lock lock{m_queues[w]->mutex};
+    for (auto task = t_n_tasks * w / n_workers;
+         task < t_n_tasks * (w + 1) / n_workers; ++task) {
+      m_queues[w]->tasks.push_back(task);
+    }
+  }
+
+  std::unique_lock lock{m_mutex};
+  m_fn = &t_fn;
+  m_error = nullptr;
+  m_failed = false;
+  m_busy = n_workers;
+  ++m_generation;
+  m_wake.notify_all();
+  m_done.wait(lock, [&] { return m_busy == 0; });
+  m_fn = nullptr;
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+}
+
+void Scheduler::work(std::size_t t_worker) {
+  uint64_t seen{0};
+  while (true) {
+    const Task* fn{nullptr};
+    {
+      std::unique_lock lock{m_mutex};
+      m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+      if (m_stop) {
+        return;
+      }
+      seen = m_generation;
+      fn = m_fn;
+    }
+    while (auto task = pop(t_worker)) {
+      if (m_failed) {
+        continue;
+      }
+      try {
+        (*fn)(t_worker, *task);
+      } catch (...) {
+        std::scoped_lock lock{m_mutex};
+        if (!m_failed) {
+          m_error = std::current_exception();
+          m_failed = true;
+        }
+      }
+    }
+    std::scoped_lock lock{m_mutex};
+    if (--m_busy == 0) {
+      m_done.notify_one();
+    }
+  }
+}
+
+auto Scheduler::pop(std::size_t t_worker) -> std::optional<std::size_t> {
+  {
+    auto& own = *m_queues[t_worker];
+    std::scoped_lock lock{own.mutex};
+    if (!own.tasks.empty()) {
+      auto task = own.tasks.front();
+      own.tasks.pop_front();
+      return task;
+    }
+  }
+  // steal, starting with the next worker over so that thieves spread out.
+  for (std::size_t i = 1; i < m_queues.size(); ++i) {
+    auto& other = *m_queues[(t_worker + i) % m_queues.size()];
+    std::scoped_lock lock{other.mutex};
+    if (!other.tasks.empty()) {
+      auto task = other.tasks.back();
+      other.tasks.pop_back();
+      return task;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace tinydb
@@ -0,0 +1,105 @@
+/**
+ * @file scheduler.hxx
+ * @brief A fixed pool of worker threads, sharing out the tasks of one job at
+ * a time.
+ *
+ * The tasks of a job are dealt out up front, in contiguous blocks, one queue
+ * per worker. Each worker takes its own tasks from the front of its queue,
+ * in order, and once it runs out steals from the back of the others'. A
+ * worker finishing early thus takes over from one falling behind, without
+ * any coordination as long as everyone still has work of their own.
+ *
+ * The queues are deques behind a mutex each, rather than lock-free
+ * (Chase-Lev) deques: tasks here are morsels of tens of thousands of rows,
+ * so a lock no other thread wants, taken once per task, costs nothing
+ * measurable.
+ */
+
+#ifndef TINYDB_SCHEDULER_HXX
+#define TINYDB_SCHEDULER_HXX
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace tinydb {
+
+/**
+ * @class Scheduler
+ * @brief Worker threads, started once and reused by every `run`.
+ */
+class Scheduler {
+  public:
+    /**
+     * @brief `t_worker` is in [0, n_workers()): anything a worker keeps
+     * across tasks can be indexed by it, without locking.
+     */
+    using Task = std::function<void(std::size_t t_worker, std::size_t t_task)>;
+
+    /**
+     * @param t_n_workers At least 1. Defaults to one per hardware thread.
+     */
+    explicit Scheduler(std::size_t t_n_workers = default_workers());
+    Scheduler(const Scheduler&) = delete;
+    Scheduler(Scheduler&&) = delete;
+    auto operator=(const Scheduler&) -> Scheduler& = delete;
+    auto operator=(Scheduler&&) -> Scheduler& = delete;
+    ~Scheduler();
+
+    [[nodiscard]] auto n_workers() const noexcept -> std::size_t {
+        return m_threads.size();
+    }
+
+    /**
+     * @brief Calls `t_fn` for every task in [0, t_n_tasks), and waits until
+     * they're all done. Concurrent calls run one after the other.
+     *
+     * If a task throws, the tasks that haven't started yet are skipped, and
+     * the first exception is rethrown here.
+     */
+    void run(std::size_t t_n_tasks, const Task& t_fn);
+
+    static auto default_workers() noexcept -> std::size_t;
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    // one job at a time.
+    std::mutex m_run_mutex;
+
+    // guards everything below.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const Task* m_fn{nullptr};
+    // bumped by every `run`, so workers know there's a new job.
+    uint64_t m_generation{0};
+    // workers still on the current job.
+    std::size_t m_busy{0};
+    std::exception_ptr m_error;
+    bool m_stop{false};
+    // set as soon as a task throws, for the others to stop early.
+    std::atomic<bool> m_failed{false};
+
+    void work(std::size_t t_worker);
+    auto pop(std::size_t t_worker) -> std::optional<std::size_t>;
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_SCHEDULER_HXX
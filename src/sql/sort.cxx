@@ -0,0 +1,481 @@
+#include "sort.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace tinydb {
+
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+using dbfile::internal::SpillFile;
+
+namespace {
+
+// a top-K sort compacts its rows once it dropped at least this many.
+constexpr std::size_t MIN_DROPPED = 1024;
+
+template <typename T> void put(std::vector<std::byte>& t_out, const T& t_val) {
+  const auto* src = std::bit_cast<const std::byte*>(&t_val);
+  t_out.insert(t_out.end(), src, src + sizeof(T));
+}
+
+template <typename T>
+auto get(SpillFile::Reader& t_reader, std::istream& t_in, T& t_val) -> bool {
+  return t_reader.read({std::bit_cast<std::byte*>(&t_val), sizeof(T)}, t_in);
+}
+
+/**
+ * @brief Appends a number most significant byte first, so that `memcmp`
+ * compares them as unsigned numbers.
+ */
+void put_big(std::vector<std::byte>& t_out, uint64_t t_val) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    t_out.push_back(static_cast<std::byte>(t_val >> shift));
+  }
+}
+
+/**
+ * @brief Appends the normalized form of a value: a byte, 1 if NULL, then
+ * the value, such that `memcmp` orders them like the values are ordered.
+ *
+ * Ints get their sign bit flipped, and floats all their bits if negative,
+ * their sign bit otherwise. A string ends with two zero bytes, and a zero
+ * byte inside is followed by 0xff, so that a string comes before any longer
+ * one it starts. Every byte is inverted when descending.
+ */
+void normalize(const SortKey& t_key, const ColumnVector& t_col,
+               std::size_t t_row, std::vector<std::byte>& t_out) {
+  constexpr uint64_t SIGN = uint64_t{1} << 63;
+  const auto start = t_out.size();
+  if (t_col.is_null(t_row)) {
+    t_out.push_back(std::byte{1});
+  } else {
+    t_out.push_back(std::byte{0});
+    switch (t_key.type) {
+    case VType::Bool:
+      t_out.push_back(
+          static_cast<std::byte>(t_col.values<uint8_t>()[t_row] != 0));
+      break;
+    case VType::Int:
+      put_big(t_out,
+              std::bit_cast<uint64_t>(t_col.values<int64_t>()[t_row]) ^ SIGN);
+      break;
+    case VType::Float: {
+      auto val = t_col.values<double>()[t_row];
+      // -0 is 0, and every NaN the same one, after everything else.
+      if (val == 0.0) {
+        val = 0.0;
+      } else if (std::isnan(val)) {
+        val = std::numeric_limits<double>::quiet_NaN();
+      }
+      auto bits = std::bit_cast<uint64_t>(val);
+      put_big(t_out, (bits & SIGN) != 0 ? ~bits : bits | SIGN);
+      break;
+    }
+    case VType::Text:
+      for (auto c : t_col.text(t_row)) {
+        t_out.push_back(static_cast<std::byte>(c));
+        if (c == '\0') {
+          t_out.push_back(std::byte{0xff});
+        }
+      }
+      t_out.insert(t_out.end(), 2, std::byte{0});
+      break;
+    }
+  }
+  if (t_key.desc) {
+    for (auto i = start; i < t_out.size(); ++i) {
+      t_out[i] = ~t_out[i];
+    }
+  }
+}
+
+auto compare(std::span<const std::byte> t_lhs, std::span<const std::byte> t_rhs)
+    -> std::strong_ordering {
+  return std::lexicographical_compare_three_way(t_lhs.begin(), t_lhs.end(),
+                                                t_rhs.begin(), t_rhs.end());
+}
+
+/**
+ * @return The first 8 bytes of a key, as a number that compares like them.
+ */
+auto prefix_of(std::span<const std::byte> t_key) -> uint64_t {
+  uint64_t ret{0};
+  for (std::size_t i = 0; i < sizeof(uint64_t); ++i) {
+    ret <<= 8U;
+    if (i < t_key.size()) {
+      ret |= static_cast<uint64_t>(t_key[i]);
+    }
+  }
+  return ret;
+}
+
+auto memory_of(const ColumnVector& t_col) -> std::size_t {
+  return t_col.data.size() + t_col.nulls.size() +
+         (t_col.offsets.size() * sizeof(uint32_t));
+}
+
+void copy_value(const ColumnVector& t_src, std::size_t t_row,
+                ColumnVector& t_dst) {
+  if (t_src.is_null(t_row)) {
+    t_dst.push_null();
+  } else {
+    t_dst.push_bytes(t_src.bytes(t_row));
+  }
+}
+
+} // namespace
+
+Sorter::Sorter(std::vector<SortKey> t_keys, std::vector<ColType> t_cols,
+               std::optional<dbfile::internal::SpillSpace> t_spill,
+               std::size_t t_mem_limit, std::optional<std::size_t> t_limit)
+    : m_keys{std::move(t_keys)}, m_types{std::move(t_cols)},
+      m_spill{t_spill}, m_mem_limit{t_mem_limit},
+      m_limit{t_limit && *t_limit <= MAX_TOP_K ? t_limit : std::nullopt},
+      m_rows{empty_rows()} {}
+
+Sorter::~Sorter() {
+  if (!m_spill) {
+    return;
+  }
+  for (auto& run : m_runs) {
+    run.file.free_pages(*m_spill->fl, *m_spill->io);
+  }
+}
+
+auto Sorter::empty_rows() const -> Rows {
+  Rows ret{.cols{}, .key_off{0}, .keys{}};
+  for (auto type : m_types) {
+    ret.cols.emplace_back(type);
+  }
+  return ret;
+}
+
+void Sorter::encode(const Batch& t_batch, std::size_t t_row) {
+  m_key.clear();
+  for (const auto& key : m_keys) {
+    normalize(key, *t_batch.cols[key.col], t_row, m_key);
+  }
+}
+
+void Sorter::add_row(Rows& t_rows, std::span<const ColumnVector* const> t_cols,
+                     std::size_t t_row, std::span<const std::byte> t_key) {
+  for (std::size_t c = 0; c < t_rows.cols.size(); ++c) {
+    copy_value(*t_cols[c], t_row, t_rows.cols[c]);
+  }
+  t_rows.keys.insert(t_rows.keys.end(), t_key.begin(), t_key.end());
+  t_rows.key_off.push_back(static_cast<uint32_t>(t_rows.keys.size()));
+}
+
+void Sorter::add(const Batch& t_batch) {
+  auto add_one = [&](std::size_t t_row) {
+    encode(t_batch, t_row);
+    if (m_limit) {
+      add_top_k(t_batch, t_row);
+    } else {
+      add_row(m_rows, t_batch.cols, t_row, m_key);
+    }
+  };
+  if (t_batch.selective) {
+    for (auto row : t_batch.sel) {
+      add_one(row);
+    }
+  } else {
+    for (std::size_t row = 0; row < t_batch.n_rows; ++row) {
+      add_one(row);
+    }
+  }
+  if (!m_limit && m_spill && memory() > m_mem_limit) {
+    spill_run();
+  }
+}
+
+auto Sorter::before(uint32_t t_lhs, uint32_t t_rhs) const -> bool {
+  auto cmp = compare(m_rows.key(t_lhs), m_rows.key(t_rhs));
+  return cmp < 0 || (cmp == 0 && t_lhs < t_rhs);
+}
+
+void Sorter::add_top_k(const Batch& t_batch, std::size_t t_row) {
+  const auto limit = *m_limit;
+  if (limit == 0) {
+    return;
+  }
+  // the worst row on top.
+  auto goes_before = [this](uint32_t t_lhs, uint32_t t_rhs) {
+    return before(t_lhs, t_rhs);
+  };
+  if (m_heap.size() == limit && compare(m_key, m_rows.key(m_heap[0])) >= 0) {
+    return;
+  }
+  add_row(m_rows, t_batch.cols, t_row, m_key);
+  m_heap.push_back(static_cast<uint32_t>(m_rows.size() - 1));
+  std::ranges::push_heap(m_heap, goes_before);
+  if (m_heap.size() > limit) {
+    std::ranges::pop_heap(m_heap, goes_before);
+    m_heap.pop_back();
+    ++m_dropped;
+  }
+  if (m_dropped >= std::max(limit, MIN_DROPPED)) {
+    compact();
+  }
+}
+
+void Sorter::compact() {
+  // in the order they were added, so that ties stay in that order.
+  std::ranges::sort(m_heap);
+  auto rows = empty_rows();
+  std::vector<const ColumnVector*> cols;
+  for (const auto& col : m_rows.cols) {
+    cols.push_back(&col);
+  }
+  for (auto row : m_heap) {
+    add_row(rows, cols, row, m_rows.key(row));
+  }
+  m_rows = std::move(rows);
+  std::iota(m_heap.begin(), m_heap.end(), 0);
+  std::ranges::make_heap(m_heap, [this](uint32_t t_lhs, uint32_t t_rhs) {
+    return before(t_lhs, t_rhs);
+  });
+  m_dropped = 0;
+}
+
+void Sorter::sort(const Rows& t_rows, std::span<const uint32_t> t_which,
+                  std::vector<uint32_t>& t_out) {
+  struct Entry {
+    uint64_t prefix;
+    uint32_t row;
+  };
+  std::vector<Entry> entries;
+  entries.reserve(t_which.size());
+  for (auto row : t_which) {
+    entries.push_back({.prefix = prefix_of(t_rows.key(row)), .row = row});
+  }
+  // least significant byte first, each pass stable. A byte that's the same
+  // everywhere needs no pass.
+  std::vector<Entry> tmp(entries.size());
+  for (unsigned shift = 0; shift < 64; shift += 8) {
+    std::array<std::size_t, 256> counts{};
+    for (const auto& entry : entries) {
+      ++counts[(entry.prefix >> shift) & 0xffU];
+    }
+    if (std::ranges::find(counts, entries.size()) != counts.end()) {
+      continue;
+    }
+    std::size_t sum{0};
+    for (auto& count : counts) {
+      sum += std::exchange(count, sum);
+    }
+    for (const auto& entry : entries) {
+      tmp[counts[(entry.prefix >> shift) & 0xffU]++] = entry;
+    }
+    entries.swap(tmp);
+  }
+  // then the rest of the keys, among rows with the same first 8 bytes.
+  for (auto first = entries.begin(); first != entries.end();) {
+    auto last = std::find_if(first, entries.end(), [&](const Entry& t_entry) {
+      return t_entry.prefix != first->prefix;
+    });
+    if (last - first > 1) {
+      std::stable_sort(first, last,
+                       [&](const Entry& t_lhs, const Entry& t_rhs) {
+                         return compare(t_rows.key(t_lhs.row),
+                                        t_rows.key(t_rhs.row)) < 0;
+                       });
+    }
+    first = last;
+  }
+  t_out.clear();
+  for (const auto& entry : entries) {
+    t_out.push_back(entry.row);
+  }
+}
+
+void Sorter::spill_run() {
+  std::vector<uint32_t> all(m_rows.size());
+  std::iota(all.begin(), all.end(), 0);
+  sort(m_rows, all, m_order);
+  // each row: its key, after its length, then each column: whether it's
+  // there, then its bytes, after their length for Text.
+  auto& run = m_runs.emplace_back(
+      Run{.file{}, .reader{}, .row = empty_rows(), .done = false});
+  for (auto row : m_order) {
+    m_buf.clear();
+    auto key = m_rows.key(row);
+    put(m_buf, static_cast<uint32_t>(key.size()));
+    m_buf.insert(m_buf.end(), key.begin(), key.end());
+    for (const auto& col : m_rows.cols) {
+      const bool null = col.is_null(row);
+      put(m_buf, static_cast<uint8_t>(!null));
+      if (null) {
+        continue;
+      }
+      auto bytes = col.bytes(row);
+      if (col.type == ColType::Text) {
+        put(m_buf, static_cast<uint32_t>(bytes.size()));
+      }
+      const auto* src = std::bit_cast<const std::byte*>(bytes.data());
+      m_buf.insert(m_buf.end(), src, src + bytes.size());
+    }
+    run.file.write(m_buf, *m_spill->fl, *m_spill->io);
+  }
+  run.file.flush(*m_spill->io);
+  m_rows = empty_rows();
+  m_order.clear();
+}
+
+auto Sorter::read_row(Run& t_run) -> bool {
+  auto& row = t_run.row;
+  for (auto& col : row.cols) {
+    col.clear();
+  }
+  row.keys.clear();
+  row.key_off.resize(1);
+  auto& io = *m_spill->io;
+  uint32_t len{0};
+  if (!get(*t_run.reader, io, len)) {
+    t_run.done = true;
+    return false;
+  }
+  row.keys.resize(len);
+  t_run.reader->read(row.keys, io);
+  row.key_off.push_back(len);
+  for (auto& col : row.cols) {
+    uint8_t present{0};
+    get(*t_run.reader, io, present);
+    if (present == 0) {
+      col.push_null();
+      continue;
+    }
+    if (col.type == ColType::Text) {
+      get(*t_run.reader, io, len);
+    } else {
+      len = static_cast<uint32_t>(dbfile::column::type_size(col.type));
+    }
+    m_val.resize(len);
+    t_run.reader->read(std::as_writable_bytes(std::span{m_val}), io);
+    col.push_bytes({m_val.data(), m_val.size()});
+  }
+  return true;
+}
+
+auto Sorter::beats(std::size_t t_lhs, std::size_t t_rhs) const -> bool {
+  const auto& lhs = m_runs[t_lhs];
+  const auto& rhs = m_runs[t_rhs];
+  if (lhs.done || rhs.done) {
+    return !lhs.done;
+  }
+  // runs are in the order their rows were added.
+  auto cmp = compare(lhs.row.key(0), rhs.row.key(0));
+  return cmp < 0 || (cmp == 0 && t_lhs < t_rhs);
+}
+
+auto Sorter::build_tree(std::size_t t_node) -> std::size_t {
+  // nodes 1 to k - 1 are inside the tree, k to 2k - 1 are the runs.
+  if (t_node >= m_runs.size()) {
+    return t_node - m_runs.size();
+  }
+  auto lhs = build_tree(2 * t_node);
+  auto rhs = build_tree((2 * t_node) + 1);
+  if (beats(lhs, rhs)) {
+    m_tree[t_node] = rhs;
+    return lhs;
+  }
+  m_tree[t_node] = lhs;
+  return rhs;
+}
+
+void Sorter::replay(std::size_t t_run) {
+  auto winner = t_run;
+  for (auto node = (t_run + m_runs.size()) / 2; node != 0; node /= 2) {
+    if (beats(m_tree[node], winner)) {
+      std::swap(m_tree[node], winner);
+    }
+  }
+  m_tree[0] = winner;
+}
+
+void Sorter::finish() {
+  m_sorted = true;
+  if (m_runs.empty()) {
+    std::vector<uint32_t> which;
+    if (m_limit) {
+      which = std::move(m_heap);
+      std::ranges::sort(which);
+    } else {
+      which.resize(m_rows.size());
+      std::iota(which.begin(), which.end(), 0);
+    }
+    sort(m_rows, which, m_order);
+    return;
+  }
+  if (m_rows.size() != 0) {
+    spill_run();
+  }
+  for (auto& run : m_runs) {
+    run.reader = run.file.reader();
+    read_row(run);
+  }
+  m_tree.assign(m_runs.size(), 0);
+  m_tree[0] = build_tree(1);
+}
+
+auto Sorter::next(std::span<ColumnVector> t_out, std::size_t t_max) -> bool {
+  if (!m_sorted) {
+    finish();
+  }
+  if (m_runs.empty()) {
+    const auto n = std::min(t_max, m_order.size() - m_pos);
+    for (std::size_t c = 0; c < t_out.size(); ++c) {
+      for (std::size_t i = m_pos; i < m_pos + n; ++i) {
+        copy_value(m_rows.cols[c], m_order[i], t_out[c]);
+      }
+    }
+    m_pos += n;
+    return n != 0;
+  }
+  std::size_t n{0};
+  for (; n < t_max; ++n) {
+    const auto winner = m_tree[0];
+    auto& run = m_runs[winner];
+    if (run.done) {
+      break;
+    }
+    for (std::size_t c = 0; c < t_out.size(); ++c) {
+      copy_value(run.row.cols[c], 0, t_out[c]);
+    }
+    read_row(run);
+    replay(winner);
+  }
+  return n != 0;
+}
+
+auto Sorter::memory() const noexcept -> std::size_t {
+  std::size_t ret{0};
+  for (const auto& col : m_rows.cols) {
+    ret += memory_of(col);
+  }
+  return ret + (m_rows.key_off.size() * sizeof(uint32_t)) + m_rows.keys.size();
+}
+
+} // namespace tinydb
@@ -0,0 +1,207 @@
+/**
+ * @file sort.hxx
+ * @brief ORDER BY: rows in the order of some keys, however many there are.
+ *
+ * The keys of a row are first turned into bytes that compare, with
+ * `memcmp`, like the keys do: normalized keys. Rows are then sorted by a
+ * radix sort on the first 8 bytes of their key, and only rows whose first 8
+ * bytes are the same are compared whole.
+ *
+ * Given somewhere to spill, rows are sorted whenever they take more memory
+ * than allowed, and written to temporary pages as a sorted run. Once every
+ * row is in, the runs are merged with a loser tree: a tournament between
+ * the next row of each run, where each node remembers who lost there, so
+ * that the next winner only replays one path from a leaf to the root.
+ *
+ * With a limit, only that many rows are ever kept: a heap of the best rows
+ * so far, whose worst one is the first to go.
+ */
+
+#ifndef TINYDB_SORT_HXX
+#define TINYDB_SORT_HXX
+
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.spill;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/spill.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace tinydb {
+
+/**
+ * @brief A key of ORDER BY: a column of the rows sorted, and its direction.
+ * NULL comes after everything else, so first when descending.
+ */
+struct SortKey {
+    std::size_t col;
+    VType type;
+    bool desc;
+};
+
+/**
+ * @class Sorter
+ * @brief An external merge sort over batches, or a top-K one with a limit.
+ *
+ * Rows come out as they were in their batches, every column, in key order.
+ * Rows with the same key come out in the order they were added.
+ */
+class Sorter {
+  public:
+    // at most this many rows in the heap of a top-K sort. More than that,
+    // and a limit is left to LimitOp.
+    static constexpr std::size_t MAX_TOP_K = std::size_t{1} << 16;
+
+    /**
+     * @param t_cols The types of the columns of the rows sorted. Keys are
+     * some of them, of `storage_type` of their type.
+     * @param t_spill Where to write sorted runs once the rows take more
+     * than `t_mem_limit` bytes. Without it, nothing is ever spilled.
+     * @param t_limit Only the first that many rows are wanted.
+     */
+    Sorter(std::vector<SortKey> t_keys,
+           std::vector<dbfile::column::ColType> t_cols,
+           std::optional<dbfile::internal::SpillSpace> t_spill,
+           std::size_t t_mem_limit,
+           std::optional<std::size_t> t_limit = std::nullopt);
+    Sorter(const Sorter&) = delete;
+    Sorter(Sorter&&) = delete;
+    auto operator=(const Sorter&) -> Sorter& = delete;
+    auto operator=(Sorter&&) -> Sorter& = delete;
+    ~Sorter();
+
+    /**
+     * @brief Adds the selected rows of a batch. Every row must be added
+     * before the first `next`.
+     */
+    void add(const Batch& t_batch);
+
+    /**
+     * @brief Appends the next rows to `t_out`, at most `t_max` of them.
+     * @return false once every one was.
+     */
+    auto next(std::span<dbfile::internal::ColumnVector> t_out,
+              std::size_t t_max) -> bool;
+
+    /**
+     * @return How many sorted runs were written to temporary pages.
+     */
+    [[nodiscard]] auto n_runs() const noexcept -> std::size_t {
+        return m_runs.size();
+    }
+
+    /**
+     * @return Whether only the best `t_limit` rows are kept.
+     */
+    [[nodiscard]] auto top_k() const noexcept -> bool {
+        return m_limit.has_value();
+    }
+
+    /**
+     * @return About how many bytes the rows in memory take.
+     */
+    [[nodiscard]] auto memory() const noexcept -> std::size_t;
+
+  private:
+    /**
+     * @brief Rows, and the normalized key of each.
+     */
+    struct Rows {
+        std::vector<dbfile::internal::ColumnVector> cols;
+        std::vector<uint32_t> key_off{0};
+        std::vector<std::byte> keys{};
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t {
+            return key_off.size() - 1;
+        }
+
+        [[nodiscard]] auto key(std::size_t t_row) const
+            -> std::span<const std::byte> {
+            return std::span{keys}.subspan(key_off[t_row],
+                                           key_off[t_row + 1] - key_off[t_row]);
+        }
+    };
+
+    /**
+     * @brief A sorted run, and its next row while merging.
+     */
+    struct Run {
+        dbfile::internal::SpillFile file{};
+        std::optional<dbfile::internal::SpillFile::Reader> reader{};
+        Rows row;
+        bool done{false};
+    };
+
+    std::vector<SortKey> m_keys;
+    std::vector<dbfile::column::ColType> m_types;
+    std::optional<dbfile::internal::SpillSpace> m_spill;
+    std::size_t m_mem_limit;
+    std::optional<std::size_t> m_limit;
+    Rows m_rows;
+    std::vector<Run> m_runs{};
+    bool m_sorted{false};
+
+    // in memory: the rows in key order, and the next one out.
+    std::vector<uint32_t> m_order{};
+    std::size_t m_pos{0};
+    // top-K: the best rows so far, worst first, and how many rows of
+    // `m_rows` were dropped from it.
+    std::vector<uint32_t> m_heap{};
+    std::size_t m_dropped{0};
+    // merging: the loser of each node of the tree, the winner in 0.
+    std::vector<std::size_t> m_tree{};
+
+    std::vector<std::byte> m_key{};
+    std::vector<std::byte> m_buf{};
+    std::vector<char> m_val{};
+
+    [[nodiscard]] auto empty_rows() const -> Rows;
+    /**
+     * @brief Appends the normalized key of a row to `m_key`, cleared first.
+     */
+    void encode(const Batch& t_batch, std::size_t t_row);
+    static void add_row(Rows& t_rows,
+                        std::span<const dbfile::internal::ColumnVector* const>
+                            t_cols,
+                        std::size_t t_row, std::span<const std::byte> t_key);
+    /**
+     * @return Whether row `t_lhs` of `m_rows` goes before row `t_rhs`: a
+     * smaller key, or the same one added first.
+     */
+    [[nodiscard]] auto before(uint32_t t_lhs, uint32_t t_rhs) const -> bool;
+    void add_top_k(const Batch& t_batch, std::size_t t_row);
+    /**
+     * @brief Keeps only the rows of the heap.
+     */
+    void compact();
+    /**
+     * @brief The rows of `t_rows` listed in `t_which`, in key order.
+     */
+    static void sort(const Rows& t_rows, std::span<const uint32_t> t_which,
+                     std::vector<uint32_t>& t_out);
+    void spill_run();
+    void finish();
+    auto read_row(Run& t_run) -> bool;
+    /**
+     * @return Whether the next row of run `t_lhs` goes before that of run
+     * `t_rhs`.
+     */
+    [[nodiscard]] auto beats(std::size_t t_lhs, std::size_t t_rhs) const
+        -> bool;
+    auto build_tree(std::size_t t_node) -> std::size_t;
+    void replay(std::size_t t_run);
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_SORT_HXX
@@ -0,0 +1,578 @@
+#include "exec.hxx"
+#include "interpreter.hxx"
+#include "prepared.hxx"
+#include "scheduler.hxx"
+#include "sizes.hxx"
+#include "test/test_util.hxx"
+#include "tokenizer.hxx"
+#include "vector_expr.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_store;
+import tinydb.dbfile.internal.freelist;
+import tinydb.dbfile.internal.heap;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_store.hxx"
+#include "dbfile/internal/freelist.hxx"
+#include "dbfile/internal/heap.hxx"
+#include "dbfile/internal/tbl.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using namespace tinydb;
+using namespace tinydb::dbfile;
+using namespace tinydb::dbfile::internal;
+
+/**
+ * @brief orders(id Uint32, qty Int16, price Float64, note Text): row `i` has
+ * qty `i % 50`, price `i / 4.0`, and a note every 3 rows.
+ */
+class Orders {
+public:
+  static constexpr uint32_t NUMROWS = 10000;
+
+  Orders() {
+    io.exceptions(std::stringstream::failbit);
+    auto fl = FreeList::default_init(1, io);
+    Heap heap{0};
+    ColID col_id{0};
+    auto add = [&](const char* t_name, column::ColType t_type) {
+      EXPECT_TRUE(tbl.add_column(ColumnMeta{.m_name{t_name},
+                                            .m_type = t_type,
+                                            .m_col_id = ++col_id,
+                                            .m_offset = 0}));
+    };
+    add("id", column::ColType::Uint32);
+    add("qty", column::ColType::Int16);
+    add("price", column::ColType::Float64);
+    add("note", column::ColType::Text);
+    store = ColumnStore{tbl};
+    auto batch = store.make_batch();
+    for (uint32_t i = 0; i < NUMROWS; ++i) {
+      batch[0].push(i);
+      batch[1].push(static_cast<int16_t>(i % 50));
+      batch[2].push(i / 4.0);
+      if (i % 3 == 0) {
+        batch[3].push_text("n" + std::to_string(i % 7));
+      } else {
+        batch[3].push_null();
+      }
+    }
+    EXPECT_TRUE(store.append(batch, heap, fl, io));
+    catalog.add(TableRef{.meta = &tbl, .store = &store, .in = &io});
+  }
+
+  auto run(std::string_view t_sql)
+      -> std::expected<ResultSet, InterpretError> {
+    EXPECT_TRUE(tk.tokenize(t_sql).has_value());
+    return interpret(tk.tokens(), catalog);
+  }
+
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * 512, '\0')};
+  // NOLINTEND(*magic-number*)
+  TableMeta tbl{"orders"};
+  ColumnStore store{tbl};
+  Catalog catalog;
+  Tokenizer tk;
+};
+
+/**
+ * @brief A table of `NUMROWS` rows `(id Int64, half Int64)` in a file of its
+ * own: the even ids, in order, and half of each.
+ */
+class Evens {
+public:
+  static constexpr uint32_t NUMROWS = 5000;
+
+  explicit Evens(const char* t_name) : tbl{t_name} {
+    io.exceptions(std::stringstream::failbit);
+    auto fl = FreeList::default_init(1, io);
+    Heap heap{0};
+    EXPECT_TRUE(tbl.add_column(ColumnMeta{.m_name{"id"},
+                                          .m_type = column::ColType::Int64,
+                                          .m_col_id = 1,
+                                          .m_offset = 0}));
+    EXPECT_TRUE(tbl.add_column(ColumnMeta{.m_name{"half"},
+                                          .m_type = column::ColType::Int64,
+                                          .m_col_id = 2,
+                                          .m_offset = 0}));
+    store = ColumnStore{tbl};
+    auto batch = store.make_batch();
+    for (int64_t i = 0; i < NUMROWS; ++i) {
+      batch[0].push(i * 2);
+      batch[1].push(i);
+    }
+    EXPECT_TRUE(store.append(batch, heap, fl, io));
+  }
+
+  [[nodiscard]] auto ref() -> TableRef {
+    return TableRef{.meta = &tbl, .store = &store, .in = &io};
+  }
+
+  // NOLINTBEGIN(*magic-number*)
+  std::stringstream io{std::string(SIZEOF_PAGE * 64, '\0')};
+  // NOLINTEND(*magic-number*)
+  TableMeta tbl;
+  ColumnStore store{tbl};
+};
+
+} // namespace
+
+TEST(exec, select) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  // pushed down to the scan, plus a residual filter over a computed value.
+  auto res = db.run("SELECT id, qty * 2 AS twice, price FROM orders "
+                    "WHERE 7 > qty AND price * 4 >= 9000");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->names, (std::vector<std::string>{"id", "twice", "price"}));
+  ASSERT_EQ(res->types[1], VType::Int);
+  std::size_t n{0};
+  for (uint32_t i = 9000; i < Orders::NUMROWS; ++i) {
+    if (i % 50 >= 7) {
+      continue;
+    }
+    ASSERT_EQ(res->cols[0].values<int64_t>()[n], i);
+    ASSERT_EQ(res->cols[1].values<int64_t>()[n], 2 * (i % 50));
+    ASSERT_EQ(res->cols[2].values<double>()[n], i / 4.0);
+    ++n;
+  }
+  ASSERT_EQ(res->n_rows(), n);
+
+  // NULLs: never equal to anything, but found by IS NULL.
+  res = db.run("SELECT note, id / 0 FROM orders WHERE id < 4");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 4);
+  ASSERT_EQ(res->cols[0].text(0), "n0");
+  ASSERT_TRUE(res->cols[0].is_null(1));
+  ASSERT_EQ(res->cols[0].text(3), "n3");
+  ASSERT_TRUE(res->cols[1].is_null(0));
+  res = db.run("SELECT id FROM orders WHERE note = 'n1' OR note IS NULL "
+               "LIMIT 3 OFFSET 2");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 3);
+  ASSERT_EQ(res->cols[0].values<int64_t>()[0], 4);
+  ASSERT_EQ(res->cols[0].values<int64_t>()[2], 7);
+
+  // LIMIT stops in the middle of a batch.
+  res = db.run("SELECT * FROM orders LIMIT 10 OFFSET 2045");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->names.size(), 4);
+  ASSERT_EQ(res->n_rows(), 10);
+  ASSERT_EQ(res->cols[0].values<int64_t>()[9], 2054);
+
+  res = db.run("SELECT 1 + 2 * 3, 7 / 2 = 3, (NOT NULL) IS NULL");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 1);
+  ASSERT_EQ(res->cols[0].values<int64_t>()[0], 7);
+  ASSERT_EQ(res->cols[1].values<uint8_t>()[0], 1);
+  ASSERT_EQ(res->cols[2].values<uint8_t>()[0], 1);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(exec, aggregate) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  auto res = db.run("SELECT COUNT(*), count(note), SUM(qty), MIN(price), "
+                    "MAX(note), AVG(id) FROM orders WHERE qty >= 10");
+  ASSERT_TRUE(res.has_value());
+  int64_t count{0};
+  int64_t notes{0};
+  int64_t sum{0};
+  double ids{0};
+  for (uint32_t i = 0; i < Orders::NUMROWS; ++i) {
+    if (i % 50 >= 10) {
+      ++count;
+      notes += static_cast<int64_t>(i % 3 == 0);
+      sum += i % 50;
+      ids += i;
+    }
+  }
+  ASSERT_EQ(res->cols[0].values<int64_t>()[0], count);
+  ASSERT_EQ(res->cols[1].values<int64_t>()[0], notes);
+  ASSERT_EQ(res->cols[2].values<int64_t>()[0], sum);
+  ASSERT_EQ(res->cols[3].values<double>()[0], 2.5);
+  ASSERT_EQ(res->cols[4].text(0), "n6");
+  ASSERT_DOUBLE_EQ(res->cols[5].values<double>()[0],
+                   ids / static_cast<double>(count));
+
+  // nothing to aggregate: NULL, except COUNT.
+  res = db.run("SELECT COUNT(*), SUM(price) FROM orders WHERE id > 99999");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->cols[0].values<int64_t>()[0], 0);
+  ASSERT_TRUE(res->cols[1].is_null(0));
+
+  // bound parameters, pushed down as well.
+  PlanCache cache;
+  auto stmt = cache.prepare("SELECT COUNT(*) FROM orders WHERE ? <= id");
+  ASSERT_TRUE(stmt.has_value());
+  ASSERT_TRUE(stmt->bind(0, Literal{9990}));
+  auto counted = stmt->execute(db.catalog);
+  ASSERT_TRUE(counted.has_value());
+  ASSERT_EQ(counted->cols[0].values<int64_t>()[0], 10);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(exec, group_by) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  auto res = db.run("SELECT COUNT(*), qty, SUM(id), MIN(note), MAX(price), "
+                    "AVG(id) FROM orders WHERE id >= 100 GROUP BY qty");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->names[1], "qty");
+  ASSERT_EQ(res->n_rows(), 50);
+  for (std::size_t r = 0; r < res->n_rows(); ++r) {
+    const auto qty = res->cols[1].values<int64_t>()[r];
+    int64_t count{0};
+    int64_t sum{0};
+    std::string min_note{"~"};
+    double max_price{0};
+    for (uint32_t i = 100; i < Orders::NUMROWS; ++i) {
+      if (i % 50 != qty) {
+        continue;
+      }
+      ++count;
+      sum += i;
+      max_price = i / 4.0;
+      if (i % 3 == 0) {
+        min_note = std::min(min_note, "n" + std::to_string(i % 7));
+      }
+    }
+    ASSERT_EQ(res->cols[0].values<int64_t>()[r], count);
+    ASSERT_EQ(res->cols[2].values<int64_t>()[r], sum);
+    ASSERT_EQ(res->cols[3].text(r), min_note);
+    ASSERT_EQ(res->cols[4].values<double>()[r], max_price);
+    ASSERT_DOUBLE_EQ(res->cols[5].values<double>()[r],
+                     static_cast<double>(sum) / static_cast<double>(count));
+  }
+
+  // NULL is a group of its own, and keys can be any expression.
+  res = db.run("SELECT note IS NULL, qty / 10 AS tens, COUNT(note), "
+               "COUNT(*) FROM orders GROUP BY qty / 10, note IS NULL");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->names[1], "tens");
+  ASSERT_EQ(res->n_rows(), 10);
+  int64_t total{0};
+  for (std::size_t r = 0; r < res->n_rows(); ++r) {
+    const bool null = res->cols[0].values<uint8_t>()[r] != 0;
+    ASSERT_LT(res->cols[1].values<int64_t>()[r], 5);
+    ASSERT_EQ(res->cols[2].values<int64_t>()[r],
+              null ? 0 : res->cols[3].values<int64_t>()[r]);
+    total += res->cols[3].values<int64_t>()[r];
+  }
+  ASSERT_EQ(total, Orders::NUMROWS);
+  res = db.run("SELECT note FROM orders GROUP BY note");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 8);
+
+  // a group per row, spilled to temporary pages.
+  test::MemFile tmp{256};
+  db.catalog.set_spill(tmp.spill(), 16 * 1024);
+  res = db.run("SELECT id, MAX(note), COUNT(*) FROM orders WHERE id < 5000 "
+               "GROUP BY id LIMIT 4000");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 4000);
+  std::vector<bool> seen(5000);
+  for (std::size_t r = 0; r < res->n_rows(); ++r) {
+    const auto id = res->cols[0].values<int64_t>()[r];
+    ASSERT_FALSE(seen[id]);
+    seen[id] = true;
+    ASSERT_EQ(res->cols[1].is_null(r), id % 3 != 0);
+    ASSERT_EQ(res->cols[2].values<int64_t>()[r], 1);
+  }
+  ASSERT_GT(tmp.pages(), 2);
+
+  auto error = [&](std::string_view t_sql) {
+    return std::get<ExecError>(db.run(t_sql).error());
+  };
+  ASSERT_EQ(error("SELECT id, COUNT(*) FROM orders GROUP BY qty"),
+            ExecError::Unsupported);
+  ASSERT_EQ(error("SELECT * FROM orders GROUP BY qty"),
+            ExecError::Unsupported);
+  ASSERT_EQ(error("SELECT qty FROM orders GROUP BY nope"),
+            ExecError::UnknownColumn);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(exec, join) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  Evens evens{"evens"};
+  Evens twos{"twos"};
+  ASSERT_TRUE(db.catalog.add(evens.ref()));
+  ASSERT_TRUE(db.catalog.add(twos.ref()));
+
+  // both sides in id order: merged.
+  const auto* sql = "SELECT COUNT(*), SUM(half), MAX(qty) FROM orders JOIN "
+                    "evens ON orders.id = evens.id WHERE note IS NULL";
+  int64_t count{0};
+  int64_t sum{0};
+  int64_t max_qty{0};
+  for (uint32_t i = 0; i < Orders::NUMROWS; i += 2) {
+    if (i % 3 != 0) {
+      ++count;
+      sum += i / 2;
+      max_qty = std::max<int64_t>(max_qty, i % 50);
+    }
+  }
+  auto check = [&](const std::expected<ResultSet, InterpretError>& t_res) {
+    ASSERT_TRUE(t_res.has_value());
+    ASSERT_EQ(t_res->n_rows(), 1);
+    ASSERT_EQ(t_res->cols[0].values<int64_t>()[0], count);
+    ASSERT_EQ(t_res->cols[1].values<int64_t>()[0], sum);
+    ASSERT_EQ(t_res->cols[2].values<int64_t>()[0], max_qty);
+  };
+  check(db.run(sql));
+
+  // a Float column against an Int one, with a filter in ON.
+  auto res = db.run("SELECT orders.id, half, price FROM orders INNER JOIN "
+                    "evens ON price = evens.id AND half > 10 WHERE "
+                    "orders.id < 8000");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 989);
+  for (std::size_t r = 0; r < res->n_rows(); ++r) {
+    const auto half = res->cols[1].values<int64_t>()[r];
+    ASSERT_GT(half, 10);
+    ASSERT_EQ(res->cols[0].values<int64_t>()[r], half * 8);
+    ASSERT_EQ(res->cols[2].values<double>()[r], static_cast<double>(half * 2));
+  }
+
+  res = db.run("SELECT * FROM orders JOIN evens ON orders.id = evens.id "
+               "LIMIT 3");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->names, (std::vector<std::string>{"id", "qty", "price",
+                                                   "note", "id", "half"}));
+  ASSERT_EQ(res->n_rows(), 3);
+  ASSERT_EQ(res->cols[5].values<int64_t>()[2], 2);
+
+  // ids multiple of 4: their half is an even id.
+  res = db.run("SELECT COUNT(*), MAX(twos.half) FROM orders JOIN evens ON "
+               "orders.id = evens.id JOIN twos ON twos.id = evens.half");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->cols[0].values<int64_t>()[0], 2500);
+  ASSERT_EQ(res->cols[1].values<int64_t>()[0], 2499);
+
+  // hash joined, spilled to temporary pages.
+  test::MemFile tmp{256};
+  db.catalog.set_spill(tmp.spill(), 16 * 1024);
+  check(db.run(sql));
+  ASSERT_GT(tmp.pages(), 2);
+
+  auto error = [&](std::string_view t_sql) {
+    return std::get<ExecError>(db.run(t_sql).error());
+  };
+  ASSERT_EQ(error("SELECT id FROM orders JOIN evens ON orders.id = evens.id"),
+            ExecError::AmbiguousColumn);
+  ASSERT_EQ(error("SELECT * FROM orders JOIN evens ON qty < half"),
+            ExecError::Unsupported);
+  ASSERT_EQ(error("SELECT * FROM orders JOIN nope ON qty = nope.x"),
+            ExecError::UnknownTable);
+  ASSERT_EQ(error("SELECT * FROM orders JOIN evens ON note = half"),
+            ExecError::TypeMismatch);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(exec, order_by) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  // NULL first when descending: the ids not multiple of 3.
+  auto res = db.run("SELECT id, note FROM orders ORDER BY note DESC, id "
+                    "LIMIT 5 OFFSET 2");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 5);
+  const std::vector<int64_t> first{4, 5, 7, 8, 10};
+  for (std::size_t r = 0; r < first.size(); ++r) {
+    ASSERT_EQ(res->cols[0].values<int64_t>()[r], first[r]);
+    ASSERT_TRUE(res->cols[1].is_null(r));
+  }
+
+  // on something that isn't selected.
+  res = db.run("SELECT id FROM orders WHERE id < 500 ORDER BY price * -1");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->types.size(), 1);
+  ASSERT_EQ(res->n_rows(), 500);
+  for (std::size_t r = 0; r < res->n_rows(); ++r) {
+    ASSERT_EQ(res->cols[0].values<int64_t>()[r], 499 - static_cast<int>(r));
+  }
+
+  // groups, by an aggregate then by alias.
+  res = db.run("SELECT qty / 10 AS tens, COUNT(*), MAX(id) FROM orders WHERE "
+               "id < 1040 GROUP BY qty / 10 ORDER BY COUNT(*) DESC, tens");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 5);
+  // 1000 ids evenly, then 1000 to 1039 for tens 0 to 3.
+  const std::vector<int64_t> tens{0, 1, 2, 3, 4};
+  for (std::size_t r = 0; r < res->n_rows(); ++r) {
+    ASSERT_EQ(res->cols[0].values<int64_t>()[r], tens[r]);
+    ASSERT_EQ(res->cols[1].values<int64_t>()[r], r < 4 ? 210 : 200);
+  }
+
+  // sorted runs spilled to temporary pages, then merged.
+  test::MemFile tmp{256};
+  db.catalog.set_spill(tmp.spill(), 16 * 1024);
+  res = db.run("SELECT qty, id, note FROM orders ORDER BY qty DESC, note");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), Orders::NUMROWS);
+  for (std::size_t r = 1; r < res->n_rows(); ++r) {
+    const auto& qty = res->cols[0];
+    const auto& note = res->cols[2];
+    ASSERT_LE(qty.values<int64_t>()[r], qty.values<int64_t>()[r - 1]);
+    if (qty.values<int64_t>()[r] != qty.values<int64_t>()[r - 1] ||
+        note.is_null(r)) {
+      continue;
+    }
+    ASSERT_FALSE(note.is_null(r - 1));
+    ASSERT_LE(note.text(r - 1), note.text(r));
+    // ties stay in the order of the table.
+    if (note.text(r - 1) == note.text(r)) {
+      ASSERT_LT(res->cols[1].values<int64_t>()[r - 1],
+                res->cols[1].values<int64_t>()[r]);
+    }
+  }
+  ASSERT_GT(tmp.pages(), 2);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(exec, errors) {
+  Orders db;
+  auto error = [&](std::string_view t_sql) {
+    return std::get<ExecError>(db.run(t_sql).error());
+  };
+  ASSERT_EQ(error("SELECT * FROM nope"), ExecError::UnknownTable);
+  ASSERT_EQ(error("SELECT nope FROM orders"), ExecError::UnknownColumn);
+  ASSERT_EQ(error("SELECT id FROM orders WHERE note > 3"),
+            ExecError::TypeMismatch);
+  ASSERT_EQ(error("SELECT id FROM orders WHERE qty"), ExecError::TypeMismatch);
+  ASSERT_EQ(error("SELECT id FROM orders LIMIT id"), ExecError::UnknownColumn);
+  ASSERT_EQ(error("SELECT id FROM orders LIMIT 'x'"), ExecError::TypeMismatch);
+  ASSERT_EQ(error("SELECT id, COUNT(*) FROM orders"), ExecError::Unsupported);
+  ASSERT_EQ(error("SELECT SUM(note) FROM orders"), ExecError::TypeMismatch);
+  ASSERT_EQ(error("SELECT COUNT(*) FROM orders ORDER BY id"),
+            ExecError::Unsupported);
+  ASSERT_EQ(error("SELECT id FROM orders WHERE id = ?"),
+            ExecError::UnboundParameter);
+}
+
+TEST(exec, prepared) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  PlanCache cache;
+  auto stmt = cache.prepare(
+      "SELECT id, qty + ? FROM orders WHERE id >= ? AND ? > qty LIMIT ?");
+  ASSERT_TRUE(stmt.has_value());
+  auto run = [&](int32_t t_add, int32_t t_id, int32_t t_qty,
+                 int32_t t_limit) {
+    EXPECT_TRUE(stmt->bind(0, Literal{t_add}));
+    EXPECT_TRUE(stmt->bind(1, Literal{t_id}));
+    EXPECT_TRUE(stmt->bind(2, Literal{t_qty}));
+    EXPECT_TRUE(stmt->bind(3, Literal{t_limit}));
+    return stmt->execute(db.catalog);
+  };
+  auto res = run(10, 100, 2, 3);
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 3);
+  for (std::size_t r = 0; r < 3; ++r) {
+    const std::vector<int64_t> ids{100, 101, 150};
+    ASSERT_EQ(res->cols[0].values<int64_t>()[r], ids[r]);
+    ASSERT_EQ(res->cols[1].values<int64_t>()[r], 10 + (ids[r] % 50));
+  }
+  // kept alive, so that its address isn't taken by the next one.
+  auto compiled = stmt->plan().compiled;
+  ASSERT_NE(compiled, nullptr);
+
+  // other values of the same types: compiled once for all of them.
+  res = run(20, 9990, 50, 100);
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 10);
+  ASSERT_EQ(res->cols[1].values<int64_t>()[9], 20 + 49);
+  // past what the columns hold, still pushed down.
+  res = run(0, -5, 100000, 100000);
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), Orders::NUMROWS);
+  res = run(0, 0, -100000, 100000);
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 0);
+  ASSERT_EQ(run(0, 0, 1, -1).error(), ExecError::TypeMismatch);
+  ASSERT_EQ(stmt->plan().compiled, compiled);
+
+  // a NULL, a value of another type, or another table: compiled again.
+  ASSERT_TRUE(run(0, 0, 50, 5).has_value());
+  ASSERT_TRUE(stmt->bind_null(0));
+  res = stmt->execute(db.catalog);
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->n_rows(), 5);
+  ASSERT_TRUE(res->cols[1].is_null(4));
+  ASSERT_NE(stmt->plan().compiled, compiled);
+  ASSERT_TRUE(stmt->bind(0, Literal{true}));
+  ASSERT_EQ(stmt->execute(db.catalog).error(), ExecError::TypeMismatch);
+
+  ASSERT_TRUE(run(1, 0, 50, 5).has_value());
+  compiled = stmt->plan().compiled;
+  const auto version = db.catalog.version();
+  Evens evens{"evens"};
+  ASSERT_TRUE(db.catalog.add(evens.ref()));
+  ASSERT_NE(db.catalog.version(), version);
+  res = run(1, 0, 50, 5);
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->cols[1].values<int64_t>()[4], 5);
+  ASSERT_NE(stmt->plan().compiled, compiled);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(exec, parallel) {
+  // NOLINTBEGIN(*magic-number*)
+  Orders db;
+  Orders serial;
+  Scheduler workers{4};
+  std::size_t opened{0};
+  db.catalog = Catalog{};
+  db.catalog.add(TableRef{.meta = &db.tbl,
+                          .store = &db.store,
+                          .in = &db.io,
+                          .open = [&] {
+                            ++opened;
+                            return std::make_unique<std::istringstream>(
+                                db.io.str());
+                          }});
+  db.catalog.set_workers(&workers, 1000);
+  ASSERT_GE(db.store.split(1000).size(), 4);
+  for (const auto* sql :
+       {"SELECT COUNT(*), count(note), SUM(qty), MIN(price), MAX(note), "
+        "AVG(id), MAX(id) FROM orders WHERE qty >= 10",
+        "SELECT COUNT(*), MIN(note) FROM orders WHERE id > 99999",
+        "SELECT id, qty * 2, note FROM orders WHERE price * 4 > 1234",
+        "SELECT * FROM orders LIMIT 10 OFFSET 2045"}) {
+    auto par = db.run(sql);
+    auto ser = serial.run(sql);
+    ASSERT_TRUE(par.has_value() && ser.has_value()) << sql;
+    ASSERT_EQ(par->n_rows(), ser->n_rows()) << sql;
+    for (std::size_t c = 0; c < par->cols.size(); ++c) {
+      for (std::size_t r = 0; r < par->n_rows(); ++r) {
+        ASSERT_EQ(par->cols[c].is_null(r), ser->cols[c].is_null(r)) << sql;
+        if (!par->cols[c].is_null(r)) {
+          ASSERT_TRUE(std::ranges::equal(par->cols[c].bytes(r),
+                                         ser->cols[c].bytes(r)))
+              << sql;
+        }
+      }
+    }
+  }
+  // one stream per worker, except with LIMIT.
+  ASSERT_EQ(opened, 3 * workers.n_workers());
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,136 @@
+#include "hash_agg.hxx"
+#include "test/test_util.hxx"
+#include "vector_expr.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace tinydb;
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+
+/**
+ * @brief `SELECT k, COUNT(*), SUM(v), MIN(v) GROUP BY k` over rows `i` in
+ * [0, t_rows): `k = i % t_groups`, `v = i`, in batches of 1000.
+ * @return For each key, its count, sum and min.
+ */
+auto group(HashAggregator& t_agg, int64_t t_rows, int64_t t_groups)
+    -> std::vector<std::vector<int64_t>> {
+  for (int64_t first = 0; first < t_rows; first += 1000) {
+    ColumnVector keys{ColType::Int64};
+    ColumnVector vals{ColType::Int64};
+    for (auto i = first; i < first + 1000; ++i) {
+      keys.push(i % t_groups);
+      vals.push(i);
+    }
+    Batch batch{.cols{}, .n_rows = 1000, .selective = false, .sel{}};
+    const std::vector<const ColumnVector*> key_cols{&keys};
+    const std::vector<const ColumnVector*> args{nullptr, &vals, &vals};
+    t_agg.add(batch, key_cols, args);
+  }
+  std::vector<std::vector<int64_t>> ret(static_cast<std::size_t>(t_groups));
+  for (std::size_t p = 0; p < t_agg.n_partitions(); ++p) {
+    std::vector<ColumnVector> out{
+        ColumnVector{ColType::Int64}, ColumnVector{ColType::Int64},
+        ColumnVector{ColType::Int64}, ColumnVector{ColType::Int64}};
+    t_agg.emit(p, out);
+    for (std::size_t r = 0; r < out[0].size(); ++r) {
+      auto& row = ret[static_cast<std::size_t>(out[0].values<int64_t>()[r])];
+      EXPECT_TRUE(row.empty());
+      row = {out[1].values<int64_t>()[r], out[2].values<int64_t>()[r],
+             out[3].values<int64_t>()[r]};
+    }
+  }
+  return ret;
+}
+
+const std::vector<AggSpec> SPECS{
+    {.kind = AggKind::CountStar, .type = VType::Int},
+    {.kind = AggKind::Sum, .type = VType::Int},
+    {.kind = AggKind::Min, .type = VType::Int}};
+
+void check(const std::vector<std::vector<int64_t>>& t_groups, int64_t t_rows) {
+  const auto n = static_cast<int64_t>(t_groups.size());
+  for (int64_t k = 0; k < n; ++k) {
+    const auto count = t_rows / n;
+    const auto& row = t_groups[static_cast<std::size_t>(k)];
+    ASSERT_EQ(row.size(), 3);
+    ASSERT_EQ(row[0], count);
+    // k + (k + n) + ... + (k + (count - 1) * n)
+    ASSERT_EQ(row[1], (k * count) + (n * count * (count - 1) / 2));
+    ASSERT_EQ(row[2], k);
+  }
+}
+
+
+} // namespace
+
+TEST(hash_agg, partitions) {
+  // NOLINTBEGIN(*magic-number*)
+  HashAggregator agg{{VType::Int}, SPECS, std::nullopt, 0};
+  auto groups = group(agg, 200000, 50000);
+  // 50000 groups outgrow L2 in a single table.
+  ASSERT_GT(agg.n_partitions(), 1);
+  ASSERT_EQ(agg.n_spills(), 0);
+  check(groups, 200000);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(hash_agg, spills) {
+  // NOLINTBEGIN(*magic-number*)
+  test::MemFile file{1024};
+  {
+    HashAggregator agg{
+        {VType::Int}, SPECS, file.spill(),
+        64 * 1024};
+    auto groups = group(agg, 40000, 8000);
+    ASSERT_GT(agg.n_spills(), 1);
+    check(groups, 40000);
+  }
+  // every spill page is free again: the same work fits in the same pages.
+  const auto pages = file.pages();
+  ASSERT_GT(pages, 2);
+  {
+    HashAggregator agg{
+        {VType::Int}, SPECS, file.spill(),
+        64 * 1024};
+    check(group(agg, 40000, 8000), 40000);
+  }
+  ASSERT_EQ(file.pages(), pages);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(hash_agg, text_memory) {
+  // NOLINTBEGIN(*magic-number*)
+  const std::vector<AggSpec> specs{{.kind = AggKind::Max, .type = VType::Text}};
+  GroupTable table{specs};
+  const std::vector<std::byte> key{std::byte{1}};
+  const auto group = table.find_or_add(0, key);
+  const auto before = table.memory();
+  // a new maximum every row, each replacing the one before.
+  ColumnVector vals{ColType::Text};
+  std::vector<uint32_t> rows;
+  for (uint32_t i = 1; i <= 500; ++i) {
+    vals.push_text(std::string(i, 'z'));
+    rows.push_back(i - 1);
+  }
+  const std::vector<uint32_t> groups(rows.size(), group);
+  for (const auto row : rows) {
+    table.update(0, &vals, std::span{&row, 1}, std::span{groups}.first(1));
+  }
+  // only the longest string is still held.
+  ASSERT_EQ(table.memory() - before, 500);
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,165 @@
+#include "join.hxx"
+#include "test/test_util.hxx"
+#include "vector_expr.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace {
+
+using namespace tinydb;
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+using test::batch_of;
+
+/**
+ * @brief Rows `i` in [t_first, t_first + t_n): key `i % t_mod`, value `i`.
+ */
+auto rows(int64_t t_first, int64_t t_n, int64_t t_mod)
+    -> std::vector<ColumnVector> {
+  std::vector<ColumnVector> ret{ColumnVector{ColType::Int64},
+                                ColumnVector{ColType::Int64}};
+  for (auto i = t_first; i < t_first + t_n; ++i) {
+    ret[0].push(i % t_mod);
+    ret[1].push(i);
+  }
+  return ret;
+}
+
+/**
+ * @brief Joins build rows `[0, t_build)` with probe rows `[0, t_probe)`, both
+ * keyed on `i % t_mod`, in batches of 1000.
+ * @return For each probe row, the sum of the build rows joined with it.
+ */
+auto hash_join(HashJoiner& t_join, int64_t t_build, int64_t t_probe,
+               int64_t t_mod) -> std::vector<int64_t> {
+  for (int64_t first = 0; first < t_build; first += 1000) {
+    auto cols = rows(first, 1000, t_mod);
+    const std::vector<const ColumnVector*> keys{&cols[0]};
+    t_join.build(batch_of(cols), keys);
+  }
+  std::vector<int64_t> ret(static_cast<std::size_t>(t_probe));
+  std::vector<ColumnVector> out{
+      ColumnVector{ColType::Int64}, ColumnVector{ColType::Int64},
+      ColumnVector{ColType::Int64}, ColumnVector{ColType::Int64}};
+  auto add = [&] {
+    for (std::size_t r = 0; r < out[0].size(); ++r) {
+      EXPECT_EQ(out[0].values<int64_t>()[r], out[2].values<int64_t>()[r]);
+      ret[static_cast<std::size_t>(out[1].values<int64_t>()[r])] +=
+          out[3].values<int64_t>()[r];
+    }
+    for (auto& col : out) {
+      col.clear();
+    }
+  };
+  for (int64_t first = 0; first < t_probe; first += 1000) {
+    auto cols = rows(first, 1000, t_mod);
+    const std::vector<const ColumnVector*> keys{&cols[0]};
+    t_join.probe(batch_of(cols), keys, out);
+    add();
+  }
+  while (t_join.drain(out)) {
+    add();
+  }
+  return ret;
+}
+
+void check(const std::vector<int64_t>& t_sums, int64_t t_build,
+           int64_t t_mod) {
+  const auto count = t_build / t_mod;
+  for (std::size_t i = 0; i < t_sums.size(); ++i) {
+    const auto k = static_cast<int64_t>(i) % t_mod;
+    // k + (k + mod) + ... + (k + (count - 1) * mod)
+    ASSERT_EQ(t_sums[i], (k * count) + (t_mod * count * (count - 1) / 2));
+  }
+}
+
+} // namespace
+
+TEST(join, hash_partitions) {
+  // NOLINTBEGIN(*magic-number*)
+  HashJoiner join{{VType::Int},
+                  {ColType::Int64, ColType::Int64},
+                  {ColType::Int64, ColType::Int64},
+                  std::nullopt,
+                  0};
+  auto sums = hash_join(join, 100000, 20000, 25000);
+  // 100000 rows outgrow L2 in a single table.
+  ASSERT_GT(join.n_partitions(), 1);
+  ASSERT_EQ(join.n_spills(), 0);
+  check(sums, 100000, 25000);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(join, hash_spills) {
+  // NOLINTBEGIN(*magic-number*)
+  test::MemFile file{1024};
+  auto run = [&] {
+    HashJoiner join{{VType::Int},
+                    {ColType::Int64, ColType::Int64},
+                    {ColType::Int64, ColType::Int64},
+                    file.spill(),
+                    64 * 1024};
+    auto sums = hash_join(join, 40000, 10000, 8000);
+    EXPECT_GT(join.n_spills(), 1);
+    check(sums, 40000, 8000);
+  };
+  run();
+  // every spill page is free again: the same work fits in the same pages.
+  const auto pages = file.pages();
+  ASSERT_GT(pages, 2);
+  run();
+  ASSERT_EQ(file.pages(), pages);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(join, merge) {
+  // NOLINTBEGIN(*magic-number*)
+  // an Int key against a Float one, with NULLs that never match.
+  ColumnVector lkeys{ColType::Int64};
+  ColumnVector rkeys{ColType::Float64};
+  for (int64_t i = 0; i < 100; ++i) {
+    lkeys.push(i / 2);
+  }
+  lkeys.push_null();
+  for (int64_t i = 99; i >= 0; i -= 3) {
+    rkeys.push(static_cast<double>(i));
+  }
+  rkeys.push_null();
+  const std::vector<const ColumnVector*> lcols{&lkeys};
+  const std::vector<const ColumnVector*> rcols{&rkeys};
+
+  MergeJoiner join{{VType::Float}, {ColType::Int64}, {ColType::Float64}};
+  join.add(0, batch_of({lkeys}), lcols);
+  join.add(1, batch_of({rkeys}), rcols);
+  std::vector<ColumnVector> out{ColumnVector{ColType::Int64},
+                                ColumnVector{ColType::Float64}};
+  std::vector<int64_t> keys;
+  while (join.next(out, 7)) {
+    for (std::size_t r = 0; r < out[0].size(); ++r) {
+      ASSERT_EQ(static_cast<double>(out[0].values<int64_t>()[r]),
+                out[1].values<double>()[r]);
+      keys.push_back(out[0].values<int64_t>()[r]);
+    }
+    for (auto& col : out) {
+      col.clear();
+    }
+  }
+  // the left side was in order, the right one wasn't.
+  ASSERT_EQ(join.n_sorts(), 1);
+  // keys 0, 3, ..., 48, twice each, in order.
+  ASSERT_EQ(keys.size(), 34);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(keys[i], static_cast<int64_t>(i / 2) * 3);
+  }
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,187 @@
+#include "ast.hxx"
+#include "kernels.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using namespace tinydb;
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+
+/**
+ * @brief A vector of the specified numeric type holding `t_vals`, NULL where
+ * the value is 5.
+ */
+auto make(ColType t_type, const std::vector<int>& t_vals) -> ColumnVector {
+  ColumnVector vec{t_type};
+  for (auto val : t_vals) {
+    if (val == 5) {
+      vec.push_null();
+      continue;
+    }
+    switch (t_type) {
+    case ColType::Int8:
+      vec.push(static_cast<int8_t>(val));
+      break;
+    case ColType::Uint8:
+      vec.push(static_cast<uint8_t>(val));
+      break;
+    case ColType::Int16:
+      vec.push(static_cast<int16_t>(val));
+      break;
+    case ColType::Uint16:
+      vec.push(static_cast<uint16_t>(val));
+      break;
+    case ColType::Int32:
+      vec.push(static_cast<int32_t>(val));
+      break;
+    case ColType::Uint32:
+      vec.push(static_cast<uint32_t>(val));
+      break;
+    case ColType::Int64:
+      vec.push(static_cast<int64_t>(val));
+      break;
+    case ColType::Uint64:
+      vec.push(static_cast<uint64_t>(val));
+      break;
+    case ColType::Float32:
+      vec.push(static_cast<float>(val));
+      break;
+    default:
+      vec.push(static_cast<double>(val));
+      break;
+    }
+  }
+  return vec;
+}
+
+auto cmp(BinaryOp t_op, int t_x, int t_y) -> bool {
+  switch (t_op) {
+  case BinaryOp::Eq:
+    return t_x == t_y;
+  case BinaryOp::Ne:
+    return t_x != t_y;
+  case BinaryOp::Lt:
+    return t_x < t_y;
+  case BinaryOp::Le:
+    return t_x <= t_y;
+  case BinaryOp::Gt:
+    return t_x > t_y;
+  default:
+    return t_x >= t_y;
+  }
+}
+
+auto arith(BinaryOp t_op, int t_x, int t_y) -> int {
+  switch (t_op) {
+  case BinaryOp::Add:
+    return t_x + t_y;
+  case BinaryOp::Sub:
+    return t_x - t_y;
+  default:
+    return t_x * t_y;
+  }
+}
+
+} // namespace
+
+TEST(kernels, every_numeric_pair) {
+  // NOLINTBEGIN(*magic-number*)
+  // small enough to fit every type, signed or not.
+  const std::vector<int> lhs_vals{0, 3, 7, 5, 2, 9, 4};
+  const std::vector<int> rhs_vals{1, 3, 5, 2, 8, 0, 4};
+  const std::vector<BinaryOp> ops{
+      BinaryOp::Eq,  BinaryOp::Ne,  BinaryOp::Lt,  BinaryOp::Le, BinaryOp::Gt,
+      BinaryOp::Ge,  BinaryOp::Add, BinaryOp::Sub, BinaryOp::Mul};
+  const auto n = lhs_vals.size();
+  for (int l = 0; l <= static_cast<int>(ColType::Float64); ++l) {
+    for (int r = 0; r <= static_cast<int>(ColType::Float64); ++r) {
+      const auto ltype = static_cast<ColType>(l);
+      const auto rtype = static_cast<ColType>(r);
+      const bool floats =
+          ltype >= ColType::Float32 || rtype >= ColType::Float32;
+      auto lhs = make(ltype, lhs_vals);
+      auto rhs = make(rtype, rhs_vals);
+      for (auto op : ops) {
+        auto kernel = binary_kernel(op, ltype, rtype, Shape::ColCol);
+        ASSERT_NE(kernel, nullptr);
+        ColumnVector out{op >= BinaryOp::Add
+                             ? (floats ? ColType::Float64 : ColType::Int64)
+                             : ColType::Uint8};
+        kernel(lhs, rhs, out, n);
+        ASSERT_EQ(out.size(), n);
+        for (std::size_t i = 0; i < n; ++i) {
+          const bool null = lhs_vals[i] == 5 || rhs_vals[i] == 5;
+          ASSERT_EQ(out.is_null(i), null);
+          if (null) {
+            continue;
+          }
+          if (op < BinaryOp::Add) {
+            ASSERT_EQ(out.values<uint8_t>()[i],
+                      cmp(op, lhs_vals[i], rhs_vals[i]));
+          } else if (floats) {
+            ASSERT_EQ(out.values<double>()[i],
+                      arith(op, lhs_vals[i], rhs_vals[i]));
+          } else {
+            ASSERT_EQ(out.values<int64_t>()[i],
+                      arith(op, lhs_vals[i], rhs_vals[i]));
+          }
+        }
+      }
+    }
+  }
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(kernels, constants) {
+  // NOLINTBEGIN(*magic-number*)
+  auto col = make(ColType::Int16, {-4, 10, 5, 7});
+  ColumnVector ten{ColType::Int64};
+  ten.push(int64_t{10});
+  ColumnVector out{ColType::Int64};
+
+  // 10 - col, then col - 10.
+  binary_kernel(BinaryOp::Sub, ColType::Int64, ColType::Int16,
+                Shape::ConstCol)(ten, col, out, col.size());
+  ASSERT_EQ(out.values<int64_t>()[0], 14);
+  ASSERT_EQ(out.values<int64_t>()[3], 3);
+  ASSERT_TRUE(out.is_null(2));
+  binary_kernel(BinaryOp::Sub, ColType::Int16, ColType::Int64,
+                Shape::ColConst)(col, ten, out, col.size());
+  ASSERT_EQ(out.values<int64_t>()[0], -14);
+  ASSERT_EQ(out.values<int64_t>()[1], 0);
+
+  // dividing by 0 is NULL.
+  ColumnVector zero{ColType::Int64};
+  zero.push(int64_t{0});
+  binary_kernel(BinaryOp::Div, ColType::Int16, ColType::Int64,
+                Shape::ColConst)(col, zero, out, col.size());
+  ASSERT_TRUE(out.is_null(0) && out.is_null(1) && out.is_null(3));
+
+  // a NULL constant makes everything NULL.
+  ColumnVector null{ColType::Int64};
+  null.push_null();
+  ColumnVector flags{ColType::Uint8};
+  binary_kernel(BinaryOp::Lt, ColType::Int16, ColType::Int64,
+                Shape::ColConst)(col, null, flags, col.size());
+  ASSERT_TRUE(flags.is_null(0) && flags.is_null(1) && flags.is_null(3));
+
+  // constants are only ever 64 bits wide, or bytes, or text.
+  ASSERT_EQ(binary_kernel(BinaryOp::Lt, ColType::Int16, ColType::Int16,
+                          Shape::ColConst),
+            nullptr);
+  ASSERT_EQ(binary_kernel(BinaryOp::Add, ColType::Text, ColType::Text,
+                          Shape::ColCol),
+            nullptr);
+  // NOLINTEND(*magic-number*)
+}
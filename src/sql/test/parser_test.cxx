@@ -0,0 +1,170 @@
+#include "arena.hxx"
+#include "ast.hxx"
+#include "exec.hxx"
+#include "interpreter.hxx"
+#include "parser.hxx"
+#include "tokenizer.hxx"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace {
+
+using namespace tinydb;
+
+auto column(const Expr* t_expr) -> std::string_view {
+  return std::get<ColumnRef>(t_expr->node).name;
+}
+
+auto number(const Expr* t_expr) -> int32_t {
+  return std::get<int32_t>(std::get<Literal>(t_expr->node).val);
+}
+
+auto binary(const Expr* t_expr) -> const Binary& {
+  return std::get<Binary>(t_expr->node);
+}
+
+} // namespace
+
+TEST(parser, statements) {
+  // NOLINTBEGIN(*magic-number*)
+  Tokenizer tk;
+  Parser parser;
+  Arena arena;
+  auto parse = [&](std::string_view t_sql) {
+    arena.reset();
+    EXPECT_TRUE(tk.tokenize(t_sql).has_value());
+    return parser.parse(tk.tokens(), arena);
+  };
+
+  auto stmt = parse("SELECT id, price * 2 AS twice FROM orders "
+                    "WHERE NOT a OR b AND c + 1 * 2 = -3 AND d IS NOT NULL "
+                    "ORDER BY price DESC, id LIMIT 10 OFFSET 5;");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& sel = std::get<Select>(*stmt);
+  ASSERT_EQ(sel.items.size(), 2);
+  ASSERT_EQ(column(sel.items[0].expr), "id");
+  ASSERT_EQ(sel.items[1].alias, "twice");
+  ASSERT_EQ(binary(sel.items[1].expr).op, BinaryOp::Mul);
+  ASSERT_EQ(sel.table, "orders");
+  // (NOT a) OR ((b AND ((c + (1 * 2)) = -3)) AND (d IS NOT NULL))
+  const auto& top = binary(sel.where);
+  ASSERT_EQ(top.op, BinaryOp::Or);
+  ASSERT_EQ(std::get<Unary>(top.lhs->node).op, UnaryOp::Not);
+  const auto& conj = binary(top.rhs);
+  ASSERT_EQ(conj.op, BinaryOp::And);
+  ASSERT_EQ(std::get<Unary>(conj.rhs->node).op, UnaryOp::IsNotNull);
+  const auto& cmp = binary(binary(conj.lhs).rhs);
+  ASSERT_EQ(cmp.op, BinaryOp::Eq);
+  ASSERT_EQ(number(cmp.rhs), -3);
+  const auto& sum = binary(cmp.lhs);
+  ASSERT_EQ(sum.op, BinaryOp::Add);
+  ASSERT_EQ(binary(sum.rhs).op, BinaryOp::Mul);
+  ASSERT_EQ(sel.order_by.size(), 2);
+  ASSERT_TRUE(sel.order_by[0].desc);
+  ASSERT_FALSE(sel.order_by[1].desc);
+  ASSERT_EQ(number(sel.limit), 10);
+  ASSERT_EQ(number(sel.offset), 5);
+
+  // left associative: (10 - 2) - 3.
+  stmt = parse("SELECT * FROM t WHERE x = 10 - 2 - 3");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& diff = binary(binary(std::get<Select>(*stmt).where).rhs);
+  ASSERT_EQ(number(binary(diff.lhs).rhs), 2);
+  ASSERT_EQ(number(diff.rhs), 3);
+  ASSERT_TRUE(std::get<Select>(*stmt).items.empty());
+
+  stmt = parse("SELECT a, COUNT(*) FROM t GROUP BY a, b / 2 ORDER BY a");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& grouped = std::get<Select>(*stmt);
+  ASSERT_EQ(grouped.group_by.size(), 2);
+  ASSERT_EQ(column(grouped.group_by[0]), "a");
+  ASSERT_EQ(binary(grouped.group_by[1]).op, BinaryOp::Div);
+  ASSERT_EQ(grouped.order_by.size(), 1);
+
+  stmt = parse("SELECT * FROM a JOIN b ON a.x = b.y INNER JOIN c ON b.z = c.z "
+               "AND c.w > 1 WHERE a.x < 3");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& joined = std::get<Select>(*stmt);
+  ASSERT_EQ(joined.table, "a");
+  ASSERT_EQ(joined.joins.size(), 2);
+  ASSERT_EQ(joined.joins[0].table, "b");
+  ASSERT_EQ(binary(joined.joins[0].on).op, BinaryOp::Eq);
+  ASSERT_EQ(joined.joins[1].table, "c");
+  ASSERT_EQ(binary(joined.joins[1].on).op, BinaryOp::And);
+  ASSERT_NE(joined.where, nullptr);
+  ASSERT_FALSE(parse("SELECT * FROM a INNER b ON a.x = b.x").has_value());
+  ASSERT_FALSE(parse("SELECT * FROM a JOIN b").has_value());
+
+  stmt = parse("insert into t (a, b) values (1, 'x'), (2, NULL)");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& ins = std::get<Insert>(*stmt);
+  ASSERT_EQ(ins.columns.size(), 2);
+  ASSERT_EQ(ins.columns[1], "b");
+  ASSERT_EQ(ins.rows.size(), 2);
+  ASSERT_EQ(number(ins.rows[1][0]), 2);
+  ASSERT_TRUE(std::holds_alternative<NullValue>(ins.rows[1][1]->node));
+
+  stmt = parse("UPDATE t SET a = a + 1, b = 'y' WHERE t.id = 4");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& upd = std::get<Update>(*stmt);
+  ASSERT_EQ(upd.set.size(), 2);
+  ASSERT_EQ(upd.set[1].column, "b");
+  ASSERT_EQ(std::get<ColumnRef>(binary(upd.where).lhs->node).table, "t");
+
+  stmt = parse("DELETE FROM t");
+  ASSERT_TRUE(stmt.has_value());
+  ASSERT_EQ(std::get<Delete>(*stmt).where, nullptr);
+
+  stmt = parse("CREATE TABLE users (id UINT32 PRIMARY KEY, name CHAR(16))");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& create = std::get<CreateTable>(*stmt);
+  ASSERT_EQ(create.columns.size(), 2);
+  ASSERT_TRUE(create.columns[0].primary_key);
+  ASSERT_EQ(create.columns[1].type, "CHAR");
+  ASSERT_EQ(create.columns[1].length, 16);
+
+  stmt = parse("SELECT COUNT(*), max(a, b + 1) FROM t");
+  ASSERT_TRUE(stmt.has_value());
+  const auto& items = std::get<Select>(*stmt).items;
+  ASSERT_TRUE(std::get<Call>(items[0].expr->node).star);
+  ASSERT_EQ(std::get<Call>(items[1].expr->node).args.size(), 2);
+
+  ASSERT_EQ(parse("SELECT a FROM").error(), ParseError::UnexpectedEnd);
+  ASSERT_EQ(parse("SELECT a b c").error(), ParseError::UnexpectedToken);
+  // `b` is an alias, `c` is too much.
+  ASSERT_EQ(parser.error_pos(), 3);
+  ASSERT_EQ(parse("DELETE FROM 3").error(), ParseError::ExpectedIdentifier);
+  ASSERT_EQ(parse("SELECT (1 + ) FROM t").error(),
+            ParseError::ExpectedExpression);
+  ASSERT_EQ(parse("SELECT " + std::string(1000, '(') + "1").error(),
+            ParseError::TooDeep);
+  Catalog catalog;
+  ASSERT_EQ(interpret(tk.tokens(), catalog).error(),
+            InterpretError{ParseError::TooDeep});
+  ASSERT_TRUE(tk.tokenize("select 1;").has_value());
+  ASSERT_TRUE(interpret(tk.tokens(), catalog).has_value());
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(parser, arena_reuse) {
+  Tokenizer tk;
+  Parser parser;
+  Arena arena;
+  std::string sql{"SELECT a FROM t WHERE a = 0"};
+  for (int i = 1; i < 200; ++i) {
+    sql += " OR a = " + std::to_string(i);
+  }
+  ASSERT_TRUE(tk.tokenize(sql).has_value());
+  ASSERT_TRUE(parser.parse(tk.tokens(), arena).has_value());
+  const auto used = arena.capacity();
+  ASSERT_GT(used, 0);
+  // dropping a tree is O(1), and the next ones reuse the same memory.
+  for (int i = 0; i < 100; ++i) {
+    arena.reset();
+    ASSERT_TRUE(parser.parse(tk.tokens(), arena).has_value());
+  }
+  ASSERT_EQ(arena.capacity(), used);
+}
@@ -0,0 +1,108 @@
+#include "ast.hxx"
+#include "exec.hxx"
+#include "prepared.hxx"
+#include "tokenizer.hxx"
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+
+TEST(prepared, normalize) {
+  using namespace tinydb;
+  std::string out;
+  Tokenizer::normalize("  select *\n\tfrom T -- the table\n where x='A  b';",
+                       out);
+  ASSERT_EQ(out, "SELECT * FROM T WHERE x = 'A  b'");
+  std::string again;
+  Tokenizer::normalize(out, again);
+  ASSERT_EQ(again, out);
+  Tokenizer::normalize("'open", out);
+  ASSERT_EQ(out, "'open");
+}
+
+TEST(prepared, normalize_spacing) {
+  using namespace tinydb;
+  std::string dense;
+  std::string spaced;
+  Tokenizer::normalize("select a from t where a=1", dense);
+  Tokenizer::normalize("select a from t where a = 1", spaced);
+  ASSERT_EQ(dense, spaced);
+  ASSERT_EQ(dense, "SELECT a FROM t WHERE a = 1");
+
+  Tokenizer::normalize("select count ( * ),t . b from t where a>=-1-b", dense);
+  Tokenizer::normalize("select count(*), t.b from t where a >= -1 - b;",
+                       spaced);
+  ASSERT_EQ(dense, spaced);
+  ASSERT_EQ(dense, "SELECT count(*), t.b FROM t WHERE a >= -1 - b");
+
+  // same tokens as what was normalized.
+  Tokenizer before;
+  Tokenizer after;
+  const std::string_view sql = "select x-1,(x - -2)from t where y<>'a=b'";
+  Tokenizer::normalize(sql, dense);
+  ASSERT_TRUE(before.tokenize(sql).has_value());
+  ASSERT_TRUE(after.tokenize(dense).has_value());
+  ASSERT_EQ(before.tokens().size(), after.tokens().size());
+  for (std::size_t i = 0; i < before.tokens().size(); ++i) {
+    ASSERT_EQ(before.tokens()[i].index(), after.tokens()[i].index());
+  }
+}
+
+TEST(prepared, plan_cache) {
+  using namespace tinydb;
+  // NOLINTBEGIN(*magic-number*)
+  PlanCache cache{2};
+  auto stmt = cache.prepare("select a from t where id = ? and b > ?");
+  ASSERT_TRUE(stmt.has_value());
+  ASSERT_EQ(stmt->n_params(), 2);
+  const auto& where =
+      std::get<Binary>(std::get<Select>(stmt->plan().stmt).where->node);
+  ASSERT_EQ(std::get<Param>(std::get<Binary>(where.rhs->node).rhs->node).idx,
+            1);
+
+  // no table `t`: only checks the parameters are bound before running.
+  Catalog catalog;
+  ASSERT_EQ(stmt->execute(catalog).error(), ExecError::UnboundParameter);
+  ASSERT_TRUE(stmt->bind(0, Literal{7}));
+  ASSERT_TRUE(stmt->bind_null(1));
+  ASSERT_FALSE(stmt->bind(2, Literal{true}));
+  ASSERT_EQ(stmt->execute(catalog).error(), ExecError::UnknownTable);
+  stmt->clear_bindings();
+  ASSERT_EQ(stmt->execute(catalog).error(), ExecError::UnboundParameter);
+
+  // spelled differently, but the same statement: the same plan.
+  auto same = cache.prepare("SELECT a\nFROM t WHERE id = ?  AND b > ?;");
+  ASSERT_TRUE(same.has_value());
+  ASSERT_EQ(&same->plan(), &stmt->plan());
+  ASSERT_EQ(cache.hits(), 1);
+  ASSERT_EQ(cache.misses(), 1);
+
+  ASSERT_TRUE(cache.prepare("DELETE FROM t WHERE id = ?").has_value());
+  // the first statement was used last: the DELETE goes first.
+  ASSERT_TRUE(
+      cache.prepare("select a from t where id = ? and b > ?").has_value());
+  ASSERT_TRUE(cache.prepare("UPDATE t SET a = ?").has_value());
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_EQ(cache.hits(), 2);
+  ASSERT_TRUE(cache.prepare("SELECT a FROM t WHERE id = ? AND b > ?")
+                  .has_value());
+  ASSERT_EQ(cache.hits(), 3);
+  ASSERT_TRUE(cache.prepare("DELETE FROM t WHERE id = ?").has_value());
+  ASSERT_EQ(cache.misses(), 4);
+
+  ASSERT_TRUE(std::holds_alternative<ParseError>(
+      cache.prepare("SELECT FROM").error()));
+  ASSERT_TRUE(std::holds_alternative<TokenizerError>(
+      cache.prepare("SELECT 'x").error()));
+  // a statement outlives its plan's eviction.
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(
+        cache.prepare("SELECT " + std::to_string(i) + " FROM t").has_value());
+  }
+  ASSERT_TRUE(stmt->bind(0, Literal{1}));
+  ASSERT_TRUE(stmt->bind(1, Literal{std::string_view{"x"}}));
+  ASSERT_EQ(stmt->execute(catalog).error(), ExecError::UnknownTable);
+  // NOLINTEND(*magic-number*)
+}
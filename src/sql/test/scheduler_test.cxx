@@ -0,0 +1,71 @@
+#include "scheduler.hxx"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace tinydb;
+
+TEST(scheduler, runs_every_task_once) {
+  // NOLINTBEGIN(*magic-number*)
+  Scheduler workers{4};
+  ASSERT_EQ(workers.n_workers(), 4);
+  // reused from one job to the next.
+  for (std::size_t n_tasks : {0, 1, 3, 1000}) {
+    std::vector<std::atomic<int>> runs(n_tasks);
+    workers.run(n_tasks, [&](std::size_t t_worker, std::size_t t_task) {
+      ASSERT_LT(t_worker, 4);
+      ++runs[t_task];
+    });
+    for (const auto& count : runs) {
+      ASSERT_EQ(count, 1);
+    }
+  }
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(scheduler, steals) {
+  // NOLINTBEGIN(*magic-number*)
+  Scheduler workers{2};
+  // worker 0 is dealt tasks [0, 8), and starts with task 0, unless worker 1
+  // already stole it, last, along with the rest. Either way worker 0 never
+  // runs anything else: task 0 is stuck until every other task is done, so
+  // worker 1 must steal them.
+  std::atomic<int> done{0};
+  std::vector<std::size_t> by(16);
+  workers.run(16, [&](std::size_t t_worker, std::size_t t_task) {
+    by[t_task] = t_worker;
+    if (t_task == 0) {
+      while (done < 15) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+    }
+    ++done;
+  });
+  for (std::size_t task = 1; task < 16; ++task) {
+    ASSERT_EQ(by[task], 1);
+  }
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(scheduler, rethrows) {
+  // NOLINTBEGIN(*magic-number*)
+  Scheduler workers{3};
+  std::atomic<int> runs{0};
+  ASSERT_THROW(workers.run(100,
+                           [&](std::size_t, std::size_t t_task) {
+                             ++runs;
+                             if (t_task == 10) {
+                               throw std::runtime_error{"task 10"};
+                             }
+                           }),
+               std::runtime_error);
+  // still usable afterwards.
+  runs = 0;
+  workers.run(100, [&](std::size_t, std::size_t) { ++runs; });
+  ASSERT_EQ(runs, 100);
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,130 @@
+#include "sort.hxx"
+#include "test/test_util.hxx"
+#include "vector_expr.hxx"
+#include <gtest/gtest.h>
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#endif // ENABLE_MODULES
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace tinydb;
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+using test::batch_of;
+
+auto ids(const ColumnVector& t_col) -> std::vector<int64_t> {
+  auto vals = t_col.values<int64_t>();
+  return {vals.begin(), vals.end()};
+}
+
+/**
+ * @brief Every row out of a sorter, in the same columns as `t_types`.
+ */
+auto drain(Sorter& t_sort, const std::vector<ColType>& t_types)
+    -> std::vector<ColumnVector> {
+  std::vector<ColumnVector> ret;
+  for (auto type : t_types) {
+    ret.emplace_back(type);
+  }
+  // NOLINTNEXTLINE(*magic-number*)
+  while (t_sort.next(ret, 1000)) {
+  }
+  return ret;
+}
+
+} // namespace
+
+TEST(sort, keys) {
+  // NOLINTBEGIN(*magic-number*)
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const std::vector<double> floats{2.5, -0.0, nan, -1e300, 0.0, -2.5, 1e-300};
+  const std::vector<std::string> texts{"ab", std::string{"a\0b", 3}, "a", "",
+                                       "b",  std::string{"a\0", 2},  "ab"};
+  std::vector<ColumnVector> cols{ColumnVector{ColType::Float64},
+                                 ColumnVector{ColType::Text},
+                                 ColumnVector{ColType::Int64}};
+  for (std::size_t i = 0; i < floats.size(); ++i) {
+    cols[0].push(floats[i]);
+    cols[1].push_text(texts[i]);
+    cols[2].push(static_cast<int64_t>(i));
+  }
+  cols[0].push_null();
+  cols[1].push_null();
+  cols[2].push(int64_t{-1});
+  const std::vector<ColType> types{ColType::Float64, ColType::Text,
+                                   ColType::Int64};
+
+  // -1e300, -2.5, -0 = 0 in the order added, 1e-300, 2.5, NaN, then NULL.
+  Sorter floats_up{{{.col = 0, .type = VType::Float, .desc = false}},
+                   types,
+                   std::nullopt,
+                   0};
+  floats_up.add(batch_of(cols));
+  auto out = drain(floats_up, types);
+  ASSERT_EQ(ids(out[2]), (std::vector<int64_t>{3, 5, 1, 4, 6, 0, 2, -1}));
+
+  // NULL, then "b", "ab" twice in the order added, "a\0b", "a\0", "a", "".
+  Sorter texts_down{{{.col = 1, .type = VType::Text, .desc = true}},
+                    types,
+                    std::nullopt,
+                    0};
+  texts_down.add(batch_of(cols));
+  out = drain(texts_down, types);
+  ASSERT_EQ(ids(out[2]), (std::vector<int64_t>{-1, 4, 0, 6, 1, 5, 2, 3}));
+  ASSERT_TRUE(out[1].is_null(0));
+  ASSERT_EQ(out[1].text(4), texts[1]);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(sort, runs) {
+  // NOLINTBEGIN(*magic-number*)
+  test::MemFile file{256};
+  const std::vector<ColType> types{ColType::Int64, ColType::Int64};
+  // (i * 7919) % 20000 is every number below 20000, once each.
+  auto run = [&](std::optional<std::size_t> t_limit) {
+    Sorter sort{{{.col = 0, .type = VType::Int, .desc = true}},
+                types,
+                file.spill(),
+                32 * 1024,
+                t_limit};
+    for (int64_t first = 0; first < 20000; first += 1000) {
+      std::vector<ColumnVector> cols{ColumnVector{ColType::Int64},
+                                     ColumnVector{ColType::Int64}};
+      for (auto i = first; i < first + 1000; ++i) {
+        cols[0].push((i * 7919) % 20000 - 10000);
+        cols[1].push(i);
+      }
+      sort.add(batch_of(cols));
+    }
+    return std::pair{ids(drain(sort, types)[0]), sort.n_runs()};
+  };
+  auto check = [](const std::vector<int64_t>& t_keys) {
+    for (std::size_t r = 0; r < t_keys.size(); ++r) {
+      ASSERT_EQ(t_keys[r], 9999 - static_cast<int64_t>(r));
+    }
+  };
+  auto [keys, runs] = run(std::nullopt);
+  ASSERT_EQ(keys.size(), 20000);
+  ASSERT_GT(runs, 2);
+  check(keys);
+  // the best 100 only, in a heap: nothing spilled.
+  std::tie(keys, runs) = run(100);
+  ASSERT_EQ(keys.size(), 100);
+  ASSERT_EQ(runs, 0);
+  check(keys);
+  // NOLINTEND(*magic-number*)
+}
@@ -0,0 +1,39 @@
+/**
+ * @file test_util.hxx
+ * @brief Helpers shared by the tests of the SQL engine.
+ */
+
+#ifndef TINYDB_SQL_TEST_TEST_UTIL_HXX
+#define TINYDB_SQL_TEST_TEST_UTIL_HXX
+
+#include "dbfile/internal/test/test_util.hxx"
+#include "vector_expr.hxx"
+#ifdef ENABLE_MODULES
+#ifndef IMPORT_STD
+#include <vector>
+#else
+import std;
+#endif // !IMPORT_STD
+import tinydb.dbfile.internal.column_vector;
+#else
+#include "dbfile/internal/column_vector.hxx"
+#include <vector>
+#endif // ENABLE_MODULES
+
+namespace tinydb::test {
+
+/**
+ * @return A batch of every row of `t_cols`, which must outlive it.
+ */
+inline auto batch_of(const std::vector<dbfile::internal::ColumnVector>& t_cols)
+    -> Batch {
+  Batch ret{.cols{}, .n_rows = t_cols[0].size(), .selective = false, .sel{}};
+  for (const auto& col : t_cols) {
+    ret.cols.push_back(&col);
+  }
+  return ret;
+}
+
+} // namespace tinydb::test
+
+#endif // !TINYDB_SQL_TEST_TEST_UTIL_HXX
@@ -0,0 +1,120 @@
+#include "keyword.hxx"
+#include "tokenizer.hxx"
+#include <gtest/gtest.h>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+
+TEST(tokenizer, views_into_input) {
+  using namespace tinydb;
+  // NOLINTBEGIN(*magic-number*)
+  const std::string input{
+      "SELECT name, qty FROM orders -- trailing comment\n"
+      "WHERE qty >= -12 AND note <> 'it''s' AND 1st = 7;"};
+  Tokenizer tk;
+  ASSERT_TRUE(tk.tokenize(input).has_value());
+  auto tokens = tk.tokens();
+  ASSERT_EQ(tokens.size(), 20);
+
+  auto ident = [&](std::size_t t_idx) {
+    return std::get<Identifier>(tokens[t_idx]).val;
+  };
+  ASSERT_EQ(std::get<Keyword>(tokens[0]), Keyword::Select);
+  ASSERT_EQ(ident(1), "name");
+  // no copy: the token points right into the input.
+  ASSERT_EQ(ident(1).data(), input.data() + 7);
+  ASSERT_EQ(std::get<Symbol>(tokens[2]), Symbol::Comma);
+  ASSERT_EQ(std::get<Keyword>(tokens[4]), Keyword::From);
+  ASSERT_EQ(ident(5), "orders");
+  ASSERT_EQ(std::get<Keyword>(tokens[6]), Keyword::Where);
+  ASSERT_EQ(std::get<Symbol>(tokens[8]), Symbol::MoreThanEqual);
+  ASSERT_EQ(std::get<int32_t>(std::get<Literal>(tokens[9]).val), -12);
+  ASSERT_EQ(std::get<Symbol>(tokens[12]), Symbol::NotEqual);
+  // 2 quoted strings back to back.
+  ASSERT_EQ(std::get<std::string_view>(std::get<Literal>(tokens[13]).val),
+            "it");
+  ASSERT_EQ(std::get<std::string_view>(std::get<Literal>(tokens[14]).val),
+            "s");
+  ASSERT_EQ(ident(16), "1st");
+  ASSERT_EQ(std::get<int32_t>(std::get<Literal>(tokens[18]).val), 7);
+  ASSERT_EQ(std::get<Symbol>(tokens[19]), Symbol::Semicolon);
+
+  // the same tokenizer is reused, and the previous tokens are gone.
+  ASSERT_TRUE(tk.tokenize("x<y").has_value());
+  ASSERT_EQ(tk.tokens().size(), 3);
+  ASSERT_EQ(std::get<Symbol>(tk.tokens()[1]), Symbol::LessThan);
+
+  ASSERT_EQ(tk.tokenize("'open").error(), TokenizerError::MissingQuote);
+  ASSERT_EQ(tk.tokenize("a >< b").error(), TokenizerError::SussySymbols);
+  // a minus after an operand is a subtraction, not a sign.
+  ASSERT_TRUE(tk.tokenize("(a)-1 - -2").has_value());
+  ASSERT_EQ(tk.tokens().size(), 7);
+  ASSERT_EQ(std::get<Symbol>(tk.tokens()[3]), Symbol::Minus);
+  ASSERT_EQ(std::get<Literal>(tk.tokens()[6]).val, Literal{-2}.val);
+  ASSERT_EQ(tk.tokenize("99999999999").error(),
+            TokenizerError::NumberOutOfRange);
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(tokenizer, bulk_dump) {
+  using namespace tinydb;
+  // NOLINTBEGIN(*magic-number*)
+  static constexpr int32_t numrows = 500;
+  // long enough to span many vector blocks, and every boundary offset.
+  const std::string filler(100, 'x');
+  std::string input{"-- " + filler + " dump\n"};
+  for (int32_t i = 0; i < numrows; ++i) {
+    auto len = static_cast<std::size_t>(i);
+    input += "INSERT INTO t VALUES (" + std::to_string(i) + ",\t'" +
+             filler.substr(0, len % 70) + "', -" + std::to_string(i * 1000) +
+             ", col_" + filler.substr(0, len % 40) + ");" +
+             std::string(len % 37, ' ') + "\n";
+  }
+  Tokenizer tk;
+  ASSERT_TRUE(tk.tokenize(input).has_value());
+  auto tokens = tk.tokens();
+  // INSERT INTO t VALUES ( i , 's' , -n , col ) ;
+  static constexpr std::size_t per_row = 14;
+  ASSERT_EQ(tokens.size(), per_row * numrows);
+  for (int32_t i = 0; i < numrows; ++i) {
+    const auto* row = &tokens[static_cast<std::size_t>(i) * per_row];
+    ASSERT_EQ(std::get<Keyword>(row[0]), Keyword::Insert);
+    ASSERT_EQ(std::get<Keyword>(row[3]), Keyword::Values);
+    ASSERT_EQ(std::get<int32_t>(std::get<Literal>(row[5]).val), i);
+    ASSERT_EQ(std::get<std::string_view>(std::get<Literal>(row[7]).val)
+                  .size(),
+              i % 70);
+    ASSERT_EQ(std::get<int32_t>(std::get<Literal>(row[9]).val), -i * 1000);
+    ASSERT_EQ(std::get<Identifier>(row[11]).val.size(), 4 + (i % 40));
+    ASSERT_EQ(std::get<Symbol>(row[13]), Symbol::Semicolon);
+  }
+  // NOLINTEND(*magic-number*)
+}
+
+TEST(tokenizer, keywords) {
+  using namespace tinydb;
+  // every keyword is found in its own slot, in any case.
+  for (std::size_t i = 0; i < KEYWORD_NAMES.size(); ++i) {
+    auto name = std::string{KEYWORD_NAMES[i]};
+    ASSERT_EQ(find_keyword(name), static_cast<Keyword>(i));
+    for (auto& c : name) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    ASSERT_EQ(find_keyword(name), static_cast<Keyword>(i));
+  }
+  static_assert(find_keyword("sElEcT") == Keyword::Select);
+  static_assert(!find_keyword("selects"));
+  static_assert(!find_keyword("s3lect"));
+  static_assert(!find_keyword("x"));
+
+  Tokenizer tk;
+  ASSERT_TRUE(tk.tokenize("select Orders_2 from t where b = true").has_value());
+  auto tokens = tk.tokens();
+  ASSERT_EQ(tokens.size(), 8);
+  ASSERT_EQ(std::get<Keyword>(tokens[0]), Keyword::Select);
+  ASSERT_EQ(std::get<Identifier>(tokens[1]).val, "Orders_2");
+  ASSERT_EQ(std::get<Keyword>(tokens[4]), Keyword::Where);
+  ASSERT_TRUE(std::get<bool>(std::get<Literal>(tokens[7]).val));
+}
@@ -1,12 +1,21 @@
 #include "tokenizer.hxx"
-#include <cassert>
-#include <cctype>
+#include "keyword.hxx"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
 #include <cstdint>
 #include <expected>
 #include <print>
-#include <ranges>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <variant>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace tinydb {
 /**
@@ -55,203 +64,474 @@ static auto format_symbol(Symbol s) -> std::string {
   case Symbol::RParen:
     ret.append(")");
     break;
+  case Symbol::Plus:
+    ret.append("+");
+    break;
+  case Symbol::Minus:
+    ret.append("-");
+    break;
+  case Symbol::Star:
+    ret.append("*");
+    break;
+  case Symbol::Slash:
+    ret.append("/");
+    break;
+  case Symbol::Dot:
+    ret.append(".");
+    break;
+  case Symbol::Placeholder:
+    ret.append("?");
+    break;
   }
 
   return ret;
 }
 
-auto Tokenizer::tokenize(std::string_view input) -> TokenizerReturn {
-  auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n'; };
-  auto trimmed = [&](std::string_view sv) {
-    return sv | std::views::drop_while(is_space) | std::views::reverse |
-           std::views::drop_while(is_space) | std::views::reverse;
-  };
+namespace {
 
-  for (const char c : trimmed(input)) {
-    auto handle_result = handle_state(c).and_then([this](State s) {
-      m_curr_state = s;
-      return std::expected<void, TokenizerError>{};
-    });
-    if (!handle_result) {
-      return std::unexpected(handle_result.error());
-    }
+// character classes, as bits of `CLASSES`.
+constexpr uint8_t SPACE = 1U;
+constexpr uint8_t DIGIT = 2U;
+// can't be part of an identifier.
+constexpr uint8_t DELIM = 4U;
+
+constexpr auto make_classes() -> std::array<uint8_t, 256> {
+  std::array<uint8_t, 256> ret{};
+  for (char c : std::string_view{" \t\n\r"}) {
+    ret[static_cast<unsigned char>(c)] = SPACE | DELIM;
   }
-  switch (m_curr_state) {
-  case State::Space:
-  case State::Comment:
-  case State::Word:
-  case State::Number:
-    return handle_space(' ').transform([](auto) { return; });
-  case State::Quote:
-    return std::unexpected{TokenizerError::MissingQuote};
-  default:
-    return std::unexpected{TokenizerError::SussySymbols};
+  for (char c : std::string_view{"=<>',;()*+-./?"}) {
+    ret[static_cast<unsigned char>(c)] = DELIM;
+  }
+  for (char c = '0'; c <= '9'; ++c) {
+    ret[static_cast<unsigned char>(c)] = DIGIT;
   }
+  return ret;
 }
 
-auto Tokenizer::handle_space(char c) -> StateHandleReturn {
-  switch (c) {
-  case ' ':
-    if (!m_curr_word.empty()) {
-      m_tokens.emplace_back(Identifier{std::move(m_curr_word)});
-      m_curr_word = {};
-    }
-    if (m_curr_num) {
-      m_tokens.emplace_back(Literal{m_curr_num.value()});
-      m_curr_num.reset();
+constexpr auto CLASSES = make_classes();
+
+constexpr auto has_class(char c, uint8_t cls) -> bool {
+  return (CLASSES[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+constexpr auto is_digit(char c) -> bool { return has_class(c, DIGIT); }
+
+/**
+ * @return Whether a character can't be part of an identifier.
+ */
+constexpr auto ends_word(char c) -> bool { return has_class(c, DELIM); }
+
+#if defined(__AVX2__) || defined(__SSE2__)
+/**
+ * @brief The few vector operations the lexer needs, on the widest registers
+ * the target has. Every operation works on `WIDTH` bytes at once.
+ */
+struct Lanes {
+#ifdef __AVX2__
+  using reg_t = __m256i;
+  static constexpr std::size_t WIDTH = 32;
+  static auto load(const char* t_ptr) -> reg_t {
+    return _mm256_loadu_si256(reinterpret_cast<const reg_t*>(t_ptr));
+  }
+  static auto splat(char t_c) -> reg_t { return _mm256_set1_epi8(t_c); }
+  static auto eq(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm256_cmpeq_epi8(t_a, t_b);
+  }
+  static auto sub(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm256_sub_epi8(t_a, t_b);
+  }
+  static auto min(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm256_min_epu8(t_a, t_b);
+  }
+  static auto bit_or(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm256_or_si256(t_a, t_b);
+  }
+  static auto mask(reg_t t_a) -> uint32_t {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(t_a));
+  }
+#else
+  using reg_t = __m128i;
+  static constexpr std::size_t WIDTH = 16;
+  static auto load(const char* t_ptr) -> reg_t {
+    return _mm_loadu_si128(reinterpret_cast<const reg_t*>(t_ptr));
+  }
+  static auto splat(char t_c) -> reg_t { return _mm_set1_epi8(t_c); }
+  static auto eq(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm_cmpeq_epi8(t_a, t_b);
+  }
+  static auto sub(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm_sub_epi8(t_a, t_b);
+  }
+  static auto min(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm_min_epu8(t_a, t_b);
+  }
+  static auto bit_or(reg_t t_a, reg_t t_b) -> reg_t {
+    return _mm_or_si128(t_a, t_b);
+  }
+  static auto mask(reg_t t_a) -> uint32_t {
+    return static_cast<uint32_t>(_mm_movemask_epi8(t_a));
+  }
+#endif // __AVX2__
+  static constexpr uint32_t ALL = WIDTH == 32 ? ~uint32_t{0} : 0xFFFFU;
+
+  /**
+   * @brief Bytes in [t_lo, t_lo + t_n): once shifted by `t_lo`, they're the
+   * unsigned bytes below `t_n`.
+   */
+  static auto in_range(reg_t t_x, char t_lo, char t_n) -> reg_t {
+    auto shifted = sub(t_x, splat(t_lo));
+    return eq(min(shifted, splat(static_cast<char>(t_n - 1))), shifted);
+  }
+
+  static auto spaces(reg_t t_x) -> reg_t {
+    return bit_or(bit_or(in_range(t_x, '\t', 2), eq(t_x, splat('\r'))),
+                  eq(t_x, splat(' ')));
+  }
+
+  /**
+   * @return One bit per byte that has the class `Cls`.
+   */
+  template <uint8_t Cls> static auto classify(reg_t t_x) -> uint32_t {
+    if constexpr (Cls == SPACE) {
+      return mask(spaces(t_x));
+    } else if constexpr (Cls == DIGIT) {
+      return mask(in_range(t_x, '0', 10));
+    } else {
+      static_assert(Cls == DELIM);
+      // ' ( ) * + , - . / are contiguous, and so are ; < = > ?.
+      auto symbols = bit_or(in_range(t_x, '\'', 9), in_range(t_x, ';', 5));
+      return mask(bit_or(spaces(t_x), symbols));
     }
-    return State::Space;
-  default:
-    return handle_word(c);
   }
-}
+};
+#endif // __AVX2__ || __SSE2__
 
-auto Tokenizer::handle_word(char c) -> StateHandleReturn {
-  auto emplace_word = [this]() {
-    if (!m_curr_word.empty()) {
-      m_tokens.emplace_back(Identifier{std::move(m_curr_word)});
-      m_curr_word = {};
+/**
+ * @return The first position from `pos` whose character has the class
+ * `Cls` if `Is`, or hasn't it otherwise. The size of the input if none.
+ *
+ * Whole blocks of `Lanes::WIDTH` bytes are classified at once, so runs
+ * longer than a few characters cost a compare per block instead of a branch
+ * per character. The tail, and targets without SSE2, go one character at a
+ * time through the same table.
+ */
+template <uint8_t Cls, bool Is>
+auto find_class(std::string_view input, std::size_t pos) -> std::size_t {
+#if defined(__AVX2__) || defined(__SSE2__)
+  while (pos + Lanes::WIDTH <= input.size()) {
+    auto bits = Lanes::classify<Cls>(Lanes::load(input.data() + pos));
+    if constexpr (!Is) {
+      bits = ~bits & Lanes::ALL;
     }
-  };
-  if (isdigit(c)) {
-    assert(!m_curr_num);
-    if (m_curr_word.empty()) {
-      m_curr_num = (c - '0');
-      return State::Number;
+    if (bits != 0) {
+      return pos + static_cast<std::size_t>(std::countr_zero(bits));
     }
+    pos += Lanes::WIDTH;
   }
+#endif // __AVX2__ || __SSE2__
+  while (pos < input.size() && has_class(input[pos], Cls) != Is) {
+    ++pos;
+  }
+  return pos;
+}
+
+auto word_end(std::string_view input, std::size_t pos) -> std::size_t {
+  return find_class<DELIM, true>(input, pos);
+}
+
+auto digits_end(std::string_view input, std::size_t pos) -> std::size_t {
+  return find_class<DIGIT, false>(input, pos);
+}
+
+auto spaces_end(std::string_view input, std::size_t pos) -> std::size_t {
+  return find_class<SPACE, false>(input, pos);
+}
+
+/**
+ * @brief What `normalize` last wrote, which decides the space before the
+ * next piece.
+ */
+enum class Piece : uint8_t {
+  Start,
+  Name,
+  Keyword,
+  Value,
+  Open,
+  Close,
+  Dot,
+  Comma,
+  Semicolon,
+  Operator,
+};
+
+auto symbol_piece(char c) -> Piece {
   switch (c) {
-  case ' ':
-    emplace_word();
-    // reconstructs m_curr_word
-    return State::Space;
-  case '=':
-    emplace_word();
-    m_tokens.emplace_back(Symbol::Equal);
-    return State::Space;
-  case '<':
-    emplace_word();
-    return State::LeftPointy;
-  case '>':
-    emplace_word();
-    return State::RightPointy;
-  case '\'':
-    emplace_word();
-    return State::Quote;
-  case ',':
-    emplace_word();
-    m_tokens.emplace_back(Symbol::Comma);
-    return State::Space;
-  case ';':
-    emplace_word();
-    m_tokens.emplace_back(Symbol::Semicolon);
-    return State::Space;
-  case '-':
-    emplace_word();
-    return State::Dash;
   case '(':
-    emplace_word();
-    m_tokens.emplace_back(Symbol::LParen);
-    return State::Space;
+    return Piece::Open;
   case ')':
-    emplace_word();
-    m_tokens.emplace_back(Symbol::RParen);
-    return State::Space;
+    return Piece::Close;
+  case '.':
+    return Piece::Dot;
+  case ',':
+    return Piece::Comma;
+  case ';':
+    return Piece::Semicolon;
   default:
-    m_curr_word.push_back(c);
-    return State::Word;
+    return Piece::Operator;
   }
 }
 
-auto Tokenizer::handle_quote(char c) -> StateHandleReturn {
-  if (c == '\'') {
-    m_tokens.emplace_back(Literal{std::move(m_curr_word)});
-    m_curr_word = {};
-    return State::Space;
-  }
-
-  m_curr_word.push_back(c);
-  return State::Quote;
+/**
+ * @brief Same as `Tokenizer::after_operand`: a `-` after these is a minus.
+ */
+auto operand(Piece t_piece) -> bool {
+  return t_piece == Piece::Name || t_piece == Piece::Value ||
+         t_piece == Piece::Close;
 }
 
-auto Tokenizer::handle_left_pointy(char c) -> StateHandleReturn {
-  switch (c) {
-  case '<':
-    return std::unexpected{TokenizerError::SussySymbols};
-  case '>':
-    m_tokens.emplace_back(Symbol::NotEqual);
-    return State::Space;
-  case '=':
-    m_tokens.emplace_back(Symbol::LessThanEqual);
-    return State::Space;
+/**
+ * @brief One space between pieces, except around `.`, inside parentheses,
+ * before `,` and `;`, and between a function or table name and its `(`.
+ */
+auto spaced(Piece t_prev, Piece t_next) -> bool {
+  switch (t_next) {
+  case Piece::Close:
+  case Piece::Dot:
+  case Piece::Comma:
+  case Piece::Semicolon:
+    return false;
+  case Piece::Open:
+    if (t_prev == Piece::Name) {
+      return false;
+    }
+    break;
   default:
-    m_tokens.emplace_back(Symbol::LessThan);
-    return handle_space(c);
+    break;
   }
+  return t_prev != Piece::Start && t_prev != Piece::Open &&
+         t_prev != Piece::Dot;
 }
 
-auto Tokenizer::handle_right_pointy(char c) -> StateHandleReturn {
-  switch (c) {
-  case '>':
-  case '<':
-    return std::unexpected{TokenizerError::SussySymbols};
-  case '=':
-    m_tokens.emplace_back(Symbol::MoreThanEqual);
-    return State::Space;
-  default:
-    m_tokens.emplace_back(Symbol::MoreThan);
-    return handle_space(c);
+} // namespace
+
+auto Tokenizer::tokenize(std::string_view input) -> TokenizerReturn {
+  // keeps the capacity, so that the next statements don't allocate.
+  m_tokens.clear();
+  std::size_t pos{0};
+  auto next = [&]() { return pos + 1 < input.size() ? input[pos + 1] : '\0'; };
+  auto symbol = [&](Symbol sym, std::size_t len) {
+    m_tokens.emplace_back(sym);
+    pos += len;
+  };
+  while (pos < input.size()) {
+    const char c = input[pos];
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      // indentation and blank lines come in runs.
+      pos = spaces_end(input, pos);
+      break;
+    case '=':
+      symbol(Symbol::Equal, 1);
+      break;
+    case ',':
+      symbol(Symbol::Comma, 1);
+      break;
+    case ';':
+      symbol(Symbol::Semicolon, 1);
+      break;
+    case '(':
+      symbol(Symbol::LParen, 1);
+      break;
+    case ')':
+      symbol(Symbol::RParen, 1);
+      break;
+    case '+':
+      symbol(Symbol::Plus, 1);
+      break;
+    case '*':
+      symbol(Symbol::Star, 1);
+      break;
+    case '/':
+      symbol(Symbol::Slash, 1);
+      break;
+    case '.':
+      symbol(Symbol::Dot, 1);
+      break;
+    case '?':
+      symbol(Symbol::Placeholder, 1);
+      break;
+    case '<':
+      switch (next()) {
+      case '<':
+        return std::unexpected{TokenizerError::SussySymbols};
+      case '>':
+        symbol(Symbol::NotEqual, 2);
+        break;
+      case '=':
+        symbol(Symbol::LessThanEqual, 2);
+        break;
+      default:
+        symbol(Symbol::LessThan, 1);
+        break;
+      }
+      break;
+    case '>':
+      switch (next()) {
+      case '>':
+      case '<':
+        return std::unexpected{TokenizerError::SussySymbols};
+      case '=':
+        symbol(Symbol::MoreThanEqual, 2);
+        break;
+      default:
+        symbol(Symbol::MoreThan, 1);
+        break;
+      }
+      break;
+    case '\'': {
+      // find is a memchr, which already looks at whole vectors: long string
+      // literals and comments are skipped in bulk.
+      auto end = input.find('\'', pos + 1);
+      if (end == std::string_view::npos) {
+        return std::unexpected{TokenizerError::MissingQuote};
+      }
+      m_tokens.emplace_back(Literal{input.substr(pos + 1, end - pos - 1)});
+      pos = end + 1;
+      break;
+    }
+    case '-':
+      if (next() == '-') {
+        // it's a comment until it's a new line.
+        pos = std::min(input.find('\n', pos), input.size());
+        break;
+      }
+      if (!is_digit(next()) || after_operand()) {
+        symbol(Symbol::Minus, 1);
+        break;
+      }
+      [[fallthrough]];
+    default:
+      if (c == '-' || is_digit(c)) {
+        auto end = scan_number(input, pos);
+        if (!end) {
+          return std::unexpected{end.error()};
+        }
+        pos = *end;
+        break;
+      }
+      auto end = word_end(input, pos);
+      auto word = input.substr(pos, end - pos);
+      if (auto kw = find_keyword(word); !kw) {
+        m_tokens.emplace_back(Identifier{word});
+      } else if (*kw == Keyword::True || *kw == Keyword::False) {
+        m_tokens.emplace_back(Literal{*kw == Keyword::True});
+      } else {
+        m_tokens.emplace_back(*kw);
+      }
+      pos = end;
+      break;
+    }
   }
+  return {};
 }
 
-auto Tokenizer::handle_number(char c) -> StateHandleReturn {
-  if (isdigit(c)) {
-    m_curr_num = m_curr_num
-                     .transform([c](int32_t i) {
-                       // the goddamn 'magic number' warning.
-                       constexpr int32_t ten = 10;
-                       if (i < 0) {
-                         return (ten * i) - (c - '0');
-                       }
-                       return (ten * i) + (c - '0');
-                     })
-                     .or_else([this, c]() {
-                       if (m_curr_state == State::Dash) {
-                         // the goddamn 'magic number' warning.
-                         return decltype(m_curr_num)(-(c - '0'));
-                       }
-                       return decltype(m_curr_num)(c - '0');
-                     });
-    return State::Number;
+void Tokenizer::normalize(std::string_view input, std::string& out) {
+  out.clear();
+  std::size_t pos{0};
+  auto prev = Piece::Start;
+  auto emit = [&](Piece t_piece, std::string_view t_text) {
+    if (spaced(prev, t_piece)) {
+      out.push_back(' ');
+    }
+    out.append(t_text);
+    prev = t_piece;
+  };
+  while (pos < input.size()) {
+    const char c = input[pos];
+    const char next = pos + 1 < input.size() ? input[pos + 1] : '\0';
+    if (has_class(c, SPACE)) {
+      pos = spaces_end(input, pos);
+    } else if (c == '-' && next == '-') {
+      pos = std::min(input.find('\n', pos), input.size());
+    } else if (c == '\'') {
+      // an unterminated string is copied as is, for tokenize to complain.
+      auto end = std::min(input.find('\'', pos + 1), input.size() - 1);
+      emit(Piece::Value, input.substr(pos, end + 1 - pos));
+      pos = end + 1;
+    } else if (c == '-' && is_digit(next) && !operand(prev)) {
+      // a negative number, which must stay glued to its sign.
+      auto end = word_end(input, pos + 1);
+      emit(Piece::Value, input.substr(pos, end - pos));
+      pos = end;
+    } else if (!ends_word(c)) {
+      auto end = word_end(input, pos);
+      auto word = input.substr(pos, end - pos);
+      auto kw = find_keyword(word);
+      if (!kw) {
+        emit(Piece::Name, word);
+      } else {
+        emit(*kw == Keyword::True || *kw == Keyword::False ? Piece::Value
+                                                           : Piece::Keyword,
+             keyword_name(*kw));
+      }
+      pos = end;
+    } else {
+      // <>, <= and >= are one symbol; so are the invalid << and ><, for
+      // tokenize to still reject them.
+      auto len = (c == '<' || c == '>') &&
+                         std::string_view{"<>="}.contains(next)
+                     ? 2U
+                     : 1U;
+      emit(symbol_piece(c), input.substr(pos, len));
+      pos += len;
+    }
   }
-  assert(m_curr_num);
-  assert(m_curr_word.empty());
-  if (isalpha(c) || c == '_') {
-    // I know it's just a couple lines to hand-roll but I'm lazy.
-    m_curr_word = std::to_string(m_curr_num.value());
-    m_curr_num.reset();
-    return handle_word(c);
+  if (!out.empty() && out.back() == ';') {
+    out.pop_back();
   }
-  m_tokens.emplace_back(Literal{m_curr_num.value()});
-  m_curr_num.reset();
-  return handle_space(c);
 }
 
-auto Tokenizer::handle_dash(char c) -> StateHandleReturn {
-  if (c == '-') {
-    return State::Comment;
+auto Tokenizer::after_operand() const -> bool {
+  if (m_tokens.empty()) {
+    return false;
+  }
+  const auto& last = m_tokens.back();
+  const auto* sym = std::get_if<Symbol>(&last);
+  return sym == nullptr ? !std::holds_alternative<Keyword>(last)
+                        : *sym == Symbol::RParen;
+}
+
+auto Tokenizer::scan_number(std::string_view input, std::size_t pos)
+    -> std::expected<std::size_t, TokenizerError> {
+  const auto start = pos;
+  if (input[pos] == '-') {
+    ++pos;
+  }
+  pos = digits_end(input, pos);
+  if (pos < input.size() && !ends_word(input[pos])) {
+    auto end = word_end(input, pos);
+    m_tokens.emplace_back(Identifier{input.substr(start, end - start)});
+    return end;
   }
-  if (c >= '0' && c <= '9') {
-    return handle_number(c);
+  int32_t val{0};
+  auto [ptr, ec] =
+      std::from_chars(input.data() + start, input.data() + pos, val);
+  if (ec != std::errc{}) {
+    return std::unexpected{TokenizerError::NumberOutOfRange};
   }
-  return std::unexpected{TokenizerError::SussySymbols};
+  m_tokens.emplace_back(Literal{val});
+  return pos;
 }
 
 #ifndef NDEBUG
 void Tokenizer::print_tokens() {
   auto print_literal = [](const Literal& lit) {
     std::visit(matches{
-                   [](const std::string& s) {
+                   [](std::string_view s) {
                      std::println("Literal string: '{}'", s);
                    },
                    [](int32_t i) { std::println("Literal number: {}", i); },
@@ -265,7 +545,10 @@ void Tokenizer::print_tokens() {
                   std::println("Identifier: {}", iden.val);
                 },
                 [&](const Literal& lit) { print_literal(lit); },
-                [](Symbol sym) { std::println("{}", format_symbol(sym)); }},
+                [](Symbol sym) { std::println("{}", format_symbol(sym)); },
+                [](Keyword kw) {
+                  std::println("Keyword: {}", keyword_name(kw));
+                }},
         tok);
   }
 }
@@ -6,19 +6,32 @@
  * - Spaces are ignored unless quoted.
  * - Symbols (comment, semicolon, comma and operators).
  * - Literal values (quoted string, number, boolean).
- * - Identifiers.
+ * - Keywords (see keyword.hxx), recognized whatever their case.
+ * - Identifiers: every other word.
  *
- * The next step after tokenizing will resolve the Identifiers category
- * into either reserved keywords or actual identifiers.
+ * `TRUE` and `FALSE` are keywords, but come out as boolean literals.
+ *
+ * Tokens don't own any text: identifiers and string literals are views into
+ * the input string, which the caller must keep alive as long as it uses the
+ * tokens. Together with reusing the same token vector for every statement,
+ * tokenizing a statement doesn't allocate anything once the vector is big
+ * enough.
+ *
+ * Within a token (words, numbers, runs of spaces, string literals and
+ * comments), the input is classified a vector register at a time; only the
+ * choice of the next token looks at single characters. That keeps big
+ * `INSERT ... VALUES` dumps from being bound by lexing.
  */
 
 #ifndef TINYDB_TOKENIZER_HXX
 #define TINYDB_TOKENIZER_HXX
 
+#include "keyword.hxx"
 #include <cstdint>
 #include <expected>
-#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -29,6 +42,7 @@ enum class TokenizerError : uint8_t {
     MissingArguments,
     SussySymbols,
     MissingQuote,
+    NumberOutOfRange,
 };
 
 /**
@@ -46,17 +60,12 @@ enum class Symbol : uint8_t {
     Semicolon,     // ;
     LParen,        // (
     RParen,        // )
-};
-
-enum class State : uint8_t {
-    Comment,
-    Dash, // resolve to a comment (or a minus, in the future)
-    Space,
-    Word,
-    Quote,
-    Number,
-    LeftPointy,
-    RightPointy,
+    Plus,          // +
+    Minus,         // -
+    Star,          // *
+    Slash,         // /
+    Dot,           // .
+    Placeholder,   // ?
 };
 
 // token types
@@ -65,52 +74,63 @@ enum class State : uint8_t {
  * @brief Generic unquoted bunch of characters
  */
 struct Identifier {
-    std::string val;
+    std::string_view val;
 };
 /**
  * @class Literal
  * @brief Literal values (string, number, boolean).
- * - Stored as a `variant<string, int32, bool>`.
+ * - Stored as a `variant<string_view, int32, bool>`. A string is the text
+ *   between the quotes.
  */
 struct Literal {
-    std::variant<std::string, int32_t, bool> val;
+    std::variant<std::string_view, int32_t, bool> val;
 };
 
 // explicit instantiation to reduce compile time.
 using TokenizerReturn = std::expected<void, TokenizerError>;
 
 // explicit instantiation to reduce compile time.
-using StateHandleReturn = std::expected<State, TokenizerError>;
-
-// explicit instantiation to reduce compile time.
-using Token = std::variant<Identifier, Literal, Symbol>;
+using Token = std::variant<Identifier, Literal, Symbol, Keyword>;
 
 /**
  * @class Tokenizer
  * @brief Converts an input string into tokens.
  *
+ * One `Tokenizer` is meant to be reused for every statement: each call to
+ * `tokenize` replaces the previous tokens, but keeps the memory.
  */
 class Tokenizer {
   public:
     Tokenizer() = default;
 
     /**
-     * @brief Take the list of tokens out of `Tokenizer`.
-     * After this function call, one should not use this `Tokenizer` anymore, or
-     * one should construct a new `Tokenizer.`
-     *
-     * @return rvalue of tokens vector.
+     * @return The tokens of the last `tokenize` call. Only valid until the
+     * next one, and as long as the input string is alive.
      */
-    auto take_tokens() -> std::vector<Token>&& { return std::move(m_tokens); }
+    [[nodiscard]] auto tokens() const noexcept -> std::span<const Token> {
+        return m_tokens;
+    }
 
     /**
      * @brief Tokenize the input string.
      *
-     * @param input
-     * @return Nothing if successful, ParseError if an error occurs.
+     * @param input Must outlive the tokens.
+     * @return Nothing if successful, ParseError if an error occurs. The
+     * tokens before the error are kept.
      */
     auto tokenize(std::string_view input) -> TokenizerReturn;
 
+    /**
+     * @brief Writes `input` to `out` in a canonical spelling, so that the
+     * same statement written differently gives the same text: comments are
+     * dropped, keywords are upper case, a trailing `;` goes away and the
+     * spacing only depends on the tokens (`a=1` and `a = 1` both become
+     * `a = 1`). Quoted strings are kept as they are.
+     *
+     * The result tokenizes to the same tokens as `input`, minus the `;`.
+     */
+    static void normalize(std::string_view input, std::string& out);
+
 #ifndef NDEBUG
     /**
      * @brief Debug printing
@@ -118,50 +138,21 @@ class Tokenizer {
     void print_tokens();
 #endif // !NDEBUG
   private:
-    std::string m_curr_word{};
     std::vector<Token> m_tokens{};
-    State m_curr_state{State::Word};
-    std::optional<int32_t> m_curr_num;
-
-    auto handle_state(char c) -> StateHandleReturn {
-        switch (m_curr_state) {
-        case State::Comment:
-            // it's a comment until it's a new line.
-            return State::Comment;
-        case State::Dash:
-            return handle_dash(c);
-        case State::Space:
-            return handle_space(c);
-        case State::Word:
-            return handle_word(c);
-        case State::Number:
-            return handle_number(c);
-        case State::Quote:
-            return handle_quote(c);
-        case State::LeftPointy:
-            return handle_left_pointy(c);
-        case State::RightPointy:
-            return handle_right_pointy(c);
-            // TODO: switch for all states
-        }
-        return {};
-    }
-
-    auto handle_dash(char c) -> StateHandleReturn;
-
-    auto handle_space(char c) -> StateHandleReturn;
-
-    auto handle_word(char c) -> StateHandleReturn;
-
-    auto handle_quote(char c) -> StateHandleReturn;
-
-    auto handle_number(char c) -> StateHandleReturn;
 
-    auto handle_left_pointy(char c) -> StateHandleReturn;
-
-    auto handle_right_pointy(char c) -> StateHandleReturn;
+    /**
+     * @return Whether the last token ends an operand, so that a `-` right
+     * after it is a subtraction and not the sign of a number.
+     */
+    [[nodiscard]] auto after_operand() const -> bool;
 
-    // TODO: handle all the other equals
+    /**
+     * @brief Reads a number starting at `pos`, sign included.
+     * @return Where the number ends. A number directly followed by anything
+     * that can be part of an identifier is an identifier instead, like `1st`.
+     */
+    auto scan_number(std::string_view input, std::size_t pos)
+        -> std::expected<std::size_t, TokenizerError>;
 };
 
 } // namespace tinydb
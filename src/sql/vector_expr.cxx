@@ -0,0 +1,493 @@
+#include "vector_expr.hxx"
+#include "ast.hxx"
+#include "kernels.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/tbl.hxx"
+#endif // ENABLE_MODULES
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace tinydb {
+
+using dbfile::column::ColType;
+using dbfile::internal::ColumnVector;
+
+namespace {
+
+template <typename T> auto resize(ColumnVector& t_vec, std::size_t t_n) -> T* {
+  t_vec.data.resize(t_n * sizeof(T));
+  t_vec.nulls.resize(t_n);
+  return std::bit_cast<T*>(t_vec.data.data());
+}
+
+template <typename T> auto raw(const ColumnVector& t_vec) -> const T* {
+  return std::bit_cast<const T*>(t_vec.data.data());
+}
+
+constexpr auto is_numeric(VType t_type) -> bool {
+  return t_type == VType::Int || t_type == VType::Float;
+}
+
+} // namespace
+
+auto Scope::resolve(const ColumnRef& t_ref) const
+    -> std::expected<Column, ExecError> {
+  std::optional<Column> ret;
+  for (std::size_t tbl = 0; tbl < m_tables.size(); ++tbl) {
+    if (!t_ref.table.empty() && t_ref.table != m_tables[tbl]->get_name()) {
+      continue;
+    }
+    auto pos = m_tables[tbl]->column_pos(t_ref.name);
+    if (!pos) {
+      continue;
+    }
+    if (ret) {
+      return std::unexpected{ExecError::AmbiguousColumn};
+    }
+    ret = Column{.tbl = tbl, .pos = *pos};
+  }
+  if (!ret) {
+    return std::unexpected{ExecError::UnknownColumn};
+  }
+  return *ret;
+}
+
+auto Scope::column(const ColumnRef& t_ref)
+    -> std::expected<std::pair<std::size_t, ColType>, ExecError> {
+  auto col = resolve(t_ref);
+  if (!col) {
+    return std::unexpected{col.error()};
+  }
+  return column(col->pos, col->tbl);
+}
+
+auto Scope::column(std::size_t t_pos, std::size_t t_tbl)
+    -> std::pair<std::size_t, ColType> {
+  auto type = m_tables[t_tbl]->columns()[t_pos].m_type;
+  auto it = std::ranges::find_if(m_columns, [&](const Column& t_col) {
+    return t_col.tbl == t_tbl && t_col.pos == t_pos;
+  });
+  if (it != m_columns.end()) {
+    return {static_cast<std::size_t>(it - m_columns.begin()), type};
+  }
+  m_columns.push_back({.tbl = t_tbl, .pos = t_pos});
+  return {m_columns.size() - 1, type};
+}
+
+auto Scope::scanned(std::size_t t_tbl) const -> std::vector<std::size_t> {
+  std::vector<std::size_t> ret;
+  for (const auto& col : m_columns) {
+    if (col.tbl == t_tbl) {
+      ret.push_back(col.pos);
+    }
+  }
+  return ret;
+}
+
+auto VectorExpr::compile(const Expr& t_expr, Scope& t_scope)
+    -> std::expected<VectorExpr, ExecError> {
+  if (const auto* ref = std::get_if<ColumnRef>(&t_expr.node)) {
+    auto col = t_scope.column(*ref);
+    if (!col) {
+      return std::unexpected{col.error()};
+    }
+    return column(col->first, col->second);
+  }
+  if (const auto* lit = std::get_if<Literal>(&t_expr.node)) {
+    return constant(*lit);
+  }
+  if (std::holds_alternative<NullValue>(t_expr.node)) {
+    // untyped: the other side of the operator decides.
+    return null(VType::Int);
+  }
+  if (const auto* prm = std::get_if<Param>(&t_expr.node)) {
+    if (prm->idx >= t_scope.params().size()) {
+      return std::unexpected{ExecError::UnboundParameter};
+    }
+    return param(prm->idx, t_scope.params()[prm->idx]);
+  }
+  if (const auto* un = std::get_if<Unary>(&t_expr.node)) {
+    auto arg = compile(*un->operand, t_scope);
+    if (!arg) {
+      return arg;
+    }
+    return unary(un->op, std::move(*arg));
+  }
+  if (const auto* bin = std::get_if<Binary>(&t_expr.node)) {
+    auto lhs = compile(*bin->lhs, t_scope);
+    if (!lhs) {
+      return lhs;
+    }
+    auto rhs = compile(*bin->rhs, t_scope);
+    if (!rhs) {
+      return rhs;
+    }
+    return binary(bin->op, std::move(*lhs), std::move(*rhs));
+  }
+  return std::unexpected{ExecError::Unsupported};
+}
+
+auto VectorExpr::column(std::size_t t_col, ColType t_type) -> VectorExpr {
+  VectorExpr ret{Kind::Column, widen(t_type)};
+  ret.m_col = t_col;
+  ret.m_src = t_type;
+  return ret;
+}
+
+auto VectorExpr::constant(const Literal& t_lit) -> VectorExpr {
+  if (const auto* str = std::get_if<std::string_view>(&t_lit.val)) {
+    VectorExpr ret{Kind::Const, VType::Text};
+    ret.m_const.push_text(*str);
+    return ret;
+  }
+  if (const auto* num = std::get_if<int32_t>(&t_lit.val)) {
+    VectorExpr ret{Kind::Const, VType::Int};
+    ret.m_const.push(static_cast<int64_t>(*num));
+    return ret;
+  }
+  VectorExpr ret{Kind::Const, VType::Bool};
+  ret.m_const.push(static_cast<uint8_t>(std::get<bool>(t_lit.val)));
+  return ret;
+}
+
+auto VectorExpr::null(VType t_type) -> VectorExpr {
+  VectorExpr ret{Kind::Const, t_type};
+  ret.m_const.push_null();
+  return ret;
+}
+
+auto VectorExpr::param(std::size_t t_idx, const ParamValue& t_val)
+    -> std::expected<VectorExpr, ExecError> {
+  if (const auto* lit = std::get_if<Literal>(&t_val)) {
+    VectorExpr ret{Kind::Param, constant(*lit).type()};
+    ret.m_param = t_idx;
+    return ret;
+  }
+  if (std::holds_alternative<NullValue>(t_val)) {
+    return null(VType::Int);
+  }
+  return std::unexpected{ExecError::UnboundParameter};
+}
+
+auto VectorExpr::unary(UnaryOp t_op, VectorExpr t_arg)
+    -> std::expected<VectorExpr, ExecError> {
+  VType type{VType::Bool};
+  switch (t_op) {
+  case UnaryOp::Not:
+    if (t_arg.is_null_const()) {
+      t_arg = null(VType::Bool);
+    }
+    if (t_arg.type() != VType::Bool) {
+      return std::unexpected{ExecError::TypeMismatch};
+    }
+    break;
+  case UnaryOp::Neg:
+    if (!is_numeric(t_arg.type())) {
+      return std::unexpected{ExecError::TypeMismatch};
+    }
+    type = t_arg.type();
+    break;
+  case UnaryOp::IsNull:
+  case UnaryOp::IsNotNull:
+    break;
+  }
+  VectorExpr ret{Kind::Unary, type};
+  ret.m_unary = t_op;
+  ret.m_args.push_back(std::move(t_arg));
+  return ret.is_fixed() ? fold(std::move(ret)) : std::move(ret);
+}
+
+auto VectorExpr::binary(BinaryOp t_op, VectorExpr t_lhs, VectorExpr t_rhs)
+    -> std::expected<VectorExpr, ExecError> {
+  VType type{VType::Bool};
+  switch (t_op) {
+  case BinaryOp::And:
+  case BinaryOp::Or:
+    for (auto* arg : {&t_lhs, &t_rhs}) {
+      if (arg->is_null_const()) {
+        *arg = null(VType::Bool);
+      }
+    }
+    if (t_lhs.type() != VType::Bool || t_rhs.type() != VType::Bool) {
+      return std::unexpected{ExecError::TypeMismatch};
+    }
+    break;
+  case BinaryOp::Add:
+  case BinaryOp::Sub:
+  case BinaryOp::Mul:
+  case BinaryOp::Div:
+    unify(t_lhs, t_rhs);
+    if (!is_numeric(t_lhs.type()) || !is_numeric(t_rhs.type())) {
+      return std::unexpected{ExecError::TypeMismatch};
+    }
+    type = t_lhs.type() == VType::Float || t_rhs.type() == VType::Float
+               ? VType::Float
+               : VType::Int;
+    break;
+  default:
+    unify(t_lhs, t_rhs);
+    if (t_lhs.type() != t_rhs.type() &&
+        !(is_numeric(t_lhs.type()) && is_numeric(t_rhs.type()))) {
+      return std::unexpected{ExecError::TypeMismatch};
+    }
+    break;
+  }
+  VectorExpr ret{Kind::Binary, type};
+  auto single = [](const VectorExpr& t_arg) {
+    return t_arg.m_kind == Kind::Const || t_arg.m_kind == Kind::Param;
+  };
+  const bool lconst = single(t_lhs);
+  const bool rconst = single(t_rhs);
+  // 2 constants are folded right away, by a kernel for vectors of 1 value.
+  // With a `?`, they can't be: both are repeated for every row instead.
+  ret.m_shape = lconst == rconst ? Shape::ColCol
+                : lconst         ? Shape::ConstCol
+                                 : Shape::ColConst;
+  ret.m_kernel = binary_kernel(t_op, t_lhs.operand_type(),
+                               t_rhs.operand_type(), ret.m_shape);
+  if (ret.m_kernel == nullptr) {
+    return std::unexpected{ExecError::TypeMismatch};
+  }
+  ret.m_args.push_back(std::move(t_lhs));
+  ret.m_args.push_back(std::move(t_rhs));
+  return ret.is_fixed() ? fold(std::move(ret)) : std::move(ret);
+}
+
+void VectorExpr::unify(VectorExpr& t_lhs, VectorExpr& t_rhs) {
+  if (t_lhs.type() == t_rhs.type()) {
+    return;
+  }
+  if (t_lhs.is_null_const()) {
+    t_lhs = null(t_rhs.type());
+    return;
+  }
+  if (t_rhs.is_null_const()) {
+    t_rhs = null(t_lhs.type());
+    return;
+  }
+  // converted once here rather than on every row.
+  for (auto [num, other] :
+       {std::pair{&t_lhs, &t_rhs}, std::pair{&t_rhs, &t_lhs}}) {
+    if (num->type() != VType::Int || other->type() != VType::Float) {
+      continue;
+    }
+    if (num->m_kind == Kind::Const) {
+      VectorExpr cast{Kind::Const, VType::Float};
+      cast.m_const.push(static_cast<double>(num->m_const.values<int64_t>()[0]));
+      *num = std::move(cast);
+      return;
+    }
+    if (num->m_kind == Kind::Param) {
+      // converted when bound.
+      VectorExpr cast{Kind::Param, VType::Float};
+      cast.m_param = num->m_param;
+      *num = std::move(cast);
+      return;
+    }
+  }
+}
+
+auto VectorExpr::fold(VectorExpr t_expr) -> VectorExpr {
+  Batch one;
+  one.n_rows = 1;
+  VectorExpr ret{Kind::Const, t_expr.type()};
+  const auto& val = t_expr.eval(one);
+  if (val.is_null(0)) {
+    ret.m_const.push_null();
+  } else {
+    ret.m_const.push_bytes(val.bytes(0));
+  }
+  return ret;
+}
+
+auto VectorExpr::is_null_const() const -> bool {
+  return m_kind == Kind::Const && m_const.is_null(0);
+}
+
+auto VectorExpr::is_const() const -> bool {
+  switch (m_kind) {
+  case Kind::Column:
+    return false;
+  case Kind::Const:
+  case Kind::Param:
+    return true;
+  default:
+    return std::ranges::all_of(m_args, &VectorExpr::is_const);
+  }
+}
+
+auto VectorExpr::is_fixed() const -> bool {
+  switch (m_kind) {
+  case Kind::Column:
+  case Kind::Param:
+    return false;
+  case Kind::Const:
+    return true;
+  default:
+    return std::ranges::all_of(m_args, &VectorExpr::is_fixed);
+  }
+}
+
+void VectorExpr::bind(std::span<const ParamValue> t_params) {
+  for (auto& arg : m_args) {
+    arg.bind(t_params);
+  }
+  if (m_kind != Kind::Param) {
+    return;
+  }
+  assert(m_param < t_params.size());
+  const auto& lit = std::get<Literal>(t_params[m_param]);
+  m_const.clear();
+  m_out.clear();
+  switch (m_type) {
+  case VType::Text:
+    m_const.push_text(std::get<std::string_view>(lit.val));
+    break;
+  case VType::Int:
+    m_const.push(static_cast<int64_t>(std::get<int32_t>(lit.val)));
+    break;
+  case VType::Float:
+    m_const.push(static_cast<double>(std::get<int32_t>(lit.val)));
+    break;
+  case VType::Bool:
+    m_const.push(static_cast<uint8_t>(std::get<bool>(lit.val)));
+    break;
+  }
+}
+
+auto VectorExpr::operand_type() const -> ColType {
+  if (m_kind == Kind::Column) {
+    // CharN columns are turned into Text.
+    return dbfile::column::is_text(m_src) ? ColType::Text : m_src;
+  }
+  return storage_type(m_type);
+}
+
+auto VectorExpr::operand(const Batch& t_batch) -> const ColumnVector& {
+  switch (m_kind) {
+  case Kind::Column:
+    if (!dbfile::column::is_text(m_src) || m_src == ColType::Text) {
+      return *t_batch.cols[m_col];
+    }
+    return eval_column(t_batch);
+  default:
+    return eval(t_batch);
+  }
+}
+
+auto VectorExpr::eval(const Batch& t_batch) -> const ColumnVector& {
+  const auto n = t_batch.n_rows;
+  switch (m_kind) {
+  case Kind::Column:
+    return eval_column(t_batch);
+  case Kind::Const:
+  case Kind::Param:
+    // the same value every time: only redone when the size changes.
+    assert(m_const.size() == 1);
+    if (m_out.size() != n) {
+      m_out.clear();
+      for (std::size_t i = 0; i < n; ++i) {
+        if (m_const.is_null(0)) {
+          m_out.push_null();
+        } else {
+          m_out.push_bytes(m_const.bytes(0));
+        }
+      }
+    }
+    return m_out;
+  case Kind::Unary:
+    eval_unary(m_args[0].eval(t_batch), n);
+    return m_out;
+  case Kind::Binary: {
+    // constant operands are passed as is, not repeated for every row.
+    const auto& lhs = m_shape == Shape::ConstCol ? m_args[0].m_const
+                                                 : m_args[0].operand(t_batch);
+    const auto& rhs = m_shape == Shape::ColConst ? m_args[1].m_const
+                                                 : m_args[1].operand(t_batch);
+    m_kernel(lhs, rhs, m_out, n);
+    return m_out;
+  }
+  }
+  return m_out;
+}
+
+auto VectorExpr::eval_column(const Batch& t_batch) -> const ColumnVector& {
+  const auto& src = *t_batch.cols[m_col];
+  // already in its final type: no copy.
+  if (m_src == storage_type(m_type)) {
+    return src;
+  }
+  if (auto widen = widen_kernel(m_src)) {
+    widen(src, m_out);
+    return m_out;
+  }
+  // CharN: the zero padding isn't part of the string.
+  m_out.clear();
+  for (std::size_t i = 0; i < src.size(); ++i) {
+    if (src.is_null(i)) {
+      m_out.push_null();
+      continue;
+    }
+    auto str = src.bytes(i);
+    m_out.push_text(str.substr(0, str.find('\0')));
+  }
+  return m_out;
+}
+
+void VectorExpr::eval_unary(const ColumnVector& t_arg, std::size_t t_n) {
+  switch (m_unary) {
+  case UnaryOp::Not: {
+    const auto* in = raw<uint8_t>(t_arg);
+    auto* out = resize<uint8_t>(m_out, t_n);
+    for (std::size_t i = 0; i < t_n; ++i) {
+      out[i] = in[i] ^ 1U;
+    }
+    std::ranges::copy(t_arg.nulls, m_out.nulls.begin());
+    break;
+  }
+  case UnaryOp::Neg:
+    if (m_type == VType::Int) {
+      const auto* in = raw<int64_t>(t_arg);
+      auto* out = resize<int64_t>(m_out, t_n);
+      for (std::size_t i = 0; i < t_n; ++i) {
+        // wrapping, like the hardware does, instead of undefined.
+        out[i] = static_cast<int64_t>(0 - static_cast<uint64_t>(in[i]));
+      }
+    } else {
+      const auto* in = raw<double>(t_arg);
+      auto* out = resize<double>(m_out, t_n);
+      for (std::size_t i = 0; i < t_n; ++i) {
+        out[i] = -in[i];
+      }
+    }
+    std::ranges::copy(t_arg.nulls, m_out.nulls.begin());
+    break;
+  case UnaryOp::IsNull:
+  case UnaryOp::IsNotNull: {
+    const uint8_t flip = m_unary == UnaryOp::IsNotNull ? 1 : 0;
+    auto* out = resize<uint8_t>(m_out, t_n);
+    for (std::size_t i = 0; i < t_n; ++i) {
+      out[i] = static_cast<uint8_t>((t_arg.nulls[i] != 0) ^ flip);
+    }
+    std::ranges::fill(m_out.nulls, 0);
+    break;
+  }
+  }
+}
+
+} // namespace tinydb
@@ -0,0 +1,334 @@
+/**
+ * @file vector_expr.hxx
+ * @brief Expressions evaluated a whole batch of rows at a time.
+ *
+ * The engine never looks at one row at a time. A batch is a handful of
+ * ColumnVector (a plain array per column) for up to a few thousand rows, and
+ * evaluating `price * 2 > 10` over it is one loop for the `*`, then one loop
+ * for the `>`, each over plain arrays, with no branch on types or operators
+ * inside: the loops are simple enough for the compiler to vectorize.
+ *
+ * Values have 4 types as far as the query is concerned (see VType), but
+ * columns are read as stored: the kernels (see kernels.hxx) exist for every
+ * combination of types, so that `qty < 7` on an Int16 column compares
+ * int16_t values directly. What an expression outputs, though, is always
+ * widened to 64 bits.
+ *
+ * NULLs are handled like in SQL: an operation on a NULL is NULL, except
+ * `IS [NOT] NULL`, and `AND`/`OR` which follow three-valued logic.
+ *
+ * A `?` is compiled with the type of the value bound to it then, but its
+ * value is only read when the expression runs (see `VectorExpr::bind`): the
+ * same compiled expression runs with any value of that type. A `?` bound to
+ * NULL is compiled as a NULL, like the keyword.
+ */
+
+#ifndef TINYDB_VECTOR_EXPR_HXX
+#define TINYDB_VECTOR_EXPR_HXX
+
+#include "ast.hxx"
+#include "kernels.hxx"
+#ifdef ENABLE_MODULES
+import tinydb.dbfile.coltype;
+import tinydb.dbfile.internal.column_vector;
+import tinydb.dbfile.internal.tbl;
+#else
+#include "dbfile/coltype.hxx"
+#include "dbfile/internal/column_vector.hxx"
+#include "dbfile/internal/tbl.hxx"
+#endif // ENABLE_MODULES
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace tinydb {
+
+enum class ExecError : uint8_t {
+    UnboundParameter = 0,
+    UnknownTable,
+    UnknownColumn,
+    TypeMismatch,
+    NotConstant,
+    Unsupported,
+    AmbiguousColumn,
+};
+
+/**
+ * @brief The value of a parameter: not bound yet, NULL, or a value. Bound
+ * strings are views, and must outlive the next `execute`.
+ */
+using ParamValue = std::variant<std::monostate, NullValue, Literal>;
+
+/**
+ * @brief The types of values while a query runs.
+ */
+enum class VType : uint8_t {
+    Bool,
+    Int,
+    Float,
+    Text,
+};
+
+/**
+ * @return How a value of type `t_type` is stored in a ColumnVector: one byte
+ * (0 or 1), int64_t, double, or the string.
+ */
+constexpr auto storage_type(VType t_type) -> dbfile::column::ColType {
+    using enum dbfile::column::ColType;
+    switch (t_type) {
+    case VType::Bool:
+        return Uint8;
+    case VType::Int:
+        return Int64;
+    case VType::Float:
+        return Float64;
+    case VType::Text:
+        return Text;
+    }
+    return Text;
+}
+
+/**
+ * @return The type a column's values have once loaded.
+ */
+constexpr auto widen(dbfile::column::ColType t_type) -> VType {
+    using enum dbfile::column::ColType;
+    switch (t_type) {
+    case Float32:
+    case Float64:
+        return VType::Float;
+    case Text:
+    case Char8:
+    case Char16:
+    case Char32:
+    case Char64:
+        return VType::Text;
+    default:
+        return VType::Int;
+    }
+}
+
+/**
+ * @class Batch
+ * @brief Some rows, one vector per column, as passed between operators.
+ *
+ * The vectors belong to whichever operator produced them, and are only valid
+ * until its next batch. A filter doesn't move rows around: it lists the rows
+ * that are still part of the batch in `sel` instead.
+ */
+struct Batch {
+    std::vector<const dbfile::internal::ColumnVector*> cols;
+    // rows in each vector, selected or not.
+    std::size_t n_rows{0};
+    // if set, only the rows in `sel` are part of the batch, in order.
+    bool selective{false};
+    std::vector<uint32_t> sel;
+
+    /**
+     * @return The number of rows actually part of the batch.
+     */
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return selective ? sel.size() : n_rows;
+    }
+};
+
+/**
+ * @class Scope
+ * @brief What names and `?` mean inside the expressions of a query. The
+ * parameters only give the `?` their types, and are only looked at while
+ * compiling.
+ *
+ * Columns are numbered in the order they're first used, whatever their
+ * table: column `i` of the scope is `cols[i]` in the batches, and position
+ * `columns()[i].pos` in table `columns()[i].tbl`. With a single table, that
+ * is position `scanned()[i]`.
+ */
+class Scope {
+  public:
+    struct Column {
+        // index of the table in the scope.
+        std::size_t tbl;
+        std::size_t pos;
+    };
+
+    /**
+     * @param t_tbl nullptr for a query without a table.
+     */
+    Scope(const dbfile::internal::TableMeta* t_tbl,
+          std::span<const ParamValue> t_params)
+        : m_params{t_params} {
+        if (t_tbl != nullptr) {
+            m_tables.push_back(t_tbl);
+        }
+    }
+
+    /**
+     * @brief A scope over several tables, joined. An unqualified name must
+     * only be a column of one of them.
+     */
+    Scope(std::vector<const dbfile::internal::TableMeta*> t_tbls,
+          std::span<const ParamValue> t_params)
+        : m_tables{std::move(t_tbls)}, m_params{t_params} {}
+
+    /**
+     * @return The table and position a name refers to, without making it a
+     * column of the scope.
+     */
+    [[nodiscard]] auto resolve(const ColumnRef& t_ref) const
+        -> std::expected<Column, ExecError>;
+
+    /**
+     * @return The position of the column in the batches, and its type.
+     */
+    auto column(const ColumnRef& t_ref)
+        -> std::expected<std::pair<std::size_t, dbfile::column::ColType>,
+                         ExecError>;
+
+    /**
+     * @brief Same, for a position inside a table.
+     */
+    auto column(std::size_t t_pos, std::size_t t_tbl = 0)
+        -> std::pair<std::size_t, dbfile::column::ColType>;
+
+    /**
+     * @return The first table, nullptr without any.
+     */
+    [[nodiscard]] auto table() const noexcept
+        -> const dbfile::internal::TableMeta* {
+        return m_tables.empty() ? nullptr : m_tables.front();
+    }
+
+    [[nodiscard]] auto tables() const noexcept
+        -> std::span<const dbfile::internal::TableMeta* const> {
+        return m_tables;
+    }
+
+    [[nodiscard]] auto params() const noexcept -> std::span<const ParamValue> {
+        return m_params;
+    }
+
+    [[nodiscard]] auto columns() const noexcept -> std::span<const Column> {
+        return m_columns;
+    }
+
+    /**
+     * @return The positions of the columns of a table, in scope order.
+     */
+    [[nodiscard]] auto scanned(std::size_t t_tbl = 0) const
+        -> std::vector<std::size_t>;
+
+  private:
+    std::vector<const dbfile::internal::TableMeta*> m_tables{};
+    std::span<const ParamValue> m_params;
+    std::vector<Column> m_columns{};
+};
+
+/**
+ * @class VectorExpr
+ * @brief A compiled expression: types are checked and names resolved once,
+ * and `eval` only runs the loops.
+ */
+class VectorExpr {
+  public:
+    /**
+     * @brief Compiles an expression. Function calls are left to the
+     * operators: they're `Unsupported` here.
+     */
+    static auto compile(const Expr& t_expr, Scope& t_scope)
+        -> std::expected<VectorExpr, ExecError>;
+
+    /**
+     * @brief The column at position `t_col` of the batches.
+     */
+    static auto column(std::size_t t_col, dbfile::column::ColType t_type)
+        -> VectorExpr;
+
+    [[nodiscard]] auto type() const noexcept -> VType { return m_type; }
+
+    /**
+     * @return Whether the expression doesn't depend on any row, like `?` or
+     * `1 + 2`.
+     */
+    [[nodiscard]] auto is_const() const -> bool;
+
+    /**
+     * @brief Gives the `?` of the expression their values, before it runs.
+     * Each must have the type it had when compiled, and not be NULL.
+     */
+    void bind(std::span<const ParamValue> t_params);
+
+    /**
+     * @brief Evaluates the expression for every row of the batch, selected
+     * or not.
+     * @return A vector of `storage_type(type())`, valid until the next call.
+     */
+    auto eval(const Batch& t_batch) -> const dbfile::internal::ColumnVector&;
+
+  private:
+    enum class Kind : uint8_t { Column, Const, Param, Unary, Binary };
+
+    VectorExpr(Kind t_kind, VType t_type)
+        : m_kind{t_kind}, m_type{t_type}, m_out{storage_type(t_type)},
+          m_const{storage_type(t_type)} {}
+
+    Kind m_kind;
+    VType m_type;
+    // Column: position in the batches, and type as stored.
+    std::size_t m_col{0};
+    dbfile::column::ColType m_src{dbfile::column::ColType::Int64};
+    UnaryOp m_unary{UnaryOp::Not};
+    // Binary: picked once, when compiled.
+    Kernel m_kernel{nullptr};
+    Shape m_shape{Shape::ColCol};
+    std::vector<VectorExpr> m_args{};
+    dbfile::internal::ColumnVector m_out;
+    // Const: the single value. Param: the same, once bound.
+    dbfile::internal::ColumnVector m_const;
+    // Param: which `?`.
+    std::size_t m_param{0};
+
+    static auto constant(const Literal& t_lit) -> VectorExpr;
+    static auto null(VType t_type) -> VectorExpr;
+    static auto param(std::size_t t_idx, const ParamValue& t_val)
+        -> std::expected<VectorExpr, ExecError>;
+    static auto unary(UnaryOp t_op, VectorExpr t_arg)
+        -> std::expected<VectorExpr, ExecError>;
+    static auto binary(BinaryOp t_op, VectorExpr t_lhs, VectorExpr t_rhs)
+        -> std::expected<VectorExpr, ExecError>;
+    /**
+     * @brief Gives an untyped NULL the type of the other side, and an
+     * integer constant next to a float the float type.
+     */
+    static void unify(VectorExpr& t_lhs, VectorExpr& t_rhs);
+    /**
+     * @brief Evaluates an expression whose operands are all constants, once
+     * and for all.
+     */
+    static auto fold(VectorExpr t_expr) -> VectorExpr;
+    [[nodiscard]] auto is_null_const() const -> bool;
+    /**
+     * @return Whether the value is known once compiled: constant, and
+     * without any `?`.
+     */
+    [[nodiscard]] auto is_fixed() const -> bool;
+    /**
+     * @return The type of the vector the kernels get: a column as stored,
+     * the single value of a constant.
+     */
+    [[nodiscard]] auto operand_type() const -> dbfile::column::ColType;
+
+    auto operand(const Batch& t_batch)
+        -> const dbfile::internal::ColumnVector&;
+    auto eval_column(const Batch& t_batch)
+        -> const dbfile::internal::ColumnVector&;
+    void eval_unary(const dbfile::internal::ColumnVector& t_arg,
+                    std::size_t t_n);
+};
+
+} // namespace tinydb
+
+#endif // !TINYDB_VECTOR_EXPR_HXX